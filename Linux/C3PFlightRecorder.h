@@ -0,0 +1,104 @@
+/*
+File:   C3PFlightRecorder.h
+Author: J. Ian Lindsay
+Date:   2026.10.16
+
+Copyright 2026 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+On-disk format of the flight recorder. This is a memory-mapped ring file that
+  holds a compact binary copy of every c3p_log() call. Because it is a shared
+  mapping, its contents survive the process, however it dies.
+
+This header has no dependencies, so that decoders can be built without the
+  rest of the platform.
+
+File layout:
+  C3PFlightHeader
+  C3PFlightTag[tag_count]         Tag strings, keyed by hash. Filled as seen.
+  C3PFlightRecord[record_count]   The ring. Each slot is record_size bytes.
+*/
+
+#ifndef __C3P_FLIGHT_RECORDER_H__
+#define __C3P_FLIGHT_RECORDER_H__
+
+#include <stdint.h>
+
+#define C3P_FLIGHT_MAGIC        0x52463343   // "C3FR", little-endian.
+#define C3P_FLIGHT_VERSION      2
+#define C3P_FLIGHT_TAG_LEN      120          // Longer tags are truncated.
+#define C3P_FLIGHT_REC_OVERHEAD 32           // Bytes of a record that precede the payload.
+
+#define C3P_FLIGHT_REC_FLAG_TRUNCATED  0x01  // The payload didn't fit.
+
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;     // Bytes per record slot. Multiple of 8.
+  uint32_t record_count;    // Slots in the ring. Power of two.
+  uint32_t tag_count;       // Slots in the tag table. Power of two.
+  uint32_t pid;
+  uint32_t reserved0;
+  uint64_t epoch_us;        // Wall-clock time (us since 1970) at which micros() read zero.
+  uint64_t w_seq;           // Count of records ever claimed. Atomic.
+  char     binary[64];      // Name of the process that wrote the file.
+  uint8_t  reserved1[24];
+} C3PFlightHeader;          // 128 bytes.
+
+
+typedef struct {
+  uint32_t hash;            // FNV-1a of the tag. Zero means the slot is empty.
+  uint32_t ready;           // Set once text is complete. The slot is claimed before that.
+  char     text[C3P_FLIGHT_TAG_LEN];
+} C3PFlightTag;             // 128 bytes.
+
+
+/*
+* A record is valid if (seq - 1) maps to the slot that holds it. The writer
+*   zeroes seq before filling the record, and stores it last. So a record
+*   being written when the process died reads as empty.
+*/
+typedef struct {
+  uint64_t seq;             // One more than the record's sequence number.
+  uint64_t timestamp;       // micros() at the time of logging.
+  uint32_t tag_hash;        // Index into the tag table.
+  uint32_t tid;             // Kernel thread ID of the logger.
+  uint16_t len;             // Bytes of payload.
+  uint8_t  severity;        // syslog-style.
+  uint8_t  flags;
+  uint32_t reserved;
+  char     payload[];       // Not terminated. Runs to the end of the slot.
+} C3PFlightRecord;
+
+
+/* FNV-1a. Never returns zero, as that marks an empty tag slot. */
+inline uint32_t c3p_flight_hash(const char* str) {
+  uint32_t h = 2166136261u;
+  if (nullptr != str) {
+    while (*str) {
+      h = (h ^ (uint8_t) *str++) * 16777619u;
+    }
+  }
+  return ((0 == h) ? 1 : h);
+}
+
+inline uint64_t c3p_flight_file_size(const C3PFlightHeader* hdr) {
+  return sizeof(C3PFlightHeader)
+    + ((uint64_t) hdr->tag_count * sizeof(C3PFlightTag))
+    + ((uint64_t) hdr->record_count * hdr->record_size);
+}
+
+#endif  // __C3P_FLIGHT_RECORDER_H__
@@ -30,11 +30,14 @@ This file forms the catch-all for linux platforms that have no support.
 #include "BusQueue/I2CAdapter.h"
 #include "CryptoBurrito/CryptoBurrito.h"
 #include "TimerTools/C3PScheduler.h"
+#include "C3PStreamCapture.h"
 
+#include <atomic>
 #include <pthread.h>
 #include <sys/signal.h>
 #include <sys/time.h>
 #include <sys/socket.h>
+#include <termios.h>
 
 #if defined(CONFIG_C3P_STORAGE)
   #include "LinuxStorage.h"
@@ -47,6 +50,97 @@ This file forms the catch-all for linux platforms that have no support.
 
 int8_t _load_config();       // Called during boot to load configuration.
 
+class ParsingConsole;
+
+/*
+* Linux-specific thread options. May be passed as the platform-specific
+*   argument to createThread(), alongside the usual PlatformThreadOpts.
+*/
+typedef struct {
+  cpu_set_t cpus;         // CPUs the thread may run on. An empty set means any.
+  int      sched_policy;  // SCHED_FIFO or SCHED_RR. Only used if priority is non-zero.
+} LinuxThreadOpts;
+
+/*
+* The scheduler is advanced by a dedicated thread that blocks on a timerfd.
+*   TICK:    The timer is periodic, and keeps its phase across late wakeups.
+*   ONESHOT: The timer is re-armed one period after each service pass, so that
+*              overruns are never made up with a burst of back-to-back ticks.
+*   TICKLESS: The timer is armed for exactly the next pending deadline, as
+*              reported by the function given to schedulerDeadlineSource().
+*/
+enum class LinuxSchedMode : uint8_t {
+  TICK     = 0,
+  ONESHOT  = 1,
+  TICKLESS = 2
+};
+
+/*
+* In TICKLESS mode, the platform asks this function how many microseconds
+*   remain until the next schedule is due. Return false if nothing is pending.
+*/
+typedef bool (*SchedDeadlineFxn)(uint32_t* due_in_us);
+
+/*
+* Where c3p_log() output ends up. Messages are written by a dedicated thread.
+*/
+enum class LinuxLogTarget : uint8_t {
+  STDOUT = 0,
+  FILE   = 1,
+  SYSLOG = 2
+};
+
+/*******************************************************************************
+* TX flow control
+* Drivers that queue output for a slower consumer hold it to a byte budget.
+*   Once the queue reaches the high watermark, pushBuffer() refuses further
+*   buffers (leaving them with the caller) until the queue drains to the low
+*   watermark. At that point, the upstream is told that it may write again.
+*******************************************************************************/
+#ifndef CONFIG_C3P_PIPE_TX_BUDGET
+  // Bytes of TX that a pipe will queue before it starts refusing buffers.
+  #define CONFIG_C3P_PIPE_TX_BUDGET  262144
+#endif
+
+/*
+* Called when a pipe that refused a buffer has drained to its low watermark.
+*   Runs on whichever thread did the draining, without the pipe's locks held,
+*   so it is safe to push from here.
+*/
+typedef void (*PipeWritableCallback)(BufferAccepter* pipe, void* arg);
+
+class LinuxFlowGate {
+  public:
+    LinuxFlowGate(uint32_t budget = CONFIG_C3P_PIPE_TX_BUDGET);
+
+    void    budget(uint32_t high_water, uint32_t low_water = 0);
+    inline uint32_t budget() {      return _high_water;   };
+    inline uint32_t queued() {      return _queued;       };
+    inline void writableCallback(PipeWritableCallback cb, void* arg) {   _cb = cb;   _cb_arg = arg;   };
+
+    /* Caller must hold the pipe's TX lock for these four. */
+    bool    admit(uint32_t len);
+    void    added(uint32_t len);
+    bool    removed(uint32_t len);
+    int32_t available();
+
+    void    notify(BufferAccepter* pipe);
+    void    reset();
+    void    printDebug(StringBuilder*);
+
+  private:
+    PipeWritableCallback _cb     = nullptr;
+    void*     _cb_arg            = nullptr;
+    uint32_t  _high_water;
+    uint32_t  _low_water;
+    uint32_t  _queued            = 0;     // Bytes accepted and not yet written.
+    uint32_t  _queued_peak       = 0;
+    uint32_t  _count_refused     = 0;     // Buffers refused for want of room.
+    uint32_t  _count_resumed     = 0;     // Times the upstream was told to resume.
+    bool      _throttled         = false; // Above the high watermark, or refused since the last resume.
+};
+
+
 /*******************************************************************************
 * The STDIO driver class
 *******************************************************************************/
@@ -56,27 +150,337 @@ class LinuxStdIO : public BufferAccepter {
     ~LinuxStdIO();
 
     /* Implementation of BufferAccepter. */
-    inline int8_t pushBuffer(StringBuilder* buf) {  _tx_buffer.concatHandoff(buf); return 1;   };
-    inline int32_t bufferAvailable() {  return 0xFFFF;   };   // TODO: Use real value.
+    int8_t  pushBuffer(StringBuilder* buf);
+    int32_t bufferAvailable();
 
     inline void readCallback(BufferAccepter* cb) {   _read_cb_obj = cb;   };
-    inline void write(const char* str) {  _tx_buffer.concat((uint8_t*) str, strlen(str));  };
+    inline void writableCallback(PipeWritableCallback cb, void* arg) {   _tx_gate.writableCallback(cb, arg);   };
+    inline void txBudget(uint32_t high, uint32_t low = 0) {   _tx_gate.budget(high, low);   };
+    void   write(const char* str);
+    void   printDebug(StringBuilder* out);
     int8_t poll();
 
   private:
-    BufferAccepter* _read_cb_obj = nullptr;
+    BufferAccepter* _read_cb_obj   = nullptr;
+    int8_t          _reactor_state = 0;   // 0: not yet tried, 1: attached, -1: using fgets().
+    bool            _stdin_eof     = false;
+    pthread_mutex_t _mutex;
+    pthread_cond_t  _cond;                // Signaled by input, and by output from other threads.
+    LinuxFlowGate   _tx_gate;             // Guarded by _mutex.
     StringBuilder   _tx_buffer;
     StringBuilder   _rx_buffer;
+    StringBuilder   _rx_pending;          // Filled by the reactor. Guarded by _mutex.
+
+    void _flush_tx();
+
+    static void _reactor_cb(int fd, uint32_t events, void* arg);
+};
+
+
+/*******************************************************************************
+* The I/O reactor
+* Drivers register their file descriptors here, and are called back on a
+*   reactor thread when the kernel says they are ready.
+*******************************************************************************/
+struct LinuxReactorSource;
+struct LinuxReactorShard;
+struct LinuxReactorFdPage;
+
+/*
+* Called on a reactor thread. events holds the EPOLL* flags that fired.
+*/
+typedef void (*ReactorCallback)(int fd, uint32_t events, void* arg);
+
+class LinuxReactor {
+  public:
+    int8_t add(int fd, uint32_t events, ReactorCallback, void* arg, int8_t shard = -1);
+    int8_t modify(int fd, uint32_t events);
+    int8_t remove(int fd);
+    int    addTimer(uint32_t period_us, ReactorCallback, void* arg, int8_t shard = -1);
+    int8_t shardOf(int fd);
+    int8_t shardStats(uint8_t shard, uint32_t* sources, uint32_t* dispatches);
+    void   printDebug(StringBuilder*);
+
+    inline uint8_t shardCount() {   return _shard_count;   };
+
+    static LinuxReactor* getInstance();
+    static void shutdown();
+
+
+  private:
+    pthread_mutex_t      _mutex;              // Serializes add(). Nothing else needs it.
+    LinuxReactorShard*   _shards      = nullptr;
+    uint8_t              _shard_count = 0;
+    LinuxReactorFdPage** _fd_pages    = nullptr;
+
+    LinuxReactor();
+    ~LinuxReactor();
+    int8_t _start();
+    int8_t _add(int fd, uint32_t events, ReactorCallback, void* arg, bool is_timer, int8_t shard);
+    LinuxReactorFdPage* _page(int fd, bool create);
+    LinuxReactorSource* _find_locked(int fd);
+
+    static void* _thread_handler(void*);
+};
+
+
+/*******************************************************************************
+* The io_uring backend
+* With CONFIG_C3P_IO_URING, sockets and files do their I/O through one shared
+*   ring, instead of being told by the reactor when they are ready. If the
+*   kernel can't do what is needed (or the ring is switched off), getInstance()
+*   returns nullptr, and drivers use the reactor as they would without it.
+*******************************************************************************/
+#if defined(CONFIG_C3P_IO_URING)
+#ifndef CONFIG_C3P_IO_URING_CHAIN
+  // Most SQEs in one linked send chain, or in one file transfer.
+  #define CONFIG_C3P_IO_URING_CHAIN  16
+#endif
+
+struct LinuxUringOp;
+struct LinuxUringRings;
+
+/*
+* Called on the ring's thread for each completion. res is the kernel's result.
+*   For receives, data points at the bytes in a provided buffer. Returning 1
+*   keeps that buffer (it is then the callback's to free()), and returning 0
+*   gives it back to the ring. more is false on the last completion of an op.
+*/
+typedef int8_t (*UringCallback)(int32_t res, uint8_t* data, bool more, void* arg);
+
+class LinuxUring {
+  public:
+    int8_t  accept(int fd, UringCallback, void* arg);
+    int8_t  recv(int fd, UringCallback, void* arg);
+    int8_t  send(int fd, struct iovec* iov, int count, UringCallback, void* arg);
+    int8_t  splice(int fd, int fd_in, int64_t off_in, int fd_out, uint32_t len, UringCallback, void* arg);
+    int32_t transfer(int fd, bool write, struct iovec* iov, int count, uint64_t offset);
+    int8_t  cancel(int fd);
+    void    hold(int fd, StringBuilder*);
+    bool    onRingThread();
+    void    printDebug(StringBuilder*);
+
+    static LinuxUring* getInstance();
+    static bool enabled();
+    static void enabled(bool);
+    static bool stopped();
+    static void shutdown();
+
+
+  private:
+    pthread_mutex_t  _mutex;              // Guards the SQ, and the op list.
+    LinuxUringRings* _rings      = nullptr;
+    LinkedList<LinuxUringOp*> _ops;
+    unsigned long    _thread_id  = 0;
+    pthread_t        _self;
+    int              _current_fd = -1;    // The fd whose callback is running, if any.
+    uint32_t         _unsubmitted = 0;    // SQEs queued by the ring thread, for its next wait.
+    uint32_t         _cancels_owed = 0;   // Cancels that found the SQ full. The ring thread retries them.
+    bool             _running    = false;
+    uint32_t         _count_enter = 0;
+    uint32_t         _count_sqe   = 0;
+    uint32_t         _count_cqe   = 0;
+    uint32_t         _count_nobufs = 0;   // Receives that found no provided buffer.
+
+    LinuxUring();
+    ~LinuxUring();
+    int8_t _start();
+    int8_t _self_test();
+    void*  _get_sqe();
+    int    _enter(uint32_t to_submit, uint32_t min_complete);
+    int8_t _submit();
+    LinuxUringOp* _op_new(int fd, UringCallback, void* arg, uint16_t sqe_count);
+    void   _queue_cancel(LinuxUringOp*);
+    void   _reap();
+    void   _recycle(uint16_t bid, bool replace);
+
+    static void* _thread_handler(void*);
+};
+#endif  // CONFIG_C3P_IO_URING
+
+
+/*******************************************************************************
+* Stream capture and replay
+* A capture records every chunk that a UART or socket moves, in both
+*   directions, with the time that it moved. A replay plays one side of a
+*   capture back into a BufferAccepter, at the recorded pace or as fast as the
+*   receiver will take it. Together, they make benchmarks repeatable.
+*******************************************************************************/
+#ifndef CONFIG_C3P_CAPTURE_BUFFER
+  // Bytes of capture held in memory between writes to the file.
+  #define CONFIG_C3P_CAPTURE_BUFFER  65536
+#endif
+
+struct iovec;
+
+/*
+* Drivers call record() from whichever thread moved the bytes, so it takes a
+*   lock. A capture must be detached from its driver (with capture(nullptr))
+*   before it is destroyed. Closing it while attached is safe: a closed
+*   capture ignores what it is given.
+*/
+class LinuxStreamCapture {
+  public:
+    LinuxStreamCapture();
+    ~LinuxStreamCapture();
+
+    int8_t open(const char* path, uint8_t kind, const char* source, uint32_t bitrate = 0);
+    int8_t close();
+    inline bool isOpen() {   return (0 <= _fd);   };
+
+    void record(uint8_t dir, const uint8_t* buf, uint32_t len);
+    void recordv(uint8_t dir, const struct iovec* iov, int iov_count, uint32_t len);
+
+    inline uint32_t records() {   return _count_records;   };
+    void printDebug(StringBuilder* out);
+
+
+  private:
+    int             _fd            = -1;
+    uint8_t*        _buf           = nullptr;   // Records not yet written to the file.
+    uint32_t        _buf_len       = 0;
+    uint64_t        _last_us       = 0;         // CLOCK_MONOTONIC of the last record.
+    uint32_t        _count_records = 0;
+    uint64_t        _count_rx      = 0;
+    uint64_t        _count_tx      = 0;
+    uint64_t        _count_file    = 0;         // Bytes written to the file, headers included.
+    uint32_t        _count_errors  = 0;         // Writes to the file that failed.
+    char*           _path          = nullptr;
+    pthread_mutex_t _mutex;
+
+    void _begin(uint8_t dir, uint32_t len);
+    void _append(const uint8_t* buf, uint32_t len);
+    void _flush();
+};
+
+
+/*
+* Plays back the chunks of a capture that went one way (RX, by default) on
+*   its own thread. Whatever is pushed into it (the receiver's replies) is
+*   counted and dropped, so that it can stand in for a driver.
+*/
+class LinuxStreamReplay : public BufferAccepter {
+  public:
+    LinuxStreamReplay();
+    ~LinuxStreamReplay();
+
+    /* Implementation of BufferAccepter. */
+    int8_t  pushBuffer(StringBuilder* buf);
+    int32_t bufferAvailable();
+
+    inline void readCallback(BufferAccepter* cb) {   _read_cb_obj = cb;   };
+
+    /*
+    * By default, the replay's thread calls the receiver. A receiver that is
+    *   serviced by another thread (a main loop, say) should set this, and
+    *   call poll() from that thread. The replay then only queues each chunk
+    *   when it is due, and poll() hands over what is queued.
+    */
+    inline void deliverByPoll(bool x) {   _by_poll = x;   };
+    int8_t poll();
+
+    int8_t open(const char* path);
+    int8_t close();
+    int8_t start(uint16_t speed_pct = 100, uint8_t dir = C3P_CAPTURE_DIR_RX);   // A speed of 0 is as fast as possible.
+    void   stop();
+    inline bool running() {    return _running;    };
+    inline bool finished() {   return _finished;   };   // The last run reached the end of the capture.
+    inline const C3PCaptureHeader* header() {   return (const C3PCaptureHeader*) _map;   };
+
+    inline uint32_t chunks() {      return _count_chunks;   };
+    inline uint64_t bytes() {       return _count_bytes;    };
+    inline uint64_t elapsedUs() {   return _elapsed_us;     };
+    void printDebug(StringBuilder* out);
+
+
+  private:
+    BufferAccepter* _read_cb_obj   = nullptr;
+    uint8_t*        _map           = nullptr;   // The whole capture, mapped read-only.
+    size_t          _map_len       = 0;
+    char*           _path          = nullptr;
+    unsigned long   _thread_id     = 0;
+    uint16_t        _speed_pct     = 100;
+    uint8_t         _dir           = C3P_CAPTURE_DIR_RX;
+    bool            _running       = false;
+    bool            _finished      = false;
+    bool            _by_poll       = false;
+    pthread_mutex_t _mutex;                     // Guards the queue, and the wait.
+    pthread_cond_t  _cond;                      // Wakes the thread for stop(), and when the queue drains.
+    StringBuilder   _pending;                   // Chunks that are due, waiting for poll().
+    uint32_t        _count_chunks  = 0;         // Chunks the receiver took.
+    uint64_t        _count_bytes   = 0;
+    uint32_t        _count_stalls  = 0;         // Times the receiver refused a chunk.
+    uint32_t        _count_pushed  = 0;         // Bytes pushed into us.
+    uint64_t        _elapsed_us    = 0;         // From start to the last chunk taken.
+    uint64_t        _capture_us    = 0;         // Time the played chunks spanned in the capture.
+    uint32_t        _lag_max_us    = 0;         // Furthest behind schedule that a chunk went out.
+
+    int8_t _play();
+    bool   _wait_until(uint64_t due_us);
+    int8_t _deliver(StringBuilder* chunk);
+    static void* _thread_handler(void*);
 };
 
 
 /*******************************************************************************
 * Socket driver class
 *******************************************************************************/
+#ifndef CONFIG_C3P_SOCKET_BACKLOG
+  // Pending connections the kernel will queue for a listener. Clamped by
+  //   /proc/sys/net/core/somaxconn.
+  #define CONFIG_C3P_SOCKET_BACKLOG  512
+#endif
+
 class LinuxSockPipe;
 class LinuxSockListener;
+class C3PFile;
+struct LinuxSockShard;
+struct LinuxSockFileTX;
+
+/*
+* Reports on a file given to LinuxSockPipe::sendFile(). Called as its bytes go
+*   out, and once more when it is finished. err is 0 until then, and on
+*   success. Otherwise it is a negative errno, and the rest of the file was not
+*   sent. Called without the pipe's locks held.
+*/
+typedef void (*SendFileCallback)(LinuxSockPipe*, uint64_t sent, uint64_t total, int err, void* arg);
+
+/*
+* Called with each new connection. Return 1 to keep the pipe, or anything else
+*   to have it closed. A sharded listener calls this on each shard's thread, so
+*   it may run concurrently with itself.
+*/
 typedef int8_t (*NewSocketCallback)(LinuxSockListener*, LinuxSockPipe*);
 
+/*
+* How a socket path is reached. "unix:<path>" is always a unix socket. A
+*   "host:port" with no '/' and a numeric port is TCP. Anything else is a path
+*   in the filesystem, which a listener binds as a unix socket, and a pipe
+*   connects to as a unix socket if it is one (or opens as a file if not).
+*/
+enum class LinuxSockTransport : uint8_t {
+  FILE = 0,
+  UNIX = 1,
+  TCP  = 2
+};
+
+LinuxSockTransport c3p_sock_transport(const char* path, const char** addr);
+int8_t c3p_sock_split_host(const char* addr, char* host, int host_len, const char** port);
+
+/*
+* Per-pipe socket options. A value given to LinuxSockPipe::sockOpt() is
+*   applied at once if the socket is open, and again at every later connect().
+*/
+enum class LinuxSockOpt : uint8_t {
+  NODELAY      = 0,   // TCP. 1 turns off Nagle's algorithm.
+  CORK         = 1,   // TCP. 1 holds back partial segments. Setting 0 sends them.
+  SNDBUF       = 2,   // Bytes. The kernel doubles what it is given.
+  RCVBUF       = 3,   // Bytes. The kernel doubles what it is given.
+  KEEPALIVE    = 4,   // TCP. Seconds idle before (and between) probes. 0 is off.
+  USER_TIMEOUT = 5,   // TCP. Milliseconds that sent data may go unacked. 0 is the default.
+  INVALID      = 6    // Not an option. Marks the end of the list.
+};
+
 
 class LinuxSockListener {
   public:
@@ -92,45 +496,87 @@ class LinuxSockListener {
     int    listen(char* path = nullptr);  // Open a listening socket.
     int8_t close();   // Close the listener, if it is open.
 
+    inline int  backlog() {          return _backlog;   };
+    inline void backlog(int x) {     _backlog = x;      };   // Takes effect on the next listen().
+    inline bool isTCP() {            return _is_tcp;    };
+    inline uint8_t shards() {        return _shards_wanted;   };
+    inline void shards(uint8_t x) {  _shards_wanted = x;      };   // TCP only. 0 is one per reactor thread. Takes effect on the next listen().
+
     /* Built-in per-instance console handler. */
     int8_t console_handler(StringBuilder* text_return, StringBuilder* args);
 
 
   private:
-    int             _sock_id     = 0;
+    LinuxSockShard* _shards      = nullptr;   // One per listening socket. Each keeps its own counts.
+    uint8_t         _shard_count = 0;
+    uint8_t         _shards_wanted = 1;
+    int             _backlog     = CONFIG_C3P_SOCKET_BACKLOG;
     char*           _sock_path   = nullptr;
-    unsigned long   _thread_id   = 0;
     NewSocketCallback _new_cb   = nullptr;
-
-    int8_t _set_sock_path(char*);
+    bool            _is_tcp      = false;
+    uint32_t        _count_accepted = 0;   // Connections accepted by shards since closed.
+    uint32_t        _count_refused  = 0;   // Connections refused by shards since closed.
+    uint32_t        _rate_peak      = 0;   // Most accepts seen by any closed shard in one second.
+
+    int8_t  _set_sock_path(char*);
+    uint8_t _open_shards(const char* addr, uint8_t count);
+    int8_t  _reactor_attach(LinuxSockShard*);
+    void    _reactor_detach();
+    int     _open_unix(const char*);
+    int     _open_tcp(const char*, bool reuse_port);
+    int8_t  _poll_shard(LinuxSockShard*);
+    void    _note_accept(LinuxSockShard*);
+    void    _accepted(LinuxSockShard*, int sock, struct sockaddr* addr, socklen_t addr_len);
+
+    static void _reactor_cb(int fd, uint32_t events, void* arg);
+    #if defined(CONFIG_C3P_IO_URING)
+      LinuxUring*   _ring = nullptr;    // Set if the ring accepts for us, rather than the reactor.
+      static int8_t _uring_accept_cb(int32_t res, uint8_t* data, bool more, void* arg);
+    #endif
 };
 
 
 class LinuxSockPipe : public BufferAccepter {
   public:
-    LinuxSockPipe(char* path, int sock_id);
+    LinuxSockPipe(char* path, int sock_id, int8_t reactor_shard = -1);
     LinuxSockPipe(char* path);
     LinuxSockPipe() : LinuxSockPipe(nullptr) {};
     virtual ~LinuxSockPipe();
 
     /* Implementation of BufferAccepter. */
-    inline int8_t pushBuffer(StringBuilder* buf) {  _tx_buffer.concatHandoff(buf); return 1;   };
-    inline int32_t bufferAvailable() {  return 0xFFFF;   };   // TODO: Use real value.
+    int8_t  pushBuffer(StringBuilder* buf);
+    int32_t bufferAvailable();
 
     inline void readCallback(BufferAccepter* cb) {   _read_cb_obj = cb;   };
+    inline void writableCallback(PipeWritableCallback cb, void* arg) {   _tx_gate.writableCallback(cb, arg);   };
+    inline void txBudget(uint32_t high, uint32_t low = 0) {   _tx_gate.budget(high, low);   };
     int8_t poll();
     void   printDebug(StringBuilder* out);
+    static void rxPoolStats(uint32_t* hits, uint32_t* misses);   // Shared by all pipes.
 
-    inline void write(const char* str) {  _tx_buffer.concat((uint8_t*) str, strlen(str));  };
+    void     write(const char* str);
     uint32_t read(StringBuilder* buf);
     uint32_t read(uint8_t* buf, uint32_t len);
     uint32_t write(char c);
     uint32_t write(uint8_t* buf, uint32_t len);
+    int8_t   sendFile(C3PFile*, uint64_t offset = 0, uint64_t len = 0, SendFileCallback cb = nullptr, void* cb_arg = nullptr);
 
     int    connected();  // Returns the number of connections, or -1 if not connected.
     int    connect(char* path = nullptr);  // Open an existing socket.
     int8_t close();   // Close the socket, if it is open.
-    inline bool   flushed() {   return _tx_buffer.isEmpty();   };
+    int    detach();  // Give up the socket without closing it.
+    inline bool   flushed() {      return (_tx_buffer.isEmpty() && (0 == _tx_files.size()));   };
+    inline bool   connecting() {   return _connecting;            };
+    inline LinuxSockTransport transport() {   return _transport;   };
+    inline uint32_t bytesSent() {       return _count_tx;           };
+    inline uint32_t bytesReceived() {   return _count_rx;           };
+    inline uint32_t txQueued() {        return _tx_gate.queued();   };   // Bytes accepted and not yet written.
+    inline uint32_t txBudget() {        return _tx_gate.budget();   };
+    inline uint32_t lastRX() {          return _last_rx_ms;         };
+    inline void capture(LinuxStreamCapture* x) {   _capture = x;   };   // Bytes given to sendFile() are not recorded.
+
+    int8_t sockOpt(LinuxSockOpt, int value);
+    int    sockOpt(LinuxSockOpt);
 
     /* Built-in per-instance console handler. */
     int8_t console_handler(StringBuilder* text_return, StringBuilder* args);
@@ -138,17 +584,138 @@ class LinuxSockPipe : public BufferAccepter {
 
   private:
     BufferAccepter* _read_cb_obj = nullptr;
+    LinuxStreamCapture* _capture = nullptr;
     uint32_t        _flags       = 0;
     uint32_t        _last_rx_ms  = 0;
     uint32_t        _count_tx    = 0;
     uint32_t        _count_rx    = 0;
     int             _sock_id     = 0;
+    int             _tx_frag_off = 0;       // Bytes of the first TX fragment already sent.
     char*           _sock_path   = nullptr;
+    int             _opts[(int) LinuxSockOpt::INVALID];   // -1 means "leave it alone".
+    LinuxSockTransport _transport = LinuxSockTransport::FILE;
+    bool            _connecting  = false;   // A non-blocking connect() is in flight.
+    bool            _tx_armed    = false;   // Reactor is watching for writability.
+    bool            _reactor_attached = false;   // The reactor services the socket. poll() stands aside.
+    int8_t          _shard       = -1;      // Reactor thread to attach to. -1 lets the reactor pick.
+    pthread_mutex_t _tx_mutex;              // Guards the TX members above and below.
+    pthread_mutex_t _close_mutex;           // Only one thread closes at a time.
+    LinuxFlowGate   _tx_gate;
     StringBuilder   _tx_buffer;
     StringBuilder   _rx_buffer;
+    LinkedList<LinuxSockFileTX*> _tx_files;   // Files to send, in order with _tx_buffer.
 
     int8_t _open();
+    int    _connect_unix(const char*);
+    int    _connect_tcp(const char*);
+    int8_t _connect_finish();
+    int8_t _apply_opt(LinuxSockOpt, int);
     int8_t _set_sock_path(char*);
+    int8_t _reactor_attach();
+    void   _arm_tx();
+    void   _tx_consume(int);
+    void   _tx_capture(int);
+    void   _tx_compact_head();
+    int    _tx_flush();
+    int    _tx_file(LinuxSockFileTX*);
+    void   _tx_files_drop(int err);
+    int    _rx_drain();
+    int8_t _close();
+    void   _hangup();
+    void   _reactor_detach();
+
+    static void _reactor_cb(int fd, uint32_t events, void* arg);
+    #if defined(CONFIG_C3P_IO_URING)
+      LinuxUring*   _ring        = nullptr;   // Set if the ring does our I/O, rather than the reactor.
+      uint16_t      _tx_inflight = 0;         // Sends in the chain that the kernel has.
+      bool          _tx_failed   = false;     // The socket refused a send. Don't try again.
+      int8_t _uring_attach();
+      void   _uring_tx();
+      static int8_t _uring_rx_cb(int32_t res, uint8_t* data, bool more, void* arg);
+      static int8_t _uring_tx_cb(int32_t res, uint8_t* data, bool more, void* arg);
+      void   _uring_file_tx(LinuxSockFileTX*);
+      static int8_t _uring_file_cb(int32_t res, uint8_t* data, bool more, void* arg);
+    #endif
+};
+
+
+/*******************************************************************************
+* Shared-memory pipe
+* A byte ring in each direction, in a memfd shared by two processes on the same
+*   host. The memfd is passed over an AF_UNIX socket, which is kept afterward
+*   only so that a dead peer can be noticed. Data moves with no syscalls unless
+*   the far side is asleep, in which case it is woken with a futex.
+*******************************************************************************/
+#ifndef CONFIG_C3P_SHM_RING_SIZE
+  // Bytes of ring in each direction. Must be a power of two.
+  #define CONFIG_C3P_SHM_RING_SIZE  1048576
+#endif
+
+struct C3PShmRegion;
+
+class LinuxShmPipe : public BufferAccepter {
+  public:
+    LinuxShmPipe();
+    ~LinuxShmPipe();
+
+    /* Implementation of BufferAccepter. */
+    int8_t  pushBuffer(StringBuilder* buf);
+    int32_t bufferAvailable();
+
+    inline void readCallback(BufferAccepter* cb) {   _read_cb_obj = cb;   };
+    inline void writableCallback(PipeWritableCallback cb, void* arg) {   _tx_gate.writableCallback(cb, arg);   };
+    inline void txBudget(uint32_t high, uint32_t low = 0) {   _tx_gate.budget(high, low);   };
+    int8_t poll();
+    void   printDebug(StringBuilder* out);
+    void   rxResume();   // Tells the pipe that the read callback has room again.
+
+    int8_t offer(int sock);       // Makes the rings, and sends them over a connected AF_UNIX socket.
+    int8_t join(int sock);        // Receives the rings that the peer offered over sock.
+    int    connect(char* path);   // Connects to a unix socket, and joins.
+    int    connected();  // Returns the number of connections, or -1 if not connected.
+    int8_t close();
+    inline bool flushed() {   return _tx_buffer.isEmpty();   };
+
+    /* Built-in per-instance console handler. */
+    int8_t console_handler(StringBuilder* text_return, StringBuilder* args);
+
+
+  private:
+    BufferAccepter* _read_cb_obj  = nullptr;
+    C3PShmRegion*   _region       = nullptr;
+    size_t          _region_len   = 0;
+    uint32_t        _ring_size    = 0;       // Fixed at offer() or join(). The region's copy is not trusted.
+    int             _ctl_sock     = -1;      // The setup socket. Hangs up when the peer dies.
+    int             _tx_frag_off  = 0;       // Bytes of the first TX fragment already in the ring.
+    unsigned long   _thread_id    = 0;
+    uint8_t         _side         = 0;       // 0 for the side that offered, 1 for the side that joined.
+    bool            _running      = false;
+    bool            _rx_held      = false;   // The read callback had no room, so RX was left in the ring.
+    bool            _exit_release = false;   // Closed from our own thread, which lets go of the region as it leaves.
+    std::atomic<bool> _peer_gone{false};
+    uint32_t        _count_tx     = 0;
+    uint32_t        _count_rx     = 0;
+    uint32_t        _count_rx_held = 0;      // Times RX was held back for the read callback.
+    uint32_t        _count_wakes  = 0;       // Times we had to wake the peer.
+    uint32_t        _count_sleeps = 0;       // Times our thread went to sleep.
+    pthread_mutex_t _tx_mutex;               // Guards the ring we write, and the TX members.
+    pthread_mutex_t _rx_mutex;               // Guards the ring we read, and the RX buffer.
+    pthread_mutex_t _close_mutex;            // Only one thread closes at a time.
+    LinuxFlowGate   _tx_gate;                // Counts what didn't fit in the ring.
+    StringBuilder   _tx_buffer;
+    StringBuilder   _rx_buffer;
+
+    int8_t _map(int memfd, size_t len);
+    int8_t _start();
+    int    _tx_flush(bool* resume);
+    int    _rx_drain();
+    int8_t _close(bool from_our_thread);
+    void   _release();
+    bool   _idle();
+    void   _kick();
+    void   _peer_fault(const char* where);
+
+    static void* _thread_handler(void*);
 };
 
 
@@ -163,12 +730,66 @@ class LinuxUART : public UARTAdapter {
     void irq_handler();
     char* path();
 
+    /* Override from BufferAccepter, so that TX can arm the reactor. */
+    int8_t pushBuffer(StringBuilder*);
+
+    void printDebug(StringBuilder*);
+    inline uint32_t bitrateActual() {   return _bitrate_actual;   };   // As read back from the kernel.
+    inline void capture(LinuxStreamCapture* x) {   _capture = x;   };   // Records what the port moves.
+
+    /*
+    * Idle-gap framing. When the gap is non-zero, RX is handed downstream one
+    *   frame per pushBuffer(), where a frame ends once the line has been idle
+    *   for that many character-times. Zero (the default) passes RX through
+    *   as it arrives. Can be changed while the port is open.
+    */
+    inline uint8_t  rxFrameGap() {            return _frame_gap;     };
+    void            rxFrameGap(uint8_t);
+    inline uint64_t frameStart() {            return _ready_first;   };   // CLOCK_MONOTONIC us of the frame's first chunk.
+    inline uint64_t frameEnd() {              return _ready_last;    };   // CLOCK_MONOTONIC us of the frame's last chunk.
+    inline uint64_t lastChunk() {             return _frame_last;    };   // CLOCK_MONOTONIC us of the latest RX chunk, when framing.
+
 
   protected:
     /* Obligatory overrides from UARTAdapter */
     int8_t _pf_init();
     int8_t _pf_poll();
     int8_t _pf_deinit();
+
+
+  private:
+    char*           _path     = nullptr;  // This tracks the device under Linux.
+    int             _sock     = -1;       // This tracks the open port under Linux.
+    int             _timer    = -1;       // One-shot timer for work that readiness can't announce.
+    LinuxStreamCapture* _capture = nullptr;
+    uint32_t        _timer_at = 0;        // micros() when the timer will fire, or 0 if disarmed.
+    uint32_t        _events   = 0;        // The EPOLL* flags the reactor is watching for.
+    uint32_t        _bitrate_actual = 0;  // The line rate the kernel reports, or 0 if closed.
+    bool            _bitrate_other  = false;  // Was the rate set through termios2?
+    pthread_mutex_t _io_mutex;            // Orders interest changes between pushBuffer() and the reactor.
+    struct termios  _termAttr;            // This tracks the port settings under Linux.
+    uint8_t         _frame_gap   = 0;     // Character-times of idle that end a frame. 0 is no framing.
+    uint32_t        _frame_gap_us = 0;    // The same, in microseconds at the applied rate.
+    uint32_t        _frames_rx   = 0;     // Frames the application has taken.
+    uint64_t        _frame_first = 0;     // Timestamps of the frame being received...
+    uint64_t        _frame_last  = 0;
+    uint64_t        _ready_first = 0;     // ...and of the frame waiting for the application.
+    uint64_t        _ready_last  = 0;
+    StringBuilder   _rx_frame;            // The frame being received.
+    StringBuilder   _rx_ready;            // A finished frame the application hasn't taken yet.
+
+    void _set_interest(uint32_t events);
+    void _arm_timer(uint32_t delay_us);
+    uint32_t _char_bits();
+    uint32_t _frame_gap_to_us(uint8_t gap);
+    bool     _framing();
+    int8_t   _apply_bitrate(bool standard);
+    int8_t   _poll_rx_framed(uint32_t* wait_us);
+    int8_t   _close_frame();
+    int8_t   _deliver_frame();
+    void _close_port();
+
+    static void _reactor_cb(int fd, uint32_t events, void* arg);
 };
 
 
@@ -177,10 +798,67 @@ class LinuxI2C : public I2CAdapter {
     LinuxI2C(char* path, const I2CAdapterOptions*);
     ~LinuxI2C();
 
+    int8_t queue_io_job(BusOp*);   // Wakes the I2C thread.
     bool switch_device(uint8_t nu_addr);
 };
 
 
+/*******************************************************************************
+* Latency histograms
+* Log-linear (HDR-style) histograms of how long hot paths take. With
+*   CONFIG_C3P_PERF_HISTOGRAMS undefined, the macros below compile to nothing.
+*
+* Usage, at file scope:     C3P_PERF_HISTOGRAM(_perf_foo, "Foo::poll");
+*   and in the hot path:    C3P_PERF_SCOPE(_perf_foo);
+*******************************************************************************/
+#if defined(CONFIG_C3P_PERF_HISTOGRAMS)
+  #define C3P_PERF_SUB_BITS      5     // 32 sub-buckets per power of two, or ~3% error.
+  #define C3P_PERF_SUB_COUNT     (1 << C3P_PERF_SUB_BITS)
+  #define C3P_PERF_MAX_MSB       40    // Values at or above 2^41 ns (~36 minutes) are clamped.
+  #define C3P_PERF_BUCKETS       (C3P_PERF_SUB_COUNT * (C3P_PERF_MAX_MSB - C3P_PERF_SUB_BITS + 2))
+
+class LinuxPerfHistogram {
+  public:
+    LinuxPerfHistogram(const char* name);
+
+    void     record(uint64_t ns);
+    void     reset();
+    uint64_t percentile(double pct);
+    void     printDebug(StringBuilder*);
+
+    static void printAll(StringBuilder*);
+    static void resetAll();
+
+
+  private:
+    const char*         _name;
+    LinuxPerfHistogram* _next;         // All instances form a list, built at static init.
+    uint64_t            _reset_ns;     // CLOCK_MONOTONIC at the last reset.
+    uint64_t            _sum_ns;
+    uint64_t            _max_ns;
+    uint32_t            _count;
+    uint32_t            _buckets[C3P_PERF_BUCKETS];
+};
+
+/* Records the lifetime of the scope into the given histogram. */
+class LinuxPerfScope {
+  public:
+    LinuxPerfScope(LinuxPerfHistogram* h);
+    ~LinuxPerfScope();
+
+  private:
+    LinuxPerfHistogram* _hist;
+    uint64_t            _start_ns;
+};
+
+  #define C3P_PERF_HISTOGRAM(var, name)  static LinuxPerfHistogram var(name)
+  #define C3P_PERF_SCOPE(var)            LinuxPerfScope var##_scope(&var)
+#else
+  #define C3P_PERF_HISTOGRAM(var, name)
+  #define C3P_PERF_SCOPE(var)
+#endif  // CONFIG_C3P_PERF_HISTOGRAMS
+
+
 /*******************************************************************************
 * Platform object
 *******************************************************************************/
@@ -195,19 +873,51 @@ class LinuxPlatform : public AbstractPlatform {
     void firmware_shutdown(uint8_t);
     int8_t init();
     void printDebug(StringBuilder* out);
+    int  shutdownRequested();   // The signal (SIGINT or SIGTERM) that asked us to stop, or 0.
 
     /* Threading */
     int createThread(unsigned long*, void*, ThreadFxnPtr, void*, PlatformThreadOpts*);
     int deleteThread(unsigned long*);
     int wakeThread(unsigned long);
+    int8_t threadAffinity(const char* name, const cpu_set_t* cpus);
+    void   printThreads(StringBuilder*);
 
     inline int  yieldThread() {    return sched_yield();     };
-    inline void suspendThread() {  sleep_ms(100);            };   // TODO
+    void suspendThread();
+    void suspendThread(uint32_t timeout_ms);
+
+    /* Console integration */
+    int8_t configureConsole(ParsingConsole*);
+
+    /* Scheduler timer */
+    LinuxSchedMode schedulerMode();
+    int8_t schedulerMode(LinuxSchedMode);
+    void   schedulerDeadlineSource(SchedDeadlineFxn);
+    void   kickScheduler();
+    int8_t addSchedule(C3PSchedule*);
+    void   printSchedulerJitter(StringBuilder*);
+    void   resetSchedulerJitter();
+    void   benchmarkScheduler(StringBuilder*, uint32_t seconds);
+
+    /* Logging */
+    LinuxLogTarget logTarget();
+    int8_t  logTarget(LinuxLogTarget, const char* path = nullptr);
+    uint8_t logVerbosity();
+    void    logVerbosity(uint8_t);
+    int8_t  flushLog(uint32_t timeout_ms = 1000);
+    void    printLogStats(StringBuilder*);
+
+    #if defined(__HAS_CRYPT_WRAPPER)
+      /* Cryptographic processing */
+      int8_t queueCryptoJob(CryptOp*);   // Queues the job, and wakes the crypto thread.
+    #endif
 
 
   private:
     void   _close_open_threads();
     void   _init_rng();
+    int8_t _init_scheduler_thread();
+    int8_t _init_log_thread();
     #if defined(__HAS_CRYPT_WRAPPER)
       // Additional ratchet-straps (if we were built with CryptoBurrito).
       int8_t internal_integrity_check(uint8_t* test_buf, int test_len);
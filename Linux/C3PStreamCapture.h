@@ -0,0 +1,99 @@
+/*
+File:   C3PStreamCapture.h
+Author: J. Ian Lindsay
+Date:   2026.10.17
+
+Copyright 2026 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+On-disk format of a stream capture. This is an append-only file that holds
+  every chunk a UART or socket moved, in either direction, with the time it
+  moved. LinuxStreamCapture writes it, and LinuxStreamReplay plays it back.
+
+This header has no dependencies, so that other tools can read captures
+  without the rest of the platform.
+
+File layout:
+  C3PCaptureHeader
+  Records, back to back, until the end of the file:
+    varint   delta_us     Microseconds since the previous record (or start_us).
+    varint   len_dir      (length << 1) | direction
+    uint8_t  payload[length]
+
+Varints are LEB128: seven bits per byte, least significant first, with the
+  high bit set on every byte but the last. A record that is cut short by the
+  end of the file was being written when the capture stopped, and is ignored.
+*/
+
+#ifndef __C3P_STREAM_CAPTURE_H__
+#define __C3P_STREAM_CAPTURE_H__
+
+#include <stdint.h>
+
+#define C3P_CAPTURE_MAGIC       0x50433343   // "C3CP", little-endian.
+#define C3P_CAPTURE_VERSION     1
+#define C3P_CAPTURE_SOURCE_LEN  48           // Longer sources are truncated.
+#define C3P_CAPTURE_VARINT_MAX  10           // Bytes in the longest varint.
+
+#define C3P_CAPTURE_DIR_RX      0x00         // Bytes the stream received.
+#define C3P_CAPTURE_DIR_TX      0x01         // Bytes the stream sent.
+
+#define C3P_CAPTURE_KIND_OTHER  0x00
+#define C3P_CAPTURE_KIND_UART   0x01
+#define C3P_CAPTURE_KIND_SOCKET 0x02
+
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;     // Bytes that precede the first record.
+  uint64_t epoch_us;        // Wall-clock time (us since 1970) at start_us.
+  uint64_t start_us;        // CLOCK_MONOTONIC (us) when the capture was opened.
+  uint32_t bitrate;         // Line rate of a UART, or 0.
+  uint8_t  kind;            // C3P_CAPTURE_KIND_*
+  uint8_t  reserved[3];
+  char     source[C3P_CAPTURE_SOURCE_LEN];   // Path or address. Terminated.
+} C3PCaptureHeader;         // 80 bytes.
+
+
+/* Writes a varint. Returns the number of bytes written. */
+inline uint32_t c3p_capture_put_varint(uint8_t* buf, uint64_t val) {
+  uint32_t i = 0;
+  while (val >= 0x80) {
+    buf[i++] = (uint8_t) (val | 0x80);
+    val >>= 7;
+  }
+  buf[i++] = (uint8_t) val;
+  return i;
+}
+
+
+/*
+* Reads a varint from no more than len bytes. Returns the number of bytes
+*   consumed, or 0 if the varint runs past len (or is too long to be valid).
+*/
+inline uint32_t c3p_capture_get_varint(const uint8_t* buf, uint64_t len, uint64_t* val) {
+  uint64_t ret = 0;
+  for (uint32_t i = 0; (i < len) && (i < C3P_CAPTURE_VARINT_MAX); i++) {
+    ret |= ((uint64_t) (buf[i] & 0x7F)) << (7 * i);
+    if (0 == (buf[i] & 0x80)) {
+      *val = ret;
+      return (i + 1);
+    }
+  }
+  return 0;
+}
+
+#endif  // __C3P_STREAM_CAPTURE_H__
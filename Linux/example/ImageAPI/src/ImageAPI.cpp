@@ -101,7 +101,7 @@ int main(int argc, const char *argv[]) {
         console_adapter.poll();
 
         scheduler->serviceSchedules();
-      } while (continue_running);   // GUI thread handles the heavy-lifting.
+      } while (continue_running && (0 == platform.shutdownRequested()));   // GUI thread handles the heavy-lifting.
     }
     else {
       c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to create the root GUI window (not great, not terrible).");
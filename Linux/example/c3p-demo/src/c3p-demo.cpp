@@ -21,8 +21,10 @@ CryptoLogShunt crypto_logger;
 const char*   program_name;
 bool          continue_running  = true;
 
-uint32_t ping_req_time = 0;
-uint32_t ping_nonce    = 0;
+/* Messages arrive on session workers as well as the main thread. */
+pthread_mutex_t ping_mutex = PTHREAD_MUTEX_INITIALIZER;
+uint32_t ping_req_time = 0;   // Guarded by ping_mutex.
+uint32_t ping_nonce    = 0;   // Guarded by ping_mutex.
 
 M2MLinkOpts link_opts(
   100,   // ACK timeout is 100ms.
@@ -58,19 +60,48 @@ ParsingConsole console(U_INPUT_BUFF_SIZE);
 LinuxStdIO console_adapter;
 LinuxSockPipe socket_adapter;
 
+/* Recordings of the UART and socket_adapter, and a player for them. */
+LinuxStreamCapture uart_capture;
+LinuxStreamCapture socket_capture;
+LinuxStreamReplay  replayer;
+
 C3PLogger c3p_log_obj(0, &console_adapter);
 
 
-LinkedList<LinkSockPair*> active_links;
+/* Sessions that arrive by way of socket_listener. */
+LinkSessionManager link_sessions(LINK_SESSION_MAX);
+
+/* Main-loop latency, for the `perf` console command. */
+C3P_PERF_HISTOGRAM(_perf_link_poll, "M2MLink::poll");
+C3P_PERF_HISTOGRAM(_perf_service_schedules, "C3PScheduler::serviceSchedules");
 
+void link_callback_state(M2MLink* cb_link);
+void link_callback_message(uint32_t session_tag, M2MMsg* msg);
+
+/*
+* Called on a reactor thread, and possibly on several at once.
+*/
 int8_t new_socket_connection_callback(LinuxSockListener* svr, LinuxSockPipe* pipe) {
   int8_t ret = 0;   // We should reject by default.
-  c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, "New socket connection.");
+  if (link_sessions.full()) {
+    c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Refusing socket connection. At the cap of %u sessions.", link_sessions.maxSessions());
+    return ret;
+  }
   M2MLink* new_link = new M2MLink(&link_opts);
   if (nullptr != new_link) {
-    active_links.insert(new LinkSockPair(pipe, new_link));
-    m_link = new_link;
-    ret = 1;   // Accept connection.
+    new_link->setCallback(link_callback_state);
+    new_link->setCallback(link_callback_message);
+    new_link->localIdentity(&hub.ident_program);
+    if (LinuxSockTransport::TCP == pipe->transport()) {
+      pipe->sockOpt(LinuxSockOpt::NODELAY, 1);   // Don't hold back ACKs and KAs.
+    }
+    if (0 == link_sessions.addSession(pipe, new_link)) {
+      c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, "New socket session (0x%x).", new_link->linkTag());
+      ret = 1;   // Accept connection.
+    }
+    else {
+      delete new_link;   // Lost a race for the last slot.
+    }
   }
   return ret;
 }
@@ -98,6 +129,7 @@ void link_callback_message(uint32_t session_tag, M2MMsg* msg) {
         //dump_msg_debug = false;
         // Counterparty may have replied to our ping. If not, reply logic will
         //   handle the response.
+        pthread_mutex_lock(&ping_mutex);
         if (ping_nonce) {
           if (ping_nonce == msg->uniqueId()) {
             log.concatf("\tPing returned in %ums.\n", micros_since(ping_req_time));
@@ -105,6 +137,7 @@ void link_callback_message(uint32_t session_tag, M2MMsg* msg) {
             ping_nonce    = 0;
           }
         }
+        pthread_mutex_unlock(&ping_mutex);
       }
       else if (0 == strcmp("IMG_CAST", fxn_name)) {
         // Counterparty is sending us an image.
@@ -188,7 +221,7 @@ int callback_crypt_tools(StringBuilder* text_return, StringBuilder* args) {
       rng_op->setResBuffer(buf, depth);
       rng_op->freeResBuffer(true);
       rng_op->reapJob(true);
-      text_return->concatf("queue_job() returned %d\n", platformObj()->crypto->queue_job(rng_op));
+      text_return->concatf("queueCryptoJob() returned %d\n", platform.queueCryptoJob(rng_op));
     }
   }
 
@@ -253,15 +286,32 @@ int callback_uart_tools(StringBuilder* text_return, StringBuilder* args) {
     }
     else text_return->concat("Program currently only allows one UART at a time.\n");
   }
+  else if (0 == StringBuilder::strcasecmp(cmd, "capture")) {
+    if (nullptr != hub.uart) {
+      if (2 == args->count()) {
+        char* path = args->position_trimmed(1);
+        if (0 == StringBuilder::strcasecmp(path, "stop")) {
+          hub.uart->capture(nullptr);
+          uart_capture.close();
+        }
+        else if (0 == uart_capture.open(path, C3P_CAPTURE_KIND_UART, hub.uart->path(), hub.uart->bitrateActual())) {
+          hub.uart->capture(&uart_capture);
+        }
+      }
+      uart_capture.printDebug(text_return);
+    }
+    else print_alloc_fail = true;
+  }
   else if (0 == StringBuilder::strcasecmp(cmd, "free")) {
     if (nullptr != hub.uart) {
       m_link->setEfferant(nullptr);   // Remove refs held elsewhere.
+      uart_capture.close();
       delete hub.uart;
       hub.uart = nullptr;
     }
     else print_alloc_fail = true;
   }
-  else text_return->concat("Usage:\t uart [info|reset|bitrate|new|free]\n");
+  else text_return->concat("Usage:\t uart [info|reset|bitrate|new|capture [<path>|stop]|free]\n");
 
   if (print_alloc_fail) {
     text_return->concat("UART unallocated.\n");
@@ -275,13 +325,18 @@ int callback_link_tools(StringBuilder* text_return, StringBuilder* args) {
   int ret = -1;
   char* cmd = args->position_trimmed(0);
   // We interdict if the command is something specific to this application.
-  if (0 == StringBuilder::strcasecmp(cmd, "ping")) {
+  if (0 == StringBuilder::strcasecmp(cmd, "sessions")) {
+    ret = link_sessions.console_handler(text_return, args);
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "ping")) {
     // Send a description request message.
+    pthread_mutex_lock(&ping_mutex);
     ping_req_time = (uint32_t) millis();
     ping_nonce = randomUInt32();
     KeyValuePair* a = new KeyValuePair("PING",  "fxn");
     a->append(ping_req_time, "time_ms");
     a->append(ping_nonce,    "rand");
+    pthread_mutex_unlock(&ping_mutex);
     int8_t ret_local = m_link->send(a, true);
     text_return->concatf("Ping send() returns ID %u\n", ret_local);
     ret = 0;
@@ -311,6 +366,20 @@ int callback_socket_tools(StringBuilder* text_return, StringBuilder* args) {
     args->drop_position(0);
     text_return->concatf("write(%s) returned %d\n", (char*) args->string(), socket_adapter.pushBuffer(args));
   }
+  else if (0 == StringBuilder::strcasecmp(cmd, "capture")) {
+    if (2 == args->count()) {
+      char* path = args->position_trimmed(1);
+      if (0 == StringBuilder::strcasecmp(path, "stop")) {
+        socket_adapter.capture(nullptr);
+        socket_capture.close();
+      }
+      else if (0 == socket_capture.open(path, C3P_CAPTURE_KIND_SOCKET, "socket_adapter")) {
+        socket_adapter.capture(&socket_capture);
+      }
+    }
+    socket_capture.printDebug(text_return);
+    ret = 0;
+  }
   else {
     ret = socket_adapter.console_handler(text_return, args);
   }
@@ -318,6 +387,67 @@ int callback_socket_tools(StringBuilder* text_return, StringBuilder* args) {
 }
 
 
+
+/*
+* Plays the RX side of a capture into M2MLink, or into the console. The link
+*   can only be fed while there is no UART, since it would answer on both.
+*/
+int callback_replay_tools(StringBuilder* text_return, StringBuilder* args) {
+  int ret = 0;
+  char* cmd = args->position_trimmed(0);
+  if (0 == StringBuilder::strcasecmp(cmd, "start")) {
+    const int ARG_COUNT = args->count();
+    char* target = (ARG_COUNT > 3) ? args->position_trimmed(3) : (char*) "link";
+    const bool TO_LINK = (0 != StringBuilder::strcasecmp(target, "console"));
+    if (ARG_COUNT < 2) {
+      text_return->concat("Usage:\t replay start <path> [speed%] [link|console]\n");
+      ret = -1;
+    }
+    else if (replayer.running()) {
+      text_return->concat("A replay is already running.\n");
+      ret = -1;
+    }
+    else if (TO_LINK && (nullptr != hub.uart)) {
+      text_return->concat("Free the UART before replaying into the link.\n");
+      ret = -1;
+    }
+    else if (0 != replayer.open(args->position_trimmed(1))) {
+      text_return->concatf("Could not open %s as a capture.\n", args->position_trimmed(1));
+      ret = -1;
+    }
+    else {
+      const uint16_t SPEED = (ARG_COUNT > 2) ? (uint16_t) args->position_as_int(2) : 100;
+      if (TO_LINK) {
+        replayer.readCallback(m_link);
+        m_link->setEfferant(&replayer);
+      }
+      else {
+        replayer.readCallback(&console);
+      }
+      replayer.deliverByPoll(true);   // Neither receiver is safe to call from its thread.
+      replayer.start(SPEED);
+      replayer.printDebug(text_return);
+    }
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "stop")) {
+    replayer.stop();
+    replayer.readCallback(nullptr);
+    if (nullptr == hub.uart) {
+      m_link->setEfferant(nullptr);
+    }
+    replayer.printDebug(text_return);
+  }
+  else if ((0 == StringBuilder::strcasecmp(cmd, "info")) || (0 == args->count())) {
+    replayer.printDebug(text_return);
+  }
+  else {
+    text_return->concat("Usage:\t replay [info|start <path> [speed%] [link|console]|stop]\n\tA speed of 0 replays as fast as the receiver allows.\n");
+    ret = -1;
+  }
+  return ret;
+}
+
+
 C3PScheduler* scheduler = nullptr;
 
 /*******************************************************************************
@@ -341,6 +471,7 @@ int main(int argc, const char *argv[]) {
   for (int i = 1; i < argc; i++) {
     if ((strcasestr(argv[i], "--help")) || (strcasestr(argv[i], "-h"))) {
       printf("-u  --uart <path>   Instance a UART to talk to the hardware.\n");
+      printf("-L  --listen <addr> Accept connections on a unix socket, or host:port.\n");
       printf("-v  --version       Print the version and exit.\n");
       printf("    --gui           Run the GUI.\n");
       printf("-h  --help          Print this output and exit.\n");
@@ -392,7 +523,7 @@ int main(int argc, const char *argv[]) {
       }
       else if ((strcasestr(argv[i], "--listen")) || (strcasestr(argv[i], "-L"))) {
         if (argc - i < 2) {  // Mis-use of flag...
-          printf("Using --listen means you must supply a path.\n");
+          printf("Using --listen means you must supply a path or host:port.\n");
           exit(1);
         }
         i++;
@@ -435,6 +566,7 @@ int main(int argc, const char *argv[]) {
   console.defineCommand("link",       'l', "Linked device tools.", "", 0, callback_link_tools);
   console.defineCommand("uart",       'u', "UART tools.", "", 0, callback_uart_tools);
   console.defineCommand("socket",     'S', "Socket tools.", "", 0, callback_socket_tools);
+  console.defineCommand("replay",     '\0', "Stream replay.", "[info|start|stop]", 0, callback_replay_tools);
   console.defineCommand("quit",       'Q', "Commit sudoku.", "", 0, callback_program_quit);
   console.defineCommand("help",       '?', "Prints help to console.", "[<specific command>]", 0, callback_help);
   platform.configureConsole(&console);
@@ -445,20 +577,31 @@ int main(int argc, const char *argv[]) {
   console.printPrompt();
 
   scheduler = C3PScheduler::getInstance();
+  link_sessions.start();
 
   // The main loop. Run until told to stop.
-  while (continue_running) {
+  while (continue_running && (0 == platform.shutdownRequested())) {
     if (nullptr != m_link) {
-      m_link->poll(&output);
+      {
+        C3P_PERF_SCOPE(_perf_link_poll);
+        m_link->poll(&output);
+      }
       if (!output.isEmpty()) {
         console.printToLog(&output);
       }
     }
     console_adapter.poll();
+    replayer.poll();
+    C3P_PERF_SCOPE(_perf_service_schedules);
     scheduler->serviceSchedules();
   }
   console.emitPrompt(false);  // Avoid a trailing prompt.
 
+  socket_listener.close();
+  link_sessions.stop();
+  replayer.close();   // Before the link it feeds is deleted.
+  socket_adapter.capture(nullptr);
+  socket_capture.close();
   if (nullptr != m_link) {
     m_link->hangup();
     delete m_link;
@@ -468,6 +611,7 @@ int main(int argc, const char *argv[]) {
     delete hub.uart;
     hub.uart = nullptr;
   }
+  uart_capture.close();
   console_adapter.poll();
 
   if (hub.main_window) {
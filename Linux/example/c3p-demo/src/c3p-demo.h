@@ -18,6 +18,7 @@
 #include <math.h>
 #include <fstream>
 #include <iostream>
+#include <atomic>
 
 /* The parts of CppPotpourri we want. */
 #include "CppPotpourri.h"
@@ -99,23 +100,105 @@ class CryptoLogShunt : public CryptOpCallback {
 };
 
 
+/*******************************************************************************
+* Socket sessions
+*
+* Each accepted socket gets its own M2MLink. The pair is handed to one of a
+*   small pool of worker threads, which polls the link, keeps the rate
+*   figures, and reaps the pair once the socket has closed or the link has
+*   hung up.
+* The socket hands its RX to the pair, and not to the link directly, since
+*   that happens on a reactor thread while the worker may be polling the link.
+*   The pair's lock keeps the two apart.
+*******************************************************************************/
+#define LINK_SESSION_WORKERS      2     // Threads that poll socket sessions.
+#define LINK_SESSION_MAX         64     // Default cap on concurrent sessions.
+#define LINK_SESSION_RATE_MS   1000     // Period over which session rates are taken.
+#define LINK_SESSION_PARK_MS     10     // Longest a worker sleeps, so link timers still run.
+
+class LinkSessionWorker;
+
 // TODO: Don't code against this too much. It will probably be templated and promoted to C3P.
-class LinkSockPair {
+class LinkSockPair : public BufferAccepter {
   public:
     LinuxSockPipe* sock;
     M2MLink* link;
+    pthread_mutex_t mutex;      // Guards the link.
     uint32_t established;
+    uint8_t  worker      = 0;   // Index of the worker that polls this session.
+    LinkSessionWorker* poller = nullptr;   // ...and the worker itself, to wake on RX.
+    uint32_t rate_ms     = 0;   // When the rate figures were last taken.
+    uint32_t rate_rx_at  = 0;   // Byte counts when the rate figures were last taken.
+    uint32_t rate_tx_at  = 0;
+    uint32_t rate_rx     = 0;   // Bytes per second over the last period.
+    uint32_t rate_tx     = 0;
 
     LinkSockPair(LinuxSockPipe* s, M2MLink* l) :
       sock(s),
       link(l),
       established(millis())
-    {};
+    {
+      pthread_mutex_init(&mutex, nullptr);
+    };
 
     ~LinkSockPair() {
-      delete sock;
+      delete sock;   // The socket goes first, so it can't call the link.
       delete link;
+      pthread_mutex_destroy(&mutex);
     };
+
+    /* Implementation of BufferAccepter. Forwards RX to the link. */
+    int8_t  pushBuffer(StringBuilder*);
+    int32_t bufferAvailable();
+
+    bool   pollLink(StringBuilder* log);
+    void   updateRates(uint32_t now);
+};
+
+
+class LinkSessionManager;
+
+class LinkSessionWorker {
+  public:
+    LinkSessionManager* owner = nullptr;
+    LinkedList<LinkSockPair*> sessions;
+    pthread_mutex_t mutex;    // Guards the session list and the poll count.
+    unsigned long thread_id = 0;
+    uint32_t count_polls    = 0;
+    std::atomic<bool> running{false};
+
+    void wake();
+};
+
+
+class LinkSessionManager {
+  public:
+    LinkSessionManager(uint16_t max_sessions);
+    ~LinkSessionManager();
+
+    int8_t start();
+    void   stop();
+    int8_t addSession(LinuxSockPipe*, M2MLink*);
+    void   printSessions(StringBuilder*);
+    int    console_handler(StringBuilder* text_return, StringBuilder* args);
+
+    inline bool     full() {                    return (_count >= _max_sessions);   };
+    inline uint16_t sessionCount() {            return _count;          };
+    inline uint16_t maxSessions() {             return _max_sessions;   };
+    inline void     maxSessions(uint16_t x) {   _max_sessions = x;      };   // Sessions already open are kept.
+
+
+  private:
+    LinkSessionWorker _workers[LINK_SESSION_WORKERS];
+    pthread_mutex_t   _mutex;            // Guards the count and the worker choice.
+    uint16_t          _max_sessions;
+    uint16_t          _count          = 0;
+    uint32_t          _count_opened   = 0;
+    uint32_t          _count_reaped   = 0;
+
+    int  _poll_worker(LinkSessionWorker*, StringBuilder* log);
+
+    static void* _worker_thread(void*);
 };
 
 
@@ -243,5 +326,6 @@ class StaticHub {
 * Globals that are extern'd
 *******************************************************************************/
 extern StaticHub hub;
+extern LinkSessionManager link_sessions;
 
 #endif  // __C3PDEMO_HEADER_H__
@@ -0,0 +1,331 @@
+/*
+* File:   c3p-demo_sessions.cpp
+* Author: J. Ian Lindsay
+* Date:   2026.10.17
+*
+* Session management for M2MLinks carried over sockets. The listener may call
+*   addSession() from any reactor thread, so everything here that touches the
+*   session lists does so under a lock. Each link is only touched under its
+*   pair's lock, since its socket delivers RX on a reactor thread.
+*/
+
+#include "c3p-demo.h"
+
+
+/*******************************************************************************
+* LinkSockPair
+*******************************************************************************/
+
+/*
+* Called on the socket's reactor thread with inbound data. The worker is woken
+*   to poll the link, rather than waiting out its park.
+*/
+int8_t LinkSockPair::pushBuffer(StringBuilder* buf) {
+  pthread_mutex_lock(&mutex);
+  const int8_t RET = link->pushBuffer(buf);
+  pthread_mutex_unlock(&mutex);
+  if (nullptr != poller) {
+    poller->wake();
+  }
+  return RET;
+}
+
+
+int32_t LinkSockPair::bufferAvailable() {
+  pthread_mutex_lock(&mutex);
+  const int32_t RET = link->bufferAvailable();
+  pthread_mutex_unlock(&mutex);
+  return RET;
+}
+
+
+/*
+* Called by the worker that owns the session.
+*
+* @return true if the link has hung up.
+*/
+bool LinkSockPair::pollLink(StringBuilder* log) {
+  pthread_mutex_lock(&mutex);
+  link->poll(log);
+  const bool RET = (M2MLinkState::HUNGUP == link->currentState());
+  pthread_mutex_unlock(&mutex);
+  return RET;
+}
+
+
+/*
+* Takes the byte rates for the session, once per LINK_SESSION_RATE_MS. Called
+*   by the worker that owns the session.
+*/
+void LinkSockPair::updateRates(uint32_t now) {
+  const uint32_t ELAPSED = (now - rate_ms);
+  if (ELAPSED >= LINK_SESSION_RATE_MS) {
+    const uint32_t RX = sock->bytesReceived();
+    const uint32_t TX = sock->bytesSent();
+    rate_rx    = (uint32_t) (((uint64_t) (RX - rate_rx_at) * 1000) / ELAPSED);
+    rate_tx    = (uint32_t) (((uint64_t) (TX - rate_tx_at) * 1000) / ELAPSED);
+    rate_rx_at = RX;
+    rate_tx_at = TX;
+    rate_ms    = now;
+  }
+}
+
+
+/*******************************************************************************
+* LinkSessionWorker
+*******************************************************************************/
+
+/*
+* Wakes the worker if it is parked. Safe to call from any thread, and before
+*   the worker is started.
+*/
+void LinkSessionWorker::wake() {
+  const unsigned long TID = __atomic_load_n(&thread_id, __ATOMIC_ACQUIRE);
+  if (0 != TID) {
+    platform.wakeThread(TID);
+  }
+}
+
+
+/*******************************************************************************
+* LinkSessionManager
+*******************************************************************************/
+
+LinkSessionManager::LinkSessionManager(uint16_t max_sessions) : _max_sessions(max_sessions) {
+  pthread_mutex_init(&_mutex, nullptr);
+  for (uint8_t i = 0; i < LINK_SESSION_WORKERS; i++) {
+    _workers[i].owner = this;
+    pthread_mutex_init(&_workers[i].mutex, nullptr);
+  }
+}
+
+
+LinkSessionManager::~LinkSessionManager() {
+  stop();
+  for (uint8_t i = 0; i < LINK_SESSION_WORKERS; i++) {
+    pthread_mutex_destroy(&_workers[i].mutex);
+  }
+  pthread_mutex_destroy(&_mutex);
+}
+
+
+/**
+* Starts the worker threads. Sessions can be added before this is called, but
+*   nothing will service them until it is.
+*
+* @return 0 on success, -1 if a worker could not be started.
+*/
+int8_t LinkSessionManager::start() {
+  int8_t ret = 0;
+  for (uint8_t i = 0; i < LINK_SESSION_WORKERS; i++) {
+    LinkSessionWorker* w = &_workers[i];
+    if (!w->running) {
+      char name[16];
+      snprintf(name, sizeof(name), "LinkSession%u", i);
+      PlatformThreadOpts topts;
+      memset(&topts, 0, sizeof(topts));
+      topts.thread_name = name;
+      unsigned long tid = 0;
+      w->running = true;
+      if (0 != platform.createThread(&tid, nullptr, _worker_thread, (void*) w, &topts)) {
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to start session worker %u.", i);
+        w->running = false;
+        ret = -1;
+      }
+      else {
+        __atomic_store_n(&w->thread_id, tid, __ATOMIC_RELEASE);
+      }
+    }
+  }
+  return ret;
+}
+
+
+/**
+* Stops the worker threads, then hangs up and frees every session that is left.
+*/
+void LinkSessionManager::stop() {
+  for (uint8_t i = 0; i < LINK_SESSION_WORKERS; i++) {
+    LinkSessionWorker* w = &_workers[i];
+    if (w->running) {
+      w->running = false;
+      w->wake();
+      pthread_join((pthread_t) w->thread_id, nullptr);
+      __atomic_store_n(&w->thread_id, 0, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_lock(&w->mutex);
+    while (0 < w->sessions.size()) {
+      LinkSockPair* pair = w->sessions.remove();
+      pthread_mutex_lock(&pair->mutex);
+      pair->link->hangup();
+      pthread_mutex_unlock(&pair->mutex);
+      delete pair;
+    }
+    pthread_mutex_unlock(&w->mutex);
+  }
+  pthread_mutex_lock(&_mutex);
+  _count = 0;
+  pthread_mutex_unlock(&_mutex);
+}
+
+
+/**
+* Wires a new socket to its link, and gives the pair to the worker with the
+*   fewest sessions. Safe to call from any thread.
+*
+* @return 0 if the session was taken, -1 if the cap has been reached. On
+*   failure, the caller still owns both objects.
+*/
+int8_t LinkSessionManager::addSession(LinuxSockPipe* sock, M2MLink* link) {
+  int8_t ret = -1;
+  pthread_mutex_lock(&_mutex);
+  if (_count < _max_sessions) {
+    uint8_t idx = 0;
+    int fewest  = -1;
+    for (uint8_t i = 0; i < LINK_SESSION_WORKERS; i++) {
+      pthread_mutex_lock(&_workers[i].mutex);
+      const int SESSIONS = _workers[i].sessions.size();
+      pthread_mutex_unlock(&_workers[i].mutex);
+      if ((0 > fewest) | (SESSIONS < fewest)) {
+        fewest = SESSIONS;
+        idx    = i;
+      }
+    }
+    LinkSockPair* pair = new LinkSockPair(sock, link);
+    pair->worker     = idx;
+    pair->poller     = &_workers[idx];
+    pair->rate_ms    = millis();
+    pair->rate_rx_at = sock->bytesReceived();
+    pair->rate_tx_at = sock->bytesSent();
+    link->setEfferant(sock);   // Attach M2MLink to the socket...
+    sock->readCallback(pair);  // ...and the socket to M2MLink, by way of the pair.
+    pthread_mutex_lock(&_workers[idx].mutex);
+    _workers[idx].sessions.insert(pair);
+    pthread_mutex_unlock(&_workers[idx].mutex);
+    _workers[idx].wake();
+    _count++;
+    _count_opened++;
+    ret = 0;
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+/*
+* Polls every session the worker holds, and reaps those that are finished.
+*   Reaped pairs are freed outside the worker's lock, since freeing the socket
+*   waits out any reactor callback that is still running.
+*
+* @return the number of sessions reaped.
+*/
+int LinkSessionManager::_poll_worker(LinkSessionWorker* w, StringBuilder* log) {
+  LinkedList<LinkSockPair*> dead;
+  const uint32_t NOW = millis();
+  pthread_mutex_lock(&w->mutex);
+  for (int i = 0; i < w->sessions.size(); i++) {
+    LinkSockPair* pair = w->sessions.get(i);
+    const bool LINK_GONE = pair->pollLink(log);
+    pair->updateRates(NOW);
+    const bool SOCK_GONE = (0 == pair->sock->connected());
+    if (SOCK_GONE | LINK_GONE) {
+      dead.insert(pair);
+    }
+  }
+  for (int i = 0; i < dead.size(); i++) {
+    w->sessions.remove(dead.get(i));
+  }
+  w->count_polls++;
+  pthread_mutex_unlock(&w->mutex);
+
+  const int REAPED = dead.size();
+  while (0 < dead.size()) {
+    LinkSockPair* pair = dead.remove();
+    log->concatf("Reaped session 0x%x after %us.\n", pair->link->linkTag(), (NOW - pair->established) / 1000);
+    pair->sock->readCallback(nullptr);
+    delete pair;
+  }
+  if (0 < REAPED) {
+    pthread_mutex_lock(&_mutex);
+    _count -= REAPED;
+    _count_reaped += REAPED;
+    pthread_mutex_unlock(&_mutex);
+  }
+  return REAPED;
+}
+
+
+/*
+* Each worker parks between polls. RX and new sessions wake it early, and the
+*   bounded park keeps the links' own timers running when the wire is quiet.
+*/
+void* LinkSessionManager::_worker_thread(void* arg) {
+  LinkSessionWorker* w = (LinkSessionWorker*) arg;
+  StringBuilder output;
+  while (w->running) {
+    w->owner->_poll_worker(w, &output);
+    if (!output.isEmpty()) {
+      c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, &output);
+      output.clear();
+    }
+    platform.suspendThread(LINK_SESSION_PARK_MS);
+  }
+  return nullptr;
+}
+
+
+void LinkSessionManager::printSessions(StringBuilder* output) {
+  const uint32_t NOW = millis();
+  pthread_mutex_lock(&_mutex);
+  output->concatf("Sessions: %u of %u (opened %u, reaped %u)\n", _count, _max_sessions, _count_opened, _count_reaped);
+  pthread_mutex_unlock(&_mutex);
+  output->concat("\tTag       \tWorker\tState          \tAge (s)\tRX B/s\tTX B/s\tTX queue\n");
+  for (uint8_t i = 0; i < LINK_SESSION_WORKERS; i++) {
+    LinkSessionWorker* w = &_workers[i];
+    pthread_mutex_lock(&w->mutex);
+    for (int n = 0; n < w->sessions.size(); n++) {
+      LinkSockPair* pair = w->sessions.get(n);
+      pthread_mutex_lock(&pair->mutex);
+      output->concatf("\t0x%08x\t%u\t%-15s\t%u\t%u\t%u\t%u / %u\n",
+        pair->link->linkTag(), pair->worker,
+        M2MLink::sessionStateStr(pair->link->currentState()),
+        (NOW - pair->established) / 1000,
+        pair->rate_rx, pair->rate_tx,
+        pair->sock->txQueued(), pair->sock->txBudget()
+      );
+      pthread_mutex_unlock(&pair->mutex);
+    }
+    pthread_mutex_unlock(&w->mutex);
+  }
+  for (uint8_t i = 0; i < LINK_SESSION_WORKERS; i++) {
+    LinkSessionWorker* w = &_workers[i];
+    pthread_mutex_lock(&w->mutex);
+    const int      SESSIONS = w->sessions.size();
+    const uint32_t POLLS    = w->count_polls;
+    pthread_mutex_unlock(&w->mutex);
+    output->concatf("\tWorker %u: %d sessions, %u polls%s\n", i, SESSIONS, POLLS, (w->running ? "" : " (stopped)"));
+  }
+}
+
+
+/*
+* Expects the first argument to be "sessions".
+*/
+int LinkSessionManager::console_handler(StringBuilder* text_return, StringBuilder* args) {
+  int ret = 0;
+  char* cmd = args->position_trimmed(1);
+  if (0 == StringBuilder::strcasecmp(cmd, "max")) {
+    if (3 == args->count()) {
+      maxSessions((uint16_t) args->position_as_int(2));
+    }
+    text_return->concatf("Session cap is %u.\n", maxSessions());
+  }
+  else if (1 == args->count()) {
+    printSessions(text_return);
+  }
+  else {
+    text_return->concat("Usage:\t link sessions [max [n]]\n");
+    ret = -1;
+  }
+  return ret;
+}
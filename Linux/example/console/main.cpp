@@ -137,7 +137,7 @@ int main(int argc, const char* argv[]) {
   /*
   * The main loop. Run until told to stop.
   */
-  while (continue_running) {
+  while (continue_running && (0 == platform.shutdownRequested())) {
     // Polling the adapter will drive the entire program forward.
     console_adapter.poll();
   }
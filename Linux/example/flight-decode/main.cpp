@@ -0,0 +1,181 @@
+/*
+File:   main.cpp
+Author: J. Ian Lindsay
+Date:   2026.10.16
+
+Copyright 2026 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Decodes a flight recorder ring file (written by a program built with
+  CONFIG_C3P_FLIGHT_RECORDER) back into text, oldest record first.
+
+Usage: flight-decode <ring-file> [-n <last-N-records>] [-s <last-N-seconds>]
+
+This program has no dependency on CppPotpourri.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../C3PFlightRecorder.h"
+
+
+static const char* sev_str(uint8_t sev) {
+  static const char* const STRS[8] = {"EMERG", "ALERT", "CRIT", "ERROR", "WARN", "NOTICE", "INFO", "DEBUG"};
+  return ((sev < 8) ? STRS[sev] : "?");
+}
+
+
+static const char* tag_str(const C3PFlightHeader* hdr, const C3PFlightTag* tags, uint32_t hash) {
+  const uint32_t MASK = (hdr->tag_count - 1);
+  for (uint32_t i = 0; i < 8; i++) {
+    const C3PFlightTag* slot = &tags[(hash + i) & MASK];
+    if (hash == slot->hash) {
+      // A writer that died between claiming the slot and naming it leaves no text.
+      return ((0 != slot->ready) ? slot->text : nullptr);
+    }
+    if (0 == slot->hash) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+
+static void print_record(const C3PFlightHeader* hdr, const C3PFlightTag* tags, const C3PFlightRecord* rec) {
+  const uint64_t WALL_US = hdr->epoch_us + rec->timestamp;
+  const time_t   SECS    = (time_t) (WALL_US / 1000000ULL);
+  struct tm tm_local;
+  char time_str[32];
+  localtime_r(&SECS, &tm_local);
+  strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm_local);
+
+  uint32_t len = rec->len;
+  while ((0 < len) && ('\n' == rec->payload[len - 1])) {
+    len--;   // Most messages carry their own newline.
+  }
+  const char* tag = tag_str(hdr, tags, rec->tag_hash);
+  printf("%s.%06u %12.6f [%u] %-6s ",
+    time_str, (unsigned) (WALL_US % 1000000ULL),
+    (double) rec->timestamp / 1000000.0, rec->tid, sev_str(rec->severity)
+  );
+  if (nullptr != tag) {
+    printf("%s: ", tag);
+  }
+  else {
+    printf("<tag 0x%08x>: ", rec->tag_hash);
+  }
+  printf("%.*s%s\n", (int) len, rec->payload, ((rec->flags & C3P_FLIGHT_REC_FLAG_TRUNCATED) ? " [...]" : ""));
+}
+
+
+int main(int argc, char** argv) {
+  const char* path    = nullptr;
+  uint64_t last_n     = 0;
+  double   last_secs  = 0.0;
+  for (int i = 1; i < argc; i++) {
+    if ((0 == strcmp(argv[i], "-n")) && (i + 1 < argc)) {
+      last_n = strtoull(argv[++i], nullptr, 0);
+    }
+    else if ((0 == strcmp(argv[i], "-s")) && (i + 1 < argc)) {
+      last_secs = strtod(argv[++i], nullptr);
+    }
+    else if (nullptr == path) {
+      path = argv[i];
+    }
+  }
+  if (nullptr == path) {
+    fprintf(stderr, "Usage: %s <ring-file> [-n <last-N-records>] [-s <last-N-seconds>]\n", argv[0]);
+    return 1;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Could not open %s\n", path);
+    return 1;
+  }
+  struct stat st;
+  fstat(fd, &st);
+  if ((size_t) st.st_size < sizeof(C3PFlightHeader)) {
+    fprintf(stderr, "%s is too small to be a flight recorder.\n", path);
+    return 1;
+  }
+  uint8_t* map = (uint8_t*) mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (MAP_FAILED == map) {
+    fprintf(stderr, "Could not map %s\n", path);
+    return 1;
+  }
+  const C3PFlightHeader* hdr = (const C3PFlightHeader*) map;
+  if ((C3P_FLIGHT_MAGIC != hdr->magic) || (C3P_FLIGHT_VERSION != hdr->version)) {
+    fprintf(stderr, "%s is not a version %d flight recorder.\n", path, C3P_FLIGHT_VERSION);
+    return 1;
+  }
+  if ((c3p_flight_file_size(hdr) > (uint64_t) st.st_size) || (hdr->record_size <= C3P_FLIGHT_REC_OVERHEAD)) {
+    fprintf(stderr, "%s is truncated or corrupt.\n", path);
+    return 1;
+  }
+  const C3PFlightTag* tags = (const C3PFlightTag*) (map + sizeof(C3PFlightHeader));
+  const uint8_t*      recs = map + sizeof(C3PFlightHeader) + ((uint64_t) hdr->tag_count * sizeof(C3PFlightTag));
+  const uint32_t      MASK = (hdr->record_count - 1);
+
+  // The ring holds at most record_count of the most recent records.
+  const uint64_t W_SEQ = hdr->w_seq;
+  uint64_t first = ((W_SEQ > hdr->record_count) ? (W_SEQ - hdr->record_count) : 0);
+  if ((0 < last_n) && ((W_SEQ - first) > last_n)) {
+    first = W_SEQ - last_n;
+  }
+
+  // Find the newest intact timestamp, so that -s has a reference.
+  uint64_t newest_ts = 0;
+  for (uint64_t seq = first; seq < W_SEQ; seq++) {
+    const C3PFlightRecord* rec = (const C3PFlightRecord*) (recs + ((seq & MASK) * hdr->record_size));
+    if ((seq + 1) == rec->seq) {
+      newest_ts = (rec->timestamp > newest_ts) ? rec->timestamp : newest_ts;
+    }
+  }
+  const uint64_t CUTOFF = (uint64_t) (last_secs * 1000000.0);
+  const uint64_t MIN_TS = ((0 < CUTOFF) && (newest_ts > CUTOFF)) ? (newest_ts - CUTOFF) : 0;
+
+  printf("# %s: pid %u (%s), %llu records logged, %u-record ring.\n",
+    path, hdr->pid, hdr->binary, (unsigned long long) W_SEQ, hdr->record_count
+  );
+  uint32_t torn = 0;
+  for (uint64_t seq = first; seq < W_SEQ; seq++) {
+    const C3PFlightRecord* rec = (const C3PFlightRecord*) (recs + ((seq & MASK) * hdr->record_size));
+    if ((seq + 1) != rec->seq) {
+      torn++;   // Being written when the process stopped, or already lapped.
+      continue;
+    }
+    if (rec->timestamp < MIN_TS) {
+      continue;
+    }
+    if (rec->len > (hdr->record_size - C3P_FLIGHT_REC_OVERHEAD)) {
+      torn++;
+      continue;
+    }
+    print_record(hdr, tags, rec);
+  }
+  if (0 < torn) {
+    printf("# %u records were incomplete and skipped.\n", torn);
+  }
+  munmap(map, st.st_size);
+  return 0;
+}
@@ -0,0 +1,1023 @@
+/*
+File:   main.cpp
+Author: J. Ian Lindsay
+Date:   2026.10.17
+
+Copyright 2026 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Benchmarks for the Linux I/O drivers. Each test runs the driver against a
+  local peer (a socketpair, a pty, or a second pipe in this process), so the
+  numbers measure our own overhead, and not a device or a network. Results
+  are the best of three runs, as the first is usually cold.
+
+Usage: io-bench <test> [seconds-per-run]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <pty.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* CppPotpourri */
+#include <StringBuilder.h>
+#include <CppPotpourri.h>
+
+/* ManuvrPlatform for vanilla Linux. */
+#include <Linux.h>
+
+
+/*******************************************************************************
+* Defs and types                                                               *
+*******************************************************************************/
+#define PROGRAM_VERSION        "0.0.1"    // Program version.
+#define BENCH_RUNS                   3    // Each case is run this many times.
+#define BENCH_DEFAULT_SECONDS        2    // Length of each run, unless given.
+#define BENCH_RTT_MAX_SAMPLES   200000    // Round trips kept per run.
+
+/* A test takes the length of each run, and returns 0 on success. */
+typedef int (*BenchFxn)(double secs);
+
+typedef struct {
+  const char* name;
+  const char* desc;
+  BenchFxn    fxn;
+} BenchDef;
+
+
+/*******************************************************************************
+* Helpers                                                                      *
+*******************************************************************************/
+
+static double _now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((double) ts.tv_sec + ((double) ts.tv_nsec / 1000000000.0));
+}
+
+
+/*
+* Reads from an fd until EOF, and counts the bytes. Stands in for the far side
+*   of a connection that never falls behind.
+*/
+typedef struct {
+  int      fd;
+  uint64_t total;   // Atomic.
+} BenchDrain;
+
+static void* _drain_thread(void* arg) {
+  BenchDrain* drain = (BenchDrain*) arg;
+  uint8_t buf[65536];
+  while (true) {
+    const ssize_t N = read(drain->fd, buf, sizeof(buf));
+    if (N > 0) {
+      __atomic_fetch_add(&drain->total, (uint64_t) N, __ATOMIC_RELEASE);
+    }
+    else if ((N < 0) && (EINTR == errno)) {
+      continue;
+    }
+    else {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+
+/*
+* Writes everything read from an fd straight back, and counts it. Stands in
+*   for a device that echoes.
+*/
+static void* _echo_thread(void* arg) {
+  BenchDrain* echo = (BenchDrain*) arg;
+  uint8_t buf[4096];
+  while (true) {
+    const ssize_t N = read(echo->fd, buf, sizeof(buf));
+    if (N > 0) {
+      ssize_t off = 0;
+      while (off < N) {
+        const ssize_t W = write(echo->fd, buf + off, (size_t) (N - off));
+        if (W > 0) {
+          off += W;
+        }
+        else if ((W < 0) && (EINTR != errno) && (EAGAIN != errno)) {
+          return nullptr;
+        }
+      }
+      __atomic_fetch_add(&echo->total, (uint64_t) N, __ATOMIC_RELEASE);
+    }
+    else if ((N < 0) && (EINTR == errno)) {
+      continue;
+    }
+    else {
+      break;   // EOF, or EIO once the slave is closed.
+    }
+  }
+  return nullptr;
+}
+
+
+/*
+* Sums the reactor's dispatches over all of its threads.
+*/
+static uint32_t _reactor_dispatches() {
+  uint32_t total = 0;
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if (nullptr != reactor) {
+    for (uint8_t i = 0; i < reactor->shardCount(); i++) {
+      uint32_t fds = 0;
+      uint32_t dispatches = 0;
+      reactor->shardStats(i, &fds, &dispatches);
+      total += dispatches;
+    }
+  }
+  return total;
+}
+
+
+/*
+* A refused pushBuffer() waits on this until the pipe calls back with room.
+*/
+static pthread_mutex_t _writable_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  _writable_cond  = PTHREAD_COND_INITIALIZER;
+
+static void _writable_cb(BufferAccepter*, void*) {
+  pthread_mutex_lock(&_writable_mutex);
+  pthread_cond_broadcast(&_writable_cond);
+  pthread_mutex_unlock(&_writable_mutex);
+}
+
+static void _wait_writable(uint32_t timeout_ms) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+  deadline.tv_sec  += (timeout_ms / 1000) + (deadline.tv_nsec / 1000000000L);
+  deadline.tv_nsec %= 1000000000L;
+  pthread_mutex_lock(&_writable_mutex);
+  pthread_cond_timedwait(&_writable_cond, &_writable_mutex, &deadline);
+  pthread_mutex_unlock(&_writable_mutex);
+}
+
+
+/*
+* Reads whatever a driver delivers, and counts it. If echo is set, the data is
+*   sent back out of that pipe first.
+*/
+class BenchSink : public BufferAccepter {
+  public:
+    BufferAccepter* echo  = nullptr;
+    uint64_t        total = 0;   // Atomic.
+
+    int8_t pushBuffer(StringBuilder* buf) {
+      const int LEN = buf->length();
+      if (nullptr != echo) {
+        echo->pushBuffer(buf);
+      }
+      buf->clear();
+      __atomic_fetch_add(&total, (uint64_t) LEN, __ATOMIC_RELEASE);
+      return 1;
+    };
+
+    int32_t bufferAvailable() {   return 0x7FFFFFFF;   };
+};
+
+
+static int _cmp_double(const void* x, const void* y) {
+  const double DX = *((const double*) x);
+  const double DY = *((const double*) y);
+  return ((DX < DY) ? -1 : ((DX > DY) ? 1 : 0));
+}
+
+
+/*
+* Sends len bytes out, and waits for all of them to come back in, over and over
+*   for secs seconds. Reports the median and 99th-percentile round trips.
+*
+* @return 0 on success, or -1 if an echo never came back.
+*/
+static int _rtt_measure(BufferAccepter* out, BenchSink* in, uint32_t len, double secs, double* p50_us, double* p99_us) {
+  double*  samples = (double*) malloc(BENCH_RTT_MAX_SAMPLES * sizeof(double));
+  uint8_t* payload = (uint8_t*) malloc(len);
+  memset(payload, 0x55, len);
+  uint32_t count = 0;
+  uint64_t want  = __atomic_load_n(&in->total, __ATOMIC_ACQUIRE);
+  int      ret   = 0;
+  const double T0 = _now();
+  while (((_now() - T0) < secs) && (count < BENCH_RTT_MAX_SAMPLES) && (0 == ret)) {
+    StringBuilder msg;
+    msg.concat(payload, (int) len);
+    want += len;
+    const double T_SEND = _now();
+    out->pushBuffer(&msg);
+    while (__atomic_load_n(&in->total, __ATOMIC_ACQUIRE) < want) {
+      if ((_now() - T_SEND) > 1.0) {
+        ret = -1;
+        break;
+      }
+      sched_yield();
+    }
+    samples[count++] = (_now() - T_SEND) * 1000000.0;
+  }
+  qsort(samples, count, sizeof(double), _cmp_double);
+  *p50_us = samples[count / 2];
+  *p99_us = samples[(count * 99) / 100];
+  free(payload);
+  free(samples);
+  return ret;
+}
+
+
+/*******************************************************************************
+* sock: LinuxSockPipe TX over a socketpair.
+* The pipe owns one end, and is serviced by the reactor. A thread drains the
+*   other. Fragments are queued from this thread in batches, as an application
+*   would, and the reactor gathers them into writev().
+*******************************************************************************/
+
+/*
+* Pushes batches of frag-byte fragments for secs seconds.
+*
+* @return MB/s delivered to the far side, or a negative value on failure.
+*/
+static double _sock_tx_run(uint32_t frag, uint32_t batch, double secs) {
+  int sv[2];
+  if (0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv)) {
+    return -1.0;
+  }
+  BenchDrain drain = {sv[1], 0};
+  pthread_t drain_thread;
+  pthread_create(&drain_thread, nullptr, _drain_thread, (void*) &drain);
+  LinuxSockPipe* pipe = new LinuxSockPipe(nullptr, sv[0]);
+  pipe->writableCallback(_writable_cb, nullptr);
+
+  uint8_t* payload = (uint8_t*) malloc(frag);
+  memset(payload, 0x55, frag);
+  uint64_t pushed = 0;
+  const double T0 = _now();
+  while ((_now() - T0) < secs) {
+    StringBuilder out;
+    for (uint32_t i = 0; i < batch; i++) {
+      out.concat(payload, (int) frag);
+    }
+    while (1 != pipe->pushBuffer(&out)) {
+      _wait_writable(10);
+    }
+    pushed += ((uint64_t) frag * batch);
+  }
+  while (__atomic_load_n(&drain.total, __ATOMIC_ACQUIRE) < pushed) {
+    sched_yield();
+  }
+  const double ELAPSED = _now() - T0;
+  delete pipe;   // Closes sv[0], so the drain sees EOF.
+  pthread_join(drain_thread, nullptr);
+  ::close(sv[1]);
+  free(payload);
+  return ((double) pushed / ELAPSED / 1000000.0);
+}
+
+
+static int bench_sock(double secs) {
+  const struct {
+    const char* label;
+    uint32_t    frag;
+    uint32_t    batch;
+  } CASES[] = {
+    {"256B fragments, 1 per push",     256,    1},
+    {"256B fragments, 16 per push",    256,   16},
+    {"4KB fragments, 16 per push",    4096,   16},
+    {"4KB fragments, 2048 per push",  4096, 2048},   // An 8MB image.
+  };
+  printf("LinuxSockPipe TX over a socketpair (%.1fs per run)\n", secs);
+  for (uint32_t c = 0; c < (sizeof(CASES) / sizeof(CASES[0])); c++) {
+    double best = 0.0;
+    for (uint32_t r = 0; r < BENCH_RUNS; r++) {
+      const double MBPS = _sock_tx_run(CASES[c].frag, CASES[c].batch, secs);
+      if (0.0 > MBPS) {
+        printf("\tFailed to make a socketpair.\n");
+        return -1;
+      }
+      best = strict_max(best, MBPS);
+    }
+    printf("\t%-32s %9.1f MB/s\n", CASES[c].label, best);
+  }
+  return 0;
+}
+
+
+/*******************************************************************************
+* sock-rx: LinuxSockPipe RX over a socketpair.
+* A thread writes into one end as fast as the socket takes it, and the pipe
+*   owns the other. The reactor reads into pooled buffers, and the read
+*   callback takes and drops what it is given, as a parser would.
+*******************************************************************************/
+typedef struct {
+  int      fd;
+  uint32_t len;       // Bytes per write().
+  bool     running;   // Atomic.
+} BenchFeed;
+
+static void* _feed_thread(void* arg) {
+  BenchFeed* feed = (BenchFeed*) arg;
+  uint8_t* payload = (uint8_t*) malloc(feed->len);
+  memset(payload, 0x55, feed->len);
+  while (__atomic_load_n(&feed->running, __ATOMIC_ACQUIRE)) {
+    if ((0 > write(feed->fd, payload, feed->len)) && (EINTR != errno)) {
+      break;
+    }
+  }
+  free(payload);
+  return nullptr;
+}
+
+
+/*
+* Feeds len-byte writes for secs seconds.
+*
+* @return MB/s delivered to the read callback, or a negative value on failure.
+*   The pool's hits and misses over the run are added to the given counts.
+*/
+static double _sock_rx_run(uint32_t len, double secs, uint32_t* hits, uint32_t* misses) {
+  int sv[2];
+  if (0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv)) {
+    return -1.0;
+  }
+  uint32_t hits_0   = 0;
+  uint32_t misses_0 = 0;
+  LinuxSockPipe::rxPoolStats(&hits_0, &misses_0);
+  BenchSink sink;
+  LinuxSockPipe* pipe = new LinuxSockPipe(nullptr, sv[0]);
+  pipe->readCallback(&sink);
+  BenchFeed feed = {sv[1], len, true};
+  pthread_t feed_thread;
+  pthread_create(&feed_thread, nullptr, _feed_thread, (void*) &feed);
+
+  const double T0 = _now();
+  sleep_ms((uint32_t) (secs * 1000.0));
+  const uint64_t GOT = __atomic_load_n(&sink.total, __ATOMIC_ACQUIRE);
+  const double ELAPSED = _now() - T0;
+  __atomic_store_n(&feed.running, false, __ATOMIC_RELEASE);
+  ::shutdown(sv[1], SHUT_WR);   // Unblocks a write() that is stuck on a full socket.
+  delete pipe;
+  pthread_join(feed_thread, nullptr);
+  ::close(sv[1]);
+
+  uint32_t hits_1   = 0;
+  uint32_t misses_1 = 0;
+  LinuxSockPipe::rxPoolStats(&hits_1, &misses_1);
+  *hits   += (hits_1 - hits_0);
+  *misses += (misses_1 - misses_0);
+  return ((double) GOT / ELAPSED / 1000000.0);
+}
+
+
+static int bench_sock_rx(double secs) {
+  const struct {
+    const char* label;
+    uint32_t    len;
+  } CASES[] = {
+    {"64B writes (KA/ACK traffic)",   64},
+    {"1KB writes",                  1024},
+    {"64KB writes (image cast)",   65536},
+  };
+  printf("LinuxSockPipe RX over a socketpair (%.1fs per run)\n", secs);
+  printf("\t%-32s %14s %16s\n", "", "Throughput", "Pool hit rate");
+  for (uint32_t c = 0; c < (sizeof(CASES) / sizeof(CASES[0])); c++) {
+    double   best   = 0.0;
+    uint32_t hits   = 0;
+    uint32_t misses = 0;
+    for (uint32_t r = 0; r < BENCH_RUNS; r++) {
+      const double MBPS = _sock_rx_run(CASES[c].len, secs, &hits, &misses);
+      if (0.0 > MBPS) {
+        printf("\tFailed to make a socketpair.\n");
+        return -1;
+      }
+      best = strict_max(best, MBPS);
+    }
+    const double HIT_PCT = (0 < (hits + misses)) ? ((100.0 * hits) / (hits + misses)) : 0.0;
+    printf("\t%-32s %9.1f MB/s %15.1f%%\n", CASES[c].label, best, HIT_PCT);
+  }
+  return 0;
+}
+
+
+/*******************************************************************************
+* shm: LinuxShmPipe against LinuxSockPipe, between two pipes in this process.
+* Both ends of each pair live here. For latency, the far end's reader sends
+*   every byte straight back, and this thread waits for it. For throughput,
+*   the far end's reader only counts.
+*******************************************************************************/
+/*
+* Makes a connected pair of pipes of one kind, and gives each a sink.
+*
+* @return 0 on success, or -1 on failure.
+*/
+static int8_t _pair_open(bool shm, BenchSink* sink_a, BenchSink* sink_b, BufferAccepter** a, BufferAccepter** b) {
+  int sv[2];
+  if (0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv)) {
+    return -1;
+  }
+  if (shm) {
+    LinuxShmPipe* pa = new LinuxShmPipe();
+    LinuxShmPipe* pb = new LinuxShmPipe();
+    pa->readCallback(sink_a);
+    pb->readCallback(sink_b);
+    pa->writableCallback(_writable_cb, nullptr);
+    if ((0 != pa->offer(sv[0])) || (0 != pb->join(sv[1]))) {
+      delete pa;
+      delete pb;
+      ::close(sv[0]);
+      ::close(sv[1]);
+      return -1;
+    }
+    *a = pa;
+    *b = pb;
+  }
+  else {
+    LinuxSockPipe* pa = new LinuxSockPipe(nullptr, sv[0]);
+    LinuxSockPipe* pb = new LinuxSockPipe(nullptr, sv[1]);
+    pa->readCallback(sink_a);
+    pb->readCallback(sink_b);
+    pa->writableCallback(_writable_cb, nullptr);
+    *a = pa;
+    *b = pb;
+  }
+  return 0;
+}
+
+
+static void _pair_close(bool shm, BufferAccepter* a, BufferAccepter* b) {
+  if (shm) {
+    delete (LinuxShmPipe*) a;
+    delete (LinuxShmPipe*) b;
+  }
+  else {
+    delete (LinuxSockPipe*) a;
+    delete (LinuxSockPipe*) b;
+  }
+}
+
+
+/*
+* Sends one byte at a time, and waits for each to come back, for secs seconds.
+*
+* @return 0 on success, or -1 on failure.
+*/
+static int _shm_rtt_run(bool shm, double secs, double* p50_us, double* p99_us) {
+  BenchSink sink_a;
+  BenchSink sink_b;
+  BufferAccepter* a = nullptr;
+  BufferAccepter* b = nullptr;
+  if (0 != _pair_open(shm, &sink_a, &sink_b, &a, &b)) {
+    return -1;
+  }
+  sink_b.echo = b;
+  const int RET = _rtt_measure(a, &sink_a, 1, secs, p50_us, p99_us);
+  _pair_close(shm, a, b);
+  return RET;
+}
+
+
+/*
+* Pushes batches of frag-byte fragments from one end for secs seconds.
+*
+* @return MB/s delivered to the other end, or a negative value on failure.
+*/
+static double _shm_tput_run(bool shm, uint32_t frag, uint32_t batch, double secs) {
+  BenchSink sink_a;
+  BenchSink sink_b;
+  BufferAccepter* a = nullptr;
+  BufferAccepter* b = nullptr;
+  if (0 != _pair_open(shm, &sink_a, &sink_b, &a, &b)) {
+    return -1.0;
+  }
+  uint8_t* payload = (uint8_t*) malloc(frag);
+  memset(payload, 0x55, frag);
+  uint64_t pushed = 0;
+  const double T0 = _now();
+  while ((_now() - T0) < secs) {
+    StringBuilder out;
+    for (uint32_t i = 0; i < batch; i++) {
+      out.concat(payload, (int) frag);
+    }
+    while (1 != a->pushBuffer(&out)) {
+      _wait_writable(10);
+    }
+    pushed += ((uint64_t) frag * batch);
+  }
+  while (__atomic_load_n(&sink_b.total, __ATOMIC_ACQUIRE) < pushed) {
+    sched_yield();
+  }
+  const double ELAPSED = _now() - T0;
+  _pair_close(shm, a, b);
+  free(payload);
+  return ((double) pushed / ELAPSED / 1000000.0);
+}
+
+
+static int bench_shm(double secs) {
+  const struct {
+    const char* label;
+    uint32_t    frag;
+    uint32_t    batch;
+  } CASES[] = {
+    {"256B fragments, 1 per push",     256,    1},
+    {"4KB fragments, 16 per push",    4096,   16},
+    {"4KB fragments, 2048 per push",  4096, 2048},
+  };
+  const char* KINDS[2] = {"LinuxSockPipe", "LinuxShmPipe"};
+  printf("LinuxShmPipe vs. LinuxSockPipe in one process (%.1fs per run)\n", secs);
+  printf("\t%-32s %15s %15s\n", "", KINDS[0], KINDS[1]);
+  double p50[2];
+  double p99[2];
+  for (uint32_t k = 0; k < 2; k++) {
+    p50[k] = 0.0;
+    p99[k] = 0.0;
+    for (uint32_t r = 0; r < BENCH_RUNS; r++) {
+      double run_p50 = 0.0;
+      double run_p99 = 0.0;
+      if (0 != _shm_rtt_run((1 == k), secs, &run_p50, &run_p99)) {
+        printf("\t%s lost an echo.\n", KINDS[k]);
+        return -1;
+      }
+      if ((0 == r) || (run_p50 < p50[k])) {
+        p50[k] = run_p50;
+        p99[k] = run_p99;
+      }
+    }
+  }
+  printf("\t%-32s %12.1f us %12.1f us\n", "1-byte round trip, p50", p50[0], p50[1]);
+  printf("\t%-32s %12.1f us %12.1f us\n", "1-byte round trip, p99", p99[0], p99[1]);
+  for (uint32_t c = 0; c < (sizeof(CASES) / sizeof(CASES[0])); c++) {
+    double best[2] = {0.0, 0.0};
+    for (uint32_t k = 0; k < 2; k++) {
+      for (uint32_t r = 0; r < BENCH_RUNS; r++) {
+        const double MBPS = _shm_tput_run((1 == k), CASES[c].frag, CASES[c].batch, secs);
+        if (0.0 > MBPS) {
+          printf("\tFailed to connect a %s pair.\n", KINDS[k]);
+          return -1;
+        }
+        best[k] = strict_max(best[k], MBPS);
+      }
+    }
+    printf("\t%-32s %10.1f MB/s %10.1f MB/s\n", CASES[c].label, best[0], best[1]);
+  }
+  return 0;
+}
+
+
+/*******************************************************************************
+* relay: Echo sessions behind a LinuxSockListener, on the reactor and the ring.
+* Clients connect to a unix socket, and each pipe the listener hands over
+*   echoes what it reads. A round sends one message on every connection, and
+*   then reads every echo back. If built with CONFIG_C3P_IO_URING, the same
+*   runs are made with the pipes on the ring, for an A/B of the two.
+*******************************************************************************/
+#define BENCH_RELAY_PATH       "/tmp/io-bench-relay.sock"
+#define BENCH_RELAY_MAX_CONNS  128    // Most connections in one run.
+#define BENCH_RELAY_MSG         64    // Bytes per message.
+
+typedef struct {
+  LinuxSockPipe* pipe;
+  BenchSink*     sink;
+} RelaySession;
+
+static RelaySession    _relay_sessions[BENCH_RELAY_MAX_CONNS];
+static uint32_t        _relay_count = 0;
+static pthread_mutex_t _relay_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/*
+* Called by the listener with each new connection. The pipe is kept, and
+*   echoes into itself.
+*/
+static int8_t _relay_new_cb(LinuxSockListener*, LinuxSockPipe* pipe) {
+  int8_t ret = 0;
+  pthread_mutex_lock(&_relay_mutex);
+  if (_relay_count < BENCH_RELAY_MAX_CONNS) {
+    BenchSink* sink = new BenchSink();
+    sink->echo = pipe;
+    pipe->readCallback(sink);
+    _relay_sessions[_relay_count].pipe = pipe;
+    _relay_sessions[_relay_count].sink = sink;
+    _relay_count++;
+    ret = 1;
+  }
+  pthread_mutex_unlock(&_relay_mutex);
+  return ret;
+}
+
+
+static uint32_t _relay_sessions_open() {
+  pthread_mutex_lock(&_relay_mutex);
+  const uint32_t RET = _relay_count;
+  pthread_mutex_unlock(&_relay_mutex);
+  return RET;
+}
+
+
+static void _relay_sessions_close() {
+  pthread_mutex_lock(&_relay_mutex);
+  for (uint32_t i = 0; i < _relay_count; i++) {
+    delete _relay_sessions[i].pipe;   // The pipe goes first, so it can't call the sink.
+    delete _relay_sessions[i].sink;
+  }
+  _relay_count = 0;
+  pthread_mutex_unlock(&_relay_mutex);
+}
+
+
+/*
+* Runs rounds over conns connections for secs seconds.
+*
+* @return echoed messages per second, or a negative value on failure.
+*/
+static double _relay_run(bool ring, uint32_t conns, double secs) {
+  #if defined(CONFIG_C3P_IO_URING)
+    LinuxUring::enabled(ring);
+  #endif
+  LinuxSockListener listener((char*) BENCH_RELAY_PATH);
+  listener.newConnectionCallback(_relay_new_cb);
+  if (0 >= listener.listen()) {
+    return -1.0;
+  }
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, BENCH_RELAY_PATH, sizeof(addr.sun_path) - 1);
+  struct timeval timeout = {1, 0};   // A lost echo fails the run, rather than hanging it.
+  int fds[BENCH_RELAY_MAX_CONNS];
+  uint32_t opened = 0;
+  while (opened < conns) {
+    const int FD = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ((FD < 0) || (0 != connect(FD, (struct sockaddr*) &addr, sizeof(addr)))) {
+      if (0 <= FD) {
+        ::close(FD);
+      }
+      break;
+    }
+    setsockopt(FD, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    fds[opened++] = FD;
+  }
+  const double T_OPEN = _now();
+  while ((_relay_sessions_open() < opened) && ((_now() - T_OPEN) < 1.0)) {
+    sleep_ms(1);
+  }
+
+  double ret = -1.0;
+  if ((opened == conns) && (_relay_sessions_open() == conns)) {
+    uint8_t msg[BENCH_RELAY_MSG];
+    uint8_t back[BENCH_RELAY_MSG];
+    memset(msg, 0x55, sizeof(msg));
+    uint64_t echoed = 0;
+    bool     lost   = false;
+    const double T0 = _now();
+    while (((_now() - T0) < secs) && !lost) {
+      for (uint32_t i = 0; i < conns; i++) {
+        if ((ssize_t) sizeof(msg) != write(fds[i], msg, sizeof(msg))) {
+          lost = true;
+        }
+      }
+      for (uint32_t i = 0; (i < conns) && !lost; i++) {
+        uint32_t got = 0;
+        while ((got < sizeof(back)) && !lost) {
+          const ssize_t N = read(fds[i], back + got, sizeof(back) - got);
+          if (N > 0) {
+            got += (uint32_t) N;
+          }
+          else if ((N < 0) && (EINTR == errno)) {
+            continue;
+          }
+          else {
+            lost = true;
+          }
+        }
+      }
+      echoed += conns;
+    }
+    if (!lost) {
+      ret = ((double) echoed / (_now() - T0));
+    }
+  }
+  for (uint32_t i = 0; i < opened; i++) {
+    ::close(fds[i]);
+  }
+  listener.close();
+  _relay_sessions_close();
+  return ret;
+}
+
+
+static int bench_relay(double secs) {
+  const uint32_t CONNS[] = {1, 16, 128};
+  const char* KINDS[2] = {"reactor", "io_uring"};
+  bool have_ring = false;
+  #if defined(CONFIG_C3P_IO_URING)
+    LinuxUring::enabled(true);
+    have_ring = (nullptr != LinuxUring::getInstance());
+  #endif
+  printf("Echo relay through LinuxSockListener, %uB messages (%.1fs per run)\n", BENCH_RELAY_MSG, secs);
+  printf("\t%-32s %15s %15s\n", "", KINDS[0], KINDS[1]);
+  for (uint32_t c = 0; c < (sizeof(CONNS) / sizeof(CONNS[0])); c++) {
+    double best[2] = {0.0, 0.0};
+    for (uint32_t k = 0; k < (have_ring ? 2 : 1); k++) {
+      for (uint32_t r = 0; r < BENCH_RUNS; r++) {
+        const double MPS = _relay_run((1 == k), CONNS[c], secs);
+        if (0.0 > MPS) {
+          printf("\tThe %s relay failed with %u connections.\n", KINDS[k], CONNS[c]);
+          return -1;
+        }
+        best[k] = strict_max(best[k], MPS);
+      }
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "%u connection%s", CONNS[c], ((1 == CONNS[c]) ? "" : "s"));
+    if (have_ring) {
+      printf("\t%-32s %9.0f msg/s %9.0f msg/s\n", label, best[0], best[1]);
+    }
+    else {
+      printf("\t%-32s %9.0f msg/s %15s\n", label, best[0], "n/a");
+    }
+  }
+  #if defined(CONFIG_C3P_IO_URING)
+    LinuxUring::shutdown();
+  #endif
+  return 0;
+}
+
+
+/*******************************************************************************
+* pty-rtt: LinuxUART round trips through a pty.
+* The UART opens the pty's slave, and a thread echoes everything that reaches
+*   the master. Each round trip runs from pushBuffer() to the read callback.
+*   A pty has no line rate, so this is the driver's latency, and not the
+*   wire's.
+*******************************************************************************/
+
+/*
+* Opens a raw pty, and a LinuxUART on its slave.
+*
+* @return the UART, or nullptr on failure. On success, *master is the pty's
+*   master, and the caller must close it.
+*/
+static LinuxUART* _pty_uart_open(uint32_t bitrate, int* master) {
+  int  slave = -1;
+  char name[64];
+  if (0 != openpty(master, &slave, name, nullptr, nullptr)) {
+    return nullptr;
+  }
+  struct termios t;
+  tcgetattr(*master, &t);
+  cfmakeraw(&t);
+  tcsetattr(*master, TCSANOW, &t);
+  UARTOpts opts;
+  memset(&opts, 0, sizeof(opts));
+  opts.bitrate      = bitrate;
+  opts.bit_per_word = 8;
+  opts.stop_bits    = UARTStopBit::STOP_1;
+  opts.parity       = UARTParityBit::NONE;
+  opts.flow_control = UARTFlowControl::NONE;
+  LinuxUART* uart = new LinuxUART(name);
+  const int8_t RET = uart->init(&opts);
+  ::close(slave);   // The UART has its own.
+  if (0 != RET) {
+    delete uart;
+    ::close(*master);
+    return nullptr;
+  }
+  return uart;
+}
+
+
+static int bench_pty_rtt(double secs) {
+  const uint32_t LENS[] = {1, 16, 512};
+  printf("LinuxUART round trips through an echoing pty (%.1fs per run)\n", secs);
+  for (uint32_t c = 0; c < (sizeof(LENS) / sizeof(LENS[0])); c++) {
+    double p50 = 0.0;
+    double p99 = 0.0;
+    for (uint32_t r = 0; r < BENCH_RUNS; r++) {
+      int master = -1;
+      LinuxUART* uart = _pty_uart_open(115200, &master);
+      if (nullptr == uart) {
+        printf("\tFailed to open a pty.\n");
+        return -1;
+      }
+      BenchSink  sink;
+      BenchDrain echo = {master, 0};
+      pthread_t  echo_thread;
+      uart->readCallback(&sink);
+      pthread_create(&echo_thread, nullptr, _echo_thread, (void*) &echo);
+      double run_p50 = 0.0;
+      double run_p99 = 0.0;
+      const int RET = _rtt_measure(uart, &sink, LENS[c], secs, &run_p50, &run_p99);
+      delete uart;   // Closes the slave, so the echo sees EIO.
+      pthread_join(echo_thread, nullptr);
+      ::close(master);
+      if (0 != RET) {
+        printf("\tThe pty lost an echo.\n");
+        return -1;
+      }
+      if ((0 == r) || (run_p50 < p50)) {
+        p50 = run_p50;
+        p99 = run_p99;
+      }
+    }
+    printf("\t%4u-byte round trip     p50 %9.1f us     p99 %9.1f us\n", LENS[c], p50, p99);
+  }
+
+  // An idle port should cost nothing.
+  int master = -1;
+  LinuxUART* uart = _pty_uart_open(115200, &master);
+  if (nullptr != uart) {
+    sleep_ms(100);
+    const uint32_t BEFORE = _reactor_dispatches();
+    sleep_ms(1000);
+    const uint32_t WAKES = _reactor_dispatches() - BEFORE;
+    delete uart;
+    ::close(master);
+    printf("\tIdle port                %u reactor wakeups/s\n", WAKES);
+  }
+  return 0;
+}
+
+
+/*******************************************************************************
+* pty-tput: Sustained LinuxUART TX through a pty.
+* A pty has no line rate of its own, so a thread stands in for the far end of
+*   a line at each bitrate, and drains the master at (bitrate / 10) bytes per
+*   second. The application keeps the driver's TX ring fed, as a firmware
+*   updater would. The figures are the share of the line that was used, and
+*   how often the reactor woke to do it.
+*******************************************************************************/
+#define BENCH_TPUT_WARMUP_SECONDS  0.5    // Time to fill the queues before measuring.
+
+typedef struct {
+  int      fd;
+  uint32_t bitrate;   // 0 drains as fast as possible.
+  uint64_t total;     // Atomic.
+  bool     running;   // Atomic.
+} BenchLine;
+
+static void* _line_thread(void* arg) {
+  BenchLine* line = (BenchLine*) arg;
+  uint8_t buf[65536];
+  double credit = 0.0;
+  double last   = _now();
+  while (__atomic_load_n(&line->running, __ATOMIC_ACQUIRE)) {
+    sleep_us(1000);
+    const double NOW = _now();
+    credit += (NOW - last) * (line->bitrate / 10.0);
+    last = NOW;
+    if (0 == line->bitrate) {
+      credit = (double) sizeof(buf);
+    }
+    while (credit >= 1.0) {
+      const size_t WANT = (size_t) strict_min(credit, (double) sizeof(buf));
+      const ssize_t N = read(line->fd, buf, WANT);
+      if (N <= 0) {
+        credit = 0.0;
+        break;
+      }
+      credit -= (double) N;
+      __atomic_fetch_add(&line->total, (uint64_t) N, __ATOMIC_RELEASE);
+    }
+    credit = strict_min(credit, 8192.0);   // No saving up while starved.
+  }
+  return nullptr;
+}
+
+
+/*
+* Keeps the UART fed for secs seconds, after a warm-up.
+*
+* @return 0 on success, or -1 if the port would not open.
+*/
+static int _pty_tput_run(uint32_t bitrate, double secs, double* bytes_per_sec, double* wakes_per_sec) {
+  int master = -1;
+  // Ask for the line rate if there is one, so the drain estimate matches it.
+  LinuxUART* uart = _pty_uart_open(((0 < bitrate) ? bitrate : 3000000), &master);
+  if (nullptr == uart) {
+    return -1;
+  }
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL, 0) | O_NONBLOCK);
+  BenchLine line = {master, bitrate, 0, true};
+  pthread_t line_thread;
+  pthread_create(&line_thread, nullptr, _line_thread, (void*) &line);
+
+  uint8_t chunk[256];
+  memset(chunk, 0x55, sizeof(chunk));
+  const double T_START = _now();
+  double   t0     = 0.0;
+  uint64_t bytes0 = 0;
+  uint32_t wakes0 = 0;
+  while ((0.0 == t0) || ((_now() - t0) < secs)) {
+    while (uart->bufferAvailable() >= (int32_t) sizeof(chunk)) {
+      StringBuilder out;
+      out.concat(chunk, (int) sizeof(chunk));
+      uart->pushBuffer(&out);
+    }
+    if ((0.0 == t0) && ((_now() - T_START) >= BENCH_TPUT_WARMUP_SECONDS)) {
+      t0     = _now();
+      bytes0 = __atomic_load_n(&line.total, __ATOMIC_ACQUIRE);
+      wakes0 = _reactor_dispatches();
+    }
+    sleep_us(500);
+  }
+  const double ELAPSED = _now() - t0;
+  *bytes_per_sec = (double) (__atomic_load_n(&line.total, __ATOMIC_ACQUIRE) - bytes0) / ELAPSED;
+  *wakes_per_sec = (double) (_reactor_dispatches() - wakes0) / ELAPSED;
+  __atomic_store_n(&line.running, false, __ATOMIC_RELEASE);
+  pthread_join(line_thread, nullptr);
+  delete uart;
+  ::close(master);
+  return 0;
+}
+
+
+static int bench_pty_tput(double secs) {
+  const uint32_t RATES[] = {115200, 460800, 921600, 3000000, 0};
+  printf("Sustained LinuxUART TX through a pty (%.1fs per run)\n", secs);
+  for (uint32_t c = 0; c < (sizeof(RATES) / sizeof(RATES[0])); c++) {
+    double best_bps   = 0.0;
+    double best_wakes = 0.0;
+    for (uint32_t r = 0; r < BENCH_RUNS; r++) {
+      double bps   = 0.0;
+      double wakes = 0.0;
+      if (0 != _pty_tput_run(RATES[c], secs, &bps, &wakes)) {
+        printf("\tFailed to open a pty at %ubps.\n", RATES[c]);
+        return -1;
+      }
+      if (bps > best_bps) {
+        best_bps   = bps;
+        best_wakes = wakes;
+      }
+    }
+    const double PER_WAKE = (0.0 < best_wakes) ? (best_bps / best_wakes) : 0.0;
+    if (0 < RATES[c]) {
+      printf("\t%8u bps   %5.1f%% of line   %7.0f wakeups/s   %6.1f B/wakeup\n", RATES[c], (100.0 * best_bps) / (RATES[c] / 10.0), best_wakes, PER_WAKE);
+    }
+    else {
+      printf("\tunthrottled    %6.2f MB/s       %7.0f wakeups/s   %6.1f B/wakeup\n", best_bps / 1000000.0, best_wakes, PER_WAKE);
+    }
+  }
+  return 0;
+}
+
+
+/*******************************************************************************
+* The main function.                                                           *
+*******************************************************************************/
+
+static const BenchDef BENCHES[] = {
+  {"sock",  "LinuxSockPipe TX throughput over a socketpair.", bench_sock},
+  {"sock-rx", "LinuxSockPipe RX throughput over a socketpair.", bench_sock_rx},
+  {"shm",   "LinuxShmPipe vs. LinuxSockPipe latency and throughput.", bench_shm},
+  {"relay", "Echo sessions behind a listener, on the reactor and on io_uring.", bench_relay},
+  {"pty-rtt", "LinuxUART round-trip latency through a pty.", bench_pty_rtt},
+  {"pty-tput", "Sustained LinuxUART TX through a pty, at several line rates.", bench_pty_tput},
+};
+static const uint32_t BENCH_COUNT = (sizeof(BENCHES) / sizeof(BENCHES[0]));
+
+
+static void _usage(const char* name) {
+  printf("%s %s\nUsage: %s <test> [seconds-per-run]\n", name, PROGRAM_VERSION, name);
+  for (uint32_t i = 0; i < BENCH_COUNT; i++) {
+    printf("\t%-10s %s\n", BENCHES[i].name, BENCHES[i].desc);
+  }
+}
+
+
+int main(int argc, const char* argv[]) {
+  if (2 > argc) {
+    _usage(argv[0]);
+    return 1;
+  }
+  const double SECS = (2 < argc) ? strtod(argv[2], nullptr) : (double) BENCH_DEFAULT_SECONDS;
+  for (uint32_t i = 0; i < BENCH_COUNT; i++) {
+    if (0 == strcmp(argv[1], BENCHES[i].name)) {
+      const int RET = BENCHES[i].fxn((0.0 < SECS) ? SECS : (double) BENCH_DEFAULT_SECONDS);
+      LinuxReactor::shutdown();
+      return RET;
+    }
+  }
+  _usage(argv[0]);
+  return 1;
+}
@@ -113,11 +113,18 @@ LinuxStdIO console_adapter;
 LinuxSockPipe socket_adapter;
 LinkedList<LinkSockPair*> active_links;
 
+/* Main-loop latency, for the `perf` console command. */
+C3P_PERF_HISTOGRAM(_perf_link_poll, "M2MLink::poll");
+C3P_PERF_HISTOGRAM(_perf_service_schedules, "C3PScheduler::serviceSchedules");
+
 int8_t new_socket_connection_callback(LinuxSockListener* svr, LinuxSockPipe* pipe) {
   int8_t ret = 0;   // We should reject by default.
   c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, "New socket connection.");
   M2MLink* new_link = new M2MLink(&link_opts);
   if (nullptr != new_link) {
+    if (LinuxSockTransport::TCP == pipe->transport()) {
+      pipe->sockOpt(LinuxSockOpt::NODELAY, 1);   // Don't hold back ACKs and KAs.
+    }
     active_links.insert(new LinkSockPair(pipe, new_link));
     m_link = new_link;
     ret = 1;   // Accept connection.
@@ -240,7 +247,7 @@ int callback_uart_tools(StringBuilder* text_return, StringBuilder* args) {
           text_return->concat("Attempting to set bitrate on UART...\n");
           break;
         default:
-          text_return->concatf("UART bitrate is %u\n", uart->uartOpts()->bitrate);
+          text_return->concatf("UART bitrate is %u (kernel reports %u)\n", uart->uartOpts()->bitrate, uart->bitrateActual());
           break;
       }
     }
@@ -343,6 +350,7 @@ int main(int argc, const char *argv[]) {
   for (int i = 1; i < argc; i++) {
     if ((strcasestr(argv[i], "--help")) || (strcasestr(argv[i], "-h"))) {
       printf("-u  --uart <path>   Instance a UART to talk to the hardware.\n");
+      printf("-L  --listen <addr> Accept connections on a unix socket, or host:port.\n");
       printf("-h  --help          Print this output and exit.\n");
       printf("-c  --conf          Use a non-default conf blob.\n");
       printf("    --conf-dump     Load the program configuration, dump it, and exit.\n");
@@ -379,7 +387,7 @@ int main(int argc, const char *argv[]) {
       }
       else if ((strcasestr(argv[i], "--listen")) || (strcasestr(argv[i], "-L"))) {
         if (argc - i < 2) {  // Mis-use of flag...
-          printf("Using --listen means you must supply a path.\n");
+          printf("Using --listen means you must supply a path or host:port.\n");
           exit(1);
         }
         i++;
@@ -426,7 +434,10 @@ int main(int argc, const char *argv[]) {
       c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, &output);
       do {   // The main loop. Run until told to stop.
         if (nullptr != m_link) {
-          m_link->poll(&output);
+          {
+            C3P_PERF_SCOPE(_perf_link_poll);
+            m_link->poll(&output);
+          }
           if (!output.isEmpty()) {
             console.printToLog(&output);
           }
@@ -436,8 +447,9 @@ int main(int argc, const char *argv[]) {
           uart->poll();
         }
 
+        C3P_PERF_SCOPE(_perf_service_schedules);
         scheduler->serviceSchedules();
-      } while (continue_running);   // GUI thread handles the heavy-lifting.
+      } while (continue_running && (0 == platform.shutdownRequested()));   // GUI thread handles the heavy-lifting.
     }
     else {
       c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to create the root GUI window (not great, not terrible).");
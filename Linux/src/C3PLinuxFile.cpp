@@ -28,12 +28,101 @@ Simple file handler for Linux.
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+
+#if defined(CONFIG_C3P_IO_URING)
+  #include "../C3PLinux.h"
+#endif
 
 // NOTE: This is not the maximum file size that can be loaded. It is the chunk
 //   size that will be loaded per-call. The maximum file size is not
 //   constrained by anything but the heap availability.
 #define FILE_BUFFER_SIZE 4096
 
+#if defined(CONFIG_C3P_IO_URING)
+  #ifndef CONFIG_C3P_IO_URING_FILE_CHUNK
+    // Bytes per read that a file hands to the ring.
+    #define CONFIG_C3P_IO_URING_FILE_CHUNK  65536
+  #endif
+  #define FILE_WRITE_IOV  CONFIG_C3P_IO_URING_CHAIN
+#else
+  #define FILE_WRITE_IOV  16
+#endif
+
+
+#if defined(CONFIG_C3P_IO_URING)
+/*
+* Reads the file through the ring, with up to CONFIG_C3P_IO_URING_CHAIN chunks
+*   in flight per submission. The chunks become fragments of the buffer
+*   without being copied.
+*
+* @return the number of bytes read, which is 0 if the ring isn't available.
+*/
+static ulong _file_read_ring(int fd, ulong fsize, StringBuilder* buf) {
+  LinuxUring* ring = LinuxUring::getInstance();
+  if ((nullptr == ring) || (0 == fsize) || ring->onRingThread()) {
+    return 0;
+  }
+  ulong total   = 0;
+  bool  stopped = false;
+  struct iovec iov[CONFIG_C3P_IO_URING_CHAIN];
+  size_t wanted[CONFIG_C3P_IO_URING_CHAIN];
+  while (!stopped && (total < fsize)) {
+    int count = 0;
+    ulong planned = total;
+    while ((planned < fsize) && (count < CONFIG_C3P_IO_URING_CHAIN)) {
+      wanted[count] = (size_t) strict_min((ulong) CONFIG_C3P_IO_URING_FILE_CHUNK, (fsize - planned));
+      iov[count].iov_base = malloc(wanted[count]);
+      iov[count].iov_len  = wanted[count];
+      if (nullptr == iov[count].iov_base) {
+        break;
+      }
+      planned += wanted[count];
+      count++;
+    }
+    if (0 == count) {
+      break;
+    }
+    const int32_t RET = ring->transfer(fd, false, iov, count, total);
+    stopped = (RET <= 0);
+    for (int i = 0; i < count; i++) {
+      const size_t GOT = iov[i].iov_len;
+      if (stopped || (0 == GOT)) {
+        free(iov[i].iov_base);
+        stopped = true;
+        continue;
+      }
+      uint8_t* chunk = (uint8_t*) iov[i].iov_base;
+      if (GOT < wanted[i]) {
+        uint8_t* trimmed = (uint8_t*) realloc(chunk, GOT);
+        chunk = ((nullptr != trimmed) ? trimmed : chunk);
+        stopped = true;   // The file is shorter than it was.
+      }
+      buf->concatHandoffRaw(chunk, (int) GOT);
+      total += GOT;
+    }
+  }
+  return total;
+}
+#endif  // CONFIG_C3P_IO_URING
+
+
+/*
+* Writes a batch of buffers at the given offset, through the ring if there is
+*   one.
+*
+* @return the number of bytes written, or <0 on failure.
+*/
+static int32_t _file_write_batch(int fd, struct iovec* iov, int count, off_t offset) {
+  #if defined(CONFIG_C3P_IO_URING)
+    LinuxUring* ring = LinuxUring::getInstance();
+    if ((nullptr != ring) && !ring->onRingThread()) {
+      return ring->transfer(fd, true, iov, count, (uint64_t) offset);
+    }
+  #endif
+  return (int32_t) pwritev(fd, iov, count, offset);
+}
+
 
 C3PFile::C3PFile(char* p) {
   memset(_mode, 0, sizeof(_mode));
@@ -68,8 +157,16 @@ int32_t C3PFile::read(StringBuilder* buf) {
   int fd = open(_path, O_RDONLY);
   if (fd >= 0) {
     ulong total_read = 0;
+    #if defined(CONFIG_C3P_IO_URING)
+      total_read = _file_read_ring(fd, _fsize, buf);
+      if ((0 < total_read) && (total_read < _fsize)) {
+        lseek(fd, (off_t) total_read, SEEK_SET);   // The loop below picks up where it stopped.
+      }
+    #endif
     uint8_t self_mass[FILE_BUFFER_SIZE];
-    do {
+    bool first_pass = (0 == total_read);   // A file of unknown size gets one read.
+    while (first_pass || (total_read < _fsize)) {
+      first_pass = false;
       int r_len = ::read(fd, self_mass, FILE_BUFFER_SIZE);
       if ((r_len > 0) || (0 == _fsize)) {
         buf->concat(self_mass, r_len);
@@ -80,7 +177,7 @@ int32_t C3PFile::read(StringBuilder* buf) {
         c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Aborting read due to zero byte return. %s", _path);
         total_read = _fsize;
       }
-    } while (total_read < _fsize);
+    }
     if (_fsize == total_read) {
       return_value = (int32_t) total_read;
     }
@@ -97,8 +194,56 @@ int32_t C3PFile::read(StringBuilder* buf) {
 
 
 
+/*
+* Replaces the file's contents with the buffer, which is not changed. The
+*   buffer's fragments are written as they are, without being collapsed.
+*
+* @return the number of bytes written on success, or <0 on failure.
+*/
 int32_t C3PFile::write(StringBuilder* buf) {
-  return -1;
+  int32_t return_value = -1;
+  int fd = open(_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd >= 0) {
+    struct iovec iov[FILE_WRITE_IOV];
+    int32_t total_written = 0;
+    int frags = 0;
+    bool done = false;
+    while (!done) {
+      int count = 0;
+      int32_t batch_len = 0;
+      while (count < FILE_WRITE_IOV) {
+        int frag_len = 0;
+        uint8_t* frag = buf->position(frags, &frag_len);
+        if (nullptr == frag) {
+          done = true;
+          break;
+        }
+        frags++;
+        if (0 < frag_len) {
+          iov[count].iov_base = frag;
+          iov[count].iov_len  = (size_t) frag_len;
+          batch_len += frag_len;
+          count++;
+        }
+      }
+      if (0 < count) {
+        const int32_t RET = _file_write_batch(fd, iov, count, (off_t) total_written);
+        if (RET != batch_len) {
+          c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to write %s after %d bytes.", _path, total_written);
+          total_written = -1;
+          break;
+        }
+        total_written += RET;
+      }
+    }
+    close(fd);
+    return_value = total_written;
+    _fill_from_stat();
+  }
+  else {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to open path for writing: %s", _path);
+  }
+  return return_value;
 }
 
 
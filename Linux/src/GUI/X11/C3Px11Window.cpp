@@ -9,6 +9,8 @@
 
 const char* const LOG_TAG = "C3Px11Window";
 
+C3P_PERF_HISTOGRAM(_perf_gui_poll, "C3Px11Window::poll");
+
 
 /*******************************************************************************
 * This is a thread to run the GUI.
@@ -17,7 +19,11 @@ void* gui_thread_handler(void* _ptr) {
   c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Started GUI thread.");
   C3Px11Window* ptr = (C3Px11Window*) _ptr;
   // The thread's polling loop. Repeat forever until told otherwise.
-  while (ptr->keepPolling() && 0 <= ptr->poll()) {}
+  int8_t poll_ret = 0;
+  while (ptr->keepPolling() && (0 <= poll_ret)) {
+    C3P_PERF_SCOPE(_perf_gui_poll);
+    poll_ret = ptr->poll();
+  }
   c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Exiting GUI thread...");
   ptr->_thread_id = 0;
   return nullptr;
@@ -105,7 +111,10 @@ int8_t C3Px11Window::_init_window() {
         Atom WM_DELETE_WINDOW = XInternAtom(_dpy, "WM_DELETE_WINDOW", False);
         XSetWMProtocols(_dpy, _win, &WM_DELETE_WINDOW, 1);
         _keep_polling = true;
-        platform.createThread(&_thread_id, nullptr, gui_thread_handler, (void*) this, nullptr);
+        PlatformThreadOpts topts;
+        memset(&topts, 0, sizeof(topts));
+        topts.thread_name = (char*) "C3Px11Window";
+        platform.createThread(&_thread_id, nullptr, gui_thread_handler, (void*) this, &topts);
         ret = 0;
       }
     }
@@ -26,10 +26,22 @@ This file forms the catch-all for linux platforms that have no specific support.
 #include <sys/time.h>
 #include <unistd.h>
 #include <signal.h>
+#include <errno.h>
 #include <syslog.h>
 #include <sys/utsname.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <sys/random.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "Console/C3PConsole.h"
 #if defined(CONFIG_C3P_STORAGE)
-  #include <fcntl.h>      // Needed for integrity checks.
   #include <sys/stat.h>   // Needed for integrity checks.
 #endif
 
@@ -39,6 +51,72 @@ This file forms the catch-all for linux platforms that have no specific support.
   #define CONFIG_C3P_INTERVAL_PERIOD_MS  10
 #endif
 
+#ifndef CONFIG_C3P_SCHED_DEFAULT_MODE
+  // Unless otherwise specified, the scheduler timer will run in periodic mode.
+  #define CONFIG_C3P_SCHED_DEFAULT_MODE  LinuxSchedMode::TICK
+#endif
+
+#ifndef CONFIG_C3P_SCHED_JITTER_SAMPLES
+  // How many of the most recent scheduler wakeups are kept for jitter stats.
+  #define CONFIG_C3P_SCHED_JITTER_SAMPLES  1024
+#endif
+
+#ifndef CONFIG_C3P_SCHED_TICKLESS_MAX_SLEEP_MS
+  // In tickless mode, the scheduler will still wake at least this often, in
+  //   case a schedule was added without a call to kickScheduler().
+  #define CONFIG_C3P_SCHED_TICKLESS_MAX_SLEEP_MS  1000
+#endif
+
+#ifndef CONFIG_C3P_SCHED_BENCH_MAX_SECONDS
+  // `sched bench` blocks the console for six runs of this many seconds, at most.
+  #define CONFIG_C3P_SCHED_BENCH_MAX_SECONDS  5
+#endif
+
+#ifndef CONFIG_C3P_THREAD_PARK_TIMEOUT_MS
+  // suspendThread() will return after this long, even if nothing woke it.
+  #define CONFIG_C3P_THREAD_PARK_TIMEOUT_MS  100
+#endif
+
+#ifndef CONFIG_C3P_LOG_RING_SLOTS
+  // How many messages each logging thread may have in flight. Power of two.
+  #define CONFIG_C3P_LOG_RING_SLOTS  64
+#endif
+
+#ifndef CONFIG_C3P_LOG_SLOT_SIZE
+  // Longer messages are truncated.
+  #define CONFIG_C3P_LOG_SLOT_SIZE   256
+#endif
+
+#ifndef CONFIG_C3P_LOG_BATCH_MAX
+  // The most messages handed to a single writev().
+  #define CONFIG_C3P_LOG_BATCH_MAX   64
+#endif
+
+#ifndef CONFIG_C3P_LOG_DEFAULT_VERBOSITY
+  #define CONFIG_C3P_LOG_DEFAULT_VERBOSITY  LOG_LEV_DEBUG
+#endif
+
+#if defined(CONFIG_C3P_FLIGHT_RECORDER)
+  #include "../C3PFlightRecorder.h"
+
+  #ifndef CONFIG_C3P_FLIGHT_RECORDER_PATH
+    // Formatted with our PID.
+    #define CONFIG_C3P_FLIGHT_RECORDER_PATH     "/dev/shm/c3p-%d.ring"
+  #endif
+  #ifndef CONFIG_C3P_FLIGHT_RECORDER_RECORDS
+    // Slots in the ring. Power of two.
+    #define CONFIG_C3P_FLIGHT_RECORDER_RECORDS  8192
+  #endif
+  #ifndef CONFIG_C3P_FLIGHT_RECORDER_REC_SIZE
+    // Bytes per slot, including the 32-byte record header. Multiple of 8.
+    #define CONFIG_C3P_FLIGHT_RECORDER_REC_SIZE 128
+  #endif
+  #ifndef CONFIG_C3P_FLIGHT_RECORDER_TAGS
+    // Distinct tags whose text is kept. Power of two.
+    #define CONFIG_C3P_FLIGHT_RECORDER_TAGS     512
+  #endif
+#endif
+
 #ifndef CONFIG_C3P_CRYPTO_QUEUE_MAX_DEPTH
   // Unless otherwise specified, the cryptographic processing queue depth is 32.
   #define CONFIG_C3P_CRYPTO_QUEUE_MAX_DEPTH  32
@@ -48,6 +126,11 @@ This file forms the catch-all for linux platforms that have no specific support.
   #define PLATFORM_RNG_CARRY_CAPACITY  1024
 #endif
 
+#ifndef PLATFORM_RNG_LOW_WATER_MARK
+  // The RNG thread is woken to refill the pool when it drops below this many words.
+  #define PLATFORM_RNG_LOW_WATER_MARK  (PLATFORM_RNG_CARRY_CAPACITY / 2)
+#endif
+
 
 
 #define MANUVR_INIT_STATE_UNINITIALIZED   0
@@ -77,9 +160,6 @@ AbstractPlatform* platformObj() {   return (AbstractPlatform*) &platform;   }
   long unsigned int crypto_thread_id = 0;
 #endif
 
-struct itimerval _interval              = {0};
-struct sigaction _signal_action_SIGALRM = {0};
-
 char* _binary_name = nullptr;
 static int   _main_pid    = 0;
 
@@ -88,69 +168,463 @@ static int   _main_pid    = 0;
 /*******************************************************************************
 * Signal catching code.                                                        *
 *******************************************************************************/
+/*
+* Set by the signal handler to the signal that asked us to stop. The handler
+*   may only do async-signal-safe work, so the shutdown itself is left to the
+*   application's main loop, which is expected to watch shutdownRequested().
+*/
+static volatile sig_atomic_t _shutdown_signal = 0;
+
 /*
 * This function is the signal handler for the basal platform. All other signals
 *   are left for optional application usage.
 */
 void _platform_sig_handler(int signo) {
   switch (signo) {
-    case SIGKILL:
-      printf("Received a SIGKILL signal. Something bad must have happened.\n");
-    case SIGINT:    // CTRL+C will cause an immediate shutdown.
-      platform.firmware_shutdown(1);   // TODO: Would be nice to give this to the application.
-      break;
+    case SIGINT:    // CTRL+C
     case SIGTERM:
-      printf("Received a SIGTERM signal.\n");
-      platform.firmware_shutdown(1);   // TODO: Would be nice to give this to the application.
+      if (0 != _shutdown_signal) {
+        _exit(128 + signo);   // Asked twice. The application isn't listening.
+      }
+      _shutdown_signal = signo;
+      break;
+    default:
+      break;
+  }
+}
+
+
+/*******************************************************************************
+* Futex wrappers                                                               *
+*******************************************************************************/
+/*
+* Blocks until the word at addr is woken, or no longer holds expected, or the
+*   timeout (in milliseconds) expires. A timeout of 0 means forever.
+*
+* @return 0 if woken, -1 on timeout, mismatch, or interruption.
+*/
+static int _futex_wait(uint32_t* addr, uint32_t expected, uint32_t timeout_ms) {
+  struct timespec ts;
+  struct timespec* ts_ptr = nullptr;
+  if (0 < timeout_ms) {
+    ts.tv_sec  = (time_t) (timeout_ms / 1000);
+    ts.tv_nsec = (long) ((timeout_ms % 1000) * 1000000UL);
+    ts_ptr = &ts;
+  }
+  return (int) syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, ts_ptr, nullptr, 0);
+}
+
+/*
+* Wakes up to count threads blocked on the word at addr.
+*
+* @return the number of threads woken.
+*/
+static int _futex_wake(uint32_t* addr, int count) {
+  return (int) syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+
+/*******************************************************************************
+* Scheduler thread                                                             *
+*******************************************************************************/
+/*
+* The scheduler used to be driven by SIGALRM. That ran the scheduler in signal
+*   context, and sprayed EINTR into every blocking call in the process. Now a
+*   dedicated thread blocks in epoll_wait() on a timerfd, and an eventfd that is
+*   used to wake the thread for reconfiguration and shutdown.
+*/
+static long unsigned int sched_thread_id = 0;
+static int  _sched_timer_fd = -1;
+static int  _sched_event_fd = -1;
+static volatile bool _sched_running = false;
+static volatile LinuxSchedMode _sched_mode = CONFIG_C3P_SCHED_DEFAULT_MODE;
+static SchedDeadlineFxn _sched_deadline_fxn = nullptr;
+
+/* Tick jitter is the lateness of each wakeup, relative to its absolute deadline.
+     The scheduler thread writes these, and the console reads them, so both
+     hold _sched_stats_mutex. */
+static pthread_mutex_t _sched_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t _sched_jitter_samples[CONFIG_C3P_SCHED_JITTER_SAMPLES];
+static uint32_t _sched_wakeups   = 0;   // Total timer wakeups.
+static uint32_t _sched_overruns  = 0;   // Expirations that were missed entirely.
+static uint32_t _sched_late_max  = 0;   // Worst lateness ever observed (us).
+static uint32_t _sched_rearms    = 0;   // Tickless re-arms due to kickScheduler().
+static uint64_t _sched_stats_epoch_ns = 0;
+
+
+static const char* _sched_mode_str(LinuxSchedMode m) {
+  switch (m) {
+    case LinuxSchedMode::TICK:      return "TICK";
+    case LinuxSchedMode::ONESHOT:   return "ONESHOT";
+    case LinuxSchedMode::TICKLESS:  return "TICKLESS";
+    default:  break;
+  }
+  return "UNKNOWN";
+}
+
+
+/* Returns the raw CLOCK_MONOTONIC time in nanoseconds. */
+static uint64_t _mono_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000000ULL) + (uint64_t) ts.tv_nsec;
+}
+
+
+/*
+* Arms the timerfd to fire at an absolute CLOCK_MONOTONIC time. If the period
+*   is zero, the timer will fire only once.
+*/
+static int _sched_arm_timer(uint64_t deadline_ns, uint64_t period_ns) {
+  struct itimerspec its;
+  its.it_value.tv_sec     = (time_t) (deadline_ns / 1000000000ULL);
+  its.it_value.tv_nsec    = (long)   (deadline_ns % 1000000000ULL);
+  its.it_interval.tv_sec  = (time_t) (period_ns / 1000000000ULL);
+  its.it_interval.tv_nsec = (long)   (period_ns % 1000000000ULL);
+  return timerfd_settime(_sched_timer_fd, TFD_TIMER_ABSTIME, &its, nullptr);
+}
+
+
+static void _sched_record_lateness(uint64_t lateness_ns, uint32_t overruns) {
+  const uint64_t LATE_US_WIDE = (lateness_ns / 1000ULL);
+  const uint32_t LATE_US = (LATE_US_WIDE > 0xFFFFFFFFULL) ? 0xFFFFFFFF : (uint32_t) LATE_US_WIDE;
+  pthread_mutex_lock(&_sched_stats_mutex);
+  _sched_jitter_samples[_sched_wakeups % CONFIG_C3P_SCHED_JITTER_SAMPLES] = LATE_US;
+  _sched_late_max = strict_max(_sched_late_max, LATE_US);
+  _sched_wakeups++;
+  _sched_overruns += overruns;
+  pthread_mutex_unlock(&_sched_stats_mutex);
+}
+
+
+/*
+* Clamps a tickless deadline so that the timer fires no earlier than now, and
+*   no later than CONFIG_C3P_SCHED_TICKLESS_MAX_SLEEP_MS from now.
+*/
+static uint64_t _sched_tickless_clamp(uint64_t now_ns, uint64_t due_ns) {
+  const uint64_t LIMIT = now_ns + ((uint64_t) CONFIG_C3P_SCHED_TICKLESS_MAX_SLEEP_MS * 1000000ULL);
+  return strict_min(strict_max(due_ns, now_ns), LIMIT);
+}
+
+
+/*
+* Returns the absolute CLOCK_MONOTONIC time at which the tickless timer should
+*   next fire. With nothing pending, that is the longest allowed sleep.
+*/
+static uint64_t _sched_next_deadline() {
+  const uint64_t NOW = _mono_ns();
+  const SchedDeadlineFxn FXN = __atomic_load_n(&_sched_deadline_fxn, __ATOMIC_ACQUIRE);
+  uint32_t due_in_us = 0;
+  if ((nullptr != FXN) && FXN(&due_in_us)) {
+    return _sched_tickless_clamp(NOW, NOW + ((uint64_t) due_in_us * 1000ULL));
+  }
+  return _sched_tickless_clamp(NOW, UINT64_MAX);
+}
+
+
+/*
+* Arms the timer for the first time after a change of mode.
+*/
+static uint64_t _sched_arm_for_mode(LinuxSchedMode mode) {
+  const uint64_t PERIOD_NS = (uint64_t) CONFIG_C3P_INTERVAL_PERIOD_MS * 1000000ULL;
+  uint64_t deadline = 0;
+  switch (mode) {
+    case LinuxSchedMode::TICK:
+      deadline = _mono_ns() + PERIOD_NS;
+      _sched_arm_timer(deadline, PERIOD_NS);
       break;
-    case SIGVTALRM:
-      printf("Received a SIGVTALRM signal.\n");
-      // NOTE: No break;
-    case SIGALRM:
-      // Any periodic platform actions should be done here.
-      C3PScheduler::getInstance()->advanceScheduler();
+    case LinuxSchedMode::TICKLESS:
+      deadline = _sched_next_deadline();
+      _sched_arm_timer(deadline, 0);
       break;
+    case LinuxSchedMode::ONESHOT:
     default:
-      printf("Unhandled signal: %d\n", signo);
+      deadline = _mono_ns() + PERIOD_NS;
+      _sched_arm_timer(deadline, 0);
+      break;
+  }
+  return deadline;
+}
+
+
+/**
+* This is the thread that advances the scheduler.
+*/
+C3P_PERF_HISTOGRAM(_perf_sched_advance, "C3PScheduler::advance");
+
+static void* scheduler_thread_handler(void*) {
+  const uint64_t PERIOD_NS = (uint64_t) CONFIG_C3P_INTERVAL_PERIOD_MS * 1000000ULL;
+  // Signals belong to the main thread.
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGINT);
+  sigaddset(&set, SIGTERM);
+  sigaddset(&set, SIGHUP);
+  sigaddset(&set, SIGQUIT);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (0 > epfd) {
+    printf("Scheduler thread failed to create epoll instance.\n");
+    sched_thread_id = 0;
+    return nullptr;
+  }
+  struct epoll_event ev;
+  ev.events  = EPOLLIN;
+  ev.data.fd = _sched_timer_fd;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, _sched_timer_fd, &ev);
+  ev.data.fd = _sched_event_fd;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, _sched_event_fd, &ev);
+
+  LinuxSchedMode armed_mode = _sched_mode;
+  uint64_t deadline = _sched_arm_for_mode(armed_mode);
+  pthread_mutex_lock(&_sched_stats_mutex);
+  _sched_stats_epoch_ns = _mono_ns();
+  pthread_mutex_unlock(&_sched_stats_mutex);
+
+  while (_sched_running) {
+    struct epoll_event evs[2];
+    const int EV_COUNT = epoll_wait(epfd, evs, 2, -1);
+    if (0 > EV_COUNT) {
+      if (EINTR == errno) continue;
       break;
+    }
+    for (int i = 0; i < EV_COUNT; i++) {
+      uint64_t val = 0;
+      if (evs[i].data.fd == _sched_event_fd) {
+        // Reconfiguration, shutdown, or a change in the schedule.
+        if (sizeof(val) == read(_sched_event_fd, &val, sizeof(val))) {
+          if (!_sched_running) {
+            // Let the loop condition handle it.
+          }
+          else if (armed_mode != _sched_mode) {
+            armed_mode = _sched_mode;
+            deadline   = _sched_arm_for_mode(armed_mode);
+          }
+          else if (LinuxSchedMode::TICKLESS == armed_mode) {
+            // Only re-arm if something became due earlier than we planned.
+            const uint64_t NU_DEADLINE = _sched_next_deadline();
+            if (NU_DEADLINE < deadline) {
+              deadline = NU_DEADLINE;
+              _sched_arm_timer(deadline, 0);
+              pthread_mutex_lock(&_sched_stats_mutex);
+              _sched_rearms++;
+              pthread_mutex_unlock(&_sched_stats_mutex);
+            }
+          }
+        }
+      }
+      else if (evs[i].data.fd == _sched_timer_fd) {
+        if (sizeof(val) == read(_sched_timer_fd, &val, sizeof(val))) {
+          const uint64_t NOW = _mono_ns();
+          // If more than one expiration elapsed, we measure against the last.
+          const uint64_t LAST_DEADLINE = deadline + ((val - 1) * PERIOD_NS);
+          _sched_record_lateness(((NOW > LAST_DEADLINE) ? (NOW - LAST_DEADLINE) : 0), (uint32_t) (val - 1));
+          {
+            C3P_PERF_SCOPE(_perf_sched_advance);
+            C3PScheduler::getInstance()->advanceScheduler();
+          }
+          switch (armed_mode) {
+            case LinuxSchedMode::TICK:
+              deadline += (val * PERIOD_NS);
+              break;
+            case LinuxSchedMode::TICKLESS:
+              deadline = _sched_next_deadline();
+              _sched_arm_timer(deadline, 0);
+              break;
+            case LinuxSchedMode::ONESHOT:
+            default:
+              deadline = _mono_ns() + PERIOD_NS;
+              _sched_arm_timer(deadline, 0);
+              break;
+          }
+        }
+      }
+    }
+  }
+  close(epfd);
+  sched_thread_id = 0;
+  return nullptr;
+}
+
+
+/*
+* Sets up the timer and the thread that services it.
+*
+* @return 0 on success, -1 on failure to allocate fds, -2 on thread failure.
+*/
+int8_t LinuxPlatform::_init_scheduler_thread() {
+  int8_t ret = -1;
+  _sched_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  _sched_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if ((0 <= _sched_timer_fd) && (0 <= _sched_event_fd)) {
+    ret--;
+    _sched_running = true;
+    PlatformThreadOpts topts;
+    memset(&topts, 0, sizeof(topts));
+    topts.thread_name = (char*) "C3PScheduler";
+    if (0 == createThread(&sched_thread_id, nullptr, scheduler_thread_handler, nullptr, &topts)) {
+      ret = 0;
+    }
+    else {
+      _sched_running = false;
+      printf("Failed to create scheduler thread.\n");
+    }
+  }
+  else {
+    printf("Failed to create scheduler timer.\n");
+  }
+  return ret;
+}
+
+
+/*
+* Used to tear down the scheduler thread.
+*/
+static void _deinit_scheduler_thread() {
+  if (_sched_running) {
+    const uint64_t VAL = 1;
+    _sched_running = false;
+    if (sizeof(VAL) == write(_sched_event_fd, &VAL, sizeof(VAL))) {
+      pthread_join((pthread_t) sched_thread_id, nullptr);
+    }
+  }
+  if (0 <= _sched_timer_fd) {
+    close(_sched_timer_fd);
+    _sched_timer_fd = -1;
+  }
+  if (0 <= _sched_event_fd) {
+    close(_sched_event_fd);
+    _sched_event_fd = -1;
+  }
+}
+
+
+LinuxSchedMode LinuxPlatform::schedulerMode() {   return _sched_mode;   }
+
+
+/*
+* Changes the timer mode. The scheduler thread will re-arm its timer.
+*
+* @return 0 on success, -1 if the scheduler thread isn't running, or -2 if
+*   TICKLESS was asked for without a deadline source.
+*/
+int8_t LinuxPlatform::schedulerMode(LinuxSchedMode nu_mode) {
+  if ((LinuxSchedMode::TICKLESS == nu_mode) && (nullptr == __atomic_load_n(&_sched_deadline_fxn, __ATOMIC_ACQUIRE))) {
+    return -2;
   }
+  _sched_mode = nu_mode;
+  if (_sched_running) {
+    const uint64_t VAL = 1;
+    if (sizeof(VAL) == write(_sched_event_fd, &VAL, sizeof(VAL))) {
+      return 0;
+    }
+  }
+  return -1;
 }
 
 
 /*
-* Used to setup the periodic alarm.
-* Uses a real timer, rather than the PID's execution time.
+* Sets the function that will be asked for the next deadline in TICKLESS mode.
+*   Clearing it while in TICKLESS mode drops the scheduler back to ONESHOT.
 */
-bool set_linux_interval_timer() {
-  _signal_action_SIGALRM.sa_handler = &_platform_sig_handler;
-  //sigaction(SIGVTALRM, &_signal_action_SIGALRM, NULL);
-  sigaction(SIGALRM, &_signal_action_SIGALRM, NULL);
+void LinuxPlatform::schedulerDeadlineSource(SchedDeadlineFxn fxn) {
+  __atomic_store_n(&_sched_deadline_fxn, fxn, __ATOMIC_RELEASE);
+  if ((nullptr == fxn) && (LinuxSchedMode::TICKLESS == _sched_mode)) {
+    c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Deadline source cleared. Scheduler is now ONESHOT.");
+    schedulerMode(LinuxSchedMode::ONESHOT);
+  }
+  else {
+    kickScheduler();
+  }
+}
 
-  _interval.it_value.tv_sec      = 0;
-  _interval.it_value.tv_usec     = CONFIG_C3P_INTERVAL_PERIOD_MS * 1000;
-  _interval.it_interval.tv_sec   = 0;
-  _interval.it_interval.tv_usec  = CONFIG_C3P_INTERVAL_PERIOD_MS * 1000;
 
-  int err = setitimer(ITIMER_REAL, &_interval, nullptr);
-  if (err) {
-    printf("Failed to enable interval timer.\n");
+/*
+* Tells the scheduler thread that the schedule has changed. In TICKLESS mode,
+*   the timer will be re-armed if something is now due sooner than planned.
+*   addSchedule() does this itself. Anything else that adds a schedule, or
+*   shortens one, should call it afterward.
+*/
+void LinuxPlatform::kickScheduler() {
+  if (_sched_running) {
+    const uint64_t VAL = 1;
+    if (sizeof(VAL) != write(_sched_event_fd, &VAL, sizeof(VAL))) {
+      // The eventfd counter is saturated, so a wakeup is already pending.
+    }
   }
-  return (0 == err);
 }
 
 
 /*
-* Used to tear down the periodic alarm.
+* Adds a schedule to C3PScheduler, and re-arms a tickless timer if the new
+*   schedule is due before it would have fired.
+*
+* @return whatever C3PScheduler::addSchedule() returned.
 */
-bool unset_linux_interval_timer() {
-  _signal_action_SIGALRM.sa_handler = SIG_IGN;
-  sigaction(SIGALRM, &_signal_action_SIGALRM, NULL);
+int8_t LinuxPlatform::addSchedule(C3PSchedule* sched) {
+  const int8_t RET = C3PScheduler::getInstance()->addSchedule(sched);
+  kickScheduler();
+  return RET;
+}
 
-  _interval.it_value.tv_sec      = 0;
-  _interval.it_value.tv_usec     = 0;
-  _interval.it_interval.tv_sec   = 0;
-  _interval.it_interval.tv_usec  = 0;
-  return true;
+
+static int _uint32_cmp(const void* a, const void* b) {
+  const uint32_t A = *((const uint32_t*) a);
+  const uint32_t B = *((const uint32_t*) b);
+  return ((A > B) - (A < B));
+}
+
+
+void LinuxPlatform::resetSchedulerJitter() {
+  pthread_mutex_lock(&_sched_stats_mutex);
+  _sched_wakeups  = 0;
+  _sched_overruns = 0;
+  _sched_late_max = 0;
+  _sched_rearms   = 0;
+  _sched_stats_epoch_ns = _mono_ns();
+  pthread_mutex_unlock(&_sched_stats_mutex);
+}
+
+
+/*
+* Renders the lateness distribution of the scheduler wakeups.
+*/
+void LinuxPlatform::printSchedulerJitter(StringBuilder* output) {
+  // Take a snapshot, so that the scheduler thread isn't held up by our output.
+  uint32_t* sorted = (uint32_t*) malloc(CONFIG_C3P_SCHED_JITTER_SAMPLES * sizeof(uint32_t));
+  pthread_mutex_lock(&_sched_stats_mutex);
+  const uint32_t WAKEUPS  = _sched_wakeups;
+  const uint32_t OVERRUNS = _sched_overruns;
+  const uint32_t LATE_MAX = _sched_late_max;
+  const uint32_t REARMS   = _sched_rearms;
+  const uint64_t EPOCH_NS = _sched_stats_epoch_ns;
+  const uint32_t SAMPLE_COUNT = (nullptr == sorted) ? 0 : strict_min(WAKEUPS, (uint32_t) CONFIG_C3P_SCHED_JITTER_SAMPLES);
+  if (0 < SAMPLE_COUNT) {
+    memcpy(sorted, _sched_jitter_samples, SAMPLE_COUNT * sizeof(uint32_t));
+  }
+  pthread_mutex_unlock(&_sched_stats_mutex);
+
+  output->concatf("\tMode:          %s (%ums period)\n", _sched_mode_str(_sched_mode), CONFIG_C3P_INTERVAL_PERIOD_MS);
+  const uint64_t ELAPSED_MS = (_mono_ns() - EPOCH_NS) / 1000000ULL;
+  output->concatf("\tWakeups:       %u", WAKEUPS);
+  if (0 < ELAPSED_MS) {
+    output->concatf("  (%.2f/s)", (double) ((WAKEUPS * 1000.0) / ELAPSED_MS));
+  }
+  output->concatf("\n\tOverruns:      %u\n", OVERRUNS);
+  if (LinuxSchedMode::TICKLESS == _sched_mode) {
+    output->concatf("\tRe-arms:       %u\n", REARMS);
+  }
+  if (0 < SAMPLE_COUNT) {
+    qsort(sorted, SAMPLE_COUNT, sizeof(uint32_t), _uint32_cmp);
+    output->concatf("\tLateness over the last %u wakeups (us):\n", SAMPLE_COUNT);
+    output->concatf("\t  p50:  %u\n", sorted[((SAMPLE_COUNT - 1) * 50) / 100]);
+    output->concatf("\t  p99:  %u\n", sorted[((SAMPLE_COUNT - 1) * 99) / 100]);
+    output->concatf("\t  max:  %u  (all-time %u)\n", sorted[SAMPLE_COUNT - 1], LATE_MAX);
+  }
+  if (nullptr != sorted) {
+    free(sorted);
+  }
 }
 
 
@@ -207,216 +681,1642 @@ volatile uint8_t  watchdog_mark      = 42;
 * /_____/_/ /_/\__/_/   \____/ .___/\__, /
 *                           /_/    /____/
 *******************************************************************************/
-volatile uint32_t randomness_pool[PLATFORM_RNG_CARRY_CAPACITY];
-volatile unsigned int _random_pool_r_ptr = 0;
-volatile unsigned int _random_pool_w_ptr = 0;
+long unsigned int rng_thread_id = 0;
+
+#if defined(CONFIG_C3P_LINUX_CHACHA_DRBG)
+/*
+* The RNG is a per-thread ChaCha20 DRBG, seeded from getrandom(). There is no
+*   shared state between threads, and no refill thread.
+* After each refill of the keystream buffer, the first 32 bytes of output are
+*   taken as the next key (fast key erasure), so a compromise of the state does
+*   not reveal prior output. The key is also mixed with fresh kernel entropy
+*   every CONFIG_C3P_DRBG_RESEED_BYTES, and in the child after fork().
+*/
+#ifndef CONFIG_C3P_DRBG_RESEED_BYTES
+  #define CONFIG_C3P_DRBG_RESEED_BYTES  (1024 * 1024)
+#endif
+
+#define DRBG_BLOCKS_PER_REFILL  16
+#define DRBG_BUFFER_LEN         (DRBG_BLOCKS_PER_REFILL * 64)
+
+typedef struct {
+  uint32_t key[8];
+  uint32_t generation;           // Compared against _drbg_generation.
+  uint32_t bytes_since_reseed;
+  uint32_t buf_offset;           // Index of the next unused byte in buf.
+  uint8_t  buf[DRBG_BUFFER_LEN];
+} LinuxDRBG;
+
+static __thread LinuxDRBG _tl_drbg = {{0}, 0, 0, DRBG_BUFFER_LEN, {0}};
+static uint32_t _drbg_generation = 1;   // Bumped by fork() to force a reseed.
+
+#define CHACHA_ROTL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define CHACHA_QR(a, b, c, d) \
+  a += b;  d ^= a;  d = CHACHA_ROTL(d, 16); \
+  c += d;  b ^= c;  b = CHACHA_ROTL(b, 12); \
+  a += b;  d ^= a;  d = CHACHA_ROTL(d,  8); \
+  c += d;  b ^= c;  b = CHACHA_ROTL(b,  7);
+
+/*
+* Generates one 64-byte ChaCha20 block with the given key and counter, and a
+*   zero nonce. Nonce reuse is not a concern because the key changes on every
+*   refill.
+*/
+static void _chacha20_block(const uint32_t* key, uint32_t counter, uint8_t* out) {
+  uint32_t input[16] = {
+    0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+    key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+    counter, 0, 0, 0
+  };
+  uint32_t x[16];
+  memcpy(x, input, sizeof(x));
+  for (uint8_t i = 0; i < 10; i++) {
+    CHACHA_QR(x[0], x[4], x[ 8], x[12]);
+    CHACHA_QR(x[1], x[5], x[ 9], x[13]);
+    CHACHA_QR(x[2], x[6], x[10], x[14]);
+    CHACHA_QR(x[3], x[7], x[11], x[15]);
+    CHACHA_QR(x[0], x[5], x[10], x[15]);
+    CHACHA_QR(x[1], x[6], x[11], x[12]);
+    CHACHA_QR(x[2], x[7], x[ 8], x[13]);
+    CHACHA_QR(x[3], x[4], x[ 9], x[14]);
+  }
+  for (uint8_t i = 0; i < 16; i++) {
+    const uint32_t WORD = x[i] + input[i];
+    out[(i << 2) + 0] = (uint8_t) (WORD);
+    out[(i << 2) + 1] = (uint8_t) (WORD >> 8);
+    out[(i << 2) + 2] = (uint8_t) (WORD >> 16);
+    out[(i << 2) + 3] = (uint8_t) (WORD >> 24);
+  }
+}
+
+
+/*
+* Mixes fresh kernel entropy into this thread's key.
+*/
+static void _drbg_reseed(LinuxDRBG* drbg) {
+  uint32_t fresh[8];
+  size_t got = 0;
+  while (got < sizeof(fresh)) {
+    const ssize_t RET = getrandom(((uint8_t*) fresh) + got, sizeof(fresh) - got, 0);
+    if (0 < RET) {
+      got += (size_t) RET;
+    }
+    else if (EINTR != errno) {
+      printf("getrandom() failed. The RNG cannot be seeded.\n");
+      exit(-1);
+    }
+  }
+  for (uint8_t i = 0; i < 8; i++) {
+    drbg->key[i] ^= fresh[i];
+  }
+  memset(fresh, 0, sizeof(fresh));
+  drbg->generation         = __atomic_load_n(&_drbg_generation, __ATOMIC_ACQUIRE);
+  drbg->bytes_since_reseed = 0;
+  drbg->buf_offset         = DRBG_BUFFER_LEN;   // Discard the old keystream.
+}
+
+
+/*
+* Refills the keystream buffer, and ratchets the key forward.
+*/
+static void _drbg_refill(LinuxDRBG* drbg) {
+  if ((drbg->generation != __atomic_load_n(&_drbg_generation, __ATOMIC_ACQUIRE)) || \
+      (drbg->bytes_since_reseed >= CONFIG_C3P_DRBG_RESEED_BYTES)) {
+    _drbg_reseed(drbg);
+  }
+  for (uint32_t i = 0; i < DRBG_BLOCKS_PER_REFILL; i++) {
+    _chacha20_block(drbg->key, i, &drbg->buf[i << 6]);
+  }
+  memcpy(drbg->key, drbg->buf, sizeof(drbg->key));
+  memset(drbg->buf, 0, sizeof(drbg->key));
+  drbg->buf_offset = sizeof(drbg->key);
+  drbg->bytes_since_reseed += (DRBG_BUFFER_LEN - sizeof(drbg->key));
+}
+
+
+/* Called in the child after fork(), so that it does not repeat its parent. */
+static void _drbg_atfork_child() {
+  __atomic_fetch_add(&_drbg_generation, 1, __ATOMIC_ACQ_REL);
+}
+
+
+/**
+* Dead-simple interface to the RNG. Never blocks.
+*
+* @return   A 32-bit unsigned random number. This can be cast as needed.
+*/
+uint32_t randomUInt32() {
+  uint32_t ret = 0;
+  random_fill((uint8_t*) &ret, sizeof(ret));
+  return ret;
+}
+
+
+/**
+* Fills the given buffer with random bytes. Keystream is consumed (and erased)
+*   in whole runs.
+*
+* @param uint8_t* The buffer to fill.
+* @param size_t The number of bytes to write to the buffer.
+* @return 0, always.
+*/
+int8_t random_fill(uint8_t* buf, size_t len) {
+  LinuxDRBG* drbg = &_tl_drbg;
+  size_t written_len = 0;
+  while (written_len < len) {
+    if (DRBG_BUFFER_LEN <= drbg->buf_offset) {
+      _drbg_refill(drbg);
+    }
+    const size_t AVAILABLE = (DRBG_BUFFER_LEN - drbg->buf_offset);
+    const size_t WANTED    = (len - written_len);
+    const size_t TAKEN     = (WANTED < AVAILABLE) ? WANTED : AVAILABLE;
+    memcpy(buf + written_len, &drbg->buf[drbg->buf_offset], TAKEN);
+    memset(&drbg->buf[drbg->buf_offset], 0, TAKEN);
+    drbg->buf_offset += (uint32_t) TAKEN;
+    written_len      += TAKEN;
+  }
+  return 0;
+}
+
+
+#else   // Use a shared pool fed by /dev/urandom.
+
+/*
+* The randomness pool is a ring with a single producer (the refill thread) and
+*   any number of consumers. The indices are free-running counters, and are
+*   only ever touched with atomic operations. Consumers claim words with a CAS
+*   on the read index. Both sides block on futexes rather than spinning:
+*   consumers wait on the write index when the pool is empty, and the refill
+*   thread waits on the read index until the pool drains below the low-water
+*   mark.
+*/
+#if (0 != (PLATFORM_RNG_CARRY_CAPACITY & (PLATFORM_RNG_CARRY_CAPACITY - 1)))
+  #error PLATFORM_RNG_CARRY_CAPACITY must be a power of two.
+#endif
+
+static uint32_t randomness_pool[PLATFORM_RNG_CARRY_CAPACITY];
+static uint32_t _random_pool_r_ptr = 0;   // Futex word for the refill thread.
+static uint32_t _random_pool_w_ptr = 0;   // Futex word for consumers.
+static uint32_t _rng_consumers_waiting = 0;
+static uint32_t _rng_refill_parked     = 0;
+
+
+/* Returns the number of words ready for consumption. */
+static inline uint32_t _rng_level() {
+  const uint32_t R = __atomic_load_n(&_random_pool_r_ptr, __ATOMIC_ACQUIRE);
+  const uint32_t W = __atomic_load_n(&_random_pool_w_ptr, __ATOMIC_ACQUIRE);
+  return (W - R);
+}
+
+
+/*
+* Called by consumers after they advance the read index. If the level has
+*   dropped below the low-water mark and the refill thread is parked, wake it.
+*/
+static inline void _rng_note_consumption(uint32_t level_after) {
+  if (level_after < PLATFORM_RNG_LOW_WATER_MARK) {
+    if (__atomic_exchange_n(&_rng_refill_parked, 0, __ATOMIC_ACQ_REL)) {
+      _futex_wake(&_random_pool_r_ptr, 1);
+    }
+  }
+}
+
+
+/*
+* Blocks the calling consumer until the write index moves past the value it
+*   last saw.
+*/
+static void _rng_wait_for_words(uint32_t seen_w) {
+  __atomic_fetch_add(&_rng_consumers_waiting, 1, __ATOMIC_ACQ_REL);
+  _rng_note_consumption(0);   // The pool is empty. Make sure the producer knows.
+  if (seen_w == __atomic_load_n(&_random_pool_w_ptr, __ATOMIC_ACQUIRE)) {
+    _futex_wait(&_random_pool_w_ptr, seen_w, 100);
+  }
+  __atomic_fetch_sub(&_rng_consumers_waiting, 1, __ATOMIC_ACQ_REL);
+}
+
+
+/*
+* Copies up to len bytes out of the pool, starting at the given read index.
+*   Handles the wrap by splitting the copy into (at most) two contiguous runs.
+*/
+static void _rng_copy_out(uint8_t* dest, uint32_t r_idx, uint32_t len) {
+  const uint32_t OFFSET     = (r_idx & (PLATFORM_RNG_CARRY_CAPACITY - 1));
+  const uint32_t BYTES_TO_WRAP = (PLATFORM_RNG_CARRY_CAPACITY - OFFSET) * sizeof(uint32_t);
+  const uint32_t FIRST_RUN  = strict_min(len, BYTES_TO_WRAP);
+  memcpy(dest, (uint8_t*) &randomness_pool[OFFSET], FIRST_RUN);
+  if (FIRST_RUN < len) {
+    memcpy(dest + FIRST_RUN, (uint8_t*) &randomness_pool[0], (len - FIRST_RUN));
+  }
+}
+
+
+/**
+* This is a thread to keep the randomness pool flush.
+*/
+static void* dev_urandom_reader(void*) {
+  int ur_fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  if (0 <= ur_fd) {
+    while (platform.platformState() <= MANUVR_INIT_STATE_NOMINAL) {
+      const uint32_t R = __atomic_load_n(&_random_pool_r_ptr, __ATOMIC_ACQUIRE);
+      const uint32_t W = __atomic_load_n(&_random_pool_w_ptr, __ATOMIC_RELAXED);
+      const uint32_t RNG_LEVEL = W - R;
+      if (RNG_LEVEL >= PLATFORM_RNG_CARRY_CAPACITY) {
+        // We have filled our entropy pool. Park until consumers drain it below
+        //   the low-water mark. The timeout allows us to notice shutdown.
+        __atomic_store_n(&_rng_refill_parked, 1, __ATOMIC_SEQ_CST);
+        if (R == __atomic_load_n(&_random_pool_r_ptr, __ATOMIC_SEQ_CST)) {
+          _futex_wait(&_random_pool_r_ptr, R, 500);
+        }
+        __atomic_store_n(&_rng_refill_parked, 0, __ATOMIC_RELAXED);
+      }
+      else {
+        // We continue feeding the entropy pool as demanded until the platform
+        //   leaves its nominal state. Don't write past the wrap-point.
+        const uint32_t W_OFFSET      = W & (PLATFORM_RNG_CARRY_CAPACITY - 1);
+        const uint32_t DELTA_TO_WRAP = PLATFORM_RNG_CARRY_CAPACITY - W_OFFSET;
+        const uint32_t DELTA_TO_FILL = PLATFORM_RNG_CARRY_CAPACITY - RNG_LEVEL;
+        const uint32_t NEEDED_COUNT  = strict_min(DELTA_TO_FILL, DELTA_TO_WRAP);
+        const ssize_t  RET = read(ur_fd, (void*) &randomness_pool[W_OFFSET], NEEDED_COUNT * sizeof(uint32_t));
+        if (RET >= (ssize_t) sizeof(uint32_t)) {
+          // Publish the new words. Only whole words count.
+          __atomic_store_n(&_random_pool_w_ptr, (W + (uint32_t) (RET / sizeof(uint32_t))), __ATOMIC_RELEASE);
+          if (0 < __atomic_load_n(&_rng_consumers_waiting, __ATOMIC_ACQUIRE)) {
+            _futex_wake(&_random_pool_w_ptr, INT_MAX);
+          }
+        }
+        else if ((0 > RET) && (EINTR == errno)) {
+          // Try again.
+        }
+        else {
+          close(ur_fd);
+          printf("Failed to read /dev/urandom.\n");
+          return NULL;
+        }
+      }
+    }
+    close(ur_fd);
+  }
+  else {
+    printf("Failed to open /dev/urandom.\n");
+  }
+  printf("Exiting random thread.....\n");
+  return NULL;
+}
+
+
+/**
+* Dead-simple interface to the RNG. If random demand exceeds random supply,
+*   this will block until a random number is actually availible.
+*
+* @return   A 32-bit unsigned random number. This can be cast as needed.
+*/
+uint32_t randomUInt32() {
+  uint32_t ret = 0;
+  random_fill((uint8_t*) &ret, sizeof(ret));
+  return ret;
+}
+
+
+/**
+* Fills the given buffer with random bytes. Whole runs are copied out of the
+*   pool at once, rather than a word at a time.
+* Blocks if there is nothing random available.
+*
+* @param uint8_t* The buffer to fill.
+* @param size_t The number of bytes to write to the buffer.
+* @return 0, always.
+*/
+int8_t random_fill(uint8_t* buf, size_t len) {
+  size_t written_len = 0;
+  while (written_len < len) {
+    const uint32_t R = __atomic_load_n(&_random_pool_r_ptr, __ATOMIC_ACQUIRE);
+    const uint32_t W = __atomic_load_n(&_random_pool_w_ptr, __ATOMIC_ACQUIRE);
+    const uint32_t LEVEL = W - R;
+    if (0 == LEVEL) {
+      _rng_wait_for_words(W);
+      continue;
+    }
+    // Claim as many whole words as we need, or as are available. A partial
+    //   word at the end of the buffer consumes the entire word.
+    const size_t   BYTES_WANTED = (len - written_len);
+    const size_t   WORDS_NEEDED = ((BYTES_WANTED + 3) >> 2);
+    const uint32_t WORDS_WANTED = (WORDS_NEEDED < LEVEL) ? (uint32_t) WORDS_NEEDED : LEVEL;
+    const uint32_t BYTES_TAKEN  = (BYTES_WANTED < (WORDS_WANTED << 2)) ? (uint32_t) BYTES_WANTED : (WORDS_WANTED << 2);
+    _rng_copy_out(buf + written_len, R, BYTES_TAKEN);
+    uint32_t expected_r = R;
+    if (__atomic_compare_exchange_n(&_random_pool_r_ptr, &expected_r, (R + WORDS_WANTED), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      // The claim succeeded, and what we copied is ours.
+      written_len += BYTES_TAKEN;
+      _rng_note_consumption(LEVEL - WORDS_WANTED);
+    }
+    // Otherwise, another consumer beat us to those words. Try again.
+  }
+  return 0;
+}
+
+
+#endif  // CONFIG_C3P_LINUX_CHACHA_DRBG
+
+
+/**
+* Init the RNG. Short and sweet.
+*/
+void LinuxPlatform::_init_rng() {
+  srand(time(nullptr));          // Seed the PRNG...
+  #if defined(CONFIG_C3P_LINUX_CHACHA_DRBG)
+    // Each thread seeds itself on first use. Just prove that we can.
+    pthread_atfork(nullptr, nullptr, _drbg_atfork_child);
+    _drbg_reseed(&_tl_drbg);
+  #else
+    PlatformThreadOpts topts;
+    memset(&topts, 0, sizeof(topts));
+    topts.thread_name = (char*) "RNG";
+    if (createThread(&rng_thread_id, nullptr, dev_urandom_reader, nullptr, &topts)) {
+      printf("Failed to create RNG thread.\n");
+      exit(-1);
+    }
+    int t_out = 30;
+    while ((_rng_level() < PLATFORM_RNG_CARRY_CAPACITY) && (t_out > 0)) {
+      sleep_ms(20);
+      t_out--;
+    }
+    if (0 == t_out) {
+      printf("Failed to fill the RNG pool.\n");
+      exit(-1);
+    }
+  #endif
+  _alter_flags(true, ABSTRACT_PF_FLAG_RNG_READY);
+}
+
+
+/*******************************************************************************
+* Flight recorder                                                              *
+*                                                                              *
+* Every call to c3p_log() is also copied into a fixed-size ring in a shared    *
+*   memory-mapped file. The file outlives the process, so the last moments    *
+*   before a crash can be recovered with the decoder in example/flight-decode. *
+* Writing a record is an atomic increment and a few stores. No syscalls.      *
+*******************************************************************************/
+#if defined(CONFIG_C3P_FLIGHT_RECORDER)
+
+static C3PFlightHeader* _fr_hdr      = nullptr;
+static C3PFlightTag*    _fr_tags     = nullptr;
+static uint8_t*         _fr_recs     = nullptr;
+static size_t           _fr_map_len  = 0;
+static char             _fr_path[64] = {0};
+static __thread uint32_t    _fr_tid      = 0;
+static __thread const char* _fr_last_tag = nullptr;  // Tags are usually literals, so
+static __thread uint32_t    _fr_last_hash = 0;       //   a one-entry cache saves the hash.
+
+
+/*
+* Returns the hash of the tag, entering its text in the tag table if needed.
+*/
+static uint32_t _fr_tag_hash(const char* tag) {
+  if ((tag == _fr_last_tag) && (nullptr != tag)) {
+    return _fr_last_hash;
+  }
+  const uint32_t HASH = c3p_flight_hash(tag);
+  const uint32_t MASK = (_fr_hdr->tag_count - 1);
+  for (uint32_t i = 0; i < 8; i++) {   // Bounded probe. A full table just loses names.
+    C3PFlightTag* slot = &_fr_tags[(HASH + i) & MASK];
+    uint32_t seen = __atomic_load_n(&slot->hash, __ATOMIC_ACQUIRE);
+    if (HASH == seen) {
+      break;
+    }
+    if (0 == seen) {
+      if (__atomic_compare_exchange_n(&slot->hash, &seen, HASH, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        strncpy(slot->text, ((nullptr != tag) ? tag : ""), C3P_FLIGHT_TAG_LEN - 1);
+        __atomic_store_n(&slot->ready, 1, __ATOMIC_RELEASE);
+        break;
+      }
+      if (HASH == seen) {
+        break;   // Lost the race to a thread logging the same tag.
+      }
+    }
+  }
+  _fr_last_tag  = tag;
+  _fr_last_hash = HASH;
+  return HASH;
+}
+
+
+/*
+* Appends a record to the ring. Safe to call from any thread.
+*/
+static void _fr_record(uint8_t severity, const char* tag, const char* msg, uint32_t len) {
+  if (nullptr == _fr_hdr) {
+    return;
+  }
+  if (0 == _fr_tid) {
+    _fr_tid = (uint32_t) syscall(SYS_gettid);
+  }
+  const uint32_t REC_SIZE = _fr_hdr->record_size;
+  const uint64_t SEQ = __atomic_fetch_add(&_fr_hdr->w_seq, 1, __ATOMIC_RELAXED);
+  C3PFlightRecord* rec = (C3PFlightRecord*) (_fr_recs + ((SEQ & (_fr_hdr->record_count - 1)) * REC_SIZE));
+  __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  const uint32_t MAX_PAYLOAD = (REC_SIZE - C3P_FLIGHT_REC_OVERHEAD);
+  rec->timestamp = (uint64_t) micros();
+  rec->tag_hash  = _fr_tag_hash(tag);
+  rec->tid       = _fr_tid;
+  rec->severity  = severity;
+  rec->flags     = 0;
+  if (len > MAX_PAYLOAD) {
+    len = MAX_PAYLOAD;
+    rec->flags |= C3P_FLIGHT_REC_FLAG_TRUNCATED;
+  }
+  rec->len = (uint16_t) len;
+  memcpy(rec->payload, msg, len);
+  __atomic_store_n(&rec->seq, SEQ + 1, __ATOMIC_RELEASE);
+}
+
+
+/*
+* Creates and maps the ring file. Any file left by a previous process with the
+*   same PID is replaced.
+*
+* @return 0 on success, -1 if the file couldn't be created, -2 if it couldn't be mapped.
+*/
+static int8_t _init_flight_recorder() {
+  if (nullptr != _fr_hdr) {
+    return 0;
+  }
+  snprintf(_fr_path, sizeof(_fr_path), CONFIG_C3P_FLIGHT_RECORDER_PATH, (int) getpid());
+  const size_t MAP_LEN = sizeof(C3PFlightHeader)
+    + (CONFIG_C3P_FLIGHT_RECORDER_TAGS * sizeof(C3PFlightTag))
+    + ((size_t) CONFIG_C3P_FLIGHT_RECORDER_RECORDS * CONFIG_C3P_FLIGHT_RECORDER_REC_SIZE);
+  int fd = open(_fr_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return -1;
+  }
+  if (0 != ftruncate(fd, (off_t) MAP_LEN)) {
+    close(fd);
+    return -1;
+  }
+  void* map = mmap(nullptr, MAP_LEN, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);   // The mapping holds its own reference.
+  if (MAP_FAILED == map) {
+    return -2;
+  }
+  C3PFlightHeader* hdr = (C3PFlightHeader*) map;
+  // ftruncate() gave us zeros, which is an empty ring and an empty tag table.
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  hdr->epoch_us     = ((uint64_t) ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000) - (uint64_t) micros();
+  hdr->version      = C3P_FLIGHT_VERSION;
+  hdr->record_size  = CONFIG_C3P_FLIGHT_RECORDER_REC_SIZE;
+  hdr->record_count = CONFIG_C3P_FLIGHT_RECORDER_RECORDS;
+  hdr->tag_count    = CONFIG_C3P_FLIGHT_RECORDER_TAGS;
+  hdr->pid          = (uint32_t) getpid();
+  if (nullptr != _binary_name) {
+    strncpy(hdr->binary, _binary_name, sizeof(hdr->binary) - 1);
+  }
+  __atomic_store_n(&hdr->magic, C3P_FLIGHT_MAGIC, __ATOMIC_RELEASE);
+  _fr_tags    = (C3PFlightTag*) (((uint8_t*) map) + sizeof(C3PFlightHeader));
+  _fr_recs    = ((uint8_t*) _fr_tags) + (CONFIG_C3P_FLIGHT_RECORDER_TAGS * sizeof(C3PFlightTag));
+  _fr_map_len = MAP_LEN;
+  __atomic_store_n(&_fr_hdr, hdr, __ATOMIC_RELEASE);
+  return 0;
+}
+
+
+static void _print_flight_recorder(StringBuilder* output) {
+  if (nullptr == _fr_hdr) {
+    output->concat("-- Flight recorder is not running.\n");
+    return;
+  }
+  const uint64_t W_SEQ = __atomic_load_n(&_fr_hdr->w_seq, __ATOMIC_RELAXED);
+  output->concatf("-- Flight recorder (%s)\n", _fr_path);
+  output->concatf("\tRing:        %u x %u bytes (%u KiB mapped)\n", _fr_hdr->record_count, _fr_hdr->record_size, (unsigned) (_fr_map_len >> 10));
+  output->concatf("\tRecorded:    %llu\n", (unsigned long long) W_SEQ);
+}
+
+#endif  // CONFIG_C3P_FLIGHT_RECORDER
+
+
+
+/*******************************************************************************
+*     __                      _
+*    / /   ____  ____ _____ _(_)___  ____ _
+*   / /   / __ \/ __ `/ __ `/ / __ \/ __ `/
+*  / /___/ /_/ / /_/ / /_/ / / / / / /_/ /
+* /_____/\____/\__, /\__, /_/_/ /_/\__, /
+*             /____//____/        /____/
+*
+* On vanilla linux, we will defer to the platform object's configuration and
+*   either write to syslog, a file, or STDIO.
+*******************************************************************************/
+
+/*
+* Log messages are copied into a small ring owned by the calling thread, and
+*   drained by a single writer thread. So a thread that logs never blocks on
+*   terminal or file I/O, and never contends with other loggers. If a ring
+*   fills, the message is dropped and counted.
+* Rings are never freed. A ring whose thread has exited is marked orphaned,
+*   and is adopted by the next new thread that logs.
+*/
+typedef struct {
+  uint16_t len;       // Length of the text, including the trailing newline.
+  uint8_t  severity;
+  char     text[CONFIG_C3P_LOG_SLOT_SIZE];
+} LogSlot;
+
+typedef struct __log_ring_t {
+  uint32_t w_idx;     // Only written by the owning thread.
+  uint32_t r_idx;     // Only written by the log writer.
+  uint32_t orphaned;  // Non-zero if the ring has no owning thread.
+  struct __log_ring_t* next;
+  LogSlot  slots[CONFIG_C3P_LOG_RING_SLOTS];
+} LogRing;
+
+#if (0 != (CONFIG_C3P_LOG_RING_SLOTS & (CONFIG_C3P_LOG_RING_SLOTS - 1)))
+  #error CONFIG_C3P_LOG_RING_SLOTS must be a power of two.
+#endif
+#define LOG_RING_MASK  (CONFIG_C3P_LOG_RING_SLOTS - 1)
+
+static unsigned long   log_thread_id      = 0;
+static LogRing*        _log_rings         = nullptr;  // Push-only list of every ring.
+static __thread LogRing* _tl_log_ring     = nullptr;
+static pthread_key_t   _log_ring_key;
+static pthread_once_t  _log_key_once      = PTHREAD_ONCE_INIT;
+static pthread_mutex_t _log_target_mutex  = PTHREAD_MUTEX_INITIALIZER;
+static LinuxLogTarget  _log_target        = LinuxLogTarget::STDOUT;
+static int             _log_fd            = STDOUT_FILENO;
+static uint8_t         _log_verbosity     = CONFIG_C3P_LOG_DEFAULT_VERBOSITY;
+static bool            _log_running       = false;
+static uint32_t        _log_seq           = 0;  // Bumped by every producer. Writer parks on it.
+static uint32_t        _log_parked        = 0;  // Non-zero while the writer is parked.
+
+// Counters. All relaxed, as they are only for reporting.
+static uint32_t _log_queued    = 0;   // Messages placed into a ring.
+static uint32_t _log_written   = 0;   // Messages handed to the target.
+static uint32_t _log_dropped   = 0;   // Messages lost to a full ring.
+static uint32_t _log_truncated = 0;   // Messages that did not fit in a slot.
+static uint32_t _log_filtered  = 0;   // Messages below the severity threshold.
+static uint32_t _log_batches   = 0;   // Calls to writev() (or passes over syslog).
+
+
+static const char* _log_target_str(LinuxLogTarget t) {
+  switch (t) {
+    case LinuxLogTarget::STDOUT:  return "STDOUT";
+    case LinuxLogTarget::FILE:    return "FILE";
+    case LinuxLogTarget::SYSLOG:  return "SYSLOG";
+  }
+  return "UNKNOWN";
+}
+
+/*
+* Called by pthreads as a thread exits. Lets another thread adopt the ring.
+*/
+static void _log_ring_release(void* arg) {
+  LogRing* ring = (LogRing*) arg;
+  if (nullptr != ring) {
+    __atomic_store_n(&ring->orphaned, 1, __ATOMIC_RELEASE);
+  }
+}
+
+static void _log_key_init() {
+  pthread_key_create(&_log_ring_key, _log_ring_release);
+}
+
+/*
+* Returns the calling thread's ring, adopting or allocating one on first use.
+*/
+static LogRing* _log_ring_for_thread() {
+  if (nullptr != _tl_log_ring) {
+    return _tl_log_ring;
+  }
+  pthread_once(&_log_key_once, _log_key_init);
+  LogRing* ring = __atomic_load_n(&_log_rings, __ATOMIC_ACQUIRE);
+  while (nullptr != ring) {
+    uint32_t expected = 1;
+    if (__atomic_compare_exchange_n(&ring->orphaned, &expected, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      break;
+    }
+    ring = ring->next;
+  }
+  if (nullptr == ring) {
+    ring = (LogRing*) malloc(sizeof(LogRing));
+    if (nullptr == ring) {
+      return nullptr;
+    }
+    ring->w_idx    = 0;
+    ring->r_idx    = 0;
+    ring->orphaned = 0;
+    ring->next     = __atomic_load_n(&_log_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&_log_rings, &ring->next, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+  }
+  _tl_log_ring = ring;
+  pthread_setspecific(_log_ring_key, ring);
+  return ring;
+}
+
+
+/*
+* Writes the whole iovec array, resuming after short writes.
+*/
+static void _log_writev_all(int fd, struct iovec* iov, int iov_cnt) {
+  while (0 < iov_cnt) {
+    ssize_t w = writev(fd, iov, iov_cnt);
+    if (w < 0) {
+      if (EINTR == errno) continue;
+      return;   // Nowhere to report this. Give up on the batch.
+    }
+    while ((0 < iov_cnt) && ((size_t) w >= iov->iov_len)) {
+      w -= iov->iov_len;
+      iov++;
+      iov_cnt--;
+    }
+    if (0 < iov_cnt) {
+      iov->iov_base = ((uint8_t*) iov->iov_base) + w;
+      iov->iov_len -= w;
+    }
+  }
+}
+
+
+/*
+* Hands a batch of slots to the current target.
+*/
+static void _log_emit(LogSlot** batch, int count) {
+  if (0 == count) return;
+  pthread_mutex_lock(&_log_target_mutex);
+  if (LinuxLogTarget::SYSLOG == _log_target) {
+    for (int i = 0; i < count; i++) {
+      syslog(batch[i]->severity, "%.*s", (int) (batch[i]->len - 1), batch[i]->text);
+    }
+  }
+  else {
+    struct iovec iov[CONFIG_C3P_LOG_BATCH_MAX];
+    for (int i = 0; i < count; i++) {
+      iov[i].iov_base = batch[i]->text;
+      iov[i].iov_len  = batch[i]->len;
+    }
+    if (STDOUT_FILENO == _log_fd) {
+      fflush(stdout);   // Keep order with anything still using printf().
+    }
+    _log_writev_all(_log_fd, iov, count);
+  }
+  pthread_mutex_unlock(&_log_target_mutex);
+  __atomic_fetch_add(&_log_written, count, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&_log_batches, 1, __ATOMIC_RELAXED);
+}
+
+
+/*
+* Drains every ring into the target, in batches. Only the writer thread (or
+*   the shutdown path, after the writer is joined) may call this.
+*
+* @return the number of messages written.
+*/
+static uint32_t _log_drain() {
+  LogSlot* batch[CONFIG_C3P_LOG_BATCH_MAX];
+  LogRing* commit_ring[CONFIG_C3P_LOG_BATCH_MAX];
+  uint32_t commit_idx[CONFIG_C3P_LOG_BATCH_MAX];
+  int batch_len  = 0;
+  int commit_len = 0;
+  uint32_t ret   = 0;
+
+  LogRing* ring = __atomic_load_n(&_log_rings, __ATOMIC_ACQUIRE);
+  while (nullptr != ring) {
+    uint32_t r = ring->r_idx;
+    const uint32_t W = __atomic_load_n(&ring->w_idx, __ATOMIC_ACQUIRE);
+    while (r != W) {
+      batch[batch_len++] = &ring->slots[r & LOG_RING_MASK];
+      r++;
+      if (CONFIG_C3P_LOG_BATCH_MAX == batch_len) {
+        // Slots may only be released back to producers after they are written.
+        _log_emit(batch, batch_len);
+        for (int i = 0; i < commit_len; i++) {
+          __atomic_store_n(&commit_ring[i]->r_idx, commit_idx[i], __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&ring->r_idx, r, __ATOMIC_RELEASE);
+        ret += batch_len;
+        batch_len  = 0;
+        commit_len = 0;
+      }
+    }
+    if (r != ring->r_idx) {
+      commit_ring[commit_len] = ring;
+      commit_idx[commit_len]  = r;
+      commit_len++;
+    }
+    ring = ring->next;
+  }
+  _log_emit(batch, batch_len);
+  for (int i = 0; i < commit_len; i++) {
+    __atomic_store_n(&commit_ring[i]->r_idx, commit_idx[i], __ATOMIC_RELEASE);
+  }
+  return (ret + batch_len);
+}
+
+
+static bool _log_pending() {
+  LogRing* ring = __atomic_load_n(&_log_rings, __ATOMIC_ACQUIRE);
+  while (nullptr != ring) {
+    if (__atomic_load_n(&ring->r_idx, __ATOMIC_ACQUIRE) != __atomic_load_n(&ring->w_idx, __ATOMIC_ACQUIRE)) {
+      return true;
+    }
+    ring = ring->next;
+  }
+  return false;
+}
+
+
+static void* log_writer_thread(void*) {
+  // Signals are the business of the main thread.
+  sigset_t set;
+  sigfillset(&set);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  while (__atomic_load_n(&_log_running, __ATOMIC_ACQUIRE)) {
+    const uint32_t SEQ = __atomic_load_n(&_log_seq, __ATOMIC_SEQ_CST);
+    if (0 == _log_drain()) {
+      __atomic_store_n(&_log_parked, 1, __ATOMIC_SEQ_CST);
+      _futex_wait(&_log_seq, SEQ, CONFIG_C3P_THREAD_PARK_TIMEOUT_MS);
+      __atomic_store_n(&_log_parked, 0, __ATOMIC_SEQ_CST);
+    }
+  }
+  _log_drain();   // Whatever arrived while we were stopping.
+  return nullptr;
+}
+
+
+static void _log_wake_writer() {
+  __atomic_fetch_add(&_log_seq, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&_log_parked, __ATOMIC_SEQ_CST)) {
+    _futex_wake(&_log_seq, 1);
+  }
+}
+
+
+static void _deinit_log_thread() {
+  if (__atomic_exchange_n(&_log_running, false, __ATOMIC_ACQ_REL)) {
+    _log_wake_writer();
+    pthread_join((pthread_t) log_thread_id, nullptr);
+    log_thread_id = 0;
+  }
+}
+
+
+int8_t LinuxPlatform::_init_log_thread() {
+  if (__atomic_load_n(&_log_running, __ATOMIC_ACQUIRE)) {
+    return 0;
+  }
+  __atomic_store_n(&_log_running, true, __ATOMIC_RELEASE);
+  PlatformThreadOpts topts;
+  memset(&topts, 0, sizeof(topts));
+  topts.thread_name = (char*) "C3PLogger";
+  if (0 != createThread(&log_thread_id, nullptr, log_writer_thread, nullptr, &topts)) {
+    __atomic_store_n(&_log_running, false, __ATOMIC_RELEASE);
+    return -1;
+  }
+  atexit(_deinit_log_thread);   // Don't lose the tail of the log on return from main().
+  return 0;
+}
+
+
+/**
+* Sets where log messages are written.
+*
+* @param target is the destination.
+* @param path is the file to append to, if target is FILE.
+* @return 0 on success, -1 on bad parameters, -2 if the file couldn't be opened.
+*/
+int8_t LinuxPlatform::logTarget(LinuxLogTarget target, const char* path) {
+  int nu_fd = STDOUT_FILENO;
+  switch (target) {
+    case LinuxLogTarget::STDOUT:
+    case LinuxLogTarget::SYSLOG:
+      break;
+    case LinuxLogTarget::FILE:
+      if (nullptr == path) return -1;
+      nu_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+      if (nu_fd < 0) return -2;
+      break;
+    default:
+      return -1;
+  }
+  pthread_mutex_lock(&_log_target_mutex);
+  const int OLD_FD = _log_fd;
+  _log_fd     = nu_fd;
+  _log_target = target;
+  pthread_mutex_unlock(&_log_target_mutex);
+  if (STDOUT_FILENO != OLD_FD) {
+    close(OLD_FD);
+  }
+  return 0;
+}
+
+LinuxLogTarget LinuxPlatform::logTarget() {   return _log_target;   }
+
+/**
+* Messages less important than the given syslog-style severity are discarded
+*   by the calling thread, before they cost anything but a comparison.
+*/
+void LinuxPlatform::logVerbosity(uint8_t severity) {
+  __atomic_store_n(&_log_verbosity, severity, __ATOMIC_RELAXED);
+}
+
+uint8_t LinuxPlatform::logVerbosity() {
+  return __atomic_load_n(&_log_verbosity, __ATOMIC_RELAXED);
+}
+
+
+/**
+* Blocks until every message queued so far has been written, or the timeout
+*   (in milliseconds) expires.
+*
+* @return 0 if the log is flushed, -1 on timeout.
+*/
+int8_t LinuxPlatform::flushLog(uint32_t timeout_ms) {
+  const uint32_t START = millis();
+  while (_log_pending()) {
+    if (!__atomic_load_n(&_log_running, __ATOMIC_ACQUIRE)) {
+      return -1;
+    }
+    if ((millis() - START) >= timeout_ms) {
+      return -1;
+    }
+    _log_wake_writer();
+    sleep_ms(1);
+  }
+  return 0;
+}
+
+
+void LinuxPlatform::printLogStats(StringBuilder* output) {
+  uint32_t ring_count = 0;
+  uint32_t orphans    = 0;
+  uint32_t backlog    = 0;
+  LogRing* ring = __atomic_load_n(&_log_rings, __ATOMIC_ACQUIRE);
+  while (nullptr != ring) {
+    ring_count++;
+    if (__atomic_load_n(&ring->orphaned, __ATOMIC_RELAXED)) orphans++;
+    backlog += (__atomic_load_n(&ring->w_idx, __ATOMIC_RELAXED) - __atomic_load_n(&ring->r_idx, __ATOMIC_RELAXED));
+    ring = ring->next;
+  }
+  output->concatf("-- Logger (%s, %s)\n", _log_target_str(_log_target), (_log_running ? "async" : "sync"));
+  output->concatf("\tVerbosity:   %u\n", logVerbosity());
+  output->concatf("\tRings:       %u (%u orphaned) x %u slots of %u bytes\n", ring_count, orphans, CONFIG_C3P_LOG_RING_SLOTS, CONFIG_C3P_LOG_SLOT_SIZE);
+  output->concatf("\tQueued:      %u\n", __atomic_load_n(&_log_queued, __ATOMIC_RELAXED));
+  output->concatf("\tWritten:     %u in %u batches\n", __atomic_load_n(&_log_written, __ATOMIC_RELAXED), __atomic_load_n(&_log_batches, __ATOMIC_RELAXED));
+  output->concatf("\tBacklog:     %u\n", backlog);
+  output->concatf("\tDropped:     %u\n", __atomic_load_n(&_log_dropped, __ATOMIC_RELAXED));
+  output->concatf("\tTruncated:   %u\n", __atomic_load_n(&_log_truncated, __ATOMIC_RELAXED));
+  output->concatf("\tFiltered:    %u\n", __atomic_load_n(&_log_filtered, __ATOMIC_RELAXED));
+  #if defined(CONFIG_C3P_FLIGHT_RECORDER)
+    _print_flight_recorder(output);
+  #endif
+}
+
+
+/**
+* This function is declared in CppPotpourri (AbstractPlatform.h).
+* Log the given message.
+*
+* @param severity is the syslog-style importance of the message.
+* @param tag is the free-form source of the message.
+* @param msg contains the log content.
+*/
+void c3p_log(uint8_t severity, const char* tag, StringBuilder* msg) {
+  #if defined(CONFIG_C3P_FLIGHT_RECORDER)
+    // Recorded regardless of verbosity. That is the point.
+    _fr_record(severity, tag, (const char*) msg->string(), (uint32_t) msg->length());
+  #endif
+  if (severity > __atomic_load_n(&_log_verbosity, __ATOMIC_RELAXED)) {
+    __atomic_fetch_add(&_log_filtered, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  if (!__atomic_load_n(&_log_running, __ATOMIC_ACQUIRE)) {
+    // No writer thread (yet, or any longer). Write synchronously, to the same
+    //   target the writer would have used.
+    pthread_mutex_lock(&_log_target_mutex);
+    if (LinuxLogTarget::SYSLOG == _log_target) {
+      syslog(severity, "%s", (char*) msg->string());
+    }
+    else {
+      struct iovec iov[2];
+      iov[0].iov_base = msg->string();
+      iov[0].iov_len  = (size_t) msg->length();
+      iov[1].iov_base = (void*) "\n";
+      iov[1].iov_len  = 1;
+      if (STDOUT_FILENO == _log_fd) {
+        fflush(stdout);
+      }
+      _log_writev_all(_log_fd, iov, 2);
+    }
+    pthread_mutex_unlock(&_log_target_mutex);
+    __atomic_fetch_add(&_log_written, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  LogRing* ring = _log_ring_for_thread();
+  if (nullptr == ring) {
+    __atomic_fetch_add(&_log_dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  const uint32_t W = ring->w_idx;
+  if ((W - __atomic_load_n(&ring->r_idx, __ATOMIC_ACQUIRE)) >= CONFIG_C3P_LOG_RING_SLOTS) {
+    __atomic_fetch_add(&_log_dropped, 1, __ATOMIC_RELAXED);
+    _log_wake_writer();
+    return;
+  }
+  LogSlot* slot = &ring->slots[W & LOG_RING_MASK];
+  uint32_t len  = (uint32_t) msg->length();
+  if (len > (CONFIG_C3P_LOG_SLOT_SIZE - 1)) {
+    len = (CONFIG_C3P_LOG_SLOT_SIZE - 1);
+    __atomic_fetch_add(&_log_truncated, 1, __ATOMIC_RELAXED);
+  }
+  memcpy(slot->text, msg->string(), len);
+  slot->text[len] = '\n';
+  slot->len       = (uint16_t) (len + 1);
+  slot->severity  = severity;
+  __atomic_store_n(&ring->w_idx, W + 1, __ATOMIC_RELEASE);
+  __atomic_fetch_add(&_log_queued, 1, __ATOMIC_RELAXED);
+  _log_wake_writer();
+}
+
+
+
+/*******************************************************************************
+*     ____  __      __  ____                        ____  ____      __
+*    / __ \/ /___ _/ /_/ __/___  _________ ___     / __ \/ __ )    / /
+*   / /_/ / / __ `/ __/ /_/ __ \/ ___/ __ `__ \   / / / / __  |_  / /
+*  / ____/ / /_/ / /_/ __/ /_/ / /  / / / / / /  / /_/ / /_/ / /_/ /
+* /_/   /_/\__,_/\__/_/  \____/_/  /_/ /_/ /_/   \____/_____/\____/
+*
+* These are overrides and additions to the platform class.
+*******************************************************************************/
+
+void LinuxPlatform::printDebug(StringBuilder* output) {
+  output->concatf(
+    "==< Linux [%s] >=============================\n",
+    _board_name
+  );
+  _print_abstract_debug(output);
+
+  struct utsname sname;
+  if (uname(&sname) != -1) {
+    output->concatf("\t%s %s (%s)\n", sname.sysname, sname.release, sname.machine);
+    output->concatf("\t%s\n", sname.version);
+  }
+  else {
+    output->concat("\tFailed to get detailed kernel info.\n");
+  }
+  output->concatf("\tThreads created by the platform (%d CPUs online):\n", (int) sysconf(_SC_NPROCESSORS_ONLN));
+  printThreads(output);
+
+  #if defined(__HAS_CRYPT_WRAPPER)
+    output->concatf("-- Binary hash         %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x",
+      _binary_hash[0],  _binary_hash[1],  _binary_hash[2],  _binary_hash[3],
+      _binary_hash[4],  _binary_hash[5],  _binary_hash[6],  _binary_hash[7],
+      _binary_hash[8],  _binary_hash[9],  _binary_hash[10], _binary_hash[11],
+      _binary_hash[12], _binary_hash[13], _binary_hash[14], _binary_hash[15]
+    );
+    output->concatf("%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
+      _binary_hash[16], _binary_hash[17], _binary_hash[18], _binary_hash[19],
+      _binary_hash[20], _binary_hash[21], _binary_hash[22], _binary_hash[23],
+      _binary_hash[24], _binary_hash[25], _binary_hash[26], _binary_hash[27],
+      _binary_hash[28], _binary_hash[29], _binary_hash[30], _binary_hash[31]
+    );
+    randomArt(_binary_hash, 32, "SHA256", output);
+  #endif
+}
+
+
+
+/*******************************************************************************
+* Scheduler benchmark                                                          *
+*******************************************************************************/
+/*
+* To compare timer strategies without disturbing the real scheduler, the
+*   benchmark runs its own timerfd against a synthetic min-heap of periodic
+*   deadlines. Periods are spread between 10ms and 1s. The TICKLESS rows arm
+*   the timer for the earliest deadline in the heap, clamped the same way that
+*   LinuxSchedMode::TICKLESS clamps what its deadline source reports.
+*/
+#define SCHED_BENCH_MAX_SAMPLES  8192
+
+typedef struct {
+  uint64_t* due;      // Absolute CLOCK_MONOTONIC deadlines.
+  uint64_t* period;   // Period of each schedule.
+  uint32_t  count;
+} SchedBenchHeap;
+
+
+static void _sched_bench_sift_down(SchedBenchHeap* h, uint32_t i) {
+  while (true) {
+    const uint32_t L = (i << 1) + 1;
+    const uint32_t R = L + 1;
+    uint32_t least = i;
+    if ((L < h->count) && (h->due[L] < h->due[least])) least = L;
+    if ((R < h->count) && (h->due[R] < h->due[least])) least = R;
+    if (least == i) return;
+    uint64_t tmp = h->due[i];  h->due[i] = h->due[least];  h->due[least] = tmp;
+    tmp = h->period[i];  h->period[i] = h->period[least];  h->period[least] = tmp;
+    i = least;
+  }
+}
+
+
+/*
+* Runs one mode against one population for the given duration.
+*/
+static void _sched_bench_run(StringBuilder* output, uint32_t count, bool tickless, uint32_t seconds) {
+  const uint64_t PERIOD_NS = (uint64_t) CONFIG_C3P_INTERVAL_PERIOD_MS * 1000000ULL;
+  SchedBenchHeap heap;
+  heap.count  = count;
+  heap.due    = (uint64_t*) malloc(count * sizeof(uint64_t));
+  heap.period = (uint64_t*) malloc(count * sizeof(uint64_t));
+  uint32_t* samples = (uint32_t*) malloc(SCHED_BENCH_MAX_SAMPLES * sizeof(uint32_t));
+  const int TFD = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if ((nullptr == heap.due) || (nullptr == heap.period) || (nullptr == samples) || (0 > TFD)) {
+    output->concatf("\t%9u  Failed to allocate.\n", count);
+  }
+  else {
+    const uint64_t START = _mono_ns();
+    const uint64_t END   = START + ((uint64_t) seconds * 1000000000ULL);
+    for (uint32_t i = 0; i < count; i++) {
+      heap.period[i] = (10 + (randomUInt32() % 991)) * 1000000ULL;
+      heap.due[i]    = START + heap.period[i];
+    }
+    for (int32_t i = ((int32_t) count / 2) - 1; i >= 0; i--) {
+      _sched_bench_sift_down(&heap, (uint32_t) i);
+    }
+
+    uint32_t wakeups = 0;
+    uint32_t fired   = 0;
+    uint32_t late_max = 0;
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    uint64_t next = START + PERIOD_NS;
+    while (next < END) {
+      if (tickless) {
+        next = _sched_tickless_clamp(_mono_ns(), heap.due[0]);
+        if (next >= END) break;
+      }
+      its.it_value.tv_sec  = (time_t) (next / 1000000000ULL);
+      its.it_value.tv_nsec = (long)   (next % 1000000000ULL);
+      timerfd_settime(TFD, TFD_TIMER_ABSTIME, &its, nullptr);
+      uint64_t val = 0;
+      if (sizeof(val) != read(TFD, &val, sizeof(val))) {
+        break;
+      }
+      wakeups++;
+      const uint64_t NOW = _mono_ns();
+      while (heap.due[0] <= NOW) {
+        const uint64_t LATE_NS = NOW - heap.due[0];
+        const uint32_t LATE_US = (LATE_NS > 0xFFFFFFFFULL * 1000ULL) ? 0xFFFFFFFF : (uint32_t) (LATE_NS / 1000ULL);
+        samples[fired % SCHED_BENCH_MAX_SAMPLES] = LATE_US;
+        late_max = strict_max(late_max, LATE_US);
+        fired++;
+        heap.due[0] += heap.period[0];
+        _sched_bench_sift_down(&heap, 0);
+      }
+      if (!tickless) {
+        next += PERIOD_NS;
+      }
+    }
+
+    const uint32_t SAMPLE_COUNT = strict_min(fired, (uint32_t) SCHED_BENCH_MAX_SAMPLES);
+    qsort(samples, SAMPLE_COUNT, sizeof(uint32_t), _uint32_cmp);
+    output->concatf("\t%9u  %-8s  %10.1f  %10.1f  %8u  %8u  %8u\n",
+      count, (tickless ? "TICKLESS" : "TICK"),
+      (double) wakeups / seconds, (double) fired / seconds,
+      ((0 < SAMPLE_COUNT) ? samples[((SAMPLE_COUNT - 1) * 50) / 100] : 0),
+      ((0 < SAMPLE_COUNT) ? samples[((SAMPLE_COUNT - 1) * 99) / 100] : 0),
+      late_max
+    );
+  }
+  if (0 <= TFD) close(TFD);
+  if (nullptr != heap.due)    free(heap.due);
+  if (nullptr != heap.period) free(heap.period);
+  if (nullptr != samples)     free(samples);
+}
+
+
+/*
+* Benchmarks TICK against TICKLESS with 1, 100, and 10000 schedules. Reports
+*   wakeups per second, and the lateness of each schedule relative to its
+*   deadline. This will block the caller for (6 * seconds), so seconds is
+*   clamped to CONFIG_C3P_SCHED_BENCH_MAX_SECONDS.
+*/
+void LinuxPlatform::benchmarkScheduler(StringBuilder* output, uint32_t seconds) {
+  const uint32_t POPULATIONS[3] = {1, 100, 10000};
+  if (0 == seconds) seconds = 2;
+  seconds = strict_min(seconds, (uint32_t) CONFIG_C3P_SCHED_BENCH_MAX_SECONDS);
+  output->concatf("\tScheduler benchmark (%us per run, %ums tick)\n", seconds, CONFIG_C3P_INTERVAL_PERIOD_MS);
+  output->concat("\tSchedules  Mode       Wakeups/s     Fired/s  p50 (us)  p99 (us)  max (us)\n");
+  for (uint8_t i = 0; i < 3; i++) {
+    _sched_bench_run(output, POPULATIONS[i], false, seconds);
+    _sched_bench_run(output, POPULATIONS[i], true,  seconds);
+  }
+}
+
+
+
+/*******************************************************************************
+* Latency histograms                                                           *
+*******************************************************************************/
+#if defined(CONFIG_C3P_PERF_HISTOGRAMS)
+
+// Constant-initialized, so it is safe to use from constructors in other
+//   translation units that run before ours.
+static LinuxPerfHistogram* _perf_list = nullptr;
+
+static inline uint32_t _perf_bucket_index(uint64_t v) {
+  if (v < C3P_PERF_SUB_COUNT) {
+    return (uint32_t) v;
+  }
+  uint32_t msb = 63 - __builtin_clzll(v);
+  if (msb > C3P_PERF_MAX_MSB) {
+    return (C3P_PERF_BUCKETS - 1);
+  }
+  const uint32_t SHIFT = msb - C3P_PERF_SUB_BITS;
+  const uint32_t SUB   = (uint32_t) (v >> SHIFT) - C3P_PERF_SUB_COUNT;
+  return C3P_PERF_SUB_COUNT + (SHIFT * C3P_PERF_SUB_COUNT) + SUB;
+}
+
+/* The middle of the range of values that land in the given bucket. */
+static inline uint64_t _perf_bucket_value(uint32_t idx) {
+  if (idx < C3P_PERF_SUB_COUNT) {
+    return idx;
+  }
+  const uint32_t SHIFT = (idx - C3P_PERF_SUB_COUNT) / C3P_PERF_SUB_COUNT;
+  const uint32_t SUB   = (idx - C3P_PERF_SUB_COUNT) % C3P_PERF_SUB_COUNT;
+  const uint64_t LOW   = ((uint64_t) (C3P_PERF_SUB_COUNT + SUB)) << SHIFT;
+  return LOW + ((1ULL << SHIFT) >> 1);
+}
+
+
+LinuxPerfHistogram::LinuxPerfHistogram(const char* name) : _name(name), _next(nullptr) {
+  reset();
+  _next = __atomic_load_n(&_perf_list, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&_perf_list, &_next, this, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+}
+
+
+/**
+* Adds a sample. Lock-free, and safe to call from any thread.
+*/
+void LinuxPerfHistogram::record(uint64_t ns) {
+  __atomic_fetch_add(&_buckets[_perf_bucket_index(ns)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&_sum_ns, ns, __ATOMIC_RELAXED);
+  uint64_t seen_max = __atomic_load_n(&_max_ns, __ATOMIC_RELAXED);
+  while (ns > seen_max) {
+    if (__atomic_compare_exchange_n(&_max_ns, &seen_max, ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+}
+
+
+/**
+* Samples recorded while the reset is underway may be lost.
+*/
+void LinuxPerfHistogram::reset() {
+  for (uint32_t i = 0; i < C3P_PERF_BUCKETS; i++) {
+    __atomic_store_n(&_buckets[i], 0, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&_count,  0, __ATOMIC_RELAXED);
+  __atomic_store_n(&_sum_ns, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&_max_ns, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&_reset_ns, _mono_ns(), __ATOMIC_RELAXED);
+}
+
+
+/**
+* @param pct is the percentile of interest, from 0 to 100.
+* @return the value (in ns) at the given percentile, or 0 if there are no samples.
+*/
+uint64_t LinuxPerfHistogram::percentile(double pct) {
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < C3P_PERF_BUCKETS; i++) {
+    total += __atomic_load_n(&_buckets[i], __ATOMIC_RELAXED);
+  }
+  if (0 == total) {
+    return 0;
+  }
+  uint64_t target = (uint64_t) ((pct / 100.0) * (double) total);
+  if (target < 1) target = 1;
+  uint64_t running = 0;
+  for (uint32_t i = 0; i < C3P_PERF_BUCKETS; i++) {
+    running += __atomic_load_n(&_buckets[i], __ATOMIC_RELAXED);
+    if (running >= target) {
+      const uint64_t VAL = _perf_bucket_value(i);
+      const uint64_t MAX = __atomic_load_n(&_max_ns, __ATOMIC_RELAXED);
+      return ((VAL > MAX) ? MAX : VAL);
+    }
+  }
+  return __atomic_load_n(&_max_ns, __ATOMIC_RELAXED);
+}
+
+
+void LinuxPerfHistogram::printDebug(StringBuilder* output) {
+  const uint32_t COUNT   = __atomic_load_n(&_count, __ATOMIC_RELAXED);
+  const uint64_t ELAPSED = _mono_ns() - __atomic_load_n(&_reset_ns, __ATOMIC_RELAXED);
+  const double   RATE    = (0 < ELAPSED) ? ((double) COUNT * 1000000000.0 / (double) ELAPSED) : 0.0;
+  const double   MEAN    = (0 < COUNT) ? ((double) __atomic_load_n(&_sum_ns, __ATOMIC_RELAXED) / (double) COUNT) : 0.0;
+  output->concatf("\t%-28s %10u %10.1f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+    _name, COUNT, RATE, MEAN / 1000.0,
+    percentile(50.0) / 1000.0, percentile(90.0) / 1000.0, percentile(99.0) / 1000.0,
+    __atomic_load_n(&_max_ns, __ATOMIC_RELAXED) / 1000.0
+  );
+}
+
+
+void LinuxPerfHistogram::printAll(StringBuilder* output) {
+  output->concatf("\t%-28s %10s %10s %9s %9s %9s %9s %9s\n", "Path (times in us)", "Calls", "Calls/s", "Mean", "p50", "p90", "p99", "Max");
+  LinuxPerfHistogram* h = __atomic_load_n(&_perf_list, __ATOMIC_ACQUIRE);
+  while (nullptr != h) {
+    h->printDebug(output);
+    h = h->_next;
+  }
+}
+
+
+void LinuxPerfHistogram::resetAll() {
+  LinuxPerfHistogram* h = __atomic_load_n(&_perf_list, __ATOMIC_ACQUIRE);
+  while (nullptr != h) {
+    h->reset();
+    h = h->_next;
+  }
+}
+
+
+LinuxPerfScope::LinuxPerfScope(LinuxPerfHistogram* h) : _hist(h), _start_ns(_mono_ns()) {}
+
+LinuxPerfScope::~LinuxPerfScope() {
+  _hist->record(_mono_ns() - _start_ns);
+}
+
+#endif  // CONFIG_C3P_PERF_HISTOGRAMS
+
+
+
+/*******************************************************************************
+* TX flow control                                                              *
+*******************************************************************************/
+
+LinuxFlowGate::LinuxFlowGate(uint32_t high_water) {
+  budget(high_water);
+}
+
+
+/*
+* Sets the watermarks. If the low watermark is not given (or makes no sense),
+*   it is taken to be a quarter of the high.
+*/
+void LinuxFlowGate::budget(uint32_t high_water, uint32_t low_water) {
+  _high_water = high_water;
+  _low_water  = ((0 == low_water) || (low_water >= high_water)) ? (high_water >> 2) : low_water;
+}
+
+
+/*
+* Decides whether a buffer of the given length may be queued. An empty queue
+*   takes anything, so that a buffer larger than the budget can still pass.
+*
+* @return true if the buffer should be taken.
+*/
+bool LinuxFlowGate::admit(uint32_t len) {
+  if (0 == _queued) {
+    return true;
+  }
+  if (_throttled || ((_queued + len) > _high_water)) {
+    _throttled = true;
+    _count_refused++;
+    return false;
+  }
+  return true;
+}
+
+
+void LinuxFlowGate::added(uint32_t len) {
+  _queued += len;
+  if (_queued > _queued_peak) {
+    _queued_peak = _queued;
+  }
+  if (_queued >= _high_water) {
+    _throttled = true;
+  }
+}
+
+
+/*
+* Notes bytes that have left the queue.
+*
+* @return true if the upstream should now be notified.
+*/
+bool LinuxFlowGate::removed(uint32_t len) {
+  _queued = (len < _queued) ? (_queued - len) : 0;
+  if (_throttled && (_queued <= _low_water)) {
+    _throttled = false;
+    _count_resumed++;
+    return true;
+  }
+  return false;
+}
+
+
+/*
+* Implements bufferAvailable() for the pipe. Reads zero until the queue has
+*   drained to the low watermark.
+*/
+int32_t LinuxFlowGate::available() {
+  if (_throttled || (_queued >= _high_water)) {
+    return 0;
+  }
+  return (int32_t) (_high_water - _queued);
+}
+
+
+/*
+* Calls the writable callback, if there is one. The pipe's locks must not be
+*   held, since the callback is likely to push.
+*/
+void LinuxFlowGate::notify(BufferAccepter* pipe) {
+  if (nullptr != _cb) {
+    _cb(pipe, _cb_arg);
+  }
+}
+
+
+/* For when the queue is thrown away. Nobody is waiting on a closed pipe. */
+void LinuxFlowGate::reset() {
+  _queued    = 0;
+  _throttled = false;
+}
+
+
+void LinuxFlowGate::printDebug(StringBuilder* output) {
+  output->concatf("\tTX queued:\t%u bytes (peak %u), watermarks %u / %u%s\n", _queued, _queued_peak, _high_water, _low_water, (_throttled ? " (throttled)" : ""));
+  output->concatf("\tTX refused:\t%u buffers, %u resumes\n", _count_refused, _count_resumed);
+}
+
+
+
+/*******************************************************************************
+* Console callbacks                                                            *
+*******************************************************************************/
+
+/**
+* @page console-handlers
+* @section linux-sched-tools Scheduler tools
+*
+* This is the console handler for inspecting the thread that advances the
+*   scheduler.
+*
+* @subsection cmd-actions Actions
+*
+* Action    | Description | Additional arguments
+* --------- | ----------- | --------------------
+* `jitter`  | Print the lateness distribution of scheduler wakeups. | None
+* `reset`   | Reset the jitter statistics. | None
+* `mode`    | Print or set the timer mode. TICKLESS needs a deadline source. | [tick|oneshot|tickless]
+* `bench`   | Compare periodic and deadline-driven timer strategies. | [seconds-per-run]
+*/
+static int callback_platform_sched(StringBuilder* text_return, StringBuilder* args) {
+  int ret = 0;
+  char* cmd = args->position_trimmed(0);
+  if (0 == StringBuilder::strcasecmp(cmd, "reset")) {
+    platform.resetSchedulerJitter();
+    text_return->concat("Scheduler jitter stats reset.\n");
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "mode")) {
+    if (1 < args->count()) {
+      char* mode_str = args->position_trimmed(1);
+      if (0 == StringBuilder::strcasecmp(mode_str, "tick")) {
+        text_return->concatf("schedulerMode(TICK) returned %d\n", platform.schedulerMode(LinuxSchedMode::TICK));
+      }
+      else if (0 == StringBuilder::strcasecmp(mode_str, "oneshot")) {
+        text_return->concatf("schedulerMode(ONESHOT) returned %d\n", platform.schedulerMode(LinuxSchedMode::ONESHOT));
+      }
+      else if (0 == StringBuilder::strcasecmp(mode_str, "tickless")) {
+        text_return->concatf("schedulerMode(TICKLESS) returned %d\n", platform.schedulerMode(LinuxSchedMode::TICKLESS));
+      }
+      else {
+        text_return->concat("Usage:\t sched mode [tick|oneshot|tickless]\n");
+        ret = -1;
+      }
+    }
+    else {
+      text_return->concatf("Scheduler mode is %s\n", _sched_mode_str(platform.schedulerMode()));
+    }
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "bench")) {
+    platform.benchmarkScheduler(text_return, (uint32_t) args->position_as_int(1));
+  }
+  else {
+    platform.printSchedulerJitter(text_return);
+  }
+  return ret;
+}
 
-long unsigned int rng_thread_id = 0;
+
+static int8_t _cpu_list_parse(const char*, cpu_set_t*);
 
 /**
-* This is a thread to keep the randomness pool flush.
+* @page console-handlers
+* @section linux-thread-tools Thread tools
+*
+* Lists the threads created by the platform, and allows them to be pinned to
+*   CPUs at runtime.
+*
+* @subsection cmd-actions Actions
+*
+* Action    | Description | Additional arguments
+* --------- | ----------- | --------------------
+* `pin`     | Set the CPUs for a named thread. `any` unpins. | <name> <cpu-list|any>
 */
-static void* dev_urandom_reader(void*) {
-  FILE* ur_file = fopen("/dev/urandom", "rb");
-  unsigned int rng_level    = 0;
-  unsigned int needed_count = 0;
-
-  if (ur_file) {
-    while (platform.platformState() <= MANUVR_INIT_STATE_NOMINAL) {
-      rng_level = _random_pool_w_ptr - _random_pool_r_ptr;
-      if (rng_level == PLATFORM_RNG_CARRY_CAPACITY) {
-        // We have filled our entropy pool. Sleep.
-        // TODO: Implement wakeThread() and this can go way higher.
-        sleep_ms(10);
+static int callback_platform_threads(StringBuilder* text_return, StringBuilder* args) {
+  int ret = 0;
+  char* cmd = args->position_trimmed(0);
+  if (0 == StringBuilder::strcasecmp(cmd, "pin")) {
+    if (3 == args->count()) {
+      char* name = args->position_trimmed(1);
+      char* list = args->position_trimmed(2);
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      if ((0 != StringBuilder::strcasecmp(list, "any")) && (0 != _cpu_list_parse(list, &cpus))) {
+        text_return->concatf("Bad CPU list: %s\n", list);
+        ret = -1;
       }
       else {
-        // We continue feeding the entropy pool as demanded until the platform
-        //   leaves its nominal state. Don't write past the wrap-point.
-        unsigned int _w_ptr = _random_pool_w_ptr % PLATFORM_RNG_CARRY_CAPACITY;
-        unsigned int _delta_to_wrap = PLATFORM_RNG_CARRY_CAPACITY - _w_ptr;
-        unsigned int _delta_to_fill = PLATFORM_RNG_CARRY_CAPACITY - rng_level;
-
-        needed_count = ((_delta_to_fill < _delta_to_wrap) ? _delta_to_fill : _delta_to_wrap);
-        size_t ret = fread((void*)&randomness_pool[_w_ptr], sizeof(uint32_t), needed_count, ur_file);
-        //printf("Read %d uint32's from /dev/urandom.\n", ret);
-        if((ret > 0) && !ferror(ur_file)) {
-          _random_pool_w_ptr += ret;
-        }
-        else {
-          fclose(ur_file);
-          printf("Failed to read /dev/urandom.\n");
-          return NULL;
-        }
+        text_return->concatf("threadAffinity(%s, %s) returned %d\n", name, list, platform.threadAffinity(name, &cpus));
       }
     }
-    fclose(ur_file);
+    else {
+      text_return->concat("Usage:\t threads pin <name> <cpu-list|any>\n");
+      ret = -1;
+    }
   }
   else {
-    printf("Failed to open /dev/urandom.\n");
+    platform.printThreads(text_return);
   }
-  printf("Exiting random thread.....\n");
-  return NULL;
+  return ret;
 }
 
 
 /**
-* Dead-simple interface to the RNG. Despite the fact that it is interrupt-driven, we may resort
-*   to polling if random demand exceeds random supply. So this may block until a random number
-*   is actually availible (next_random_int != 0).
+* @page console-handlers
+* @section linux-log-tools Log tools
 *
-* @return   A 32-bit unsigned random number. This can be cast as needed.
+* Controls the asynchronous log writer. With no arguments, prints its counters.
+*
+* @subsection cmd-actions Actions
+*
+* Action    | Description | Additional arguments
+* --------- | ----------- | --------------------
+* `level`   | Print or set the severity threshold. | [0-7]
+* `target`  | Print or set the log destination. | [stdout|syslog|file <path>]
+* `flush`   | Wait for queued messages to be written. | None
 */
-uint32_t randomUInt32() {
-  // Preferably, we'd shunt to a PRNG at this point. For now we block.
-  while (_random_pool_w_ptr <= _random_pool_r_ptr) {
+static int callback_platform_log(StringBuilder* text_return, StringBuilder* args) {
+  int ret = 0;
+  char* cmd = args->position_trimmed(0);
+  if (0 == StringBuilder::strcasecmp(cmd, "level")) {
+    if (1 < args->count()) {
+      platform.logVerbosity((uint8_t) args->position_as_int(1));
+    }
+    text_return->concatf("Log verbosity is %u\n", platform.logVerbosity());
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "target")) {
+    if (1 < args->count()) {
+      char* tgt_str = args->position_trimmed(1);
+      if (0 == StringBuilder::strcasecmp(tgt_str, "stdout")) {
+        text_return->concatf("logTarget(STDOUT) returned %d\n", platform.logTarget(LinuxLogTarget::STDOUT));
+      }
+      else if (0 == StringBuilder::strcasecmp(tgt_str, "syslog")) {
+        text_return->concatf("logTarget(SYSLOG) returned %d\n", platform.logTarget(LinuxLogTarget::SYSLOG));
+      }
+      else if ((0 == StringBuilder::strcasecmp(tgt_str, "file")) && (2 < args->count())) {
+        char* path = args->position_trimmed(2);
+        text_return->concatf("logTarget(FILE, %s) returned %d\n", path, platform.logTarget(LinuxLogTarget::FILE, path));
+      }
+      else {
+        text_return->concat("Usage:\t log target [stdout|syslog|file <path>]\n");
+        ret = -1;
+      }
+    }
+    else {
+      text_return->concatf("Log target is %s\n", _log_target_str(platform.logTarget()));
+    }
   }
-  return randomness_pool[_random_pool_r_ptr++ % PLATFORM_RNG_CARRY_CAPACITY];
+  else if (0 == StringBuilder::strcasecmp(cmd, "flush")) {
+    text_return->concatf("flushLog() returned %d\n", platform.flushLog());
+  }
+  else {
+    platform.printLogStats(text_return);
+  }
+  return ret;
 }
 
 
 /**
-* Fills the given buffer with random bytes.
-* Blocks if there is nothing random available.
+* @page console-handlers
+* @section linux-reactor-tools Reactor tools
 *
-* @param uint8_t* The buffer to fill.
-* @param size_t The number of bytes to write to the buffer.
-* @return 0, always.
+* Prints the reactor threads and the fds registered with them.
 */
-int8_t random_fill(uint8_t* buf, size_t len) {
-  int written_len = 0;
-  while (4 <= (len - written_len)) {
-    // If we have slots for them, just up-cast and write 4-at-a-time.
-    *((uint32_t*) (buf + written_len)) = randomUInt32();
-    written_len += 4;
-  }
-  uint32_t slack = randomUInt32();
-  while (0 < (len - written_len)) {
-    *(buf + written_len) = (uint8_t) 0xFF & slack;
-    slack = slack >> 8;
-    written_len++;
+static int callback_platform_reactor(StringBuilder* text_return, StringBuilder* args) {
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if (nullptr == reactor) {
+    text_return->concat("The reactor is not running.\n");
+    return -1;
   }
+  reactor->printDebug(text_return);
   return 0;
 }
 
 
+#if defined(CONFIG_C3P_IO_URING)
 /**
-* Init the RNG. Short and sweet.
+* @page console-handlers
+* @section linux-uring-tools io_uring tools
+*
+* Prints the state of the shared io_uring. Sockets and files opened while the
+*   ring is off use the reactor instead, so the two can be compared (A/B) in
+*   the same process.
+*
+* @subsection cmd-actions Actions
+*
+* Action    | Description | Additional arguments
+* --------- | ----------- | --------------------
+* `on`      | Give the ring to sockets and files opened from now on. | None
+* `off`     | Give the reactor to sockets and files opened from now on. | None
 */
-void LinuxPlatform::_init_rng() {
-  srand(time(nullptr));          // Seed the PRNG...
-  if (createThread(&rng_thread_id, nullptr, dev_urandom_reader, nullptr, nullptr)) {
-    printf("Failed to create RNG thread.\n");
-    exit(-1);
+static int callback_platform_uring(StringBuilder* text_return, StringBuilder* args) {
+  char* cmd = args->position_trimmed(0);
+  if (0 == StringBuilder::strcasecmp(cmd, "on")) {
+    LinuxUring::enabled(true);
   }
-  int t_out = 30;
-  while ((_random_pool_w_ptr < PLATFORM_RNG_CARRY_CAPACITY) && (t_out > 0)) {
-    sleep_ms(20);
-    t_out--;
+  LinuxUring* ring = LinuxUring::getInstance();
+  if (nullptr != ring) {
+    ring->printDebug(text_return);
   }
-  if (0 == t_out) {
-    printf("Failed to fill the RNG pool.\n");
-    exit(-1);
+  else {
+    text_return->concatf("io_uring is %s. New I/O uses the reactor.\n", (LinuxUring::enabled() ? "unavailable" : "off"));
   }
-  _alter_flags(true, ABSTRACT_PF_FLAG_RNG_READY);
+  if (0 == StringBuilder::strcasecmp(cmd, "off")) {
+    LinuxUring::enabled(false);
+    text_return->concat("New I/O will use the reactor.\n");
+  }
+  return 0;
 }
+#endif  // CONFIG_C3P_IO_URING
 
 
-/*******************************************************************************
-*     __                      _
-*    / /   ____  ____ _____ _(_)___  ____ _
-*   / /   / __ \/ __ `/ __ `/ / __ \/ __ `/
-*  / /___/ /_/ / /_/ / /_/ / / / / / /_/ /
-* /_____/\____/\__, /\__, /_/_/ /_/\__, /
-*             /____//____/        /____/
-*
-* On vanilla linux, we will defer to the platform object's configuration and
-*   either write to syslog, or STDIO via text-transform.
-*******************************************************************************/
-
-// // Returns 1 if we ought to be logging to the fp_log.
-// //    Since this is our default logging target, we will response 'yes' even if the DB isn't loaded.
-// int shouldLogToSyslog() {
-//   int return_value    = conf.getConfigIntByKey("log-to-syslog");
-//   if (return_value == -1) {
-//     return_value    = 1;
-//   }
-//   return return_value;
-// }
-
-// int shouldLogToStdout() {
-//   int return_value    = conf.getConfigIntByKey("log-to-stdout");
-//   if (return_value == -1) {
-//     return_value    = 0;
-//   }
-//   return return_value;
-// }
-
-bool shouldLogToSyslog() {  return false; }    // TODO: This
-bool shouldLogToStdout() {  return true;  }    // TODO: This
-
+#if defined(CONFIG_C3P_PERF_HISTOGRAMS)
 /**
-* This function is declared in CppPotpourri (AbstractPlatform.h).
-* Log the given message.
+* @page console-handlers
+* @section linux-perf-tools Latency histograms
 *
-* @param severity is the syslog-style importance of the message.
-* @param tag is the free-form source of the message.
-* @param msg contains the log content.
+* Prints the latency distribution of every instrumented hot path.
+*
+* @subsection cmd-actions Actions
+*
+* Action    | Description | Additional arguments
+* --------- | ----------- | --------------------
+* `reset`   | Clear every histogram. | None
 */
-void c3p_log(uint8_t severity, const char* tag, StringBuilder* msg) {
-  bool log_disseminated = false;
-  if (shouldLogToSyslog()) {
-    syslog(severity, "%s", (char*) msg->string());
-    log_disseminated    = true;
+static int callback_platform_perf(StringBuilder* text_return, StringBuilder* args) {
+  char* cmd = args->position_trimmed(0);
+  if (0 == StringBuilder::strcasecmp(cmd, "reset")) {
+    LinuxPerfHistogram::resetAll();
+    text_return->concat("Histograms reset.\n");
   }
-
-  if (!log_disseminated || shouldLogToStdout()){
-    printf("%s\n", msg->string());
+  else {
+    LinuxPerfHistogram::printAll(text_return);
   }
+  return 0;
 }
+#endif  // CONFIG_C3P_PERF_HISTOGRAMS
 
 
-
-/*******************************************************************************
-*     ____  __      __  ____                        ____  ____      __
-*    / __ \/ /___ _/ /_/ __/___  _________ ___     / __ \/ __ )    / /
-*   / /_/ / / __ `/ __/ /_/ __ \/ ___/ __ `__ \   / / / / __  |_  / /
-*  / ____/ / /_/ / /_/ __/ /_/ / /  / / / / / /  / /_/ / /_/ / /_/ /
-* /_/   /_/\__,_/\__/_/  \____/_/  /_/ /_/ /_/   \____/_____/\____/
+/**
+* Adds the Linux-specific console commands to those provided by
+*   AbstractPlatform.
 *
-* These are overrides and additions to the platform class.
-*******************************************************************************/
-
-void LinuxPlatform::printDebug(StringBuilder* output) {
-  output->concatf(
-    "==< Linux [%s] >=============================\n",
-    _board_name
-  );
-  _print_abstract_debug(output);
-
-  struct utsname sname;
-  if (uname(&sname) != -1) {
-    output->concatf("\t%s %s (%s)\n", sname.sysname, sname.release, sname.machine);
-    output->concatf("\t%s\n", sname.version);
-  }
-  else {
-    output->concat("\tFailed to get detailed kernel info.\n");
-  }
-
-  #if defined(__HAS_CRYPT_WRAPPER)
-    output->concatf("-- Binary hash         %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x",
-      _binary_hash[0],  _binary_hash[1],  _binary_hash[2],  _binary_hash[3],
-      _binary_hash[4],  _binary_hash[5],  _binary_hash[6],  _binary_hash[7],
-      _binary_hash[8],  _binary_hash[9],  _binary_hash[10], _binary_hash[11],
-      _binary_hash[12], _binary_hash[13], _binary_hash[14], _binary_hash[15]
-    );
-    output->concatf("%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
-      _binary_hash[16], _binary_hash[17], _binary_hash[18], _binary_hash[19],
-      _binary_hash[20], _binary_hash[21], _binary_hash[22], _binary_hash[23],
-      _binary_hash[24], _binary_hash[25], _binary_hash[26], _binary_hash[27],
-      _binary_hash[28], _binary_hash[29], _binary_hash[30], _binary_hash[31]
-    );
-    randomArt(_binary_hash, 32, "SHA256", output);
+* @param console is the console to which commands will be added.
+* @return 0 on success.
+*/
+int8_t LinuxPlatform::configureConsole(ParsingConsole* console) {
+  int8_t ret = AbstractPlatform::configureConsole(console);
+  console->defineCommand("threads", '\0', "Platform thread tools.", "[pin]", 0, callback_platform_threads);
+  console->defineCommand("sched", '\0', "Scheduler timer tools.", "[jitter|reset|mode|bench]", 0, callback_platform_sched);
+  console->defineCommand("log", '\0', "Log writer tools.", "[level|target|flush]", 0, callback_platform_log);
+  console->defineCommand("reactor", '\0', "Print the I/O reactor's state.", "", 0, callback_platform_reactor);
+  #if defined(CONFIG_C3P_IO_URING)
+    console->defineCommand("uring", '\0', "io_uring tools.", "[on|off]", 0, callback_platform_uring);
   #endif
+  #if defined(CONFIG_C3P_PERF_HISTOGRAMS)
+    console->defineCommand("perf", '\0', "Hot-path latency histograms.", "[reset]", 0, callback_platform_perf);
+  #endif
+  return ret;
 }
 
 
@@ -567,22 +2467,343 @@ void sleep_us(uint32_t us) {
 /*******************************************************************************
 * Threading                                                                    *
 *******************************************************************************/
+/*
+* Every thread created through the platform is wrapped by a trampoline, so that
+*   we can learn its kernel TID, name it, and account for it in printDebug().
+*/
+typedef struct {
+  unsigned long thread_id;   // The pthread_t.
+  pid_t         tid;         // The kernel's TID, for /proc/self/task.
+  ThreadFxnPtr  fxn;
+  void*         args;
+  cpu_set_t     cpus;        // An empty set means "any CPU".
+  uint32_t*     park_word;   // Points at the thread's own park token.
+  bool*         started;     // createThread() waits on this until the TID is known.
+  char          name[16];    // Linux limits thread names to 15 characters.
+} LinuxThreadRecord;
+
+/*
+* Every thread has a park token. wakeThread() sets it and wakes the futex.
+*   suspendThread() consumes it, or blocks until it is set (or times out).
+*   A wake that arrives before the thread parks is therefore not lost.
+*/
+static __thread uint32_t _tl_park_word = 0;
+
+static pthread_mutex_t _thread_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  _thread_started_cond = PTHREAD_COND_INITIALIZER;
+static LinkedList<LinuxThreadRecord*> _thread_list;
+
+
+static void _thread_record_release(void* arg) {
+  LinuxThreadRecord* rec = (LinuxThreadRecord*) arg;
+  pthread_mutex_lock(&_thread_list_mutex);
+  _thread_list.remove(rec);
+  pthread_mutex_unlock(&_thread_list_mutex);
+  free(rec);
+}
+
+
+static void* _thread_trampoline(void* arg) {
+  LinuxThreadRecord* rec = (LinuxThreadRecord*) arg;
+  void* ret = nullptr;
+  pthread_mutex_lock(&_thread_list_mutex);
+  rec->thread_id = (unsigned long) pthread_self();
+  rec->tid       = (pid_t) syscall(SYS_gettid);
+  rec->park_word = &_tl_park_word;
+  if (nullptr != rec->started) {
+    // The flag lives on createThread()'s stack, so it is only touched here.
+    *(rec->started) = true;
+    rec->started    = nullptr;
+    pthread_cond_broadcast(&_thread_started_cond);
+  }
+  pthread_mutex_unlock(&_thread_list_mutex);
+  if (0 != rec->name[0]) {
+    pthread_setname_np(pthread_self(), rec->name);
+  }
+  // The record must be released even if the thread is cancelled.
+  pthread_cleanup_push(_thread_record_release, (void*) rec);
+  ret = rec->fxn(rec->args);
+  pthread_cleanup_pop(1);
+  return ret;
+}
+
+
+/*
+* Parses a CPU list of the form taskset(1) takes (e.g. "0,2-3") into a cpu_set_t.
+*
+* @return 0 on success, -1 on a malformed or out-of-range list.
+*/
+static int8_t _cpu_list_parse(const char* list, cpu_set_t* cpus) {
+  CPU_ZERO(cpus);
+  const char* cursor = list;
+  while ((nullptr != cursor) && (0 != *cursor)) {
+    char* end = nullptr;
+    const long FIRST = strtol(cursor, &end, 10);
+    long last = FIRST;
+    if ((end == cursor) || (0 > FIRST)) return -1;
+    if ('-' == *end) {
+      cursor = end + 1;
+      last = strtol(cursor, &end, 10);
+      if ((end == cursor) || (last < FIRST)) return -1;
+    }
+    if (CPU_SETSIZE <= last) return -1;
+    for (long i = FIRST; i <= last; i++) {
+      CPU_SET((int) i, cpus);
+    }
+    if (',' == *end) {
+      end++;
+    }
+    else if (0 != *end) {
+      return -1;
+    }
+    cursor = end;
+  }
+  return ((0 < CPU_COUNT(cpus)) ? 0 : -1);
+}
+
+
+/* Renders a cpu_set_t as a CPU list (e.g. "0,2-3"), or "any" if it is empty. */
+static void _cpu_list_render(const cpu_set_t* cpus, char* buf, size_t buf_len) {
+  size_t len = 0;
+  buf[0] = 0;
+  if (0 == CPU_COUNT(cpus)) {
+    snprintf(buf, buf_len, "any");
+    return;
+  }
+  for (int i = 0; (i < CPU_SETSIZE) && (len < buf_len); i++) {
+    if (CPU_ISSET(i, cpus)) {
+      int last = i;
+      while (((last + 1) < CPU_SETSIZE) && CPU_ISSET(last + 1, cpus)) last++;
+      if (last == i) {
+        len += snprintf(&buf[len], buf_len - len, "%s%d", ((0 < len) ? "," : ""), i);
+      }
+      else {
+        len += snprintf(&buf[len], buf_len - len, "%s%d-%d", ((0 < len) ? "," : ""), i, last);
+      }
+      i = last;
+    }
+  }
+}
+
+
 /**
 * On linux, we support pthreads. On microcontrollers, we support FreeRTOS.
 * This is the wrapper to create a new thread.
 *
-* @return The thread's return value.
+* PlatformThreadOpts are mapped onto pthread attributes:
+*   thread_name: Given to pthread_setname_np() (truncated to 15 characters).
+*   stack_sz:    Stack size in bytes. Zero (or too small) means the default.
+*   priority:    If non-zero, the thread runs under a real-time policy at that
+*                  priority (clamped to the range allowed by the policy).
+* The platform-specific argument may be a LinuxThreadOpts, which supplies a CPU
+*   affinity set and the real-time policy (SCHED_FIFO if not given).
+*
+* Does not return until the new thread has recorded its TID.
+*
+* @return 0 on success, or the error from pthread_create().
 */
 int LinuxPlatform::createThread(unsigned long* _thread_id, void* _something, ThreadFxnPtr _fxn, void* _args, PlatformThreadOpts* _thread_opts) {
-  return pthread_create(_thread_id, (const pthread_attr_t*) _something, _fxn, _args);
+  LinuxThreadOpts* l_opts = (LinuxThreadOpts*) _something;
+  LinuxThreadRecord* rec  = (LinuxThreadRecord*) malloc(sizeof(LinuxThreadRecord));
+  if (nullptr == rec) {
+    return ENOMEM;
+  }
+  memset(rec, 0, sizeof(LinuxThreadRecord));
+  bool started  = false;
+  rec->fxn      = _fxn;
+  rec->args     = _args;
+  rec->started  = &started;
+  CPU_ZERO(&rec->cpus);
+  if (nullptr != l_opts) {
+    memcpy(&rec->cpus, &l_opts->cpus, sizeof(cpu_set_t));
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  bool rt_sched = false;
+  if (nullptr != _thread_opts) {
+    if (nullptr != _thread_opts->thread_name) {
+      strncpy(rec->name, _thread_opts->thread_name, sizeof(rec->name) - 1);
+    }
+    if (PTHREAD_STACK_MIN <= _thread_opts->stack_sz) {
+      pthread_attr_setstacksize(&attr, _thread_opts->stack_sz);
+    }
+    if (0 < _thread_opts->priority) {
+      const int POLICY = ((nullptr != l_opts) && (SCHED_RR == l_opts->sched_policy)) ? SCHED_RR : SCHED_FIFO;
+      struct sched_param param;
+      param.sched_priority = strict_max(sched_get_priority_min(POLICY), strict_min(sched_get_priority_max(POLICY), (int) _thread_opts->priority));
+      pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+      pthread_attr_setschedpolicy(&attr, POLICY);
+      pthread_attr_setschedparam(&attr, &param);
+      rt_sched = true;
+    }
+  }
+  if (0 < CPU_COUNT(&rec->cpus)) {
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &rec->cpus);
+  }
+
+  pthread_mutex_lock(&_thread_list_mutex);
+  _thread_list.insert(rec);
+  pthread_mutex_unlock(&_thread_list_mutex);
+
+  int ret = pthread_create((pthread_t*) _thread_id, &attr, _thread_trampoline, (void*) rec);
+  if ((EPERM == ret) && rt_sched) {
+    // We aren't allowed a real-time policy. Fall back to the default.
+    c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "Not permitted to set real-time priority for thread %s.", rec->name);
+    pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+    ret = pthread_create((pthread_t*) _thread_id, &attr, _thread_trampoline, (void*) rec);
+  }
+  pthread_attr_destroy(&attr);
+  pthread_mutex_lock(&_thread_list_mutex);
+  if (0 != ret) {
+    _thread_list.remove(rec);
+    free(rec);
+  }
+  else {
+    // The record may already be gone by the time we wake, so we wait on our
+    //   own flag, and not on the record.
+    while (!started) {
+      pthread_cond_wait(&_thread_started_cond, &_thread_list_mutex);
+    }
+  }
+  pthread_mutex_unlock(&_thread_list_mutex);
+  return ret;
 }
 
 int LinuxPlatform::deleteThread(unsigned long* _thread_id) {
   return pthread_cancel(*_thread_id);
 }
 
+
+/**
+* Changes the CPU affinity of a platform-created thread, by name.
+*
+* @param name is the thread's name, as given in PlatformThreadOpts.
+* @param cpus is the set of allowed CPUs. nullptr or an empty set means all of them.
+* @return 0 on success, -1 if no such thread, -2 if the kernel refused.
+*/
+int8_t LinuxPlatform::threadAffinity(const char* name, const cpu_set_t* cpus) {
+  int8_t ret = -1;
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if ((nullptr != cpus) && (0 < CPU_COUNT(cpus))) {
+    memcpy(&allowed, cpus, sizeof(cpu_set_t));
+  }
+  else {
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+      CPU_SET(i, &allowed);
+    }
+  }
+  pthread_mutex_lock(&_thread_list_mutex);
+  for (int i = 0; i < _thread_list.size(); i++) {
+    LinuxThreadRecord* rec = _thread_list.get(i);
+    if ((0 != rec->thread_id) && (0 == strcmp(rec->name, name))) {
+      ret = (0 == pthread_setaffinity_np((pthread_t) rec->thread_id, sizeof(cpu_set_t), &allowed)) ? 0 : -2;
+      if (0 == ret) {
+        if (nullptr != cpus) {
+          memcpy(&rec->cpus, cpus, sizeof(cpu_set_t));
+        }
+        else {
+          CPU_ZERO(&rec->cpus);
+        }
+      }
+    }
+  }
+  pthread_mutex_unlock(&_thread_list_mutex);
+  return ret;
+}
+
+
+/**
+* Lists every platform-created thread, with the CPU it last ran on, and the CPU
+*   time it has accumulated (from /proc/self/task/<tid>/stat).
+*/
+void LinuxPlatform::printThreads(StringBuilder* output) {
+  const long CLK_TCK = sysconf(_SC_CLK_TCK);
+  output->concat("\t  TID              Name  CPU  CPU time (s)  Allowed CPUs\n");
+  pthread_mutex_lock(&_thread_list_mutex);
+  for (int i = 0; i < _thread_list.size(); i++) {
+    LinuxThreadRecord* rec = _thread_list.get(i);
+    int  cpu_num = -1;
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    char stat_path[48];
+    snprintf(stat_path, sizeof(stat_path), "/proc/self/task/%d/stat", (int) rec->tid);
+    FILE* stat_file = fopen(stat_path, "r");
+    if (nullptr != stat_file) {
+      char line[512];
+      if (nullptr != fgets(line, sizeof(line), stat_file)) {
+        // The comm field may contain spaces. Fields are counted from the
+        //   last ')'. The state is field 3.
+        char* fields = strrchr(line, ')');
+        if (nullptr != fields) {
+          char* save_ptr = nullptr;
+          char* tok = strtok_r(fields + 1, " ", &save_ptr);
+          for (int field = 3; (nullptr != tok); field++) {
+            switch (field) {
+              case 14:  utime   = strtoul(tok, nullptr, 10);  break;
+              case 15:  stime   = strtoul(tok, nullptr, 10);  break;
+              case 39:  cpu_num = atoi(tok);                  break;
+              default:  break;
+            }
+            tok = strtok_r(nullptr, " ", &save_ptr);
+          }
+        }
+      }
+      fclose(stat_file);
+    }
+    char cpu_list[64];
+    _cpu_list_render(&rec->cpus, cpu_list, sizeof(cpu_list));
+    output->concatf("\t%5d  %16s  %3d  %12.2f  %s\n",
+      (int) rec->tid, rec->name, cpu_num,
+      (double) (utime + stime) / (double) CLK_TCK, cpu_list
+    );
+  }
+  pthread_mutex_unlock(&_thread_list_mutex);
+}
+
+/**
+* Wakes a platform-created thread that is parked in suspendThread(). If the
+*   thread isn't parked, its next call to suspendThread() will return at once.
+*
+* @return 0 on success, -1 if the thread is not known to the platform.
+*/
 int LinuxPlatform::wakeThread(unsigned long _thread_id) {
-  return 0;
+  int ret = -1;
+  pthread_mutex_lock(&_thread_list_mutex);
+  for (int i = 0; i < _thread_list.size(); i++) {
+    LinuxThreadRecord* rec = _thread_list.get(i);
+    if ((rec->thread_id == _thread_id) && (nullptr != rec->park_word)) {
+      if (0 == __atomic_exchange_n(rec->park_word, 1, __ATOMIC_ACQ_REL)) {
+        _futex_wake(rec->park_word, 1);
+      }
+      ret = 0;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_thread_list_mutex);
+  return ret;
+}
+
+
+/**
+* Parks the calling thread until wakeThread() is called for it, or the default
+*   timeout elapses.
+*/
+void LinuxPlatform::suspendThread() {
+  suspendThread(CONFIG_C3P_THREAD_PARK_TIMEOUT_MS);
+}
+
+
+/**
+* Parks the calling thread until wakeThread() is called for it, or the given
+*   timeout elapses. A timeout of 0 means forever.
+*/
+void LinuxPlatform::suspendThread(uint32_t timeout_ms) {
+  if (0 == __atomic_exchange_n(&_tl_park_word, 0, __ATOMIC_ACQ_REL)) {
+    _futex_wait(&_tl_park_word, 0, timeout_ms);
+    __atomic_store_n(&_tl_park_word, 0, __ATOMIC_RELEASE);
+  }
 }
 
 
@@ -629,7 +2850,11 @@ int LinuxPlatform::wakeThread(unsigned long _thread_id) {
 * Process control                                                              *
 *******************************************************************************/
 void LinuxPlatform::_close_open_threads() {
-  unset_linux_interval_timer();   // Stop the periodic alarm.
+  _deinit_scheduler_thread();   // Stop advancing the scheduler.
+  #if defined(CONFIG_C3P_IO_URING)
+    LinuxUring::shutdown();     // Stop completing I/O.
+  #endif
+  LinuxReactor::shutdown();     // Stop servicing I/O.
   //_set_init_state(MANUVR_INIT_STATE_HALTED);
   if (rng_thread_id) {
     if (0 == deleteThread(&rng_thread_id)) {
@@ -640,6 +2865,7 @@ void LinuxPlatform::_close_open_threads() {
   if (crypto_thread_id) {
     if (0 == crypto->deinit()) {
       // Orderly thread termination is preferable.
+      wakeThread(crypto_thread_id);
       while (0 != crypto_thread_id) {
         sleep_ms(10);
       }
@@ -650,6 +2876,7 @@ void LinuxPlatform::_close_open_threads() {
   #endif  // __HAS_CRYPT_WRAPPER
 
   sleep_ms(10);
+  _deinit_log_thread();   // Last, so that the shutdown is logged.
 }
 
 
@@ -676,6 +2903,14 @@ void LinuxPlatform::firmware_reset(uint8_t reason) {
   exit(0);
 }
 
+/*
+* Signals only leave a note. The application's main loop should exit when
+*   this returns non-zero, and call firmware_shutdown() on its way out. A
+*   second signal ends the process without ceremony.
+*/
+int LinuxPlatform::shutdownRequested() {   return (int) _shutdown_signal;   }
+
+
 /*
 * On linux, we take this to mean: scheule a program restart with the OS,
 *   and then terminate this one.
@@ -693,13 +2928,17 @@ void LinuxPlatform::firmware_shutdown(uint8_t reason) {
 #if defined(__HAS_CRYPT_WRAPPER)
 
 /**
-* This is a thread to keep the randomness pool flush.
+* This is the thread that runs the CryptoProcessor's queue. It parks when the
+*   queue is idle, and queueCryptoJob() wakes it. A job queued on the
+*   CryptoProcessor directly waits for the park to time out.
 */
 static void* crypto_processor_thread(void*) {
   printf("Starting CryptoProcessor thread...\n");
   CryptoProcessor* cproc = platformObj()->crypto;
   while (cproc->initialized()) {
-    cproc->poll();
+    if (0 == cproc->poll()) {
+      platform.suspendThread();
+    }
   }
   printf("Exiting CryptoProcessor thread...\n");
   crypto_thread_id = 0;
@@ -707,6 +2946,22 @@ static void* crypto_processor_thread(void*) {
 }
 
 
+/*
+* Queues a job on the CryptoProcessor, and wakes the thread that runs it.
+*
+* @return whatever CryptoProcessor::queue_job() returned, or -1 if there is
+*   no CryptoProcessor.
+*/
+int8_t LinuxPlatform::queueCryptoJob(CryptOp* op) {
+  int8_t ret = -1;
+  if (nullptr != crypto) {
+    ret = crypto->queue_job(op);
+    wakeThread(crypto_thread_id);
+  }
+  return ret;
+}
+
+
 int8_t LinuxPlatform::internal_integrity_check(uint8_t* test_buf, int test_len) {
   if ((nullptr != test_buf) && (0 < test_len)) {
     for (int i = 0; i < test_len; i++) {
@@ -785,6 +3040,14 @@ int8_t LinuxPlatform::init() {
 
   uint32_t default_flags = DEFAULT_PLATFORM_FLAGS;
   _main_pid = getpid();  // Our PID.
+  #if defined(CONFIG_C3P_FLIGHT_RECORDER)
+    if (0 != _init_flight_recorder()) {
+      printf("Failed to map the flight recorder. Continuing without it.\n");
+    }
+  #endif
+  if (0 != _init_log_thread()) {
+    printf("Failed to start the log writer. Logging will be synchronous.\n");
+  }
   _alter_flags(true, default_flags);
 
   _init_rng();
@@ -795,7 +3058,9 @@ int8_t LinuxPlatform::init() {
     _storage_device = (Storage*) sd;
   #endif
 
-  set_linux_interval_timer();
+  if (0 != _init_scheduler_thread()) {
+    return -5;
+  }
 
   #if defined(__HAS_CRYPT_WRAPPER)
     crypto = new CryptoProcessor(CONFIG_C3P_CRYPTO_QUEUE_MAX_DEPTH);
@@ -803,7 +3068,10 @@ int8_t LinuxPlatform::init() {
       if (0 != crypto->init()) {
         return -3;
       }
-      if (createThread(&crypto_thread_id, nullptr, crypto_processor_thread, nullptr, nullptr)) {
+      PlatformThreadOpts topts;
+      memset(&topts, 0, sizeof(topts));
+      topts.thread_name = (char*) "CryptoProcessor";
+      if (createThread(&crypto_thread_id, nullptr, crypto_processor_thread, nullptr, &topts)) {
         printf("Failed to create crypto thread.\n");
         return -4;
       }
@@ -39,8 +39,17 @@ typedef struct {
 * Static members and initializers should be located here.
 *******************************************************************************/
 
-unsigned long _thread_id = 0;
+/*
+* The adapters are serviced by a thread of their own, since i2c-dev transfers
+*   block in ioctl(), and would otherwise hold up every other source on a
+*   reactor thread. The list is guarded by i2c_instances_mutex, which is held
+*   across poll(). It is recursive, so that a callback may take a bus down. But
+*   an adapter must not be destroyed from its own callbacks.
+*/
+static pthread_mutex_t i2c_instances_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static LinkedList<LinuxI2CLookup*> i2c_instances;
+static unsigned long _i2c_thread_id = 0;
+static bool          _i2c_running   = false;
 
 static LinuxI2CLookup* _i2c_table_get_by_adapter_ref(I2CAdapter* adapter) {
   for (int i = 0; i < i2c_instances.size(); i++) {
@@ -52,25 +61,69 @@ static LinuxI2CLookup* _i2c_table_get_by_adapter_ref(I2CAdapter* adapter) {
 
 
 /**
-* This is a thread to keep the UARTs churning.
+* Keeps the busses churning. The i2c-dev interface has nothing for epoll to
+*   watch, so the thread parks once a pass over the busses finds no work, and
+*   LinuxI2C::queue_io_job() wakes it.
 */
-static void* i2c_polling_handler(void*) {
-  bool keep_polling = true;
-  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Started i2c polling thread.\n");
-  while (keep_polling) {
+static void* _i2c_thread_handler(void*) {
+  while (__atomic_load_n(&_i2c_running, __ATOMIC_ACQUIRE)) {
+    bool worked = false;
+    pthread_mutex_lock(&i2c_instances_mutex);
     for (int i = 0; i < i2c_instances.size(); i++) {
       LinuxI2CLookup* temp = i2c_instances.get(i);
       if (nullptr != temp) {
         if (temp->instance->busOnline()) {
-          temp->instance->poll();
+          worked = (0 < temp->instance->poll()) || worked;
         }
       }
     }
-    keep_polling = (0 < i2c_instances.size());
+    pthread_mutex_unlock(&i2c_instances_mutex);
+    if (!worked) {
+      platform.suspendThread();
+    }
+  }
+  return nullptr;
+}
+
+
+/*
+* Starts the service thread, if it isn't running already.
+*/
+static int8_t _i2c_thread_start() {
+  if (__atomic_load_n(&_i2c_running, __ATOMIC_ACQUIRE)) {
+    return 0;
+  }
+  __atomic_store_n(&_i2c_running, true, __ATOMIC_RELEASE);
+  PlatformThreadOpts topts;
+  memset(&topts, 0, sizeof(topts));
+  topts.thread_name = (char*) "C3PI2C";
+  if (0 != platform.createThread(&_i2c_thread_id, nullptr, _i2c_thread_handler, nullptr, &topts)) {
+    __atomic_store_n(&_i2c_running, false, __ATOMIC_RELEASE);
+    _i2c_thread_id = 0;
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+* Stops the service thread. If called from the thread itself (by way of an
+*   adapter's poll()), the thread is left to exit on its own.
+*/
+static void _i2c_thread_stop() {
+  if (!__atomic_exchange_n(&_i2c_running, false, __ATOMIC_ACQ_REL)) {
+    return;
+  }
+  if (0 != _i2c_thread_id) {
+    platform.wakeThread(_i2c_thread_id);
+    if (pthread_equal(pthread_self(), (pthread_t) _i2c_thread_id)) {
+      pthread_detach((pthread_t) _i2c_thread_id);
+    }
+    else {
+      pthread_join((pthread_t) _i2c_thread_id, nullptr);
+    }
+    _i2c_thread_id = 0;
   }
-  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Exiting i2c polling thread...\n");
-  _thread_id = 0;  // Allow the thread to be restarted later.
-  return NULL;
 }
 
 
@@ -96,7 +149,9 @@ LinuxI2C::LinuxI2C(char* path, const I2CAdapterOptions* o) : I2CAdapter(o, 24, 4
     if (lookup->path) {
       memcpy(lookup->path, path, slen);
       *(lookup->path + slen) = '\0';
+      pthread_mutex_lock(&i2c_instances_mutex);
       i2c_instances.insert(lookup);
+      pthread_mutex_unlock(&i2c_instances_mutex);
     }
     else {
       free(lookup);
@@ -110,10 +165,14 @@ LinuxI2C::LinuxI2C(char* path, const I2CAdapterOptions* o) : I2CAdapter(o, 24, 4
 *   and free any memory it used to store itself.
 */
 LinuxI2C::~LinuxI2C() {
-  LinuxI2CLookup* lookup = _i2c_table_get_by_adapter_ref(this);
   _bus_deinit();
+  pthread_mutex_lock(&i2c_instances_mutex);
+  LinuxI2CLookup* lookup = _i2c_table_get_by_adapter_ref(this);
   if (nullptr != lookup) {
     i2c_instances.remove(lookup);
+  }
+  pthread_mutex_unlock(&i2c_instances_mutex);
+  if (nullptr != lookup) {
     free(lookup->path);
     lookup->path = nullptr;
     free(lookup);
@@ -121,6 +180,16 @@ LinuxI2C::~LinuxI2C() {
 }
 
 
+/*
+* Queues the job as I2CAdapter would, and wakes the thread that runs it.
+*/
+int8_t LinuxI2C::queue_io_job(BusOp* op) {
+  const int8_t RET = I2CAdapter::queue_io_job(op);
+  platform.wakeThread(__atomic_load_n(&_i2c_thread_id, __ATOMIC_ACQUIRE));
+  return RET;
+}
+
+
 /*******************************************************************************
 * Implementation of I2CAdapter.
 *******************************************************************************/
@@ -189,10 +258,14 @@ int8_t I2CAdapter::_bus_init() {
       // http://stackoverflow.com/questions/15337799/configure-linux-i2c-speed
       c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to open the i2c bus represented by %s.\n", filename);
     }
-    else {
-      platform.createThread(&_thread_id, nullptr, i2c_polling_handler, (void*) this, nullptr);
+    else if (0 == _i2c_thread_start()) {
       ret = 0;
     }
+    else {
+      c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to start the i2c service thread.\n");
+      close(open_bus_handle);
+      open_bus_handle = -1;
+    }
   }
   else {
     c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Somehow we failed to sprintf and build a filename to open i2c bus %d.\n", adapterNumber());
@@ -203,6 +276,18 @@ int8_t I2CAdapter::_bus_init() {
 
 int8_t I2CAdapter::_bus_deinit() {
   _bus_online(false);
+  bool any_online = false;
+  pthread_mutex_lock(&i2c_instances_mutex);
+  for (int i = 0; i < i2c_instances.size(); i++) {
+    LinuxI2CLookup* temp = i2c_instances.get(i);
+    if ((nullptr != temp) && temp->instance->busOnline()) {
+      any_online = true;
+    }
+  }
+  pthread_mutex_unlock(&i2c_instances_mutex);
+  if (!any_online) {
+    _i2c_thread_stop();
+  }
   if (open_bus_handle >= 0) {
     close(open_bus_handle);
   }
@@ -0,0 +1,619 @@
+/*
+File:   LinuxReactor.cpp
+Author: J. Ian Lindsay
+Date:   2026.10.16
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+The reactor is the single place where the platform waits for I/O. Drivers
+  register file descriptors with it, and are called back on the reactor's
+  thread when those descriptors are ready. Drivers that have no pollable fd
+  (I2C, for instance) can ask for a periodic timer instead.
+
+There may be more than one reactor thread (CONFIG_C3P_REACTOR_THREADS). Each
+  has its own epoll set, and a given fd is always serviced by the same thread,
+  so a driver never sees its callbacks run concurrently. Each thread also has
+  its own mutex, and fds are found through a table indexed by fd, so changing
+  the interest of an fd on one thread never waits on another thread.
+*/
+
+#include "../Linux.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+
+/*******************************************************************************
+*      _______.___________.    ___   .___________. __    ______     _______.
+*     /       |           |   /   \  |           ||  |  /      |   /       |
+*    |   (----`---|  |----`  /  ^  \ `---|  |----`|  | |  ,----'  |   (----`
+*     \   \       |  |      /  /_\  \    |  |     |  | |  |        \   \
+* .----)   |      |  |     /  _____  \   |  |     |  | |  `----.----)   |
+* |_______/       |__|    /__/     \__\  |__|     |__|  \______|_______/
+*
+* Static members and initializers should be located here.
+*******************************************************************************/
+
+#ifndef CONFIG_C3P_REACTOR_THREADS
+  // How many threads service I/O. Each fd is pinned to one of them.
+  #define CONFIG_C3P_REACTOR_THREADS     1
+#endif
+
+#ifndef CONFIG_C3P_REACTOR_MAX_EVENTS
+  // The most events taken from the kernel per wakeup.
+  #define CONFIG_C3P_REACTOR_MAX_EVENTS  32
+#endif
+
+#ifndef CONFIG_C3P_REACTOR_PIN
+  // If there is more than one thread, pin thread n to CPU (n % CPU count).
+  #define CONFIG_C3P_REACTOR_PIN         1
+#endif
+
+#ifndef CONFIG_C3P_REACTOR_MAX_FD
+  // fds at or above this can't be registered.
+  #define CONFIG_C3P_REACTOR_MAX_FD      65536
+#endif
+
+#define C3P_REACTOR_FD_PAGE  1024   // The fd table is allocated this many fds at a time.
+
+/* Everything the reactor knows about a registered fd. */
+struct LinuxReactorSource {
+  int                fd;
+  uint32_t           events;      // EPOLL* interest flags.
+  ReactorCallback    cb;
+  void*              arg;
+  LinuxReactorShard* shard;
+  bool               is_timer;    // The reactor owns the fd, and reads it before the callback.
+  bool               dead;        // Removed. Freed by the shard thread at a safe point.
+  uint32_t           dispatches;
+};
+
+/* One reactor thread, and its epoll set. */
+struct LinuxReactorShard {
+  pthread_mutex_t     mutex;       // Guards this shard's sources, and their slots in the fd table.
+  unsigned long       thread_id;
+  int                 epoll_fd;
+  int                 event_fd;    // Written to break the thread out of epoll_wait().
+  uint8_t             index;
+  bool                running;
+  uint32_t            source_count;
+  LinuxReactorSource* current;     // The source whose callback is running, if any.
+  pthread_t           self;
+  uint32_t            wakeups;
+  uint32_t            dispatches;
+  LinkedList<LinuxReactorSource*> graveyard;  // Removed sources awaiting free().
+  char                name[16];
+};
+
+/*
+* A page of the fd table. Pages are made as they are needed, and not freed
+*   until the reactor is. The shard index is readable without a lock, and says
+*   which shard's mutex guards the source pointer.
+*/
+struct LinuxReactorFdPage {
+  LinuxReactorSource* src[C3P_REACTOR_FD_PAGE];
+  uint8_t             shard[C3P_REACTOR_FD_PAGE];
+};
+
+C3P_PERF_HISTOGRAM(_perf_reactor_dispatch, "LinuxReactor::dispatch");
+
+static LinuxReactor* _reactor_instance = nullptr;
+static pthread_mutex_t _reactor_instance_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool _reactor_shut_down = false;   // Set once by shutdown(). Never cleared.
+
+
+/*
+* Frees sources that were removed before the thread last entered epoll_wait().
+*   No event batch taken after that point can refer to them.
+*/
+static void _reactor_reap(LinuxReactorShard* shard) {
+  pthread_mutex_lock(&shard->mutex);
+  while (0 < shard->graveyard.size()) {
+    LinuxReactorSource* src = shard->graveyard.remove();
+    if (src->is_timer) {
+      close(src->fd);
+    }
+    delete src;
+  }
+  pthread_mutex_unlock(&shard->mutex);
+}
+
+
+/**
+* The body of each reactor thread.
+*/
+void* LinuxReactor::_thread_handler(void* arg) {
+  LinuxReactorShard* shard = (LinuxReactorShard*) arg;
+  struct epoll_event evs[CONFIG_C3P_REACTOR_MAX_EVENTS];
+  // Signals are the business of the main thread.
+  sigset_t set;
+  sigfillset(&set);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  shard->self = pthread_self();
+  #if (CONFIG_C3P_REACTOR_PIN) && (CONFIG_C3P_REACTOR_THREADS > 1)
+    const long CPUS = sysconf(_SC_NPROCESSORS_ONLN);
+    if (1 < CPUS) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET((shard->index % CPUS), &cpus);
+      if (0 != pthread_setaffinity_np(shard->self, sizeof(cpus), &cpus)) {
+        c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "Could not pin reactor thread %u.", shard->index);
+      }
+    }
+  #endif
+  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Started reactor thread %u.", shard->index);
+
+  while (__atomic_load_n(&shard->running, __ATOMIC_ACQUIRE)) {
+    _reactor_reap(shard);
+    const int N = epoll_wait(shard->epoll_fd, evs, CONFIG_C3P_REACTOR_MAX_EVENTS, -1);
+    if (N < 0) {
+      if (EINTR == errno) continue;
+      c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "epoll_wait() failed (%d).", errno);
+      break;
+    }
+    shard->wakeups++;
+    for (int i = 0; i < N; i++) {
+      LinuxReactorSource* src = (LinuxReactorSource*) evs[i].data.ptr;
+      if (nullptr == src) {
+        uint64_t drain;
+        if (read(shard->event_fd, &drain, sizeof(drain))) {}
+        continue;
+      }
+      // Publish what we are about to run before checking whether it was
+      //   removed. remove() does the same in the opposite order.
+      __atomic_store_n(&shard->current, src, __ATOMIC_SEQ_CST);
+      if (!__atomic_load_n(&src->dead, __ATOMIC_SEQ_CST)) {
+        if (src->is_timer) {
+          uint64_t expirations;
+          if (read(src->fd, &expirations, sizeof(expirations))) {}
+        }
+        src->dispatches++;
+        shard->dispatches++;
+        C3P_PERF_SCOPE(_perf_reactor_dispatch);
+        src->cb(src->fd, evs[i].events, src->arg);
+      }
+      __atomic_store_n(&shard->current, (LinuxReactorSource*) nullptr, __ATOMIC_SEQ_CST);
+    }
+  }
+  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Exiting reactor thread %u...", shard->index);
+  return nullptr;
+}
+
+
+/*******************************************************************************
+* Reactor class
+*******************************************************************************/
+
+/**
+* Returns the reactor, creating it and starting its threads on first use.
+*
+* @return the reactor, or nullptr if it failed to start, or has been shut down.
+*   Callers on their way down must expect the latter.
+*/
+LinuxReactor* LinuxReactor::getInstance() {
+  if (nullptr == __atomic_load_n(&_reactor_instance, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&_reactor_instance_mutex);
+    if ((nullptr == _reactor_instance) && !_reactor_shut_down) {
+      LinuxReactor* nu = new LinuxReactor();
+      if (0 == nu->_start()) {
+        // Only published once its threads are running.
+        __atomic_store_n(&_reactor_instance, nu, __ATOMIC_RELEASE);
+      }
+      else {
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to start the reactor.");
+        delete nu;
+      }
+    }
+    pthread_mutex_unlock(&_reactor_instance_mutex);
+  }
+  return __atomic_load_n(&_reactor_instance, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+* Stops the reactor threads, if they were ever started. Called by the platform
+*   as it shuts down. Registered fds are not closed. This is terminal:
+*   getInstance() will return nullptr from then on.
+*/
+void LinuxReactor::shutdown() {
+  pthread_mutex_lock(&_reactor_instance_mutex);
+  LinuxReactor* r = _reactor_instance;
+  _reactor_shut_down = true;
+  __atomic_store_n(&_reactor_instance, (LinuxReactor*) nullptr, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&_reactor_instance_mutex);
+  if (nullptr != r) {
+    delete r;
+  }
+}
+
+
+LinuxReactor::LinuxReactor() {
+  pthread_mutex_init(&_mutex, nullptr);
+}
+
+
+LinuxReactor::~LinuxReactor() {
+  for (uint8_t i = 0; i < _shard_count; i++) {
+    LinuxReactorShard* shard = &_shards[i];
+    __atomic_store_n(&shard->running, false, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    if (write(shard->event_fd, &one, sizeof(one))) {}
+    if (0 != shard->thread_id) {
+      pthread_join((pthread_t) shard->thread_id, nullptr);
+    }
+    _reactor_reap(shard);
+    close(shard->epoll_fd);
+    close(shard->event_fd);
+  }
+  if (nullptr != _fd_pages) {
+    for (uint32_t p = 0; p < (CONFIG_C3P_REACTOR_MAX_FD / C3P_REACTOR_FD_PAGE); p++) {
+      LinuxReactorFdPage* page = _fd_pages[p];
+      if (nullptr != page) {
+        for (uint32_t i = 0; i < C3P_REACTOR_FD_PAGE; i++) {
+          LinuxReactorSource* src = page->src[i];
+          if (nullptr != src) {
+            if (src->is_timer) {
+              close(src->fd);
+            }
+            delete src;
+          }
+        }
+        free(page);
+      }
+    }
+    free(_fd_pages);
+    _fd_pages = nullptr;
+  }
+  if (nullptr != _shards) {
+    for (uint8_t i = 0; i < _shard_count; i++) {
+      pthread_mutex_destroy(&_shards[i].mutex);
+    }
+    delete[] _shards;
+    _shards = nullptr;
+  }
+  pthread_mutex_destroy(&_mutex);
+}
+
+
+int8_t LinuxReactor::_start() {
+  _fd_pages = (LinuxReactorFdPage**) calloc((CONFIG_C3P_REACTOR_MAX_FD / C3P_REACTOR_FD_PAGE), sizeof(LinuxReactorFdPage*));
+  if (nullptr == _fd_pages) {
+    return -1;
+  }
+  _shards = new LinuxReactorShard[CONFIG_C3P_REACTOR_THREADS];
+  for (uint8_t i = 0; i < CONFIG_C3P_REACTOR_THREADS; i++) {
+    LinuxReactorShard* shard = &_shards[i];
+    pthread_mutex_init(&shard->mutex, nullptr);
+    shard->thread_id    = 0;
+    shard->index        = i;
+    shard->running      = true;
+    shard->source_count = 0;
+    shard->current      = nullptr;
+    shard->wakeups      = 0;
+    shard->dispatches   = 0;
+    shard->epoll_fd     = epoll_create1(EPOLL_CLOEXEC);
+    shard->event_fd     = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _shard_count++;   // Counted from here, so that the destructor cleans up a failure.
+    if ((shard->epoll_fd < 0) || (shard->event_fd < 0)) {
+      return -1;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = EPOLLIN;
+    ev.data.ptr = nullptr;   // Marks the wake fd.
+    if (0 != epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->event_fd, &ev)) {
+      return -1;
+    }
+    snprintf(shard->name, sizeof(shard->name), "C3PReactor%u", i);
+    PlatformThreadOpts topts;
+    memset(&topts, 0, sizeof(topts));
+    topts.thread_name = shard->name;
+    if (0 != platform.createThread(&shard->thread_id, nullptr, LinuxReactor::_thread_handler, (void*) shard, &topts)) {
+      shard->thread_id = 0;
+      return -2;
+    }
+  }
+  return 0;
+}
+
+
+/*
+* Returns the fd's page of the fd table, or nullptr if it has none. With
+*   create, the page is made if need be. Caller must hold the mutex to create.
+*/
+LinuxReactorFdPage* LinuxReactor::_page(int fd, bool create) {
+  if ((fd < 0) || (fd >= CONFIG_C3P_REACTOR_MAX_FD) || (nullptr == _fd_pages)) {
+    return nullptr;
+  }
+  LinuxReactorFdPage** slot = &_fd_pages[fd / C3P_REACTOR_FD_PAGE];
+  LinuxReactorFdPage* page = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+  if ((nullptr == page) && create) {
+    page = (LinuxReactorFdPage*) calloc(1, sizeof(LinuxReactorFdPage));
+    __atomic_store_n(slot, page, __ATOMIC_RELEASE);
+  }
+  return page;
+}
+
+
+/*
+* Finds the fd's source, and locks the shard that owns it. The caller must
+*   unlock the shard if a source is returned.
+*
+* @return the source, or nullptr (with nothing locked) if the fd isn't registered.
+*/
+LinuxReactorSource* LinuxReactor::_find_locked(int fd) {
+  LinuxReactorFdPage* page = _page(fd, false);
+  if (nullptr == page) {
+    return nullptr;
+  }
+  const uint32_t IDX = (uint32_t) (fd % C3P_REACTOR_FD_PAGE);
+  while (true) {
+    const uint8_t SHARD_IDX = __atomic_load_n(&page->shard[IDX], __ATOMIC_ACQUIRE);
+    LinuxReactorShard* shard = &_shards[SHARD_IDX % _shard_count];
+    pthread_mutex_lock(&shard->mutex);
+    LinuxReactorSource* src = page->src[IDX];
+    if ((nullptr != src) && (shard == src->shard)) {
+      return src;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    if (nullptr == src) {
+      return nullptr;
+    }
+    // The fd was removed and added again on another thread while we looked.
+  }
+}
+
+
+int8_t LinuxReactor::_add(int fd, uint32_t events, ReactorCallback cb, void* arg, bool is_timer, int8_t shard_idx) {
+  if ((fd < 0) || (nullptr == cb) || (0 == _shard_count)) {
+    return -1;
+  }
+  int8_t ret = -2;
+  // Adds are serialized, so that the least-loaded thread stays that way.
+  pthread_mutex_lock(&_mutex);
+  LinuxReactorFdPage* page = _page(fd, true);
+  if (nullptr == page) {
+    ret = -1;
+  }
+  else if (nullptr == __atomic_load_n(&page->src[fd % C3P_REACTOR_FD_PAGE], __ATOMIC_ACQUIRE)) {
+    LinuxReactorShard* shard = &_shards[0];
+    if (0 <= shard_idx) {
+      shard = &_shards[shard_idx % _shard_count];
+    }
+    else {
+      // Give the new source to the least-loaded thread.
+      for (uint8_t i = 1; i < _shard_count; i++) {
+        if (_shards[i].source_count < shard->source_count) {
+          shard = &_shards[i];
+        }
+      }
+    }
+    LinuxReactorSource* src = new LinuxReactorSource;
+    src->fd         = fd;
+    src->events     = events;
+    src->cb         = cb;
+    src->arg        = arg;
+    src->shard      = shard;
+    src->is_timer   = is_timer;
+    src->dead       = false;
+    src->dispatches = 0;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = events;
+    ev.data.ptr = src;
+    pthread_mutex_lock(&shard->mutex);
+    if (0 == epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+      __atomic_store_n(&page->shard[fd % C3P_REACTOR_FD_PAGE], shard->index, __ATOMIC_RELEASE);
+      __atomic_store_n(&page->src[fd % C3P_REACTOR_FD_PAGE], src, __ATOMIC_RELEASE);
+      shard->source_count++;
+      ret = 0;
+    }
+    else {
+      // Regular files and some character devices can't be polled.
+      delete src;
+      ret = -3;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+/**
+* Registers an fd with the reactor. The callback will be called on a reactor
+*   thread whenever the fd is ready for any of the given events.
+* Notification is level-triggered, unless EPOLLET is given.
+*
+* @param fd is the file descriptor to watch. It remains owned by the caller.
+* @param events is the set of EPOLL* flags of interest.
+* @param cb is the function to call.
+* @param arg is passed to the callback, unchanged.
+* @param shard is the thread to service the fd, or -1 for the least loaded.
+* @return 0 on success, -1 on bad parameters, -2 if the fd is already
+*   registered, -3 if the kernel refused to watch it.
+*/
+int8_t LinuxReactor::add(int fd, uint32_t events, ReactorCallback cb, void* arg, int8_t shard) {
+  return _add(fd, events, cb, arg, false, shard);
+}
+
+
+/**
+* Changes the events of interest for a registered fd. Safe to call from any
+*   thread, including from the fd's own callback. Only the fd's own thread is
+*   locked.
+*
+* @return 0 on success, -1 if the fd is not registered, -2 on kernel refusal.
+*/
+int8_t LinuxReactor::modify(int fd, uint32_t events) {
+  int8_t ret = -1;
+  LinuxReactorSource* src = _find_locked(fd);
+  if (nullptr != src) {
+    ret = 0;
+    if (events != src->events) {
+      struct epoll_event ev;
+      memset(&ev, 0, sizeof(ev));
+      ev.events   = events;
+      ev.data.ptr = src;
+      if (0 == epoll_ctl(src->shard->epoll_fd, EPOLL_CTL_MOD, fd, &ev)) {
+        src->events = events;
+      }
+      else {
+        ret = -2;
+      }
+    }
+    pthread_mutex_unlock(&src->shard->mutex);
+  }
+  return ret;
+}
+
+
+/**
+* Unregisters an fd. Once this returns, the fd's callback is neither running
+*   nor going to run, so the caller is free to close the fd and free the
+*   callback's argument. May be called from the fd's own callback.
+*
+* @return 0 on success, -1 if the fd is not registered.
+*/
+int8_t LinuxReactor::remove(int fd) {
+  int8_t ret = -1;
+  LinuxReactorSource* src = _find_locked(fd);
+  if (nullptr != src) {
+    LinuxReactorShard* shard = src->shard;
+    epoll_ctl(shard->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    __atomic_store_n(&src->dead, true, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&_page(fd, false)->src[fd % C3P_REACTOR_FD_PAGE], (LinuxReactorSource*) nullptr, __ATOMIC_RELEASE);
+    shard->source_count--;
+    shard->graveyard.insert(src);
+    pthread_mutex_unlock(&shard->mutex);
+    ret = 0;
+
+    const bool ON_SHARD = (0 != shard->thread_id) && pthread_equal(pthread_self(), shard->self);
+    if (!ON_SHARD) {
+      // Wait out a callback that might have started before we marked it dead.
+      while (src == __atomic_load_n(&shard->current, __ATOMIC_SEQ_CST)) {
+        sched_yield();
+      }
+    }
+  }
+  return ret;
+}
+
+
+/**
+* Creates a periodic timer that is serviced like any other source. For drivers
+*   that have work to do, but nothing the kernel can tell them is ready.
+*
+* @param period_us is the interval between callbacks, in microseconds.
+* @param cb is the function to call.
+* @param arg is passed to the callback, unchanged.
+* @param shard is the thread to service the timer on, or -1 for the least-loaded.
+* @return the timer's fd (for later use with remove()), or -1 on failure.
+*/
+int LinuxReactor::addTimer(uint32_t period_us, ReactorCallback cb, void* arg, int8_t shard) {
+  if (0 == period_us) {
+    return -1;
+  }
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  struct itimerspec its;
+  its.it_interval.tv_sec  = (period_us / 1000000);
+  its.it_interval.tv_nsec = (period_us % 1000000) * 1000;
+  its.it_value            = its.it_interval;
+  if ((0 != timerfd_settime(fd, 0, &its, nullptr)) || (0 != _add(fd, EPOLLIN, cb, arg, true, shard))) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+
+/**
+* Finds the thread that services a source. A driver with more than one fd can
+*   use this to keep them all on one thread, so its callbacks never overlap.
+*
+* @return the thread's index, or -1 if the fd is not in the reactor.
+*/
+int8_t LinuxReactor::shardOf(int fd) {
+  int8_t ret = -1;
+  LinuxReactorSource* src = _find_locked(fd);
+  if (nullptr != src) {
+    ret = (int8_t) src->shard->index;
+    pthread_mutex_unlock(&src->shard->mutex);
+  }
+  return ret;
+}
+
+
+/**
+* Reports the load on one reactor thread. For drivers that spread their own
+*   fds across threads, such as a sharded listener.
+*
+* @return 0 on success, or -1 if there is no such thread.
+*/
+int8_t LinuxReactor::shardStats(uint8_t shard, uint32_t* sources, uint32_t* dispatches) {
+  if (shard >= _shard_count) {
+    return -1;
+  }
+  *sources    = __atomic_load_n(&_shards[shard].source_count, __ATOMIC_RELAXED);
+  *dispatches = __atomic_load_n(&_shards[shard].dispatches, __ATOMIC_RELAXED);
+  return 0;
+}
+
+
+void LinuxReactor::printDebug(StringBuilder* output) {
+  StringBuilder::styleHeader1(output, (char*) "Reactor");
+  for (uint8_t i = 0; i < _shard_count; i++) {
+    LinuxReactorShard* shard = &_shards[i];
+    output->concatf("\t%-12s  %2u sources  %10u wakeups  %10u dispatches\n",
+      shard->name, shard->source_count, shard->wakeups, shard->dispatches
+    );
+  }
+  // With thousands of connections, the list would be useless. Show the first few.
+  uint32_t listed = 0;
+  for (uint32_t p = 0; (nullptr != _fd_pages) && (p < (CONFIG_C3P_REACTOR_MAX_FD / C3P_REACTOR_FD_PAGE)); p++) {
+    if (nullptr == _fd_pages[p]) {
+      continue;
+    }
+    for (uint32_t i = 0; i < C3P_REACTOR_FD_PAGE; i++) {
+      const int FD = (int) ((p * C3P_REACTOR_FD_PAGE) + i);
+      LinuxReactorSource* src = _find_locked(FD);
+      if (nullptr == src) {
+        continue;
+      }
+      if (listed++ < 32) {
+        output->concatf("\t  fd %3d  %-5s  thread %u  %s%s%s %10u dispatches\n",
+          src->fd, (src->is_timer ? "timer" : "io"), src->shard->index,
+          ((src->events & EPOLLIN)  ? "R" : "-"),
+          ((src->events & EPOLLOUT) ? "W" : "-"),
+          ((src->events & EPOLLET)  ? "E" : "-"),
+          src->dispatches
+        );
+      }
+      pthread_mutex_unlock(&src->shard->mutex);
+    }
+  }
+  if (listed > 32) {
+    output->concatf("\t  (%u more)\n", (listed - 32));
+  }
+}
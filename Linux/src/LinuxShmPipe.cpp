@@ -0,0 +1,793 @@
+/*
+File:   LinuxShmPipe.cpp
+Author: J. Ian Lindsay
+Date:   2026.10.16
+
+Copyright 2026 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+This is a BufferPipe between two processes on the same host, through a pair of
+  single-producer, single-consumer byte rings in shared memory.
+
+Setup: one side accepts a unix socket connection (LinuxSockListener and
+  LinuxSockPipe::detach() will do), and calls offer() on it. The other side
+  calls connect() with the socket's path (or join() on a socket it already
+  has). The memfd crosses as SCM_RIGHTS, and is sealed against resizing.
+
+Each side has a doorbell word in the region, and a thread that sleeps on it
+  with a futex once there is nothing to read or write. A writer only rings the
+  peer's bell if the peer has said that it is asleep. So while both sides are
+  busy, nothing enters the kernel.
+*/
+
+#include <Linux.h>
+
+#if defined(CONFIG_C3P_SOCKET_WRAPPER)
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+
+/*******************************************************************************
+*      _______.___________.    ___   .___________. __    ______     _______.
+*     /       |           |   /   \  |           ||  |  /      |   /       |
+*    |   (----`---|  |----`  /  ^  \ `---|  |----`|  | |  ,----'  |   (----`
+*     \   \       |  |      /  /_\  \    |  |     |  | |  |        \   \
+* .----)   |      |  |     /  _____  \   |  |     |  | |  `----.----)   |
+* |_______/       |__|    /__/     \__\  |__|     |__|  \______|_______/
+*
+* Static members and initializers should be located here.
+*******************************************************************************/
+#ifndef CONFIG_C3P_SHM_SPIN_US
+  // How long a side keeps looking for work before it sleeps on its doorbell.
+  #define CONFIG_C3P_SHM_SPIN_US  50
+#endif
+
+#ifndef CONFIG_C3P_SHM_IDLE_MS
+  // Longest sleep between checks that the peer is still alive.
+  #define CONFIG_C3P_SHM_IDLE_MS  250
+#endif
+
+#ifndef CONFIG_C3P_SHM_RX_RETRY_MS
+  // Longest sleep while RX is held for the read callback, if rxResume() is never called.
+  #define CONFIG_C3P_SHM_RX_RETRY_MS  5
+#endif
+
+#if (0 != (CONFIG_C3P_SHM_RING_SIZE & (CONFIG_C3P_SHM_RING_SIZE - 1)))
+  #error CONFIG_C3P_SHM_RING_SIZE must be a power of two.
+#endif
+
+#define C3P_SHM_MAGIC    0x4d485343   // "CSHM", little-endian.
+#define C3P_SHM_VERSION  1
+
+/*
+* The layout of the shared region. Words written by different sides are kept
+*   on different cache lines. Indices run freely, and wrap at 2^32.
+*/
+struct C3PShmSide {
+  alignas(64) uint32_t bell;   // Futex word. The peer bumps it to wake this side.
+  uint32_t sleeping;           // Non-zero while this side waits on its bell.
+  uint32_t closed;             // Set when this side lets go.
+  uint32_t pid;
+};
+
+struct C3PShmRing {
+  alignas(64) uint32_t head;   // Bytes ever written. Stored only by the writer.
+  alignas(64) uint32_t tail;   // Bytes ever read. Stored only by the reader.
+};
+
+struct C3PShmRegion {
+  uint32_t   magic;
+  uint16_t   version;
+  uint16_t   reserved;
+  uint32_t   ring_size;
+  C3PShmSide side[2];
+  C3PShmRing ring[2];          // Side n writes ring n.
+  // The data of ring 0 follows, then that of ring 1.
+};
+
+
+/*
+* The futex wrappers in Linux.cpp are process-private. These are not, since the
+*   words they act on are mapped into two processes.
+*/
+static int _shm_futex_wait(uint32_t* addr, uint32_t expected, uint32_t timeout_ms) {
+  struct timespec ts;
+  ts.tv_sec  = (time_t) (timeout_ms / 1000);
+  ts.tv_nsec = (long) ((timeout_ms % 1000) * 1000000UL);
+  return (int) syscall(SYS_futex, addr, FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+static int _shm_futex_wake(uint32_t* addr) {
+  return (int) syscall(SYS_futex, addr, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+/*
+* The ring size is taken as an argument, and not read from the region, since
+*   the peer can write the region whenever it likes.
+*/
+static inline uint8_t* _shm_ring_data(C3PShmRegion* region, uint8_t ring, uint32_t ring_size) {
+  return ((uint8_t*) region) + sizeof(C3PShmRegion) + (ring * ring_size);
+}
+
+static uint64_t _shm_now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (((uint64_t) ts.tv_sec * 1000000ULL) + ((uint64_t) ts.tv_nsec / 1000ULL));
+}
+
+
+/**
+* The thread that services one side. It moves data while there is any to move,
+*   looks for more for a short while, and then sleeps on its doorbell.
+* If the pipe was closed from this thread, the region is let go of here.
+*/
+void* LinuxShmPipe::_thread_handler(void* arg) {
+  LinuxShmPipe* self = (LinuxShmPipe*) arg;
+  // createThread() may not have stored this yet, and close() needs it.
+  __atomic_store_n(&self->_thread_id, (unsigned long) pthread_self(), __ATOMIC_RELEASE);
+  C3PShmSide* me   = &self->_region->side[self->_side];
+  C3PShmSide* peer = &self->_region->side[1 - self->_side];
+  uint64_t last_work_us = _shm_now_us();
+  while (__atomic_load_n(&self->_running, __ATOMIC_ACQUIRE)) {
+    self->poll();
+    if (!self->_idle()) {
+      last_work_us = _shm_now_us();
+      continue;
+    }
+    if (__atomic_load_n(&peer->closed, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    if ((_shm_now_us() - last_work_us) < CONFIG_C3P_SHM_SPIN_US) {
+      sched_yield();
+      continue;
+    }
+    // Announce the sleep before the last look, so that a writer either sees
+    //   the flag, or its data is seen here.
+    const uint32_t SEEN = __atomic_load_n(&me->bell, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&me->sleeping, 1, __ATOMIC_SEQ_CST);
+    if (self->_idle() && __atomic_load_n(&self->_running, __ATOMIC_ACQUIRE)) {
+      const bool HELD = __atomic_load_n(&self->_rx_held, __ATOMIC_ACQUIRE);
+      self->_count_sleeps++;
+      if ((0 != _shm_futex_wait(&me->bell, SEEN, (HELD ? CONFIG_C3P_SHM_RX_RETRY_MS : CONFIG_C3P_SHM_IDLE_MS))) && (ETIMEDOUT == errno)) {
+        // Quiet for a while. A dead peer can't say that it closed.
+        char c;
+        if (0 == recv(self->_ctl_sock, &c, 1, MSG_PEEK | MSG_DONTWAIT)) {
+          __atomic_store_n(&peer->closed, 1, __ATOMIC_RELEASE);
+        }
+      }
+    }
+    __atomic_store_n(&me->sleeping, 0, __ATOMIC_RELAXED);
+    last_work_us = _shm_now_us();
+  }
+  if (__atomic_load_n(&peer->closed, __ATOMIC_ACQUIRE)) {
+    self->_peer_gone = true;
+    c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Shared-memory peer hung up.");
+  }
+  if (__atomic_load_n(&self->_exit_release, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&self->_close_mutex);
+    self->_release();
+    pthread_mutex_unlock(&self->_close_mutex);
+    __atomic_store_n(&self->_exit_release, false, __ATOMIC_RELEASE);   // Our last touch of self.
+  }
+  return nullptr;
+}
+
+
+/*******************************************************************************
+* Shared-memory pipe class
+*******************************************************************************/
+
+LinuxShmPipe::LinuxShmPipe() {
+  pthread_mutex_init(&_tx_mutex, nullptr);
+  pthread_mutex_init(&_rx_mutex, nullptr);
+  pthread_mutex_init(&_close_mutex, nullptr);
+}
+
+
+LinuxShmPipe::~LinuxShmPipe() {
+  close();
+  // If the pipe was closed from its own thread, that thread may still be on
+  //   its way out.
+  while (__atomic_load_n(&_exit_release, __ATOMIC_ACQUIRE)) {
+    sleep_ms(1);
+  }
+  pthread_mutex_destroy(&_tx_mutex);
+  pthread_mutex_destroy(&_rx_mutex);
+  pthread_mutex_destroy(&_close_mutex);
+}
+
+
+/*******************************************************************************
+* Implementation of BufferAccepter
+*******************************************************************************/
+
+/*
+* Copies as much of the buffer into the ring as will fit. The rest is kept,
+*   and moved into the ring by the pipe's thread as the peer makes room. If
+*   that backlog is over budget, the buffer is refused.
+*
+* @return 1 if the buffer was taken, or -1 if it was refused.
+*/
+int8_t LinuxShmPipe::pushBuffer(StringBuilder* buf) {
+  const uint32_t LEN = (uint32_t) buf->length();
+  int8_t ret    = -1;
+  bool   resume = false;
+  int    moved  = 0;
+  pthread_mutex_lock(&_tx_mutex);
+  if (_tx_gate.admit(LEN)) {
+    _tx_buffer.concatHandoff(buf);
+    _tx_gate.added(LEN);
+    moved = _tx_flush(&resume);
+    ret = 1;
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  if (0 < moved) {
+    _kick();
+  }
+  if (resume) {
+    _tx_gate.notify(this);
+  }
+  return ret;
+}
+
+
+int32_t LinuxShmPipe::bufferAvailable() {
+  pthread_mutex_lock(&_tx_mutex);
+  const int32_t RET = _tx_gate.available();
+  pthread_mutex_unlock(&_tx_mutex);
+  return RET;
+}
+
+
+/**
+* Moves whatever can be moved. The pipe's thread does this on its own, so this
+*   is only needed for manual servicing.
+*
+* @return 1 if data was received, 0 if not, -1 if the pipe is closed.
+*/
+int8_t LinuxShmPipe::poll() {
+  if ((nullptr == _region) || _peer_gone) {
+    return -1;
+  }
+  bool resume = false;
+  pthread_mutex_lock(&_tx_mutex);
+  const int MOVED = _tx_flush(&resume);
+  pthread_mutex_unlock(&_tx_mutex);
+  const int RX = _rx_drain();
+  if ((0 < MOVED) || (0 < RX)) {
+    _kick();   // Either there is data for the peer, or room.
+  }
+  if (resume) {
+    _tx_gate.notify(this);
+  }
+  return ((0 < RX) ? 1 : 0);
+}
+
+
+/*
+* Copies queued TX into our ring, as far as it has room. Caller must hold the
+*   TX mutex.
+*
+* @return the number of bytes moved.
+*/
+int LinuxShmPipe::_tx_flush(bool* resume) {
+  if ((nullptr == _region) || _peer_gone) {
+    return 0;
+  }
+  C3PShmRing* ring = &_region->ring[_side];
+  uint8_t*    data = _shm_ring_data(_region, _side, _ring_size);
+  const uint32_t SIZE = _ring_size;
+  const uint32_t HEAD = ring->head;
+  const uint32_t FILL = HEAD - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  if (FILL > SIZE) {
+    _peer_fault("TX ring");
+    return 0;
+  }
+  uint32_t room = SIZE - FILL;
+  uint32_t pos  = HEAD;
+  int      frag_len = 0;
+  uint8_t* frag = _tx_buffer.position(0, &frag_len);
+  while ((0 < room) && (nullptr != frag)) {
+    const uint32_t TAKE   = strict_min((uint32_t) (frag_len - _tx_frag_off), room);
+    const uint32_t OFFSET = (pos & (SIZE - 1));
+    const uint32_t FIRST  = strict_min(TAKE, SIZE - OFFSET);
+    memcpy(data + OFFSET, frag + _tx_frag_off, FIRST);
+    memcpy(data, frag + _tx_frag_off + FIRST, TAKE - FIRST);
+    pos  += TAKE;
+    room -= TAKE;
+    _tx_frag_off += TAKE;
+    if (_tx_frag_off >= frag_len) {
+      _tx_buffer.drop_position(0);
+      _tx_frag_off = 0;
+      frag = _tx_buffer.position(0, &frag_len);
+    }
+  }
+  const uint32_t MOVED = (pos - HEAD);
+  if (0 < MOVED) {
+    __atomic_store_n(&ring->head, pos, __ATOMIC_RELEASE);
+    _count_tx += MOVED;
+    *resume = (_tx_gate.removed(MOVED) || *resume);
+  }
+  return (int) MOVED;
+}
+
+
+/*
+* Copies what is in the peer's ring out as one fragment, and offers it to the
+*   read callback. No more is taken than the callback says it has room for.
+*   The rest stays in the ring, which holds back the peer's writer, and so in
+*   turn its upstream, by way of the peer's flow gate.
+*
+* @return the number of bytes read.
+*/
+int LinuxShmPipe::_rx_drain() {
+  if ((nullptr == _region) || _peer_gone) {
+    return 0;
+  }
+  pthread_mutex_lock(&_rx_mutex);
+  const uint8_t RING = (1 - _side);
+  C3PShmRing* ring = &_region->ring[RING];
+  const uint32_t SIZE  = _ring_size;
+  const uint32_t TAIL  = ring->tail;
+  uint32_t avail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - TAIL;
+  if (avail > SIZE) {
+    _peer_fault("RX ring");
+    avail = 0;
+  }
+  uint32_t take = avail;
+  if (nullptr != _read_cb_obj) {
+    const int32_t ROOM = (_read_cb_obj->bufferAvailable() - _rx_buffer.length());
+    take = (0 < ROOM) ? strict_min(avail, (uint32_t) ROOM) : 0;
+  }
+  const bool HELD = (take < avail);
+  if (HELD & !_rx_held) {
+    _count_rx_held++;
+  }
+  __atomic_store_n(&_rx_held, HELD, __ATOMIC_RELEASE);
+  const uint32_t TAKE = take;
+  if (0 < TAKE) {
+    uint8_t* chunk = (uint8_t*) malloc(TAKE);
+    if (nullptr != chunk) {
+      const uint8_t* data   = _shm_ring_data(_region, RING, SIZE);
+      const uint32_t OFFSET = (TAIL & (SIZE - 1));
+      const uint32_t FIRST  = strict_min(TAKE, SIZE - OFFSET);
+      memcpy(chunk, data + OFFSET, FIRST);
+      memcpy(chunk + FIRST, data, TAKE - FIRST);
+      __atomic_store_n(&ring->tail, TAIL + TAKE, __ATOMIC_RELEASE);
+      _rx_buffer.concatHandoffRaw(chunk, (int) TAKE);
+      _count_rx += TAKE;
+    }
+  }
+  if ((nullptr != _read_cb_obj) && !_rx_buffer.isEmpty()) {
+    if (0 == _read_cb_obj->pushBuffer(&_rx_buffer)) {
+      _rx_buffer.clear();
+    }
+  }
+  pthread_mutex_unlock(&_rx_mutex);
+  return (int) TAKE;
+}
+
+
+/*
+* True if our thread has nothing to do: the peer's ring is empty (or held for
+*   the read callback), and either we have nothing to send or our ring is full.
+*/
+bool LinuxShmPipe::_idle() {
+  const C3PShmRing* rx = &_region->ring[1 - _side];
+  if ((__atomic_load_n(&rx->head, __ATOMIC_ACQUIRE) != rx->tail) && !__atomic_load_n(&_rx_held, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  if (0 == _tx_gate.queued()) {
+    return true;
+  }
+  const C3PShmRing* tx = &_region->ring[_side];
+  return ((tx->head - __atomic_load_n(&tx->tail, __ATOMIC_ACQUIRE)) >= _ring_size);
+}
+
+
+/*
+* The indices of a ring were out of range, so the peer is broken or hostile.
+*   Nothing more is copied in either direction. We say that we have let go,
+*   and our thread winds down. The owner still has to call close().
+*/
+void LinuxShmPipe::_peer_fault(const char* where) {
+  c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Shared-memory peer corrupted the %s. Dropping it.", where);
+  __atomic_store_n(&_region->side[_side].closed, 1, __ATOMIC_RELEASE);
+  _peer_gone = true;
+  __atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+}
+
+
+/**
+* Wakes our thread to look at RX again. RX held for the read callback is
+*   retried every CONFIG_C3P_SHM_RX_RETRY_MS anyway, but a downstream pipe can
+*   call this from its writable callback to resume at once.
+*/
+void LinuxShmPipe::rxResume() {
+  if (nullptr != _region) {
+    C3PShmSide* me = &_region->side[_side];
+    __atomic_add_fetch(&me->bell, 1, __ATOMIC_RELEASE);
+    _shm_futex_wake(&me->bell);
+  }
+}
+
+
+/*
+* Rings the peer's doorbell, if it is asleep. Called after we change either
+*   ring.
+*/
+void LinuxShmPipe::_kick() {
+  C3PShmSide* peer = &_region->side[1 - _side];
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&peer->sleeping, __ATOMIC_RELAXED)) {
+    __atomic_add_fetch(&peer->bell, 1, __ATOMIC_RELEASE);
+    _shm_futex_wake(&peer->bell);
+    _count_wakes++;
+  }
+}
+
+
+/*******************************************************************************
+* Setup and teardown
+*******************************************************************************/
+
+/*
+* Maps the region, and checks it if it came from the peer.
+*/
+int8_t LinuxShmPipe::_map(int memfd, size_t len) {
+  void* map = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  if (MAP_FAILED == map) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "mmap() failed: %s", strerror(errno));
+    return -1;
+  }
+  _region     = (C3PShmRegion*) map;
+  _region_len = len;
+  return 0;
+}
+
+
+int8_t LinuxShmPipe::_start() {
+  __atomic_store_n(&_region->side[_side].pid, (uint32_t) getpid(), __ATOMIC_RELAXED);
+  _running   = true;
+  _rx_held   = false;
+  _peer_gone = false;
+  PlatformThreadOpts topts;
+  memset(&topts, 0, sizeof(topts));
+  topts.thread_name = (char*) "C3PShmPipe";
+  if (0 != platform.createThread(&_thread_id, nullptr, LinuxShmPipe::_thread_handler, (void*) this, &topts)) {
+    _thread_id = 0;
+    close();
+    return -1;
+  }
+  return 0;
+}
+
+
+/**
+* Makes a new pair of rings, and sends them to the peer at the other end of
+*   the given AF_UNIX socket. The socket is kept, and closed with the pipe.
+*
+* @return 0 on success, or negative on failure.
+*/
+int8_t LinuxShmPipe::offer(int sock) {
+  if ((nullptr != _region) || (sock < 0)) {
+    return -1;
+  }
+  const size_t LEN = sizeof(C3PShmRegion) + (2 * CONFIG_C3P_SHM_RING_SIZE);
+  const int MEMFD = memfd_create("c3p-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (MEMFD < 0) {
+    return -2;
+  }
+  int8_t ret = -3;
+  if ((0 == ftruncate(MEMFD, (off_t) LEN)) && (0 == fcntl(MEMFD, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL))) {
+    if (0 == _map(MEMFD, LEN)) {
+      _region->magic     = C3P_SHM_MAGIC;
+      _region->version   = C3P_SHM_VERSION;
+      _region->ring_size = CONFIG_C3P_SHM_RING_SIZE;
+      _ring_size         = CONFIG_C3P_SHM_RING_SIZE;
+      char tag = 'S';
+      struct iovec iov = { &tag, 1 };
+      char cbuf[CMSG_SPACE(sizeof(int))];
+      memset(cbuf, 0, sizeof(cbuf));
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov        = &iov;
+      msg.msg_iovlen     = 1;
+      msg.msg_control    = cbuf;
+      msg.msg_controllen = sizeof(cbuf);
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type  = SCM_RIGHTS;
+      cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+      memcpy(CMSG_DATA(cmsg), &MEMFD, sizeof(int));
+      if (1 == sendmsg(sock, &msg, MSG_NOSIGNAL)) {
+        _ctl_sock = sock;
+        _side     = 0;
+        ret = _start();
+      }
+      else {
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not send the memfd: %s", strerror(errno));
+        munmap(_region, _region_len);
+        _region = nullptr;
+        ret = -4;
+      }
+    }
+  }
+  ::close(MEMFD);   // The mapping keeps it alive.
+  return ret;
+}
+
+
+/**
+* Receives the rings offered by the peer at the other end of the given
+*   AF_UNIX socket. Waits up to a second for them. The socket is kept, and
+*   closed with the pipe.
+*
+* @return 0 on success, or negative on failure.
+*/
+int8_t LinuxShmPipe::join(int sock) {
+  if ((nullptr != _region) || (sock < 0)) {
+    return -1;
+  }
+  struct pollfd pfd = { sock, POLLIN, 0 };
+  if (1 != ::poll(&pfd, 1, 1000)) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "The peer offered no rings.");
+    return -2;
+  }
+  char tag = 0;
+  struct iovec iov = { &tag, 1 };
+  char cbuf[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = cbuf;
+  msg.msg_controllen = sizeof(cbuf);
+  int memfd = -1;
+  if ((1 == recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) && ('S' == tag)) {
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if ((nullptr != cmsg) && (SOL_SOCKET == cmsg->cmsg_level) && (SCM_RIGHTS == cmsg->cmsg_type)) {
+      memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+    }
+  }
+  if (memfd < 0) {
+    return -3;
+  }
+  // Trust nothing in the region that the seals and the size don't guarantee.
+  int8_t ret = -4;
+  struct stat st;
+  const int SEALS = fcntl(memfd, F_GET_SEALS);
+  if ((0 == fstat(memfd, &st)) && (SEALS >= 0) && (SEALS & F_SEAL_SHRINK) && ((size_t) st.st_size > sizeof(C3PShmRegion))) {
+    if (0 == _map(memfd, (size_t) st.st_size)) {
+      const uint32_t RING_SIZE = _region->ring_size;
+      const bool VALID = ((C3P_SHM_MAGIC == _region->magic) && (C3P_SHM_VERSION == _region->version) &&
+        (0 < RING_SIZE) && (0 == (RING_SIZE & (RING_SIZE - 1))) &&
+        ((sizeof(C3PShmRegion) + (2 * (size_t) RING_SIZE)) == _region_len));
+      if (VALID) {
+        _ring_size = RING_SIZE;   // Never read from the region again.
+        _ctl_sock = sock;
+        _side     = 1;
+        ret = _start();
+      }
+      else {
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "The peer's region is not one we understand.");
+        munmap(_region, _region_len);
+        _region = nullptr;
+      }
+    }
+  }
+  ::close(memfd);
+  return ret;
+}
+
+
+/**
+* Connects to a unix socket where the peer will offer() rings, and joins.
+*   A "unix:" prefix on the path is allowed.
+*
+* @return 1 if connected, or negative on failure.
+*/
+int LinuxShmPipe::connect(char* path) {
+  if (nullptr != _region) {
+    return 1;
+  }
+  const char* addr = path;
+  if ((nullptr == path) || (LinuxSockTransport::TCP == c3p_sock_transport(path, &addr))) {
+    return -1;
+  }
+  struct sockaddr_un sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  if (strlen(addr) >= sizeof(sa.sun_path)) {
+    return -1;
+  }
+  strcpy(sa.sun_path, addr);
+  const int FD = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (FD < 0) {
+    return -2;
+  }
+  if ((0 != ::connect(FD, (struct sockaddr*) &sa, sizeof(sa))) || (0 != join(FD))) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not join shared memory at %s", addr);
+    ::close(FD);
+    return -3;
+  }
+  return 1;
+}
+
+
+// Returns the number of connections, or -1 if not open.
+int LinuxShmPipe::connected() {
+  return (((nullptr != _region) && !_peer_gone) ? 1 : 0);
+}
+
+
+/**
+* Tells the peer that we are going, stops our thread, and unmaps the region.
+*   Anything not yet in the ring is dropped.
+* May be called from the read callback. If another thread is closing the pipe
+*   at the same time, it will finish once the callback returns.
+*/
+int8_t LinuxShmPipe::close() {
+  const unsigned long TID = __atomic_load_n(&_thread_id, __ATOMIC_ACQUIRE);
+  const bool FROM_OUR_THREAD = ((0 != TID) && pthread_equal(pthread_self(), (pthread_t) TID));
+  if (FROM_OUR_THREAD) {
+    // Must not wait on a close that is waiting on us.
+    if (0 != pthread_mutex_trylock(&_close_mutex)) {
+      return 0;
+    }
+  }
+  else {
+    pthread_mutex_lock(&_close_mutex);
+  }
+  const int8_t RET = _close(FROM_OUR_THREAD);
+  pthread_mutex_unlock(&_close_mutex);
+  return RET;
+}
+
+
+/*
+* Caller must hold the close mutex. From our own thread, the callback that
+*   called us is still using the region, and the thread can't join itself. So
+*   it is detached, and lets go of the region as it leaves.
+*/
+int8_t LinuxShmPipe::_close(bool from_our_thread) {
+  if (nullptr == _region) {
+    return -1;
+  }
+  if (__atomic_load_n(&_exit_release, __ATOMIC_ACQUIRE)) {
+    return 0;   // Already closed from our thread, which is still using the region.
+  }
+  C3PShmSide* me = &_region->side[_side];
+  __atomic_store_n(&me->closed, 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+  // Wake both threads. Ours to see _running, the peer's to see the flag.
+  __atomic_add_fetch(&me->bell, 1, __ATOMIC_RELEASE);
+  _shm_futex_wake(&me->bell);
+  _kick();
+  if (0 != _thread_id) {
+    if (from_our_thread) {
+      __atomic_store_n(&_exit_release, true, __ATOMIC_RELEASE);
+      pthread_detach((pthread_t) _thread_id);
+      __atomic_store_n(&_thread_id, 0, __ATOMIC_RELEASE);
+      return 0;
+    }
+    pthread_join((pthread_t) _thread_id, nullptr);
+    __atomic_store_n(&_thread_id, 0, __ATOMIC_RELEASE);
+  }
+  _release();
+  return 0;
+}
+
+
+/*
+* Unmaps the region, and drops everything queued. Does nothing if that has
+*   already been done. Caller must hold the close mutex.
+*/
+void LinuxShmPipe::_release() {
+  if (nullptr == _region) {
+    return;
+  }
+  pthread_mutex_lock(&_tx_mutex);
+  pthread_mutex_lock(&_rx_mutex);
+  munmap(_region, _region_len);
+  _region     = nullptr;
+  _region_len = 0;
+  _ring_size  = 0;
+  _tx_frag_off = 0;
+  _rx_held     = false;
+  _tx_buffer.clear();
+  _rx_buffer.clear();
+  _tx_gate.reset();
+  pthread_mutex_unlock(&_rx_mutex);
+  pthread_mutex_unlock(&_tx_mutex);
+  if (0 <= _ctl_sock) {
+    ::close(_ctl_sock);
+    _ctl_sock = -1;
+  }
+  c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Closed shared-memory pipe.");
+}
+
+
+void LinuxShmPipe::printDebug(StringBuilder* output) {
+  StringBuilder::styleHeader1(output, "Shared-memory pipe");
+  if (nullptr == _region) {
+    output->concat("\tNot connected.\n");
+    return;
+  }
+  const C3PShmRing* tx = &_region->ring[_side];
+  const C3PShmRing* rx = &_region->ring[1 - _side];
+  output->concatf("\tSide:\t\t%u of pid %u (peer pid %u%s)\n", _side, _region->side[_side].pid, _region->side[1 - _side].pid, (_peer_gone ? ", gone" : ""));
+  output->concatf("\tRing fill:\t%u / %u tx, %u / %u rx\n",
+    (uint32_t) (tx->head - tx->tail), _ring_size, (uint32_t) (rx->head - rx->tail), _ring_size
+  );
+  output->concatf("\tBytes tx/rx:\t%u / %u\n", _count_tx, _count_rx);
+  output->concatf("\tRX held:\t%u times%s\n", _count_rx_held, (_rx_held ? " (holding)" : ""));
+  output->concatf("\tWakes sent:\t%u (slept %u times)\n", _count_wakes, _count_sleeps);
+  pthread_mutex_lock(&_tx_mutex);
+  _tx_gate.printDebug(output);
+  pthread_mutex_unlock(&_tx_mutex);
+}
+
+
+/*******************************************************************************
+* Console callback
+* These are built-in handlers for using this instance via a console.
+*******************************************************************************/
+
+/**
+* @page console-handlers
+* @section shm-tools Shared-memory pipe tools
+*
+* This is the console handler for debugging the operation of `LinuxShmPipe`'s.
+*
+*/
+int8_t LinuxShmPipe::console_handler(StringBuilder* text_return, StringBuilder* args) {
+  int ret = 0;
+  char* cmd = args->position_trimmed(0);
+
+  if (0 == StringBuilder::strcasecmp(cmd, "connect")) {
+    if (args->count() > 1) {
+      text_return->concatf("connect() returned %d\n", connect(args->position_trimmed(1)));
+    }
+    else {
+      text_return->concat("Usage: connect <path>\n");
+    }
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "close")) {
+    text_return->concatf("close() returned %d\n", close());
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "poll")) {
+    text_return->concatf("poll() returned %d\n", poll());
+  }
+  else {
+    printDebug(text_return);
+  }
+
+  return ret;
+}
+
+#endif   // CONFIG_C3P_SOCKET_WRAPPER
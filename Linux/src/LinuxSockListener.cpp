@@ -18,8 +18,18 @@ See the License for the specific language governing permissions and
 limitations under the License.
 
 
-This class should be polled regularly, and will produce LinuxSockPipes as
-  connections come in.
+This class produces LinuxSockPipes as connections come in. The listening socket
+  is serviced by the reactor, so polling is optional.
+
+Paths that look like "host:port" (with no '/') are TCP listeners. "*:port" or
+  ":port" listens on every interface. Anything else is a unix socket path,
+  optionally prefixed with "unix:".
+
+A TCP listener can be split into shards (see shards()). Each shard is its own
+  socket, bound to the same address with SO_REUSEPORT, and serviced by its own
+  reactor thread. The kernel spreads new connections across them, and the
+  pipes that a shard accepts are serviced by the shard's thread. So nothing is
+  shared between threads as connections come in, or as they carry traffic.
 */
 
 
@@ -36,6 +46,12 @@ This class should be polled regularly, and will produce LinuxSockPipes as
 #include <iostream>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 
 /*******************************************************************************
@@ -49,34 +65,82 @@ This class should be polled regularly, and will produce LinuxSockPipes as
 * Static members and initializers should be located here.
 *******************************************************************************/
 
+/*
+* One listening socket. It is normally serviced by one thread, but poll() and
+*   printDebug() may reach it from any other. So the counters are only touched
+*   with atomics, and the rate figures are best-effort at window boundaries.
+*/
+struct LinuxSockShard {
+  LinuxSockListener* owner;
+  int      sock_id;
+  int      spare_fd;         // Held in reserve for shedding connections at EMFILE.
+  uint8_t  index;
+  int8_t   reactor_shard;    // The reactor thread for this socket and its pipes. -1 for any.
+  uint32_t count_accepted;   // Connections accepted since listen().
+  uint32_t count_refused;    // Connections accepted and then closed.
+  uint32_t rate_window_ms;   // Start of the current one-second window.
+  uint32_t rate_window_n;    // Accepts in the current window.
+  uint32_t rate_last;        // Accepts in the last complete window.
+  uint32_t rate_peak;        // Most accepts seen in any one window.
+};
+
+
 /**
-* This is a thread to keep the sockets churning.
+* Decides how the given socket path is to be reached. Shared by listeners and
+*   pipes, so that both take the same addresses.
+*
+* @param path is the socket path, as given by the application.
+* @param addr will be pointed at the part of the path that follows any prefix.
+* @return the transport.
 */
-static void* socket_listener_polling_handler(void* active_xport) {
-  LinuxSockListener* xport = (LinuxSockListener*) active_xport;
-  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Started socket listener thread.");
-  sigset_t set;
-  sigemptyset(&set);
-  //sigaddset(&set, SIGIO);
-  sigaddset(&set, SIGQUIT);
-  sigaddset(&set, SIGHUP);
-  sigaddset(&set, SIGTERM);
-  sigaddset(&set, SIGVTALRM);
-  sigaddset(&set, SIGINT);
-  int s = pthread_sigmask(SIG_BLOCK, &set, NULL);
-
-  if (0 == s) {
-    while (xport->listening()) {
-      xport->poll();
-      sleep_ms(20);
-    }
+LinuxSockTransport c3p_sock_transport(const char* path, const char** addr) {
+  *addr = path;
+  if (0 == strncmp(path, "unix:", 5)) {
+    *addr = (path + 5);
+    return LinuxSockTransport::UNIX;
   }
-  else {
-    //output.concatf("pthread_sigmask() returned an error: %d\n", s);
+  const char* COLON = strrchr(path, ':');
+  if ((nullptr != COLON) && (nullptr == strchr(path, '/')) && (0 < atoi(COLON + 1))) {
+    return LinuxSockTransport::TCP;
   }
+  return LinuxSockTransport::FILE;
+}
+
+
+/**
+* Splits "host:port" at the last colon, so that bracketed IPv6 literals work.
+*   The brackets are removed.
+*
+* @return 0 on success, or -1 if the host doesn't fit.
+*/
+int8_t c3p_sock_split_host(const char* addr, char* host, int host_len, const char** port) {
+  const char* COLON = strrchr(addr, ':');
+  if (nullptr == COLON) {
+    return -1;
+  }
+  const char* host_start = addr;
+  int len = (int) (COLON - addr);
+  if ((2 <= len) && ('[' == *host_start) && (']' == *(COLON - 1))) {
+    host_start++;
+    len -= 2;
+  }
+  if (len >= host_len) {
+    return -1;
+  }
+  memcpy(host, host_start, len);
+  host[len] = '\0';
+  *port = (COLON + 1);
+  return 0;
+}
 
-  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Exiting socket listener thread...");
-  return nullptr;
+
+/**
+* Called on a reactor thread when connections are waiting. The reactor is
+*   level-triggered, so poll() must leave nothing in the accept queue.
+*/
+void LinuxSockListener::_reactor_cb(int fd, uint32_t events, void* arg) {
+  LinuxSockShard* shard = (LinuxSockShard*) arg;
+  shard->owner->_poll_shard(shard);
 }
 
 
@@ -111,43 +175,316 @@ LinuxSockListener::~LinuxSockListener() {
 
 
 /**
-* Execute any I/O callbacks that are pending. The function is present because
-*   this class contains the bus implementation.
+* Accepts every connection that is waiting, and offers each to the callback.
+*   Called by the reactor, but safe to call manually.
 *
-* @return 0 or greater on success.
+* @return 1 if any connections were accepted, 0 if not.
 */
 int8_t LinuxSockListener::poll() {
   int8_t ret = 0;
-  if (_sock_id > 0) {
-    int      cli_sock;
-    struct sockaddr_in cli_addr;
-    unsigned int clientlen = sizeof(cli_addr);
-
-    /* Wait for client connection */
-    if ((cli_sock = accept(_sock_id, (struct sockaddr *) &cli_addr, &clientlen)) < 0) {
-      //output.concat("Failed to accept client connection.\n");
+  for (uint8_t i = 0; i < _shard_count; i++) {
+    if (0 != _poll_shard(&_shards[i])) {
+      ret = 1;
     }
-    else {
-      //output.concatf("TCP Client connected: %s\n", (char*) inet_ntoa(cli_addr.sin_addr));
-      if (nullptr != _new_cb) {
-        LinuxSockPipe* nu_connection = new LinuxSockPipe(_sock_path, cli_sock);
-        if (1 != _new_cb(this, nu_connection)) {
-          delete nu_connection;
+  }
+  return ret;
+}
+
+
+/*
+* Empties one shard's accept queue.
+*
+* @return 1 if any connections were accepted, 0 if not.
+*/
+int8_t LinuxSockListener::_poll_shard(LinuxSockShard* shard) {
+  int8_t ret = 0;
+  uint32_t shed = 0;
+  while (shard->sock_id > 0) {
+    struct sockaddr_storage cli_addr;
+    socklen_t clientlen = sizeof(cli_addr);
+    const int CLI_SOCK = accept4(shard->sock_id, (struct sockaddr*) &cli_addr, &clientlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (CLI_SOCK < 0) {
+      if ((EINTR == errno) || (ECONNABORTED == errno)) {
+        continue;
+      }
+      if (((EMFILE == errno) || (ENFILE == errno)) && (0 <= shard->spare_fd)) {
+        // Out of descriptors. The connection would stay queued, and the
+        //   reactor would spin on it. Spend the spare to shed it. The kernel
+        //   reports EMFILE before looking at the queue, so it may be empty.
+        ::close(shard->spare_fd);
+        const int SHED_SOCK = accept(shard->sock_id, nullptr, nullptr);
+        if (0 <= SHED_SOCK) {
+          ::close(SHED_SOCK);
+          shed++;
+        }
+        shard->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (0 <= SHED_SOCK) {
+          continue;
         }
       }
+      break;   // EAGAIN. The queue is empty.
     }
+    ret = 1;
+    _accepted(shard, CLI_SOCK, (struct sockaddr*) &cli_addr, clientlen);
+  }
+  if (0 < shed) {
+    __atomic_fetch_add(&shard->count_refused, shed, __ATOMIC_RELAXED);
+    c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "Out of descriptors. Shed %u connections on %s.", shed, _sock_path);
   }
   return ret;
 }
 
 
+/*
+* Wraps a new connection in a LinuxSockPipe, and offers it to the callback.
+*   If the peer's address isn't given, it is asked for. The pipe is serviced
+*   by the shard's reactor thread.
+*/
+void LinuxSockListener::_accepted(LinuxSockShard* shard, int sock, struct sockaddr* addr, socklen_t addr_len) {
+  _note_accept(shard);
+  // TCP connections are named for their peer, since they all share a port.
+  char peer_str[INET6_ADDRSTRLEN + 8] = "";
+  if (_is_tcp) {
+    struct sockaddr_storage peer_addr;
+    if (nullptr == addr) {
+      addr     = (struct sockaddr*) &peer_addr;
+      addr_len = sizeof(peer_addr);
+      if (0 != getpeername(sock, addr, &addr_len)) {
+        addr_len = 0;
+      }
+    }
+    char host[INET6_ADDRSTRLEN];
+    char serv[8];
+    if ((0 < addr_len) && (0 == getnameinfo(addr, addr_len, host, sizeof(host), serv, sizeof(serv), NI_NUMERICHOST | NI_NUMERICSERV))) {
+      snprintf(peer_str, sizeof(peer_str), "%s:%s", host, serv);
+    }
+  }
+  if (nullptr != _new_cb) {
+    LinuxSockPipe* nu_connection = new LinuxSockPipe(((0 < strlen(peer_str)) ? peer_str : _sock_path), sock, shard->reactor_shard);
+    if (1 != _new_cb(this, nu_connection)) {
+      delete nu_connection;
+      __atomic_fetch_add(&shard->count_refused, 1, __ATOMIC_RELAXED);
+    }
+  }
+  else {
+    ::close(sock);   // Nobody to give it to.
+    __atomic_fetch_add(&shard->count_refused, 1, __ATOMIC_RELAXED);
+  }
+}
+
+
+#if defined(CONFIG_C3P_IO_URING)
+/*
+* Called on the ring's thread with each connection taken by the multishot
+*   accept. Out of descriptors, the queue is shed by poll(), as it would be
+*   from the reactor.
+*/
+int8_t LinuxSockListener::_uring_accept_cb(int32_t res, uint8_t* data, bool more, void* arg) {
+  LinuxSockShard* shard = (LinuxSockShard*) arg;
+  LinuxSockListener* self = shard->owner;
+  if (0 <= res) {
+    self->_accepted(shard, res, nullptr, 0);
+  }
+  else if ((-EMFILE == res) || (-ENFILE == res)) {
+    self->_poll_shard(shard);
+  }
+  if (!more && (nullptr != self->_ring)) {
+    if (0 != self->_ring->accept(shard->sock_id, LinuxSockListener::_uring_accept_cb, arg)) {
+      c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not re-post accept on %s.", self->_sock_path);
+    }
+  }
+  return 0;
+}
+#endif  // CONFIG_C3P_IO_URING
+
+
+/*
+* Keeps the one-second accept-rate window current. Whichever thread moves the
+*   window's start also rolls its count over.
+*/
+void LinuxSockListener::_note_accept(LinuxSockShard* shard) {
+  const uint32_t NOW = millis();
+  __atomic_fetch_add(&shard->count_accepted, 1, __ATOMIC_RELAXED);
+  uint32_t start = __atomic_load_n(&shard->rate_window_ms, __ATOMIC_ACQUIRE);
+  if ((uint32_t) (NOW - start) >= 1000) {
+    const uint32_t SINCE = (uint32_t) (NOW - start);
+    if (__atomic_compare_exchange_n(&shard->rate_window_ms, &start, NOW, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      // If more than one window has passed, the last one was empty.
+      const uint32_t LAST_N = __atomic_exchange_n(&shard->rate_window_n, 0, __ATOMIC_ACQ_REL);
+      __atomic_store_n(&shard->rate_last, ((SINCE >= 2000) ? 0 : LAST_N), __ATOMIC_RELAXED);
+    }
+  }
+  const uint32_t IN_WINDOW = __atomic_add_fetch(&shard->rate_window_n, 1, __ATOMIC_RELAXED);
+  uint32_t seen_peak = __atomic_load_n(&shard->rate_peak, __ATOMIC_RELAXED);
+  while (IN_WINDOW > seen_peak) {
+    if (__atomic_compare_exchange_n(&shard->rate_peak, &seen_peak, IN_WINDOW, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+}
+
+
+/*
+* Hands a shard's (already non-blocking) listening socket to the ring, if
+*   there is one, or to the shard's reactor thread.
+*/
+int8_t LinuxSockListener::_reactor_attach(LinuxSockShard* shard) {
+  if (shard->sock_id <= 0) {
+    return -1;
+  }
+  #if defined(CONFIG_C3P_IO_URING)
+    LinuxUring* ring = LinuxUring::getInstance();
+    if ((nullptr != ring) && (0 == ring->accept(shard->sock_id, LinuxSockListener::_uring_accept_cb, (void*) shard))) {
+      _ring = ring;
+      return 0;
+    }
+  #endif
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if ((nullptr == reactor) || (0 != reactor->add(shard->sock_id, EPOLLIN, LinuxSockListener::_reactor_cb, (void*) shard, shard->reactor_shard))) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Reactor refused listener %d (%s).", shard->sock_id, _sock_path);
+    return -3;
+  }
+  return 0;
+}
+
+
+/*
+* Stops the reactor (or the ring) from servicing the listening sockets. Once
+*   this returns, no callback for any of them is running.
+*/
+void LinuxSockListener::_reactor_detach() {
+  #if defined(CONFIG_C3P_IO_URING)
+    if (nullptr != _ring) {
+      LinuxUring* ring = _ring;
+      _ring = nullptr;   // So that no accept is posted again.
+      for (uint8_t i = 0; (i < _shard_count) && !LinuxUring::stopped(); i++) {
+        ring->cancel(_shards[i].sock_id);
+      }
+      return;
+    }
+  #endif
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  for (uint8_t i = 0; (i < _shard_count) && (nullptr != reactor); i++) {
+    reactor->remove(_shards[i].sock_id);
+  }
+}
+
+
+/*
+* Binds a unix socket at the given path. A socket file left behind by a dead
+*   process is removed. One that something is still listening on is not.
+*
+* @return the new descriptor, or -1 on failure.
+*/
+int LinuxSockListener::_open_unix(const char* path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Socket path is too long: %s", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  struct stat st;
+  if ((0 == stat(path, &st)) && S_ISSOCK(st.st_mode)) {
+    const int PROBE = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (0 <= PROBE) {
+      if ((0 != ::connect(PROBE, (struct sockaddr*) &addr, sizeof(addr))) && (ECONNREFUSED == errno)) {
+        unlink(path);   // Stale.
+      }
+      ::close(PROBE);
+    }
+  }
+
+  const int FD = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (FD < 0) {
+    return -1;
+  }
+  if ((0 != bind(FD, (struct sockaddr*) &addr, sizeof(addr))) || (0 != ::listen(FD, _backlog))) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not listen on %s: %s", path, strerror(errno));
+    ::close(FD);
+    return -1;
+  }
+  return FD;
+}
+
+
+/*
+* Binds a TCP socket to the given "host:port". Sockets for the shards of one
+*   listener are bound with SO_REUSEPORT, so that they can share the address.
+*
+* @return the new descriptor, or -1 on failure.
+*/
+int LinuxSockListener::_open_tcp(const char* addr, bool reuse_port) {
+  char host[256];
+  const char* PORT = nullptr;
+  if (0 != c3p_sock_split_host(addr, host, sizeof(host), &PORT)) {
+    return -1;
+  }
+  const bool ANY_HOST = ((0 == strlen(host)) || (0 == strcmp(host, "*")));
+
+  struct addrinfo hints;
+  struct addrinfo* res = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags    = AI_PASSIVE;
+  const int GAI_RET = getaddrinfo((ANY_HOST ? nullptr : host), PORT, &hints, &res);
+  if (0 != GAI_RET) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not resolve %s: %s", _sock_path, gai_strerror(GAI_RET));
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo* ai = res; (nullptr != ai) && (fd < 0); ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    const int ONE = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &ONE, sizeof(ONE));
+    if (reuse_port && (0 != setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &ONE, sizeof(ONE)))) {
+      ::close(fd);
+      fd = -1;
+      continue;
+    }
+    if ((0 != bind(fd, ai->ai_addr, ai->ai_addrlen)) || (0 != ::listen(fd, _backlog))) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(res);
+  if (fd < 0) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not listen on %s: %s", _sock_path, strerror(errno));
+  }
+  return fd;
+}
+
+
 
 int8_t LinuxSockListener::close() {
   int8_t ret = -1;
-  if (0 < _sock_id) {
-    ::close(_sock_id);  // Close the socket.
-    c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Closed listener socket %d (%s)", _sock_id, ((_sock_path) ? _sock_path : "no path"));
-    _sock_id = -1;
+  if (0 < _shard_count) {
+    _reactor_detach();
+    for (uint8_t i = 0; i < _shard_count; i++) {
+      LinuxSockShard* shard = &_shards[i];
+      ::close(shard->sock_id);  // Close the socket.
+      if (0 <= shard->spare_fd) {
+        ::close(shard->spare_fd);
+      }
+      _count_accepted += __atomic_load_n(&shard->count_accepted, __ATOMIC_RELAXED);
+      _count_refused  += __atomic_load_n(&shard->count_refused, __ATOMIC_RELAXED);
+      _rate_peak = strict_max(_rate_peak, __atomic_load_n(&shard->rate_peak, __ATOMIC_RELAXED));
+    }
+    if (!_is_tcp && (nullptr != _sock_path)) {
+      const char* addr = _sock_path;
+      c3p_sock_transport(_sock_path, &addr);
+      unlink(addr);   // We made it, so we clean it up.
+    }
+    c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Closed listener socket %d (%s)", _shards[0].sock_id, ((_sock_path) ? _sock_path : "no path"));
+    delete[] _shards;
+    _shards      = nullptr;
+    _shard_count = 0;
     ret = 0;
   }
   return ret;
@@ -158,13 +495,55 @@ int8_t LinuxSockListener::close() {
 // Returns the number of connections, or -1 if not listening.
 int LinuxSockListener::listening() {
   int ret = 0;
-  if (_sock_id > 0) {
+  if (0 < _shard_count) {
     ret++;
   }
   return ret;
 }
 
 
+/*
+* Opens the listening sockets for the given number of shards, and hands each
+*   to its reactor thread. If some shards can't be opened, the listener goes
+*   on with those that were.
+*
+* @return the number of shards listening.
+*/
+uint8_t LinuxSockListener::_open_shards(const char* addr, uint8_t count) {
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  _shards = new LinuxSockShard[count];
+  memset((void*) _shards, 0, (sizeof(LinuxSockShard) * count));
+  for (uint8_t i = 0; i < count; i++) {
+    LinuxSockShard* shard = &_shards[_shard_count];
+    shard->owner    = this;
+    shard->index    = _shard_count;
+    shard->sock_id  = (_is_tcp ? _open_tcp(addr, (1 < count)) : _open_unix(addr));
+    shard->spare_fd = -1;
+    // One shard goes wherever the reactor likes. Several go one per thread.
+    shard->reactor_shard = ((1 < count) ? (int8_t) (i % strict_max((uint8_t) 1, ((nullptr != reactor) ? reactor->shardCount() : (uint8_t) 1))) : -1);
+    if (shard->sock_id <= 0) {
+      break;
+    }
+    shard->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    _shard_count++;
+    if (0 != _reactor_attach(shard)) {
+      ::close(shard->spare_fd);
+      ::close(shard->sock_id);
+      _shard_count--;
+      break;
+    }
+  }
+  if ((0 < _shard_count) && (_shard_count < count)) {
+    c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "Only %u of %u shards are listening on %s.", _shard_count, count, _sock_path);
+  }
+  if (0 == _shard_count) {
+    delete[] _shards;
+    _shards = nullptr;
+  }
+  return _shard_count;
+}
+
+
 int LinuxSockListener::listen(char* path) {
   int ret = 0;
 
@@ -180,15 +559,28 @@ int LinuxSockListener::listen(char* path) {
     }
 
     if (0 < strlen(conn_sock)) {   // We have something to work with.
-      
-      ret = 0;
+      const char* addr = conn_sock;
+      _is_tcp = (LinuxSockTransport::TCP == c3p_sock_transport(conn_sock, &addr));
+      LinuxReactor* reactor = LinuxReactor::getInstance();
+      uint8_t count = ((0 != _shards_wanted) ? _shards_wanted : ((nullptr != reactor) ? reactor->shardCount() : 1));
+      if (!_is_tcp && (1 < count)) {
+        // Unix sockets can't share an address.
+        c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Unix listeners aren't sharded. Using one socket for %s.", conn_sock);
+        count = 1;
+      }
+      if (0 < _open_shards(addr, strict_max((uint8_t) 1, count))) {
+        c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, "Listening on %s (%s, backlog %d, %u shard%s)", conn_sock, (_is_tcp ? "TCP" : "unix"), _backlog, _shard_count, ((1 == _shard_count) ? "" : "s"));
+      }
+      else {
+        ret = -2;
+      }
     }
     else {  // No action is possible. We haven't been given a path.
       ret = -1;
     }
   }
 
-  if (_sock_id > 0) {  ret++;    }
+  if (0 < _shard_count) {  ret++;    }
   return ret;
 }
 
@@ -231,12 +623,55 @@ void LinuxSockListener::printDebug(StringBuilder* output) {
   StringBuilder temp("Socket Listener");
   temp.concatf("%s (%slistening", _sock_path, ((0 < listening()) ? "":"not "));
   if (0 < listening()) {
-    temp.concatf(": %d)", _sock_id);
+    temp.concatf(": %d)", _shards[0].sock_id);
   }
   else {
     temp.concat(")");
   }
   StringBuilder::styleHeader1(output, (char*) temp.string());
+  const uint32_t NOW = millis();
+  uint32_t accepted  = _count_accepted;
+  uint32_t refused   = _count_refused;
+  uint32_t rate_last = 0;
+  uint32_t rate_now  = 0;
+  uint32_t rate_peak = _rate_peak;
+  StringBuilder shard_lines;
+  for (uint8_t i = 0; i < _shard_count; i++) {
+    LinuxSockShard* shard = &_shards[i];
+    // Windows only roll over on accept, so a stale one means a quiet socket.
+    const uint32_t SINCE_WINDOW = (uint32_t) (NOW - __atomic_load_n(&shard->rate_window_ms, __ATOMIC_ACQUIRE));
+    const uint32_t WINDOW_N  = __atomic_load_n(&shard->rate_window_n, __ATOMIC_RELAXED);
+    const uint32_t ACCEPTED  = __atomic_load_n(&shard->count_accepted, __ATOMIC_RELAXED);
+    const uint32_t REFUSED   = __atomic_load_n(&shard->count_refused, __ATOMIC_RELAXED);
+    const uint32_t RATE_LAST = (SINCE_WINDOW >= 2000) ? 0 : ((SINCE_WINDOW >= 1000) ? WINDOW_N : __atomic_load_n(&shard->rate_last, __ATOMIC_RELAXED));
+    const uint32_t RATE_NOW  = (SINCE_WINDOW >= 1000) ? 0 : WINDOW_N;
+    accepted  += ACCEPTED;
+    refused   += REFUSED;
+    rate_last += RATE_LAST;
+    rate_now  += RATE_NOW;
+    rate_peak  = strict_max(rate_peak, __atomic_load_n(&shard->rate_peak, __ATOMIC_RELAXED));
+    if (1 < _shard_count) {
+      uint32_t fds = 0;
+      uint32_t dispatches = 0;
+      LinuxReactor* reactor = LinuxReactor::getInstance();
+      if (nullptr != reactor) {
+        reactor->shardStats((uint8_t) shard->reactor_shard, &fds, &dispatches);
+      }
+      shard_lines.concatf("\t  %2u  fd %4d  thread %2d  %8u accepted  %6u refused  %5u/sec  %6u fds on thread  %10u dispatches\n",
+        shard->index, shard->sock_id, shard->reactor_shard, ACCEPTED, REFUSED, RATE_LAST, fds, dispatches
+      );
+    }
+  }
+  output->concatf("\tTransport:\t%s (backlog %d)\n", (_is_tcp ? "TCP" : "unix"), _backlog);
+  #if defined(CONFIG_C3P_IO_URING)
+    output->concatf("\tServiced by:\t%s\n", ((nullptr != _ring) ? "io_uring (multishot accept)" : "reactor"));
+  #endif
+  output->concatf("\tAccepted:\t%u (%u refused)\n", accepted, refused);
+  output->concatf("\tAccepts/sec:\t%u last second, %u this second (peak %u)\n", rate_last, rate_now, rate_peak);
+  output->concatf("\tShards:\t\t%u (%u wanted)\n", _shard_count, _shards_wanted);
+  if (1 < _shard_count) {
+    output->concatHandoff(&shard_lines);
+  }
 }
 
 
@@ -272,6 +707,18 @@ int8_t LinuxSockListener::console_handler(StringBuilder* text_return, StringBuil
   else if (0 == StringBuilder::strcasecmp(cmd, "poll")) {
     text_return->concatf("poll() returned %d\n", poll());
   }
+  else if (0 == StringBuilder::strcasecmp(cmd, "backlog")) {
+    if (args->count() > 1) {
+      backlog(args->position_as_int(1));
+    }
+    text_return->concatf("Backlog is %d (applies at the next listen).\n", _backlog);
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "shards")) {
+    if (args->count() > 1) {
+      shards((uint8_t) args->position_as_int(1));
+    }
+    text_return->concatf("Shards: %u wanted (0 is one per reactor thread), %u listening. Applies at the next listen.\n", _shards_wanted, _shard_count);
+  }
   else {
     printDebug(text_return);
   }
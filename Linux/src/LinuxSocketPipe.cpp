@@ -18,7 +18,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 
 
-This is a BufferPipe that abstracts a unix socket.
+This is a BufferPipe that abstracts a unix socket or a TCP connection. Paths
+  are read as LinuxSockListener reads them: "unix:<path>", "host:port", or a
+  filesystem path.
 */
 
 
@@ -34,7 +36,16 @@ This is a BufferPipe that abstracts a unix socket.
 #include <fstream>
 #include <iostream>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "../LinuxStorage.h"
 
 
 /*******************************************************************************
@@ -47,29 +58,178 @@ This is a BufferPipe that abstracts a unix socket.
 *
 * Static members and initializers should be located here.
 *******************************************************************************/
-static unsigned long _sock_polling_thread_id = 0;
-static LinkedList<LinuxSockPipe*> sock_instances;
+#ifndef CONFIG_C3P_SOCKET_RX_BLOCK
+  // Bytes per pooled receive buffer.
+  #define CONFIG_C3P_SOCKET_RX_BLOCK  16384
+#endif
+
+#ifndef CONFIG_C3P_SOCKET_RX_IOV
+  // Pooled receive buffers offered to each readv().
+  #define CONFIG_C3P_SOCKET_RX_IOV    4
+#endif
+
+#ifndef CONFIG_C3P_SOCKET_RX_POOL
+  // Most idle receive buffers kept for reuse, across all sockets.
+  #define CONFIG_C3P_SOCKET_RX_POOL   64
+#endif
+
+#ifndef CONFIG_C3P_SOCKET_TX_IOV
+  // Most TX fragments gathered into a single writev(). StringBuilder finds
+  //   fragments by walking a list, so this also bounds that cost.
+  #define CONFIG_C3P_SOCKET_TX_IOV  64
+#endif
+
+#ifndef CONFIG_C3P_SOCKET_TX_COALESCE
+  // TX fragments shorter than this are copied together before sending, since
+  //   the kernel's cost per iovec exceeds the cost of the copy.
+  #define CONFIG_C3P_SOCKET_TX_COALESCE  1024
+#endif
+
+#ifndef CONFIG_C3P_SOCKET_SENDFILE_CHUNK
+  // Most bytes of a file that one sendfile() or splice() is asked to move. On
+  //   the ring, this is also the size asked of the kernel pipe they go through.
+  #define CONFIG_C3P_SOCKET_SENDFILE_CHUNK  1048576
+#endif
+
+#ifndef CONFIG_C3P_SOCKET_TX_COMPACT
+  // Largest fragment that a run of short TX fragments is copied into.
+  #define CONFIG_C3P_SOCKET_TX_COMPACT  65536
+#endif
+
+
+/*
+* Receive buffers are read into, and go back to the pool as soon as what was
+*   read is copied out. StringBuilder free()'s whatever it is handed, so a
+*   buffer given to the read callback would never come back.
+*/
+static uint8_t*        _rx_pool[CONFIG_C3P_SOCKET_RX_POOL];
+static int             _rx_pool_count  = 0;
+static uint32_t        _rx_pool_hits   = 0;   // Buffers taken from the pool.
+static uint32_t        _rx_pool_misses = 0;   // Buffers that had to be allocated.
+static pthread_mutex_t _rx_pool_mutex  = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+* A file given to sendFile(). Its bytes go from the page cache to the socket
+*   without being read into the heap. It is sent once the buffered bytes that
+*   were queued ahead of it are gone.
+*/
+struct LinuxSockFileTX {
+  SendFileCallback cb;
+  void*     cb_arg;
+  int       fd;            // The file. Ours to close.
+  uint64_t  offset;        // Where in the file the next byte comes from.
+  uint64_t  sent;
+  uint64_t  total;
+  uint32_t  ahead;         // Buffered bytes that go out before this file.
+  int       pipe_fd[2];    // On the ring, the kernel pipe that splice() uses.
+  uint32_t  in_pipe;       // On the ring, bytes in that pipe.
+  bool      to_sock;       // On the ring, the splice in flight is into the socket.
+};
+
+/* A SendFileCallback to be made once the TX mutex is released. */
+struct LinuxSockFileEvent {
+  SendFileCallback cb;
+  void*     cb_arg;
+  uint64_t  sent;
+  uint64_t  total;
+  int       err;
+};
+
+static void _file_tx_event(LinuxSockFileTX* job, int err, LinuxSockFileEvent* ev) {
+  ev->cb     = job->cb;
+  ev->cb_arg = job->cb_arg;
+  ev->sent   = job->sent;
+  ev->total  = job->total;
+  ev->err    = err;
+}
+
+static void _file_tx_free(LinuxSockFileTX* job) {
+  ::close(job->fd);
+  if (0 <= job->pipe_fd[0]) {
+    ::close(job->pipe_fd[0]);
+    ::close(job->pipe_fd[1]);
+  }
+  delete job;
+}
+
+static uint8_t* _rx_block_take() {
+  uint8_t* ret = nullptr;
+  pthread_mutex_lock(&_rx_pool_mutex);
+  if (0 < _rx_pool_count) {
+    ret = _rx_pool[--_rx_pool_count];
+    _rx_pool_hits++;
+  }
+  else {
+    _rx_pool_misses++;
+  }
+  pthread_mutex_unlock(&_rx_pool_mutex);
+  return ((nullptr != ret) ? ret : (uint8_t*) malloc(CONFIG_C3P_SOCKET_RX_BLOCK));
+}
+
+/* Names for LinuxSockOpt, in order. Used by the console. */
+static const char* const _sock_opt_names[] = {
+  "nodelay", "cork", "sndbuf", "rcvbuf", "keepalive", "user_timeout"
+};
+
+static void _rx_block_give(uint8_t* block) {
+  pthread_mutex_lock(&_rx_pool_mutex);
+  if (_rx_pool_count < CONFIG_C3P_SOCKET_RX_POOL) {
+    _rx_pool[_rx_pool_count++] = block;
+    block = nullptr;
+  }
+  pthread_mutex_unlock(&_rx_pool_mutex);
+  if (nullptr != block) {
+    free(block);
+  }
+}
+
+
+/*
+* Reports how many receive buffers were taken from the pool, and how many had
+*   to be allocated, since the program started.
+*/
+void LinuxSockPipe::rxPoolStats(uint32_t* hits, uint32_t* misses) {
+  pthread_mutex_lock(&_rx_pool_mutex);
+  *hits   = _rx_pool_hits;
+  *misses = _rx_pool_misses;
+  pthread_mutex_unlock(&_rx_pool_mutex);
+}
 
 
 /**
-* This is a thread to keep the sockets churning.
-*/
-static void* socket_polling_handler(void*) {
-  bool keep_polling = true;
-  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Started socket polling thread.");
-  while (keep_polling) {
-    sleep_ms(20);
-    for (int i = 0; i < sock_instances.size(); i++) {
-      LinuxSockPipe* temp = sock_instances.get(i);
-      if (nullptr != temp) {
-        temp->poll();
+* Called on a reactor thread when the socket is ready.
+*/
+C3P_PERF_HISTOGRAM(_perf_sock_poll, "LinuxSockPipe::poll");
+
+void LinuxSockPipe::_reactor_cb(int fd, uint32_t events, void* arg) {
+  C3P_PERF_SCOPE(_perf_sock_poll);
+  LinuxSockPipe* pipe = (LinuxSockPipe*) arg;
+  if (pipe->_connecting) {
+    if (0 == (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))) {
+      return;
+    }
+    if (0 != pipe->_connect_finish()) {
+      pipe->_hangup();
+      return;
+    }
+    #if defined(CONFIG_C3P_IO_URING)
+      LinuxReactor* reactor = LinuxReactor::getInstance();
+      if ((nullptr != LinuxUring::getInstance()) && (nullptr != reactor)) {
+        reactor->remove(fd);
+        __atomic_store_n(&pipe->_reactor_attached, false, __ATOMIC_RELEASE);
+        pipe->_reactor_attach();   // Onto the ring, or back onto the reactor.
+        return;
       }
+    #endif
+  }
+  if (events & EPOLLOUT) {
+    pipe->_tx_flush();
+  }
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+    if (0 > pipe->_rx_drain()) {
+      pipe->_hangup();   // The far side hung up.
     }
-    keep_polling = (0 < sock_instances.size());
   }
-  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Exiting socket polling thread...");
-  _sock_polling_thread_id = 0;  // Allow the thread to be restarted later.
-  return NULL;
 }
 
 
@@ -84,8 +244,20 @@ static void* socket_polling_handler(void*) {
 * NOTE: Because this constructor modifies static data, it can't be relied upon
 *   if an instance of it is ever allocated statically. So don't do that.
 */
-LinuxSockPipe::LinuxSockPipe(char* path, int sock_id) : LinuxSockPipe(path) {
+LinuxSockPipe::LinuxSockPipe(char* path, int sock_id, int8_t reactor_shard) : LinuxSockPipe(path) {
   _sock_id = sock_id;
+  _shard   = reactor_shard;
+  int domain = 0;
+  socklen_t domain_len = sizeof(domain);
+  if (0 == getsockopt(sock_id, SOL_SOCKET, SO_DOMAIN, &domain, &domain_len)) {
+    if (AF_UNIX == domain) {
+      _transport = LinuxSockTransport::UNIX;
+    }
+    else if ((AF_INET == domain) || (AF_INET6 == domain)) {
+      _transport = LinuxSockTransport::TCP;
+    }
+  }
+  _reactor_attach();
 }
 
 /**
@@ -96,8 +268,12 @@ LinuxSockPipe::LinuxSockPipe(char* path, int sock_id) : LinuxSockPipe(path) {
 *   if an instance of it is ever allocated statically. So don't do that.
 */
 LinuxSockPipe::LinuxSockPipe(char* path) {
+  for (int i = 0; i < (int) LinuxSockOpt::INVALID; i++) {
+    _opts[i] = -1;
+  }
+  pthread_mutex_init(&_tx_mutex, nullptr);
+  pthread_mutex_init(&_close_mutex, nullptr);
   _set_sock_path(path);
-  sock_instances.insert(this);
 }
 
 
@@ -107,11 +283,12 @@ LinuxSockPipe::LinuxSockPipe(char* path) {
 */
 LinuxSockPipe::~LinuxSockPipe() {
   close();
-  sock_instances.remove(this);
   if (_sock_path) {
     free(_sock_path);
     _sock_path = nullptr;
   }
+  pthread_mutex_destroy(&_tx_mutex);
+  pthread_mutex_destroy(&_close_mutex);
 }
 
 
@@ -119,99 +296,1155 @@ LinuxSockPipe::~LinuxSockPipe() {
 * Implementation of BufferAccepter
 *******************************************************************************/
 
+/*
+* Queue the buffer for TX, and have the reactor send it. The buffer's fragments
+*   are taken as they are, and will be written without being copied again.
+*   If the TX budget is spent, the buffer is refused and left with the caller,
+*   who will be called back once there is room.
+*
+* @return 1 if the buffer was taken, or -1 if it was refused.
+*/
+int8_t LinuxSockPipe::pushBuffer(StringBuilder* buf) {
+  const uint32_t LEN = (uint32_t) buf->length();
+  int8_t ret = -1;
+  pthread_mutex_lock(&_tx_mutex);
+  if (_tx_gate.admit(LEN)) {
+    _tx_buffer.concatHandoff(buf);
+    _tx_gate.added(LEN);
+    _arm_tx();
+    ret = 1;
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  return ret;
+}
+
+
+int32_t LinuxSockPipe::bufferAvailable() {
+  pthread_mutex_lock(&_tx_mutex);
+  const int32_t RET = _tx_gate.available();
+  pthread_mutex_unlock(&_tx_mutex);
+  return RET;
+}
+
 
 /**
-* Execute any I/O callbacks that are pending. The function is present because
-*   this class contains the bus implementation.
+* Execute any I/O callbacks that are pending. The reactor does this on its own
+*   as the socket becomes ready, so this is only needed for manual servicing.
+*   While the reactor (or the ring) is servicing the socket, this does nothing,
+*   as draining from a second thread would race it.
 *
-* @return 0 or greater on success.
+* @return 1 if data was received, 0 if not, -1 if the socket was closed.
 */
 int8_t LinuxSockPipe::poll() {
+  C3P_PERF_SCOPE(_perf_sock_poll);
   int8_t ret = 0;
-  if (true) {
-    if (_sock_id > 0) {
-      if (0 < _tx_buffer.length()) {
-        // Refill the TX buffer...
-        int tx_count = strict_min((int32_t) 64, (int32_t) _tx_buffer.length());
-        if (0 < tx_count) {
-          int bytes_written = (int) ::write(_sock_id, _tx_buffer.string(), tx_count);
-          _tx_buffer.cull(bytes_written);
-          _count_tx += bytes_written;
-        }
+  #if defined(CONFIG_C3P_IO_URING)
+    if (nullptr != _ring) {
+      return 0;   // Nothing to do by hand.
+    }
+  #endif
+  if (__atomic_load_n(&_reactor_attached, __ATOMIC_ACQUIRE) && (nullptr != LinuxReactor::getInstance())) {
+    return 0;
+  }
+  if ((_sock_id > 0) && !_connecting) {
+    _tx_flush();
+    const int RX = _rx_drain();
+    if (0 > RX) {
+      close();
+      ret = -1;
+    }
+    else if (0 < RX) {
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+
+/*
+* Writes as much of the TX buffer as the socket will take without blocking.
+*   The buffer's fragments are gathered straight into writev(), so they are
+*   never collapsed into one allocation. Runs of short fragments are first
+*   compacted, so that each costs one iovec. Once the buffer is empty, stops
+*   asking the reactor about writability. If a refused upstream can write
+*   again, it is told so after the TX mutex is released.
+*
+* @return the number of bytes written, or -1 on error.
+*/
+int LinuxSockPipe::_tx_flush() {
+  int  ret    = 0;
+  bool resume = false;
+  LinuxSockFileEvent event;
+  event.cb = nullptr;
+  struct iovec iov[CONFIG_C3P_SOCKET_TX_IOV];
+  pthread_mutex_lock(&_tx_mutex);
+  while ((_sock_id > 0) && !_connecting) {
+    LinuxSockFileTX* job = ((0 < _tx_files.size()) ? _tx_files.get(0) : nullptr);
+    if ((nullptr != job) && (0 == job->ahead)) {
+      // Everything buffered ahead of the file is out. Now the file.
+      const int SENT = _tx_file(job);
+      const bool DONE = ((SENT < 0) || (job->sent == job->total));
+      if ((0 != SENT) || DONE) {
+        _file_tx_event(job, ((SENT < 0) ? SENT : 0), &event);
       }
-      uint8_t* buf = (uint8_t*) alloca(255);
-      int n = ::read(_sock_id, buf, 255);
-      if (n > 0) {
-        _rx_buffer.concat(buf, n);
-        _count_rx += n;
-        _last_rx_ms = millis();
-        ret = 1;
+      if (0 < SENT) {
+        ret += SENT;
       }
-      if (0 < _rx_buffer.length()) {
-        if (nullptr != _read_cb_obj) {
-          if (0 == _read_cb_obj->pushBuffer(&_rx_buffer)) {
-            _rx_buffer.clear();
-          }
+      if (DONE) {
+        _tx_files.remove(job);
+        _file_tx_free(job);
+        if (SENT < 0) {
+          ret = -1;
         }
+        break;   // One file per pass, for the sake of the callback.
+      }
+      if (0 == SENT) {
+        break;   // The send buffer is full.
+      }
+      continue;
+    }
+    const uint32_t LIMIT = ((nullptr != job) ? job->ahead : 0xFFFFFFFF);
+    _tx_compact_head();
+    // count() and length() walk the whole buffer, so the end is found by
+    //   position() coming up empty.
+    int frags     = 0;
+    int iov_count = 0;
+    int iov_bytes = 0;
+    for (; (frags < CONFIG_C3P_SOCKET_TX_IOV) && ((uint32_t) iov_bytes < LIMIT); frags++) {
+      int frag_len = 0;
+      uint8_t* frag = _tx_buffer.position(frags, &frag_len);
+      if (nullptr == frag) {
+        break;
+      }
+      const int SKIP = ((0 == frags) ? _tx_frag_off : 0);
+      if ((0 < frags) && (frag_len < CONFIG_C3P_SOCKET_TX_COALESCE)) {
+        break;   // Leave it to be compacted on the next pass.
+      }
+      if (frag_len > SKIP) {
+        const int LEN = (int) strict_min((uint32_t) (frag_len - SKIP), (LIMIT - (uint32_t) iov_bytes));
+        iov[iov_count].iov_base = (frag + SKIP);
+        iov[iov_count].iov_len  = (size_t) LEN;
+        iov_bytes += LEN;
+        iov_count++;
       }
     }
+    if (0 == frags) {
+      break;   // Everything is sent.
+    }
+    if (0 == iov_count) {
+      _tx_consume(0);   // Nothing but empty fragments.
+      continue;
+    }
+    const int BYTES_WRITTEN = (int) ((1 == iov_count) ? ::write(_sock_id, iov[0].iov_base, iov[0].iov_len) : ::writev(_sock_id, iov, iov_count));
+    if (BYTES_WRITTEN > 0) {
+      _tx_capture(BYTES_WRITTEN);
+      _tx_consume(BYTES_WRITTEN);
+      resume = (_tx_gate.removed(BYTES_WRITTEN) || resume);
+      _count_tx += BYTES_WRITTEN;
+      ret += BYTES_WRITTEN;
+      if (BYTES_WRITTEN < iov_bytes) {
+        break;   // The send buffer is full.
+      }
+    }
+    else if ((BYTES_WRITTEN < 0) && (EINTR == errno)) {
+      continue;
+    }
+    else {
+      if ((EAGAIN != errno) && (EWOULDBLOCK != errno)) {
+        ret = -1;
+      }
+      break;   // The reactor will tell us when there is room.
+    }
+  }
+  if (_tx_armed && _tx_buffer.isEmpty() && (0 == _tx_files.size()) && (_sock_id > 0) && !_connecting) {
+    LinuxReactor* reactor = LinuxReactor::getInstance();
+    _tx_armed = false;
+    if (nullptr != reactor) {
+      reactor->modify(_sock_id, EPOLLIN);
+    }
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  if (resume) {
+    _tx_gate.notify(this);
+  }
+  if (nullptr != event.cb) {
+    event.cb(this, event.sent, event.total, event.err, event.cb_arg);
   }
   return ret;
 }
 
 
+/*
+* Sends what the socket will take of the file at the front of the queue, with
+*   sendfile(). Caller must hold the TX mutex.
+*
+* @return the number of bytes sent, 0 if the socket is full, or a negative
+*   errno.
+*/
+int LinuxSockPipe::_tx_file(LinuxSockFileTX* job) {
+  const uint64_t LEFT = (job->total - job->sent);
+  if (0 == LEFT) {
+    return 0;
+  }
+  off_t offset = (off_t) job->offset;
+  const ssize_t SENT = sendfile(_sock_id, job->fd, &offset, (size_t) strict_min(LEFT, (uint64_t) CONFIG_C3P_SOCKET_SENDFILE_CHUNK));
+  if (SENT > 0) {
+    job->offset += SENT;
+    job->sent   += SENT;
+    _count_tx   += SENT;
+    return (int) SENT;
+  }
+  else if (0 == SENT) {
+    return -EIO;   // The file is shorter than it was.
+  }
+  else if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno)) {
+    return 0;
+  }
+  return -errno;
+}
+
+
+/*
+* Takes every queued file off the pipe, and tells each callback that it was not
+*   sent. Caller must not hold the TX mutex.
+*/
+void LinuxSockPipe::_tx_files_drop(int err) {
+  LinkedList<LinuxSockFileTX*> dropped;
+  pthread_mutex_lock(&_tx_mutex);
+  while (0 < _tx_files.size()) {
+    dropped.insert(_tx_files.remove());
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  while (0 < dropped.size()) {
+    LinuxSockFileTX* job = dropped.remove();
+    if (nullptr != job->cb) {
+      job->cb(this, job->sent, job->total, err, job->cb_arg);
+    }
+    _file_tx_free(job);
+  }
+}
+
+
+/*
+* If the TX buffer starts with two or more short fragments, copies as many of
+*   them as will fit into one new fragment. Each byte is copied once, and only
+*   the front of the buffer is touched. Caller must hold the TX mutex.
+*/
+void LinuxSockPipe::_tx_compact_head() {
+  int len0 = 0;
+  int len1 = 0;
+  uint8_t* frag0 = _tx_buffer.position(0, &len0);
+  if ((nullptr == frag0) || (nullptr == _tx_buffer.position(1, &len1))) {
+    return;
+  }
+  if (((len0 - _tx_frag_off) >= CONFIG_C3P_SOCKET_TX_COALESCE) || (len1 >= CONFIG_C3P_SOCKET_TX_COALESCE)) {
+    return;
+  }
+  uint8_t* chunk = (uint8_t*) malloc(CONFIG_C3P_SOCKET_TX_COMPACT);
+  if (nullptr == chunk) {
+    return;   // Send them as they are.
+  }
+  int chunk_len = 0;
+  int frag_len  = 0;
+  uint8_t* frag = _tx_buffer.position(0, &frag_len);
+  while (nullptr != frag) {
+    const int SLICE_LEN = (frag_len - _tx_frag_off);
+    if ((SLICE_LEN >= CONFIG_C3P_SOCKET_TX_COALESCE) || ((chunk_len + SLICE_LEN) > CONFIG_C3P_SOCKET_TX_COMPACT)) {
+      break;
+    }
+    memcpy(&chunk[chunk_len], (frag + _tx_frag_off), SLICE_LEN);
+    chunk_len += SLICE_LEN;
+    _tx_buffer.drop_position(0);
+    _tx_frag_off = 0;
+    frag = _tx_buffer.position(0, &frag_len);
+  }
+  if (0 == chunk_len) {
+    free(chunk);
+    return;
+  }
+  uint8_t* trimmed = (uint8_t*) realloc(chunk, chunk_len);
+  StringBuilder compacted;
+  compacted.concatHandoffRaw(((nullptr != trimmed) ? trimmed : chunk), chunk_len);
+  _tx_buffer.prependHandoff(&compacted);
+}
+
+
+/*
+* Retires the given number of sent bytes from the front of the TX buffer.
+*   Whole fragments are dropped, and a partly sent fragment is remembered by
+*   offset, rather than culled (which would collapse the buffer). The bytes
+*   are also taken off what stands ahead of the first queued file.
+*   Caller must hold the TX mutex.
+*/
+void LinuxSockPipe::_tx_consume(int len) {
+  if (0 < _tx_files.size()) {
+    LinuxSockFileTX* job = _tx_files.get(0);
+    job->ahead -= strict_min((uint32_t) len, job->ahead);
+  }
+  int frag_len = 0;
+  while (nullptr != _tx_buffer.position(0, &frag_len)) {
+    const int FRAG_REMAINING = (frag_len - _tx_frag_off);
+    if (FRAG_REMAINING > len) {
+      _tx_frag_off += len;
+      return;
+    }
+    len -= FRAG_REMAINING;
+    _tx_buffer.drop_position(0);
+    _tx_frag_off = 0;
+  }
+}
+
+
+/*
+* Records the given number of sent bytes from the front of the TX buffer, if
+*   a capture is attached. Must be called before they are consumed.
+*   Caller must hold the TX mutex.
+*/
+void LinuxSockPipe::_tx_capture(int len) {
+  if ((nullptr == _capture) || (0 >= len)) {
+    return;
+  }
+  struct iovec iov[CONFIG_C3P_SOCKET_TX_IOV];
+  int iov_count = 0;
+  int gathered  = 0;
+  int frag_len  = 0;
+  for (int i = 0; (iov_count < CONFIG_C3P_SOCKET_TX_IOV) && (gathered < len); i++) {
+    uint8_t* frag = _tx_buffer.position(i, &frag_len);
+    if (nullptr == frag) {
+      break;
+    }
+    const int SKIP = ((0 == i) ? _tx_frag_off : 0);
+    if (frag_len > SKIP) {
+      iov[iov_count].iov_base = (frag + SKIP);
+      iov[iov_count].iov_len  = (size_t) strict_min(frag_len - SKIP, len - gathered);
+      gathered += (int) iov[iov_count].iov_len;
+      iov_count++;
+    }
+  }
+  _capture->recordv(C3P_CAPTURE_DIR_TX, iov, iov_count, (uint32_t) gathered);
+}
+
+
+/*
+* Reads everything the socket has, and offers it to the read callback. Each
+*   readv() fills pooled buffers, and what it read is copied out of each into
+*   a fragment of the RX buffer. The pooled buffers are reused by the next pass.
+*
+* @return the number of bytes read, or -1 if the far side hung up.
+*/
+int LinuxSockPipe::_rx_drain() {
+  int ret = 0;
+  struct iovec iov[CONFIG_C3P_SOCKET_RX_IOV];
+  uint8_t* blocks[CONFIG_C3P_SOCKET_RX_IOV];
+  int block_count = 0;
+  while (_sock_id > 0) {
+    while (block_count < CONFIG_C3P_SOCKET_RX_IOV) {
+      blocks[block_count] = _rx_block_take();
+      if (nullptr == blocks[block_count]) {
+        break;
+      }
+      iov[block_count].iov_base = blocks[block_count];
+      iov[block_count].iov_len  = CONFIG_C3P_SOCKET_RX_BLOCK;
+      block_count++;
+    }
+    if (0 == block_count) {
+      break;   // Out of memory. The reactor will call again.
+    }
+    const int CAPACITY = (block_count * CONFIG_C3P_SOCKET_RX_BLOCK);
+    const int N = ::readv(_sock_id, iov, block_count);
+    if (N > 0) {
+      if (nullptr != _capture) {
+        _capture->recordv(C3P_CAPTURE_DIR_RX, iov, block_count, (uint32_t) N);
+      }
+      _count_rx += N;
+      ret += N;
+      for (int i = 0, off = 0; off < N; i++) {
+        const int LEN = strict_min((N - off), (int) CONFIG_C3P_SOCKET_RX_BLOCK);
+        _rx_buffer.concat(blocks[i], LEN);
+        off += LEN;
+      }
+      if (N < CAPACITY) {
+        break;   // Spare the syscall that would return EAGAIN.
+      }
+    }
+    else if (0 == N) {
+      ret = -1;   // EOF.
+      break;
+    }
+    else if (EINTR != errno) {
+      if ((EAGAIN != errno) && (EWOULDBLOCK != errno)) {
+        ret = -1;
+      }
+      break;
+    }
+  }
+  while (0 < block_count) {
+    _rx_block_give(blocks[--block_count]);
+  }
+  if (0 < ret) {
+    _last_rx_ms = millis();
+  }
+  if (0 < _rx_buffer.length()) {
+    if (nullptr != _read_cb_obj) {
+      if (0 == _read_cb_obj->pushBuffer(&_rx_buffer)) {
+        _rx_buffer.clear();
+      }
+    }
+  }
+  return ret;
+}
+
+
+/*
+* Makes the socket non-blocking, and hands it to the reactor. A socket that is
+*   still connecting is watched for writability, which is how the kernel says
+*   that the connection is made (or has failed).
+*/
+int8_t LinuxSockPipe::_reactor_attach() {
+  if (_sock_id <= 0) {
+    return -1;
+  }
+  #if defined(CONFIG_C3P_IO_URING)
+    if (!_connecting && (0 == _uring_attach())) {
+      return 0;
+    }
+  #endif
+  const int FLAGS = fcntl(_sock_id, F_GETFL, 0);
+  if ((FLAGS < 0) || (0 != fcntl(_sock_id, F_SETFL, FLAGS | O_NONBLOCK))) {
+    return -2;
+  }
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if (nullptr == reactor) {
+    return -3;
+  }
+  int8_t ret = 0;
+  pthread_mutex_lock(&_tx_mutex);
+  _tx_armed = (_connecting || !_tx_buffer.isEmpty());
+  const uint32_t EVENTS = (_tx_armed ? (EPOLLIN | EPOLLOUT) : EPOLLIN);
+  if (0 != reactor->add(_sock_id, EVENTS, LinuxSockPipe::_reactor_cb, (void*) this, _shard)) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Reactor refused socket %d (%s).", _sock_id, ((_sock_path) ? _sock_path : "no path"));
+    _tx_armed = false;
+    ret = -3;
+  }
+  else {
+    __atomic_store_n(&_reactor_attached, true, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  return ret;
+}
+
+
+#if defined(CONFIG_C3P_IO_URING)
+/*******************************************************************************
+* io_uring
+* On the ring, the kernel reads into provided buffers without being asked each
+*   time, and sends are queued as linked chains. None of this runs unless
+*   _uring_attach() succeeded.
+*******************************************************************************/
+
+/*
+* Gives the socket to the ring. The socket is made blocking, so that the kernel
+*   waits on it in our place, rather than handing back EAGAIN. Anything queued
+*   before now is sent.
+*
+* @return 0 on success, or -1 if the ring isn't available.
+*/
+int8_t LinuxSockPipe::_uring_attach() {
+  LinuxUring* ring = LinuxUring::getInstance();
+  if ((nullptr == ring) || (LinuxSockTransport::FILE == _transport)) {
+    return -1;
+  }
+  const int FLAGS = fcntl(_sock_id, F_GETFL, 0);
+  if ((FLAGS < 0) || (0 != fcntl(_sock_id, F_SETFL, FLAGS & ~O_NONBLOCK))) {
+    return -1;
+  }
+  int8_t ret = -1;
+  pthread_mutex_lock(&_tx_mutex);
+  _tx_armed    = false;
+  _tx_inflight = 0;
+  _tx_failed   = false;
+  if (0 == ring->recv(_sock_id, LinuxSockPipe::_uring_rx_cb, (void*) this)) {
+    _ring = ring;
+    _uring_tx();
+    ret = 0;
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  return ret;
+}
+
+
+/*
+* If no chain is in flight, sends the front of the TX buffer as one. Fragments
+*   go to the kernel as they are, and stay in the buffer until it says they are
+*   sent. Short fragments are compacted first, as they are for writev().
+*   Caller must hold the TX mutex.
+*/
+void LinuxSockPipe::_uring_tx() {
+  if ((nullptr == _ring) || (0 < _tx_inflight) || _tx_failed || LinuxUring::stopped()) {
+    return;
+  }
+  LinuxSockFileTX* job = ((0 < _tx_files.size()) ? _tx_files.get(0) : nullptr);
+  if ((nullptr != job) && (0 == job->ahead)) {
+    _uring_file_tx(job);
+    return;
+  }
+  const uint32_t LIMIT = ((nullptr != job) ? job->ahead : 0xFFFFFFFF);
+  _tx_compact_head();
+  struct iovec iov[CONFIG_C3P_IO_URING_CHAIN];
+  int frags = 0;
+  int count = 0;
+  uint32_t bytes = 0;
+  while ((count < CONFIG_C3P_IO_URING_CHAIN) && (bytes < LIMIT)) {
+    int frag_len = 0;
+    uint8_t* frag = _tx_buffer.position(frags, &frag_len);
+    if (nullptr == frag) {
+      break;
+    }
+    const int SKIP = ((0 == frags) ? _tx_frag_off : 0);
+    if ((0 < frags) && (frag_len < CONFIG_C3P_SOCKET_TX_COALESCE)) {
+      break;   // Leave it to be compacted before the next chain.
+    }
+    if (frag_len > SKIP) {
+      iov[count].iov_base = (frag + SKIP);
+      iov[count].iov_len  = (size_t) strict_min((uint32_t) (frag_len - SKIP), (LIMIT - bytes));
+      bytes += (uint32_t) iov[count].iov_len;
+      count++;
+    }
+    frags++;
+  }
+  if (0 == count) {
+    if (0 < frags) {
+      _tx_consume(0);   // Nothing but empty fragments.
+    }
+  }
+  else if (0 == _ring->send(_sock_id, iov, count, LinuxSockPipe::_uring_tx_cb, (void*) this)) {
+    _tx_inflight = (uint16_t) count;
+  }
+}
+
+
+/*
+* Called on the ring's thread for each send in a chain. The next chain goes
+*   out once the last of this one is back.
+*/
+int8_t LinuxSockPipe::_uring_tx_cb(int32_t res, uint8_t* data, bool more, void* arg) {
+  LinuxSockPipe* pipe = (LinuxSockPipe*) arg;
+  bool resume = false;
+  pthread_mutex_lock(&pipe->_tx_mutex);
+  if (0 < res) {
+    pipe->_tx_capture(res);
+    pipe->_tx_consume(res);
+    resume = pipe->_tx_gate.removed((uint32_t) res);
+    pipe->_count_tx += res;
+  }
+  else if ((0 > res) && (-ECANCELED != res) && !pipe->_tx_failed) {
+    // The far side is gone. Receive will find out, and close the pipe.
+    pipe->_tx_failed = true;
+    c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "Send on socket %d failed: %s", pipe->_sock_id, strerror(-res));
+  }
+  if (0 < pipe->_tx_inflight) {
+    pipe->_tx_inflight--;
+  }
+  pipe->_uring_tx();
+  pthread_mutex_unlock(&pipe->_tx_mutex);
+  if (resume) {
+    pipe->_tx_gate.notify(pipe);
+  }
+  return 0;
+}
+
+
+/*
+* Puts the next step of a queued file to the ring. Bytes go from the file into
+*   a kernel pipe, and from there into the socket, with splice(). Neither step
+*   copies them into userspace. Caller must hold the TX mutex.
+*/
+void LinuxSockPipe::_uring_file_tx(LinuxSockFileTX* job) {
+  if (0 > job->pipe_fd[0]) {
+    if (0 != pipe2(job->pipe_fd, O_CLOEXEC)) {
+      job->pipe_fd[0] = -1;
+      _tx_failed = true;
+      c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "No pipe for sendFile() on socket %d: %s", _sock_id, strerror(errno));
+      return;
+    }
+    fcntl(job->pipe_fd[1], F_SETPIPE_SZ, CONFIG_C3P_SOCKET_SENDFILE_CHUNK);   // A smaller pipe still works.
+  }
+  int8_t ret = -1;
+  job->to_sock = (0 < job->in_pipe);
+  if (job->to_sock) {
+    ret = _ring->splice(_sock_id, job->pipe_fd[0], -1, _sock_id, job->in_pipe, LinuxSockPipe::_uring_file_cb, (void*) this);
+  }
+  else {
+    const uint32_t LEN = (uint32_t) strict_min((job->total - job->sent), (uint64_t) CONFIG_C3P_SOCKET_SENDFILE_CHUNK);
+    ret = _ring->splice(_sock_id, job->fd, (int64_t) job->offset, job->pipe_fd[1], LEN, LinuxSockPipe::_uring_file_cb, (void*) this);
+  }
+  if (0 == ret) {
+    _tx_inflight = 1;
+  }
+}
+
+
+/*
+* Called on the ring's thread as each splice() of a queued file finishes. Once
+*   the file is sent, or can't be, its callback is told, and the queue moves on.
+*/
+int8_t LinuxSockPipe::_uring_file_cb(int32_t res, uint8_t* data, bool more, void* arg) {
+  LinuxSockPipe* pipe = (LinuxSockPipe*) arg;
+  LinuxSockFileEvent event;
+  event.cb = nullptr;
+  pthread_mutex_lock(&pipe->_tx_mutex);
+  if (0 < pipe->_tx_inflight) {
+    pipe->_tx_inflight--;
+  }
+  LinuxSockFileTX* job = ((0 < pipe->_tx_files.size()) ? pipe->_tx_files.get(0) : nullptr);
+  if ((nullptr != job) && (-ECANCELED != res)) {
+    int err = ((0 > res) ? res : 0);
+    if (0 == err) {
+      if (!job->to_sock) {
+        if (0 == res) {
+          err = -EIO;   // The file is shorter than it was.
+        }
+        job->in_pipe += (uint32_t) res;
+        job->offset  += (uint64_t) res;
+      }
+      else {
+        job->in_pipe -= (uint32_t) res;
+        job->sent    += (uint64_t) res;
+        pipe->_count_tx += res;
+        _file_tx_event(job, 0, &event);
+      }
+    }
+    else if (job->to_sock) {
+      pipe->_tx_failed = true;   // The far side is gone. Receive will find out.
+    }
+    if ((0 != err) || (job->sent == job->total)) {
+      _file_tx_event(job, err, &event);
+      pipe->_tx_files.remove(job);
+      _file_tx_free(job);
+    }
+  }
+  pipe->_uring_tx();
+  pthread_mutex_unlock(&pipe->_tx_mutex);
+  if (nullptr != event.cb) {
+    event.cb(pipe, event.sent, event.total, event.err, event.cb_arg);
+  }
+  return 0;
+}
+
+
+/*
+* Called on the ring's thread with each read. What was read is copied out, so
+*   that the provided buffer goes straight back to the kernel, as the pooled
+*   buffers do in _rx_drain().
+*/
+int8_t LinuxSockPipe::_uring_rx_cb(int32_t res, uint8_t* data, bool more, void* arg) {
+  LinuxSockPipe* pipe = (LinuxSockPipe*) arg;
+  if (0 < res) {
+    if (nullptr != pipe->_capture) {
+      pipe->_capture->record(C3P_CAPTURE_DIR_RX, data, (uint32_t) res);
+    }
+    pipe->_count_rx += res;
+    pipe->_last_rx_ms = millis();
+    pipe->_rx_buffer.concat(data, res);
+    if (nullptr != pipe->_read_cb_obj) {
+      if (0 == pipe->_read_cb_obj->pushBuffer(&pipe->_rx_buffer)) {
+        pipe->_rx_buffer.clear();
+      }
+    }
+  }
+  else if (-ENOBUFS != res) {
+    pipe->_hangup();   // EOF, or the socket failed.
+    return 0;
+  }
+  if (!more) {
+    // The receive stopped. Usually because every provided buffer was in use.
+    //   The TX mutex orders this against _reactor_detach().
+    int8_t rearmed = 0;
+    pthread_mutex_lock(&pipe->_tx_mutex);
+    if (nullptr != pipe->_ring) {
+      rearmed = pipe->_ring->recv(pipe->_sock_id, LinuxSockPipe::_uring_rx_cb, arg);
+    }
+    pthread_mutex_unlock(&pipe->_tx_mutex);
+    if (0 != rearmed) {
+      pipe->_hangup();
+    }
+  }
+  return 0;
+}
+#endif  // CONFIG_C3P_IO_URING
+
+
+/*
+* Opens _sock_path. Sockets are connected without blocking, and the reactor
+*   finishes the job. Paths that are not sockets are opened as files.
+*/
 int8_t LinuxSockPipe::_open() {
   int8_t ret = -1;
-  if (true) {
-    if (0 < _sock_id) {
-      ::close(_sock_id);
-      _sock_id = 0;
-    }
-    _sock_id = open(_sock_path, O_RDWR | O_NOCTTY | O_SYNC);
-    if (_sock_id != -1) {
-      c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Opened socket (%s)", _sock_path);
-      if (0 == _sock_polling_thread_id) {
-        platform.createThread(&_sock_polling_thread_id, nullptr, socket_polling_handler, nullptr, nullptr);
+  if (0 < _sock_id) {
+    close();
+    _sock_id = 0;
+  }
+  _connecting = false;
+  const char* addr = _sock_path;
+  _transport = c3p_sock_transport(_sock_path, &addr);
+  if (LinuxSockTransport::FILE == _transport) {
+    struct stat st;
+    if ((0 == stat(addr, &st)) && S_ISSOCK(st.st_mode)) {
+      _transport = LinuxSockTransport::UNIX;
+    }
+  }
+  switch (_transport) {
+    case LinuxSockTransport::TCP:    _sock_id = _connect_tcp(addr);    break;
+    case LinuxSockTransport::UNIX:   _sock_id = _connect_unix(addr);   break;
+    default:
+      _sock_id = open(_sock_path, O_RDWR | O_NOCTTY | O_SYNC);
+      break;
+  }
+  if (_sock_id > 0) {
+    for (int i = 0; i < (int) LinuxSockOpt::INVALID; i++) {
+      if (0 <= _opts[i]) {
+        _apply_opt((LinuxSockOpt) i, _opts[i]);
       }
-      ret = 0;
+    }
+    c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "%s socket (%s)", (_connecting ? "Connecting" : "Opened"), _sock_path);
+    ret = _reactor_attach();
+  }
+  else {
+    _sock_id = 0;
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Unable to open port: (%s)", _sock_path);
+  }
+  return ret;
+}
+
+
+/*
+* Starts a connection to a unix socket. These either succeed or fail on the
+*   spot, since there is no handshake.
+*
+* @return the new descriptor, or -1 on failure.
+*/
+int LinuxSockPipe::_connect_unix(const char* path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  const int FD = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if ((0 <= FD) && (0 != ::connect(FD, (struct sockaddr*) &addr, sizeof(addr)))) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not connect to %s: %s", path, strerror(errno));
+    ::close(FD);
+    return -1;
+  }
+  return FD;
+}
+
+
+/*
+* Starts a connection to "host:port". The name is resolved here (which may
+*   block, unless it is numeric), and the first address that accepts a
+*   connect() is kept. If that connection then fails, the others are not tried.
+*
+* @return the new descriptor, or -1 on failure.
+*/
+int LinuxSockPipe::_connect_tcp(const char* addr) {
+  char host[256];
+  const char* PORT = nullptr;
+  if (0 != c3p_sock_split_host(addr, host, sizeof(host), &PORT)) {
+    return -1;
+  }
+  struct addrinfo hints;
+  struct addrinfo* res = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  const int GAI_RET = getaddrinfo(host, PORT, &hints, &res);
+  if (0 != GAI_RET) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not resolve %s: %s", addr, gai_strerror(GAI_RET));
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo* ai = res; (nullptr != ai) && (fd < 0); ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (0 == ::connect(fd, ai->ai_addr, ai->ai_addrlen)) {
+      _connecting = false;   // Loopback can finish at once.
+    }
+    else if (EINPROGRESS == errno) {
+      _connecting = true;
     }
     else {
-      c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Unable to open port: (%s)", _sock_path);
+      ::close(fd);
+      fd = -1;
     }
   }
-  return ret;
+  freeaddrinfo(res);
+  if (fd < 0) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not connect to %s: %s", addr, strerror(errno));
+  }
+  return fd;
+}
+
+
+/*
+* Called by the reactor once a connecting socket is writable, or has failed.
+*
+* @return 0 if the connection is made, or -1 if it failed.
+*/
+int8_t LinuxSockPipe::_connect_finish() {
+  int err = 0;
+  socklen_t err_len = sizeof(err);
+  if (0 != getsockopt(_sock_id, SOL_SOCKET, SO_ERROR, &err, &err_len)) {
+    err = errno;
+  }
+  _connecting = false;
+  if (0 != err) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not connect to %s: %s", _sock_path, strerror(err));
+    return -1;
+  }
+  c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Connected to %s", _sock_path);
+  return 0;
+}
+
+
+/*
+* Sets a socket option. The value is kept, and applied to later connections.
+*
+* @return 0 on success (or if the socket isn't open yet), -1 if the kernel
+*   refused it, or -2 if the option doesn't fit the transport.
+*/
+int8_t LinuxSockPipe::sockOpt(LinuxSockOpt opt, int value) {
+  if ((opt >= LinuxSockOpt::INVALID) || (value < 0)) {
+    return -2;
+  }
+  _opts[(int) opt] = value;
+  return ((_sock_id > 0) ? _apply_opt(opt, value) : 0);
+}
+
+
+/*
+* Reads a socket option back from the kernel, or returns the value that will
+*   be applied if the socket isn't open.
+*
+* @return the value, or -1 if it is unknown.
+*/
+int LinuxSockPipe::sockOpt(LinuxSockOpt opt) {
+  if (opt >= LinuxSockOpt::INVALID) {
+    return -1;
+  }
+  if ((_sock_id <= 0) || (LinuxSockTransport::FILE == _transport)) {
+    return _opts[(int) opt];
+  }
+  int level = IPPROTO_TCP;
+  int name  = 0;
+  switch (opt) {
+    case LinuxSockOpt::NODELAY:       name = TCP_NODELAY;        break;
+    case LinuxSockOpt::CORK:          name = TCP_CORK;           break;
+    case LinuxSockOpt::SNDBUF:        level = SOL_SOCKET;  name = SO_SNDBUF;  break;
+    case LinuxSockOpt::RCVBUF:        level = SOL_SOCKET;  name = SO_RCVBUF;  break;
+    case LinuxSockOpt::KEEPALIVE:     name = TCP_KEEPIDLE;       break;
+    case LinuxSockOpt::USER_TIMEOUT:  name = TCP_USER_TIMEOUT;   break;
+    default:                          return -1;
+  }
+  if ((IPPROTO_TCP == level) && (LinuxSockTransport::TCP != _transport)) {
+    return _opts[(int) opt];
+  }
+  if (LinuxSockOpt::KEEPALIVE == opt) {
+    int on = 0;
+    socklen_t on_len = sizeof(on);
+    if ((0 != getsockopt(_sock_id, SOL_SOCKET, SO_KEEPALIVE, &on, &on_len)) || (0 == on)) {
+      return 0;
+    }
+  }
+  int value = 0;
+  socklen_t value_len = sizeof(value);
+  return ((0 == getsockopt(_sock_id, level, name, &value, &value_len)) ? value : -1);
+}
+
+
+int8_t LinuxSockPipe::_apply_opt(LinuxSockOpt opt, int value) {
+  if (LinuxSockTransport::FILE == _transport) {
+    return -2;
+  }
+  const bool IS_TCP = (LinuxSockTransport::TCP == _transport);
+  const int  ONE    = ((0 < value) ? 1 : 0);
+  int ret = -1;
+  switch (opt) {
+    case LinuxSockOpt::NODELAY:
+      ret = IS_TCP ? setsockopt(_sock_id, IPPROTO_TCP, TCP_NODELAY, &ONE, sizeof(ONE)) : -2;
+      break;
+    case LinuxSockOpt::CORK:
+      ret = IS_TCP ? setsockopt(_sock_id, IPPROTO_TCP, TCP_CORK, &ONE, sizeof(ONE)) : -2;
+      break;
+    case LinuxSockOpt::SNDBUF:
+      ret = setsockopt(_sock_id, SOL_SOCKET, SO_SNDBUF, &value, sizeof(value));
+      break;
+    case LinuxSockOpt::RCVBUF:
+      ret = setsockopt(_sock_id, SOL_SOCKET, SO_RCVBUF, &value, sizeof(value));
+      break;
+    case LinuxSockOpt::KEEPALIVE:
+      if (!IS_TCP) {
+        ret = -2;
+      }
+      else {
+        ret = setsockopt(_sock_id, SOL_SOCKET, SO_KEEPALIVE, &ONE, sizeof(ONE));
+        if ((0 == ret) && (0 < value)) {
+          ret |= setsockopt(_sock_id, IPPROTO_TCP, TCP_KEEPIDLE,  &value, sizeof(value));
+          ret |= setsockopt(_sock_id, IPPROTO_TCP, TCP_KEEPINTVL, &value, sizeof(value));
+        }
+      }
+      break;
+    case LinuxSockOpt::USER_TIMEOUT:
+      ret = IS_TCP ? setsockopt(_sock_id, IPPROTO_TCP, TCP_USER_TIMEOUT, &value, sizeof(value)) : -2;
+      break;
+    default:
+      ret = -2;
+      break;
+  }
+  if (-1 == ret) {
+    c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "Socket %d refused %s = %d: %s", _sock_id, _sock_opt_names[(int) opt], value, strerror(errno));
+  }
+  return (int8_t) ((0 == ret) ? 0 : ((-2 == ret) ? -2 : -1));
 }
 
 
 int8_t LinuxSockPipe::close() {
+  pthread_mutex_lock(&_close_mutex);
+  const int8_t RET = _close();
+  pthread_mutex_unlock(&_close_mutex);
+  return RET;
+}
+
+
+/*
+* For callbacks, which must not wait on a close that is waiting on them. If
+*   another thread is closing the pipe, it will finish once we return.
+*/
+void LinuxSockPipe::_hangup() {
+  if (0 == pthread_mutex_trylock(&_close_mutex)) {
+    _close();
+    pthread_mutex_unlock(&_close_mutex);
+  }
+}
+
+
+/*
+* Caller must hold the close mutex.
+*/
+int8_t LinuxSockPipe::_close() {
   int8_t ret = -1;
   if (0 < _sock_id) {
+    // Not under the TX mutex, since a callback in flight might want it.
+    _reactor_detach();
     ::close(_sock_id);  // Close the socket.
     c3p_log(LOG_LEV_NOTICE, __PRETTY_FUNCTION__, "Closed socket %d (%s)", _sock_id, ((_sock_path) ? _sock_path : "no path"));
     _sock_id = -1;
     ret = 0;
   }
+  _connecting = false;
+  pthread_mutex_lock(&_tx_mutex);
+  _tx_armed = false;
+  _tx_frag_off = 0;
   _tx_buffer.clear();
+  _tx_gate.reset();
+  pthread_mutex_unlock(&_tx_mutex);
+  _tx_files_drop(-ECANCELED);
   _rx_buffer.clear();
   return ret;
 }
 
 
+/*
+* Takes the socket away from this pipe, which is left closed and empty. This is
+*   how an accepted connection is handed to another transport, such as
+*   LinuxShmPipe::offer().
+*
+* @return the descriptor, or -1 if there was none.
+*/
+int LinuxSockPipe::detach() {
+  if (_sock_id <= 0) {
+    return -1;
+  }
+  pthread_mutex_lock(&_close_mutex);
+  const int FD = _sock_id;
+  _reactor_detach();
+  _sock_id = -1;
+  _close();
+  pthread_mutex_unlock(&_close_mutex);
+  return FD;
+}
+
+
+/*
+* Stops the reactor (or the ring) from servicing the socket. Once this returns,
+*   no callback for it is running. TX that the kernel might still be reading is
+*   kept by the ring until it is done. Caller must hold the close mutex.
+*/
+void LinuxSockPipe::_reactor_detach() {
+  #if defined(CONFIG_C3P_IO_URING)
+    if (nullptr != _ring) {
+      LinuxUring* ring = _ring;
+      pthread_mutex_lock(&_tx_mutex);
+      _ring = nullptr;   // No new sends.
+      pthread_mutex_unlock(&_tx_mutex);
+      // If the ring is already gone, the kernel cancelled our ops as it closed.
+      const bool RING_ALIVE = !LinuxUring::stopped();
+      if (RING_ALIVE) {
+        ring->cancel(_sock_id);
+      }
+      pthread_mutex_lock(&_tx_mutex);
+      if (RING_ALIVE) {
+        ring->hold(_sock_id, &_tx_buffer);
+      }
+      _tx_inflight = 0;
+      _tx_failed   = false;
+      pthread_mutex_unlock(&_tx_mutex);
+      return;
+    }
+  #endif
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if (nullptr != reactor) {
+    reactor->remove(_sock_id);
+  }
+  __atomic_store_n(&_reactor_attached, false, __ATOMIC_RELEASE);
+}
+
+
+/*
+* Asks the reactor to tell us when the socket can take the pending TX.
+*   Caller must hold the TX mutex.
+*/
+void LinuxSockPipe::_arm_tx() {
+  #if defined(CONFIG_C3P_IO_URING)
+    if (nullptr != _ring) {
+      _uring_tx();
+      return;
+    }
+  #endif
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if ((_sock_id > 0) && !_tx_armed && (nullptr != reactor)) {
+    _tx_armed = true;
+    reactor->modify(_sock_id, EPOLLIN | EPOLLOUT);
+  }
+}
+
+
+/*
+* Write to the socket. Text is never refused, but counts against the budget.
+*/
+void LinuxSockPipe::write(const char* str) {
+  const uint32_t LEN = strlen(str);
+  pthread_mutex_lock(&_tx_mutex);
+  _tx_buffer.concat((uint8_t*) str, LEN);
+  _tx_gate.added(LEN);
+  _arm_tx();
+  pthread_mutex_unlock(&_tx_mutex);
+}
+
+
 /*
 * Write to the socket.
+*
+* @return len, or 0 if the TX budget is spent.
 */
 uint32_t LinuxSockPipe::write(uint8_t* buf, uint32_t len) {
-  _tx_buffer.concat(buf, len);
-  return len;  // TODO: StringBuilder needs an API enhancement to make this safe.
+  uint32_t ret = 0;
+  pthread_mutex_lock(&_tx_mutex);
+  if (_tx_gate.admit(len)) {
+    _tx_buffer.concat(buf, len);
+    _tx_gate.added(len);
+    _arm_tx();
+    ret = len;
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  return ret;
 }
 
 
 /*
 * Write to the socket.
+*
+* @return 1, or 0 if the TX budget is spent.
 */
 uint32_t LinuxSockPipe::write(char c) {
-  _tx_buffer.concat(c);
-  return 1;  // TODO: StringBuilder needs an API enhancement to make this safe.
+  uint32_t ret = 0;
+  pthread_mutex_lock(&_tx_mutex);
+  if (_tx_gate.admit(1)) {
+    _tx_buffer.concat(c);
+    _tx_gate.added(1);
+    _arm_tx();
+    ret = 1;
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  return ret;
+}
+
+
+/**
+* Queues a file to be sent, after whatever has been written before now, and
+*   before whatever is written after. The bytes go from the page cache to the
+*   socket, with sendfile() (or splice(), on the ring), and never pass through
+*   the heap. They don't count against the TX budget. The file is opened here,
+*   so the C3PFile need not outlive the call.
+*
+* @param file is the file to send.
+* @param offset is where in the file to start.
+* @param len is how many bytes to send. Zero means the rest of the file.
+* @param cb is told of progress, and of the end. May be nullptr.
+* @param cb_arg is passed to cb.
+* @return 0 if the file was queued, -1 if the socket isn't open, or -2 if the
+*   file can't be read from that offset.
+*/
+int8_t LinuxSockPipe::sendFile(C3PFile* file, uint64_t offset, uint64_t len, SendFileCallback cb, void* cb_arg) {
+  if (_sock_id <= 0) {
+    return -1;
+  }
+  if ((nullptr == file) || (nullptr == file->path())) {
+    return -2;
+  }
+  const int FD = open(file->path(), O_RDONLY | O_CLOEXEC);
+  if (0 > FD) {
+    return -2;
+  }
+  struct stat st;
+  if ((0 != fstat(FD, &st)) || !S_ISREG(st.st_mode) || (offset > (uint64_t) st.st_size)) {
+    ::close(FD);
+    return -2;
+  }
+  const uint64_t AVAILABLE = ((uint64_t) st.st_size - offset);
+  const uint64_t TOTAL     = ((0 == len) ? AVAILABLE : strict_min(len, AVAILABLE));
+  if (0 == TOTAL) {
+    ::close(FD);
+    if (nullptr != cb) {
+      cb(this, 0, 0, 0, cb_arg);
+    }
+    return 0;
+  }
+  LinuxSockFileTX* job = new LinuxSockFileTX;
+  job->cb         = cb;
+  job->cb_arg     = cb_arg;
+  job->fd         = FD;
+  job->offset     = offset;
+  job->sent       = 0;
+  job->total      = TOTAL;
+  job->pipe_fd[0] = -1;
+  job->pipe_fd[1] = -1;
+  job->in_pipe    = 0;
+  job->to_sock    = false;
+  pthread_mutex_lock(&_tx_mutex);
+  // What is buffered now goes first, less what earlier files are waiting on.
+  uint32_t ahead = _tx_gate.queued();
+  for (int i = 0; i < _tx_files.size(); i++) {
+    ahead -= strict_min(ahead, _tx_files.get(i)->ahead);
+  }
+  job->ahead = ahead;
+  _tx_files.insert(job);
+  _arm_tx();
+  pthread_mutex_unlock(&_tx_mutex);
+  return 0;
 }
 
 
@@ -322,7 +1555,23 @@ void LinuxSockPipe::printDebug(StringBuilder* output) {
     temp.concat(")");
   }
   StringBuilder::styleHeader1(output, (char*) temp.string());
+  static const char* const TRANSPORT_STR[] = {"file", "unix", "TCP"};
+  output->concatf("\tTransport:\t%s%s\n", TRANSPORT_STR[(int) _transport], (_connecting ? " (connecting)" : ""));
+  #if defined(CONFIG_C3P_IO_URING)
+    output->concatf("\tServiced by:\t%s\n", ((nullptr != _ring) ? "io_uring" : "reactor"));
+  #endif
   output->concatf("\tBytes tx/rx:\t%u / %u\n",      _count_tx, _count_rx);
+  pthread_mutex_lock(&_tx_mutex);
+  _tx_gate.printDebug(output);
+  if (0 < _tx_files.size()) {
+    uint64_t file_bytes = 0;
+    for (int i = 0; i < _tx_files.size(); i++) {
+      file_bytes += (_tx_files.get(i)->total - _tx_files.get(i)->sent);
+    }
+    output->concatf("\tFiles queued:\t%d (%llu bytes left)\n", _tx_files.size(), (unsigned long long) file_bytes);
+  }
+  pthread_mutex_unlock(&_tx_mutex);
+  output->concatf("\tRX pool:\t%d idle of %d, %u hits / %u misses (shared)\n", _rx_pool_count, CONFIG_C3P_SOCKET_RX_POOL, _rx_pool_hits, _rx_pool_misses);
 }
 
 
@@ -358,6 +1607,47 @@ int8_t LinuxSockPipe::console_handler(StringBuilder* text_return, StringBuilder*
   else if (0 == StringBuilder::strcasecmp(cmd, "poll")) {
     text_return->concatf("poll() returned %d\n", poll());
   }
+  else if (0 == StringBuilder::strcasecmp(cmd, "budget")) {
+    if (args->count() > 1) {
+      const int HIGH = args->position_as_int(1);
+      const int LOW  = (args->count() > 2) ? args->position_as_int(2) : 0;
+      if (0 < HIGH) {
+        pthread_mutex_lock(&_tx_mutex);
+        _tx_gate.budget((uint32_t) HIGH, (uint32_t) strict_max(LOW, 0));
+        pthread_mutex_unlock(&_tx_mutex);
+      }
+    }
+    text_return->concatf("TX budget is %u bytes.\n", _tx_gate.budget());
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "sendfile")) {
+    if (args->count() > 1) {
+      C3PFile file(args->position_trimmed(1));
+      text_return->concatf("sendFile(%s) returned %d\n", file.path(), sendFile(&file));
+    }
+    else {
+      text_return->concat("Usage: sendfile <path>\n");
+    }
+  }
+  else if (0 == StringBuilder::strcasecmp(cmd, "opt")) {
+    // With a name and a value, sets the option. Always lists them all.
+    if (args->count() > 2) {
+      char* name = args->position_trimmed(1);
+      int i = 0;
+      while ((i < (int) LinuxSockOpt::INVALID) && (0 != StringBuilder::strcasecmp(name, _sock_opt_names[i]))) {
+        i++;
+      }
+      if (i < (int) LinuxSockOpt::INVALID) {
+        const int VALUE = args->position_as_int(2);
+        text_return->concatf("sockOpt(%s, %d) returned %d\n", _sock_opt_names[i], VALUE, sockOpt((LinuxSockOpt) i, VALUE));
+      }
+      else {
+        text_return->concatf("Unknown option: %s\n", name);
+      }
+    }
+    for (int i = 0; i < (int) LinuxSockOpt::INVALID; i++) {
+      text_return->concatf("\t%-12s %d\n", _sock_opt_names[i], sockOpt((LinuxSockOpt) i));
+    }
+  }
   else {
     printDebug(text_return);
   }
@@ -22,6 +22,14 @@ LinuxStdIO is the driver for wrapping STDIN/STDOUT/STDERR into a BufferAccepter.
 */
 
 #include "Linux.h"
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+#ifndef CONFIG_C3P_STDIO_POLL_WAIT_MS
+  // The longest that poll() will wait for input before returning.
+  #define CONFIG_C3P_STDIO_POLL_WAIT_MS  20
+#endif
 
 /*******************************************************************************
 *   ___ _              ___      _ _              _      _
@@ -35,27 +43,175 @@ LinuxStdIO is the driver for wrapping STDIN/STDOUT/STDERR into a BufferAccepter.
 * Constructor.
 */
 LinuxStdIO::LinuxStdIO() {
+  pthread_condattr_t cattr;
+  pthread_condattr_init(&cattr);
+  pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+  pthread_cond_init(&_cond, &cattr);
+  pthread_condattr_destroy(&cattr);
+  pthread_mutex_init(&_mutex, nullptr);
 }
 
 /**
 * Destructor
 */
 LinuxStdIO::~LinuxStdIO() {
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if ((1 == _reactor_state) && (nullptr != reactor)) {
+    reactor->remove(STDIN_FILENO);
+  }
+  pthread_cond_destroy(&_cond);
+  pthread_mutex_destroy(&_mutex);
+}
+
+
+/**
+* Called on a reactor thread when STDIN is readable. The input is handed to
+*   poll(), so that the read callback still runs on the application's thread.
+*/
+void LinuxStdIO::_reactor_cb(int fd, uint32_t events, void* arg) {
+  LinuxStdIO* self = (LinuxStdIO*) arg;
+  uint8_t buf[256];
+  // STDIN is shared with our parent, so it is left blocking. One read() per
+  //   readiness notification can't block.
+  const int N = read(fd, buf, sizeof(buf));
+  if ((N < 0) && ((EAGAIN == errno) || (EINTR == errno))) {
+    return;
+  }
+  pthread_mutex_lock(&self->_mutex);
+  if (N > 0) {
+    self->_rx_pending.concat(buf, N);
+  }
+  else {
+    self->_stdin_eof = true;   // EOF or error. Stop watching.
+  }
+  pthread_cond_signal(&self->_cond);
+  pthread_mutex_unlock(&self->_mutex);
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if ((N <= 0) && (nullptr != reactor)) {
+    reactor->remove(fd);
+  }
+}
+
+
+/*
+* Queue output, and wake poll() if another thread is waiting in it. If more
+*   output is queued than STDOUT has been taking, the buffer is refused.
+*
+* @return 1 if the buffer was taken, or -1 if it was refused.
+*/
+int8_t LinuxStdIO::pushBuffer(StringBuilder* buf) {
+  const uint32_t LEN = (uint32_t) buf->length();
+  int8_t ret = -1;
+  pthread_mutex_lock(&_mutex);
+  if (_tx_gate.admit(LEN)) {
+    _tx_buffer.concatHandoff(buf);
+    _tx_gate.added(LEN);
+    pthread_cond_signal(&_cond);
+    ret = 1;
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+int32_t LinuxStdIO::bufferAvailable() {
+  pthread_mutex_lock(&_mutex);
+  const int32_t RET = _tx_gate.available();
+  pthread_mutex_unlock(&_mutex);
+  return RET;
+}
+
+
+/*
+* Text written this way is never refused, but counts against the budget.
+*/
+void LinuxStdIO::write(const char* str) {
+  const uint32_t LEN = strlen(str);
+  pthread_mutex_lock(&_mutex);
+  _tx_buffer.concat((uint8_t*) str, LEN);
+  _tx_gate.added(LEN);
+  pthread_cond_signal(&_cond);
+  pthread_mutex_unlock(&_mutex);
+}
+
+
+/*
+* Writes everything queued so far. The bytes stay counted against the budget
+*   until printf() has taken them, since that is when their memory is freed.
+*/
+void LinuxStdIO::_flush_tx() {
+  StringBuilder out;
+  pthread_mutex_lock(&_mutex);
+  const uint32_t LEN = _tx_gate.queued();
+  out.concatHandoff(&_tx_buffer);
+  pthread_mutex_unlock(&_mutex);
+  while (out.count()) {
+    const char* working_chunk = (const char*) out.position(0);
+    printf("%s", working_chunk);
+    out.drop_position(0);
+  }
+  fflush(stdout);
+  if (0 < LEN) {
+    pthread_mutex_lock(&_mutex);
+    const bool RESUME = _tx_gate.removed(LEN);
+    pthread_mutex_unlock(&_mutex);
+    if (RESUME) {
+      _tx_gate.notify(this);
+    }
+  }
+}
+
+
+void LinuxStdIO::printDebug(StringBuilder* output) {
+  StringBuilder::styleHeader1(output, "LinuxStdIO");
+  output->concatf("\tSTDIN:\t%s%s\n", ((1 == _reactor_state) ? "reactor" : "fgets()"), (_stdin_eof ? " (EOF)" : ""));
+  pthread_mutex_lock(&_mutex);
+  _tx_gate.printDebug(output);
+  pthread_mutex_unlock(&_mutex);
 }
 
 
 /**
 * Write output to STDOUT, and read input from STDIN.
+* If STDIN can be watched by the reactor, this waits no longer than
+*   CONFIG_C3P_STDIO_POLL_WAIT_MS for input. Otherwise (STDIN is a regular
+*   file, for instance), it blocks in fgets() as it always has.
 */
 int8_t LinuxStdIO::poll() {
   int read_len = 0;
+  _flush_tx();
 
-  while (_tx_buffer.count()) {
-    const char* working_chunk = (const char*) _tx_buffer.position(0);
-    printf("%s", working_chunk);
-    _tx_buffer.drop_position(0);
+  if (0 == _reactor_state) {
+    // Deferred to here, as instances are usually static, and constructed
+    //   before the platform.
+    LinuxReactor* reactor = LinuxReactor::getInstance();
+    const int8_t RET = (nullptr != reactor) ? reactor->add(STDIN_FILENO, EPOLLIN, LinuxStdIO::_reactor_cb, (void*) this) : -1;
+    _reactor_state = ((0 == RET) ? 1 : -1);
+  }
+
+  if (1 == _reactor_state) {
+    pthread_mutex_lock(&_mutex);
+    if (_rx_pending.isEmpty() && _tx_buffer.isEmpty() && !_stdin_eof) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_nsec += (CONFIG_C3P_STDIO_POLL_WAIT_MS % 1000) * 1000000L;
+      deadline.tv_sec  += (CONFIG_C3P_STDIO_POLL_WAIT_MS / 1000) + (deadline.tv_nsec / 1000000000L);
+      deadline.tv_nsec %= 1000000000L;
+      pthread_cond_timedwait(&_cond, &_mutex, &deadline);
+    }
+    read_len = _rx_pending.length();
+    if (0 < read_len) {
+      _rx_buffer.concatHandoff(&_rx_pending);
+    }
+    pthread_mutex_unlock(&_mutex);
+    if ((nullptr != _read_cb_obj) && (0 < _rx_buffer.length())) {
+      if (0 == _read_cb_obj->pushBuffer(&_rx_buffer)) {
+        _rx_buffer.clear();
+      }
+    }
+    _flush_tx();
+    return read_len;
   }
-  fflush(stdout);
 
   // If there is an object to feed the
   char input_text[256];    // Buffer to hold user-input.
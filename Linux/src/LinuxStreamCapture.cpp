@@ -0,0 +1,688 @@
+/*
+File:   LinuxStreamCapture.cpp
+Author: J. Ian Lindsay
+Date:   2026.10.17
+
+Copyright 2026 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Recording and playback of byte streams, for benchmarks that can be repeated.
+  The format is described in C3PStreamCapture.h.
+
+A driver with a capture attached records each chunk as it is read or written,
+  so the capture holds the stream as the driver saw it, split where the kernel
+  split it. Records are gathered in memory, and written out when the buffer
+  fills, or when the capture is closed.
+
+A replay maps the capture, and hands each chunk of one direction to its read
+  callback from a thread of its own. At 100% speed, each chunk goes out when
+  it did in the capture, measured from the first one. If the receiver falls
+  behind, the replay does not slow down to match: later chunks are sent at
+  once until it has caught up with the schedule. At 0% speed, chunks go out
+  as fast as the receiver takes them. A receiver that isn't safe to call from
+  another thread can have the chunks queued instead, and take them with
+  poll(). Chunks that are queued together arrive together.
+*/
+
+#include <Linux.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+
+
+/*******************************************************************************
+*      _______.___________.    ___   .___________. __    ______     _______.
+*     /       |           |   /   \  |           ||  |  /      |   /       |
+*    |   (----`---|  |----`  /  ^  \ `---|  |----`|  | |  ,----'  |   (----`
+*     \   \       |  |      /  /_\  \    |  |     |  | |  |        \   \
+* .----)   |      |  |     /  _____  \   |  |     |  | |  `----.----)   |
+* |_______/       |__|    /__/     \__\  |__|     |__|  \______|_______/
+*
+* Static members and initializers should be located here.
+*******************************************************************************/
+#ifndef CONFIG_C3P_REPLAY_RETRY_US
+  // Delay before offering a chunk again to a receiver that refused it.
+  #define CONFIG_C3P_REPLAY_RETRY_US  100
+#endif
+
+C3P_PERF_HISTOGRAM(_perf_replay_push, "LinuxStreamReplay::push");
+
+static uint64_t _capture_mono_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000ULL) + ((uint64_t) ts.tv_nsec / 1000ULL);
+}
+
+/*
+* Writes all of the given bytes, unless the file refuses them.
+*
+* @return 0 on success, -1 on failure.
+*/
+static int8_t _capture_write(int fd, const uint8_t* buf, uint32_t len) {
+  while (0 < len) {
+    const ssize_t N = ::write(fd, buf, len);
+    if (N > 0) {
+      buf += N;
+      len -= (uint32_t) N;
+    }
+    else if ((N < 0) && (EINTR == errno)) {
+      continue;
+    }
+    else {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static const char* _capture_kind_str(uint8_t kind) {
+  switch (kind) {
+    case C3P_CAPTURE_KIND_UART:    return "UART";
+    case C3P_CAPTURE_KIND_SOCKET:  return "socket";
+    default:                       return "other";
+  }
+}
+
+
+/*******************************************************************************
+* LinuxStreamCapture
+*******************************************************************************/
+
+LinuxStreamCapture::LinuxStreamCapture() {
+  pthread_mutex_init(&_mutex, nullptr);
+}
+
+
+LinuxStreamCapture::~LinuxStreamCapture() {
+  close();
+  if (nullptr != _buf) {
+    free(_buf);
+    _buf = nullptr;
+  }
+  pthread_mutex_destroy(&_mutex);
+}
+
+
+/**
+* Creates (or truncates) the file at the given path, and writes its header.
+*   A capture that was already open is closed first.
+*
+* @param kind is one of C3P_CAPTURE_KIND_*.
+* @param source names what is being captured. It is only kept for reference.
+* @param bitrate is the line rate of a UART, or 0.
+* @return 0 on success, -1 if the file could not be written.
+*/
+int8_t LinuxStreamCapture::open(const char* path, uint8_t kind, const char* source, uint32_t bitrate) {
+  close();
+  if (nullptr == path) {
+    return -1;
+  }
+  pthread_mutex_lock(&_mutex);
+  int8_t ret = -1;
+  if (nullptr == _buf) {
+    _buf = (uint8_t*) malloc(CONFIG_C3P_CAPTURE_BUFFER);
+  }
+  if (nullptr != _buf) {
+    const int FD = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (0 <= FD) {
+      struct timeval tv;
+      gettimeofday(&tv, nullptr);
+      C3PCaptureHeader hdr;
+      memset(&hdr, 0, sizeof(hdr));
+      hdr.magic       = C3P_CAPTURE_MAGIC;
+      hdr.version     = C3P_CAPTURE_VERSION;
+      hdr.header_size = (uint16_t) sizeof(C3PCaptureHeader);
+      hdr.start_us    = _capture_mono_us();
+      hdr.epoch_us    = ((uint64_t) tv.tv_sec * 1000000ULL) + (uint64_t) tv.tv_usec;
+      hdr.bitrate     = bitrate;
+      hdr.kind        = kind;
+      if (nullptr != source) {
+        strncpy(hdr.source, source, C3P_CAPTURE_SOURCE_LEN - 1);
+      }
+      if (0 == _capture_write(FD, (const uint8_t*) &hdr, sizeof(hdr))) {
+        const int PATH_LEN = strlen(path);
+        if (nullptr != _path) {
+          free(_path);
+        }
+        _path = (char*) malloc(PATH_LEN + 1);
+        if (nullptr != _path) {
+          memcpy(_path, path, PATH_LEN + 1);
+        }
+        _fd            = FD;
+        _buf_len       = 0;
+        _last_us       = hdr.start_us;
+        _count_records = 0;
+        _count_rx      = 0;
+        _count_tx      = 0;
+        _count_file    = sizeof(hdr);
+        _count_errors  = 0;
+        ret = 0;
+      }
+      else {
+        ::close(FD);
+      }
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+  if (0 != ret) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not start a capture in %s: %s", path, strerror(errno));
+  }
+  return ret;
+}
+
+
+/**
+* Writes out whatever is buffered, and closes the file.
+*
+* @return 0 on success, -1 if the capture was not open.
+*/
+int8_t LinuxStreamCapture::close() {
+  int8_t ret = -1;
+  pthread_mutex_lock(&_mutex);
+  if (0 <= _fd) {
+    _flush();
+    ::close(_fd);
+    _fd = -1;
+    ret = 0;
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+/**
+* Records a chunk that moved in the given direction, timestamped now.
+*/
+void LinuxStreamCapture::record(uint8_t dir, const uint8_t* buf, uint32_t len) {
+  if (0 == len) {
+    return;
+  }
+  pthread_mutex_lock(&_mutex);
+  if (0 <= _fd) {
+    _begin(dir, len);
+    _append(buf, len);
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+
+/**
+* Records the first len bytes of the given iovecs as a single chunk. This is
+*   how a readv() or writev() is recorded without gathering it first.
+*/
+void LinuxStreamCapture::recordv(uint8_t dir, const struct iovec* iov, int iov_count, uint32_t len) {
+  if (0 == len) {
+    return;
+  }
+  pthread_mutex_lock(&_mutex);
+  if (0 <= _fd) {
+    _begin(dir, len);
+    for (int i = 0; (i < iov_count) && (0 < len); i++) {
+      const uint32_t TAKE = strict_min(len, (uint32_t) iov[i].iov_len);
+      _append((const uint8_t*) iov[i].iov_base, TAKE);
+      len -= TAKE;
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+
+/*
+* Starts a record. The timestamp is taken under the lock, so records are
+*   always in order of time, whichever threads they came from.
+*   Caller must hold the mutex.
+*/
+void LinuxStreamCapture::_begin(uint8_t dir, uint32_t len) {
+  const uint64_t NOW = _capture_mono_us();
+  uint8_t prefix[C3P_CAPTURE_VARINT_MAX * 2];
+  uint32_t prefix_len = c3p_capture_put_varint(prefix, NOW - _last_us);
+  prefix_len += c3p_capture_put_varint(prefix + prefix_len, (((uint64_t) len) << 1) | (dir & 0x01));
+  _last_us = NOW;
+  _append(prefix, prefix_len);
+  _count_records++;
+  if (C3P_CAPTURE_DIR_TX == dir) {
+    _count_tx += len;
+  }
+  else {
+    _count_rx += len;
+  }
+}
+
+
+/*
+* Buffers bytes for the file. Anything too large to ever be buffered is
+*   written straight through. Caller must hold the mutex.
+*/
+void LinuxStreamCapture::_append(const uint8_t* buf, uint32_t len) {
+  if ((_buf_len + len) > CONFIG_C3P_CAPTURE_BUFFER) {
+    _flush();
+  }
+  if (len >= CONFIG_C3P_CAPTURE_BUFFER) {
+    if (0 == _capture_write(_fd, buf, len)) {
+      _count_file += len;
+    }
+    else {
+      _count_errors++;
+    }
+  }
+  else {
+    memcpy(_buf + _buf_len, buf, len);
+    _buf_len += len;
+  }
+}
+
+
+/*
+* Writes out the buffer. If the file won't take it, it is dropped, and the
+*   rest of the capture will not decode past that point.
+*   Caller must hold the mutex.
+*/
+void LinuxStreamCapture::_flush() {
+  if (0 < _buf_len) {
+    if (0 == _capture_write(_fd, _buf, _buf_len)) {
+      _count_file += _buf_len;
+    }
+    else {
+      _count_errors++;
+    }
+    _buf_len = 0;
+  }
+}
+
+
+void LinuxStreamCapture::printDebug(StringBuilder* output) {
+  StringBuilder::styleHeader1(output, "Stream capture");
+  pthread_mutex_lock(&_mutex);
+  if (0 > _fd) {
+    output->concat("\tNot capturing.\n");
+  }
+  else {
+    output->concatf("\tFile:\t\t%s\n", ((nullptr != _path) ? _path : ""));
+    output->concatf("\tRecords:\t%u\n", _count_records);
+    output->concatf("\tBytes rx/tx:\t%llu / %llu\n", (unsigned long long) _count_rx, (unsigned long long) _count_tx);
+    output->concatf("\tFile size:\t%llu (%u buffered)\n", (unsigned long long) (_count_file + _buf_len), _buf_len);
+    if (0 < _count_errors) {
+      output->concatf("\tWrite errors:\t%u\n", _count_errors);
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+
+/*******************************************************************************
+* LinuxStreamReplay
+*******************************************************************************/
+
+LinuxStreamReplay::LinuxStreamReplay() {
+  pthread_mutex_init(&_mutex, nullptr);
+  pthread_condattr_t cattr;
+  pthread_condattr_init(&cattr);
+  pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+  pthread_cond_init(&_cond, &cattr);
+  pthread_condattr_destroy(&cattr);
+}
+
+
+LinuxStreamReplay::~LinuxStreamReplay() {
+  close();
+  pthread_cond_destroy(&_cond);
+  pthread_mutex_destroy(&_mutex);
+}
+
+
+/*
+* Replies from the receiver have nowhere to go. They are counted, and taken.
+*/
+int8_t LinuxStreamReplay::pushBuffer(StringBuilder* buf) {
+  _count_pushed += (uint32_t) buf->length();
+  buf->clear();
+  return 1;
+}
+
+
+int32_t LinuxStreamReplay::bufferAvailable() {
+  return CONFIG_C3P_CAPTURE_BUFFER;
+}
+
+
+/**
+* Hands whatever is queued to the receiver. Only needed with deliverByPoll(),
+*   and called from the receiver's own thread.
+*
+* @return 1 if the receiver took a chunk, 0 if not.
+*/
+int8_t LinuxStreamReplay::poll() {
+  int8_t ret = 0;
+  pthread_mutex_lock(&_mutex);
+  if (!_pending.isEmpty()) {
+    int8_t taken = 1;
+    if (nullptr != _read_cb_obj) {
+      C3P_PERF_SCOPE(_perf_replay_push);
+      taken = _read_cb_obj->pushBuffer(&_pending);
+    }
+    if (-1 != taken) {
+      _pending.clear();   // Whatever it didn't claim, it won't.
+      pthread_cond_broadcast(&_cond);
+      ret = 1;
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+/**
+* Maps a capture, and checks its header. A capture that was already open is
+*   closed first.
+*
+* @return 0 on success, -1 if the file is missing or isn't a capture, -2 if a
+*   replay is running.
+*/
+int8_t LinuxStreamReplay::open(const char* path) {
+  if (_running) {
+    return -2;
+  }
+  close();
+  const int FD = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (0 > FD) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not open %s: %s", path, strerror(errno));
+    return -1;
+  }
+  struct stat st;
+  void* map = MAP_FAILED;
+  if ((0 == fstat(FD, &st)) && ((size_t) st.st_size >= sizeof(C3PCaptureHeader))) {
+    map = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+  }
+  ::close(FD);   // The mapping holds the file.
+  if (MAP_FAILED == map) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "%s is too short to be a capture.", path);
+    return -1;
+  }
+  const C3PCaptureHeader* hdr = (const C3PCaptureHeader*) map;
+  const bool VALID = ((C3P_CAPTURE_MAGIC == hdr->magic) && (C3P_CAPTURE_VERSION == hdr->version) &&
+    (sizeof(C3PCaptureHeader) <= hdr->header_size) && ((size_t) st.st_size >= hdr->header_size));
+  if (!VALID) {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "%s is not a capture this version can read.", path);
+    munmap(map, (size_t) st.st_size);
+    return -1;
+  }
+  madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+  _map     = (uint8_t*) map;
+  _map_len = (size_t) st.st_size;
+  const int PATH_LEN = strlen(path);
+  _path = (char*) malloc(PATH_LEN + 1);
+  if (nullptr != _path) {
+    memcpy(_path, path, PATH_LEN + 1);
+  }
+  return 0;
+}
+
+
+/**
+* Stops any replay, and unmaps the capture.
+*
+* @return 0 on success, -1 if nothing was open.
+*/
+int8_t LinuxStreamReplay::close() {
+  stop();
+  if (nullptr != _path) {
+    free(_path);
+    _path = nullptr;
+  }
+  if (nullptr == _map) {
+    return -1;
+  }
+  munmap(_map, _map_len);
+  _map     = nullptr;
+  _map_len = 0;
+  return 0;
+}
+
+
+/**
+* Starts playing the capture from its beginning.
+*
+* @param speed_pct is the pace as a percentage of the recorded one. 0 sends
+*   each chunk as soon as the receiver has taken the last.
+* @param dir is which side of the capture to play. C3P_CAPTURE_DIR_RX plays
+*   what the driver received, which is what its reader was given.
+* @return 0 on success, -1 if nothing is open, -2 if a replay is running.
+*/
+int8_t LinuxStreamReplay::start(uint16_t speed_pct, uint8_t dir) {
+  if (nullptr == _map) {
+    return -1;
+  }
+  if (_running) {
+    return -2;
+  }
+  stop();   // Collect the thread of the last run.
+  _speed_pct    = speed_pct;
+  _dir          = (dir & 0x01);
+  _finished     = false;
+  _count_chunks = 0;
+  _count_bytes  = 0;
+  _count_stalls = 0;
+  _count_pushed = 0;
+  _elapsed_us   = 0;
+  _capture_us   = 0;
+  _lag_max_us   = 0;
+  pthread_mutex_lock(&_mutex);
+  _pending.clear();
+  pthread_mutex_unlock(&_mutex);
+  __atomic_store_n(&_running, true, __ATOMIC_RELEASE);
+  PlatformThreadOpts topts;
+  memset(&topts, 0, sizeof(topts));
+  topts.thread_name = (char*) "C3PReplay";
+  if (0 != platform.createThread(&_thread_id, nullptr, LinuxStreamReplay::_thread_handler, (void*) this, &topts)) {
+    _thread_id = 0;
+    _running   = false;
+    return -1;
+  }
+  return 0;
+}
+
+
+/**
+* Stops a replay, and waits for its thread. Anything queued for poll() is
+*   dropped. Safe to call if none is running.
+*/
+void LinuxStreamReplay::stop() {
+  pthread_mutex_lock(&_mutex);
+  __atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&_cond);
+  pthread_mutex_unlock(&_mutex);
+  if (0 != _thread_id) {
+    pthread_join((pthread_t) _thread_id, nullptr);
+    _thread_id = 0;
+  }
+  pthread_mutex_lock(&_mutex);
+  _pending.clear();
+  pthread_mutex_unlock(&_mutex);
+}
+
+
+/*
+* Sleeps until the given CLOCK_MONOTONIC time, or until stop() is called.
+*
+* @return true if the replay should go on.
+*/
+bool LinuxStreamReplay::_wait_until(uint64_t due_us) {
+  struct timespec due;
+  due.tv_sec  = (time_t) (due_us / 1000000ULL);
+  due.tv_nsec = (long) ((due_us % 1000000ULL) * 1000ULL);
+  pthread_mutex_lock(&_mutex);
+  while (__atomic_load_n(&_running, __ATOMIC_ACQUIRE) && (_capture_mono_us() < due_us)) {
+    pthread_cond_timedwait(&_cond, &_mutex, &due);
+  }
+  pthread_mutex_unlock(&_mutex);
+  return __atomic_load_n(&_running, __ATOMIC_ACQUIRE);
+}
+
+
+/*
+* Gives one chunk to the receiver, or queues it for poll(). The queue is
+*   allowed one capture buffer's worth before the replay waits on it.
+*
+* @return 1 if the chunk was taken or queued, or -1 if the receiver refused it.
+*/
+int8_t LinuxStreamReplay::_deliver(StringBuilder* chunk) {
+  int8_t ret = 1;
+  if (_by_poll) {
+    pthread_mutex_lock(&_mutex);
+    if (_pending.length() < CONFIG_C3P_CAPTURE_BUFFER) {
+      _pending.concatHandoff(chunk);
+    }
+    else {
+      ret = -1;
+    }
+    pthread_mutex_unlock(&_mutex);
+  }
+  else if (nullptr != _read_cb_obj) {
+    C3P_PERF_SCOPE(_perf_replay_push);
+    ret = _read_cb_obj->pushBuffer(chunk);
+  }
+  return ret;
+}
+
+
+/*
+* Walks the records, and hands the chosen side to the receiver. A record cut
+*   short by the end of the file ends the replay, as the end of the file does.
+*
+* @return 0 if the capture ran out, -1 if the replay was stopped.
+*/
+int8_t LinuxStreamReplay::_play() {
+  const C3PCaptureHeader* hdr = header();
+  const uint8_t* cur = _map + hdr->header_size;
+  const uint8_t* END = _map + _map_len;
+  const uint64_t BASE_US = _capture_mono_us();
+  uint64_t cap_us   = 0;   // Capture time of the current record.
+  uint64_t first_us = 0;   // Capture time of the first record played.
+  bool     first    = true;
+  StringBuilder chunk;
+  while (__atomic_load_n(&_running, __ATOMIC_ACQUIRE)) {
+    uint64_t delta   = 0;
+    uint64_t len_dir = 0;
+    const uint32_t N_DELTA = c3p_capture_get_varint(cur, (uint64_t) (END - cur), &delta);
+    if (0 == N_DELTA) {
+      break;
+    }
+    const uint32_t N_LEN = c3p_capture_get_varint(cur + N_DELTA, (uint64_t) (END - cur - N_DELTA), &len_dir);
+    if (0 == N_LEN) {
+      break;
+    }
+    const uint8_t* payload = cur + N_DELTA + N_LEN;
+    const uint64_t LEN     = (len_dir >> 1);
+    if (LEN > (uint64_t) (END - payload)) {
+      break;
+    }
+    cur = payload + LEN;
+    cap_us += delta;
+    if ((_dir != (len_dir & 0x01)) || (0 == LEN)) {
+      continue;
+    }
+    if (first) {
+      first_us = cap_us;   // Silence before the first chunk isn't replayed.
+      first    = false;
+    }
+    if (0 < _speed_pct) {
+      const uint64_t DUE_US = BASE_US + (((cap_us - first_us) * 100) / _speed_pct);
+      const uint64_t NOW_US = _capture_mono_us();
+      if (DUE_US > NOW_US) {
+        if (!_wait_until(DUE_US)) {
+          return -1;
+        }
+      }
+      else if ((NOW_US - DUE_US) > _lag_max_us) {
+        const uint64_t LAG_US = (NOW_US - DUE_US);
+        _lag_max_us = (LAG_US < 0xFFFFFFFF) ? (uint32_t) LAG_US : 0xFFFFFFFF;
+      }
+    }
+    chunk.concat((uint8_t*) payload, (int) LEN);
+    while (!chunk.isEmpty()) {
+      if (-1 != _deliver(&chunk)) {
+        chunk.clear();   // Whatever it didn't claim, it won't.
+      }
+      else {
+        _count_stalls++;
+        if (!_wait_until(_capture_mono_us() + CONFIG_C3P_REPLAY_RETRY_US)) {
+          return -1;
+        }
+      }
+    }
+    _count_chunks++;
+    _count_bytes += LEN;
+    _capture_us  = cap_us - first_us;
+    _elapsed_us  = _capture_mono_us() - BASE_US;
+  }
+  return (__atomic_load_n(&_running, __ATOMIC_ACQUIRE) ? 0 : -1);
+}
+
+
+void* LinuxStreamReplay::_thread_handler(void* arg) {
+  LinuxStreamReplay* self = (LinuxStreamReplay*) arg;
+  self->_finished = (0 == self->_play());
+  __atomic_store_n(&self->_running, false, __ATOMIC_RELEASE);
+  return nullptr;
+}
+
+
+void LinuxStreamReplay::printDebug(StringBuilder* output) {
+  StringBuilder::styleHeader1(output, "Stream replay");
+  if (nullptr == _map) {
+    output->concat("\tNo capture open.\n");
+    return;
+  }
+  const C3PCaptureHeader* hdr = header();
+  const time_t WHEN = (time_t) (hdr->epoch_us / 1000000ULL);
+  char when_str[32];
+  struct tm when_tm;
+  strftime(when_str, sizeof(when_str), "%Y-%m-%d %H:%M:%S", localtime_r(&WHEN, &when_tm));
+  output->concatf("\tFile:\t\t%s (%u bytes)\n", ((nullptr != _path) ? _path : ""), (uint32_t) _map_len);
+  output->concatf("\tSource:\t\t%s %s", _capture_kind_str(hdr->kind), hdr->source);
+  if (0 < hdr->bitrate) {
+    output->concatf(" at %u bps", hdr->bitrate);
+  }
+  output->concatf("\n\tCaptured:\t%s\n", when_str);
+  output->concatf("\tState:\t\t%s, %s side", (_running ? "Running" : (_finished ? "Finished" : "Stopped")), ((C3P_CAPTURE_DIR_TX == _dir) ? "TX" : "RX"));
+  if (0 < _speed_pct) {
+    output->concatf(" at %u%%\n", _speed_pct);
+  }
+  else {
+    output->concat(" as fast as possible\n");
+  }
+  output->concatf("\tChunks:\t\t%u (%llu bytes)\n", _count_chunks, (unsigned long long) _count_bytes);
+  if (0 < _elapsed_us) {
+    output->concatf("\tElapsed:\t%llu us (captured over %llu us)\n", (unsigned long long) _elapsed_us, (unsigned long long) _capture_us);
+    output->concatf("\tRate:\t\t%llu bytes/s\n", (unsigned long long) ((_count_bytes * 1000000ULL) / _elapsed_us));
+  }
+  output->concatf("\tRefusals:\t%u\n", _count_stalls);
+  if (_by_poll) {
+    pthread_mutex_lock(&_mutex);
+    output->concatf("\tQueued:\t\t%d bytes for poll()\n", _pending.length());
+    pthread_mutex_unlock(&_mutex);
+  }
+  if (0 < _speed_pct) {
+    output->concatf("\tWorst lag:\t%u us\n", _lag_max_us);
+  }
+  output->concatf("\tReplies taken:\t%u bytes\n", _count_pushed);
+}
@@ -33,21 +33,9 @@ This driver fills out the platform-abstracted UARTAdapter class in
 #include <sys/signal.h>
 #include <fstream>
 #include <termios.h>
-
-
-/*******************************************************************************
-* Since linux identifies UARTs by string ("/dev/ttyACMx", or some such), we need
-*   a small wrapper class to allow instancing this way, and forming the
-*   associated bridge to the CppPotpourri classes.
-*******************************************************************************/
-
-typedef struct {
-  UARTAdapter*   instance; // Tracks the UARTAdapter representing it to the rest of CppPotpourri.
-  char*          path;     // This tracks the device under Linux.
-  int            sock;     // This tracks the open port under Linux.
-  struct termios termAttr; // This tracks the port settings under Linux.
-  //StringBuilder  unpushed_rx;  // This eases the conversion to a reliable BufferAccepter.
-} LinuxUARTLookup;
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/ioctl.h>
 
 
 /*******************************************************************************
@@ -61,99 +49,356 @@ typedef struct {
 * Static members and initializers should be located here.
 *******************************************************************************/
 
-unsigned long _uart_polling_thread_id = 0;
-static LinkedList<LinuxUARTLookup*> uart_instances;
+#ifndef CONFIG_C3P_UART_RX_RETRY_MS
+  // Delay before offering the application RX that it refused the last time.
+  #define CONFIG_C3P_UART_RX_RETRY_MS  20
+#endif
+
+#ifndef CONFIG_C3P_UART_FRAME_MAX
+  // A frame that grows this long is handed on without waiting for the line to idle.
+  #define CONFIG_C3P_UART_FRAME_MAX  4096
+#endif
+
+#ifndef CONFIG_C3P_UART_TX_BUFFER
+  // Bytes of TX the driver will hold for the application.
+  #define CONFIG_C3P_UART_TX_BUFFER  4096
+#endif
+
+#ifndef CONFIG_C3P_UART_TX_KBUF
+  // Assumed size of the kernel's tty output queue. Bounds what TX offers at once.
+  #define CONFIG_C3P_UART_TX_KBUF  4096
+#endif
+
+C3P_PERF_HISTOGRAM(_perf_uart_poll, "LinuxUART::_pf_poll");
+
+/* RX chunks are stamped with the raw monotonic clock, so they line up with
+     timestamps taken by other processes. micros() is rebased. */
+static uint64_t _uart_mono_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000ULL) + ((uint64_t) ts.tv_nsec / 1000ULL);
+}
 
+/*
+* glibc's termios can only express the standard Bxxxx rates. The kernel's
+*   termios2 carries any integer rate when the BOTHER flag is given. We mirror
+*   the struct under our own name, since asm/termbits.h can't be included
+*   alongside termios.h. The mirror is the asm-generic layout, which only some
+*   architectures use. MIPS has 23 control characters, and PowerPC, SPARC and
+*   Alpha differ in the flags or the ioctl numbers, even where they define
+*   TCGETS2. Those go without, and take only the standard rates.
+*/
+#if defined(TCGETS2) && (defined(__i386__) || defined(__x86_64__) || defined(__arm__) || defined(__aarch64__) || defined(__riscv))
+  #define C3P_UART_HAS_TERMIOS2
+  #define C3P_UART_BOTHER   0010000   // Take the rate from c_ispeed and c_ospeed.
+  #define C3P_UART_IBSHIFT  16        // Input rate bits, above the output rate bits.
+
+  struct c3p_termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t     c_line;
+    cc_t     c_cc[19];
+    speed_t  c_ispeed;
+    speed_t  c_ospeed;
+  };
+
+  #define C3P_UART_TCGETS2  _IOR('T', 0x2A, struct c3p_termios2)
+  #define C3P_UART_TCSETS2  _IOW('T', 0x2B, struct c3p_termios2)
+#endif
 
-static LinuxUARTLookup* _uart_table_get_by_adapter_ref(UARTAdapter* adapter) {
-  for (int i = 0; i < uart_instances.size(); i++) {
-    LinuxUARTLookup* temp = uart_instances.get(i);
-    if (temp->instance == adapter) return temp;
+
+/*******************************************************************************
+* Since linux identifies UARTs by string ("/dev/ttyACMx", or some such), we need
+*   a small wrapper class to allow instancing this way, and forming the
+*   associated bridge to the CppPotpourri classes.
+*
+* Nothing here polls on a schedule. The reactor wakes us when the port has RX,
+*   when it can take TX that we have queued, when RX that the application
+*   refused is due to be offered again, or when the kernel ought to have put
+*   the last of our TX on the wire. An idle port costs nothing.
+*******************************************************************************/
+
+/**
+* Constructor will allocate memory for the path string.
+*/
+LinuxUART::LinuxUART(char* path) : UARTAdapter(0, 0, 0, 0, 0, CONFIG_C3P_UART_TX_BUFFER, 1024) {
+  const int slen = strlen(path);
+  pthread_mutex_init(&_io_mutex, nullptr);
+  bzero(&_termAttr, sizeof(_termAttr));
+  _path = (char*) malloc(slen+1);
+  if (_path) {
+    memcpy(_path, path, slen);
+    *(_path + slen) = '\0';
+  }
+}
+
+
+/**
+* Destructor will de-init the hardware, and free any memory it used to store
+*   itself.
+*/
+LinuxUART::~LinuxUART() {
+  _pf_deinit();
+  if (nullptr != _path) {
+    free(_path);
+    _path = nullptr;
   }
-  return nullptr;
+  pthread_mutex_destroy(&_io_mutex);
 }
 
 
+char* LinuxUART::path() {
+  return ((nullptr != _path) ? _path : (char*) "");
+}
+
 
 /**
-* This is a thread to keep the UARTs churning.
+* Called on a reactor thread when the port is ready, or when its timer
+*   expires. The reactor has already read the timer.
 */
-static void* uart_polling_handler(void*) {
-  bool keep_polling = true;
-  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Started UART polling thread.\n");
-  while (keep_polling) {
-    sleep_ms(20);
-    for (int i = 0; i < uart_instances.size(); i++) {
-      LinuxUARTLookup* temp = uart_instances.get(i);
-      if (nullptr != temp) {
-        if (temp->instance->initialized()) {
-          temp->instance->poll();
-        }
+void LinuxUART::_reactor_cb(int fd, uint32_t events, void* arg) {
+  LinuxUART* uart = (LinuxUART*) arg;
+  if (fd == uart->_timer) {
+    pthread_mutex_lock(&uart->_io_mutex);
+    uart->_timer_at = 0;
+    pthread_mutex_unlock(&uart->_io_mutex);
+  }
+  if (uart->initialized()) {
+    uart->poll();
+  }
+}
+
+
+/*
+* Changes what the reactor watches the port for, if that is a change. Caller
+*   must hold _io_mutex.
+*/
+void LinuxUART::_set_interest(uint32_t events) {
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if ((_sock > 0) && (events != _events) && (nullptr != reactor)) {
+    _events = events;
+    reactor->modify(_sock, events);
+  }
+}
+
+
+/*
+* Arms the one-shot timer to fire after the given delay, unless it will
+*   already fire sooner. A delay of zero disarms it. Caller must hold _io_mutex.
+*/
+void LinuxUART::_arm_timer(uint32_t delay_us) {
+  if (0 > _timer) {
+    return;
+  }
+  struct itimerspec its;
+  bzero(&its, sizeof(its));
+  if (0 == delay_us) {
+    if (0 != _timer_at) {
+      if (0 == timerfd_settime(_timer, 0, &its, nullptr)) {
+        _timer_at = 0;
       }
     }
-    keep_polling = (0 < uart_instances.size());
+    return;
+  }
+  const uint32_t DEADLINE = (micros() + delay_us) | 1;  // Zero means disarmed.
+  if ((0 == _timer_at) || (0 > (int32_t) (DEADLINE - _timer_at))) {
+    its.it_value.tv_sec  = (delay_us / 1000000);
+    its.it_value.tv_nsec = (delay_us % 1000000) * 1000;
+    if (0 == timerfd_settime(_timer, 0, &its, nullptr)) {
+      _timer_at = DEADLINE;
+    }
   }
-  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Exiting UART polling thread...\n");
-  _uart_polling_thread_id = 0;  // Allow the thread to be restarted later.
-  return NULL;
 }
 
 
-/*******************************************************************************
-* UART wrapper class
-*******************************************************************************/
+/*
+* How many bit-times each character takes on the wire, framing included.
+*/
+uint32_t LinuxUART::_char_bits() {
+  uint32_t ret = 1 + _opts.bit_per_word + 1;   // Start, data, and one stop bit.
+  if (UARTParityBit::NONE != _opts.parity) {
+    ret++;
+  }
+  if (UARTStopBit::STOP_2 == _opts.stop_bits) {
+    ret++;
+  }
+  return ret;
+}
 
-/**
-* Constructor will allocate memory for its lookup list item and the path string.
-* Adds itself to the lookup list.
+
+/*
+* Applies the rate that cfsetspeed() could not, if any, and reads back the rate
+*   the kernel actually gave us. Drivers round to what their clocks can divide.
 *
-* NOTE: Because this constructor modifies static data, it can't be relied upon
-*   if an instance of it is ever allocated statically. So don't do that.
+* @return 0 on success, -1 if the rate could not be applied.
 */
-LinuxUART::LinuxUART(char* path) : UARTAdapter(0, 0, 0, 0, 0, 1024, 1024) {
-  const int slen = strlen(path);
-  LinuxUARTLookup* lookup = (LinuxUARTLookup*) malloc(sizeof(LinuxUARTLookup));
-  if (lookup) {
-    bzero(lookup, sizeof(LinuxUARTLookup));
-    lookup->instance = (UARTAdapter*) this;
-    lookup->path     = (char*) malloc(slen+1);
-    lookup->sock     = -1;
-    if (lookup->path) {
-      memcpy(lookup->path, path, slen);
-      *(lookup->path + slen) = '\0';
-      uart_instances.insert(lookup);
+int8_t LinuxUART::_apply_bitrate(bool standard) {
+  _bitrate_other = !standard;
+  #if defined(C3P_UART_HAS_TERMIOS2)
+    struct c3p_termios2 t2;
+    if (0 != ioctl(_sock, C3P_UART_TCGETS2, &t2)) {
+      _bitrate_actual = (standard ? _opts.bitrate : 0);
+      return (standard ? 0 : -1);
+    }
+    if (!standard) {
+      // Input rate bits of zero mean the input runs at the output rate.
+      t2.c_cflag &= ~(CBAUD | (CBAUD << C3P_UART_IBSHIFT));
+      t2.c_cflag |= C3P_UART_BOTHER;
+      t2.c_ispeed = _opts.bitrate;
+      t2.c_ospeed = _opts.bitrate;
+      if ((0 != ioctl(_sock, C3P_UART_TCSETS2, &t2)) || (0 != ioctl(_sock, C3P_UART_TCGETS2, &t2))) {
+        _bitrate_actual = 0;
+        return -1;
+      }
+    }
+    _bitrate_actual = t2.c_ospeed;
+    return 0;
+  #else
+    _bitrate_actual = (standard ? _opts.bitrate : 0);
+    return (standard ? 0 : -1);
+  #endif
+}
+
+
+/*
+* Ends the open frame, and offers it to the application. Caller must have
+*   checked that no finished frame is waiting.
+*
+* @return 1 if the frame was taken, 0 otherwise.
+*/
+int8_t LinuxUART::_close_frame() {
+  _rx_ready.concatHandoff(&_rx_frame);
+  _ready_first = _frame_first;
+  _ready_last  = _frame_last;
+  return _deliver_frame();
+}
+
+
+/*
+* Offers the finished frame to the application. What it doesn't take stays
+*   put, and is offered again later as the same frame.
+*
+* @return 1 if the frame was taken, 0 otherwise.
+*/
+int8_t LinuxUART::_deliver_frame() {
+  if (!_rx_ready.isEmpty() && (nullptr != _read_cb_obj)) {
+    _read_cb_obj->pushBuffer(&_rx_ready);
+    if (_rx_ready.isEmpty()) {
+      _frames_rx++;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+/*
+* The RX half of _pf_poll() when framing by idle gaps. Every read() is a chunk,
+*   stamped on return. A chunk that follows the last one by more than the gap
+*   starts a new frame. Once the application is holding up a finished frame,
+*   we stop reading, and the kernel buffers for us.
+*
+* NOTE: A chunk holds everything the kernel had when we read. If the reactor
+*   was slow to wake us, two frames can share a chunk. USB-serial adapters
+*   also batch RX on their own latency timer (often 1-16ms), which puts a
+*   floor on the gaps that can be seen at all.
+*
+* @param wait_us is lowered to when the open frame would end, if there is one.
+* @return 1 if a frame was taken by the application, 0 otherwise.
+*/
+int8_t LinuxUART::_poll_rx_framed(uint32_t* wait_us) {
+  int8_t ret = _deliver_frame();
+  const uint32_t GAP_US = __atomic_load_n(&_frame_gap_us, __ATOMIC_ACQUIRE);
+  const bool     READ   = (0 < __atomic_load_n(&_frame_gap, __ATOMIC_ACQUIRE));
+  uint8_t buf[255];
+  while (READ && _rx_ready.isEmpty()) {
+    const int n = (int) ::read(_sock, buf, sizeof(buf));
+    if (n <= 0) {
+      break;
+    }
+    if (nullptr != _capture) {
+      _capture->record(C3P_CAPTURE_DIR_RX, buf, (uint32_t) n);
+    }
+    const uint64_t NOW = _uart_mono_us();
+    if (!_rx_frame.isEmpty() && ((NOW - _frame_last) > GAP_US)) {
+      ret |= _close_frame();
+    }
+    if (_rx_frame.isEmpty()) {
+      _frame_first = NOW;
+    }
+    _rx_frame.concat(buf, n);
+    _frame_last = NOW;
+    last_byte_rx_time = millis();
+    if ((_rx_ready.isEmpty()) && (CONFIG_C3P_UART_FRAME_MAX <= _rx_frame.length())) {
+      ret |= _close_frame();
+    }
+    if (n < (int) sizeof(buf)) {
+      break;
+    }
+  }
+  // Nothing will wake us when the line goes quiet, so the timer must.
+  if (!_rx_frame.isEmpty() && _rx_ready.isEmpty()) {
+    const uint64_t IDLE_US = _uart_mono_us() - _frame_last;
+    if (IDLE_US > GAP_US) {
+      ret |= _close_frame();
     }
     else {
-      free(lookup);
+      const uint32_t REMAINING = (uint32_t) (GAP_US - IDLE_US) + 1;
+      *wait_us = (0 == *wait_us) ? REMAINING : strict_min(*wait_us, REMAINING);
     }
   }
+  return ret;
 }
 
 
-/**
-* Destructor will de-init the hardware, remove itself from the lookup list,
-*   and free any memory it used to store itself.
+/*
+* A gap in character-times, as microseconds at the applied rate. Zero if the
+*   port is closed.
 */
-LinuxUART::~LinuxUART() {
-  LinuxUARTLookup* lookup = _uart_table_get_by_adapter_ref(this);
-  _pf_deinit();
-  if (nullptr != lookup) {
-    uart_instances.remove(lookup);
-    free(lookup->path);
-    lookup->path = nullptr;
-    free(lookup);
+uint32_t LinuxUART::_frame_gap_to_us(uint8_t gap) {
+  if (0 == _bitrate_actual) {
+    return 0;
   }
+  return (uint32_t) (((uint64_t) gap * _char_bits() * 1000000) / _bitrate_actual);
 }
 
 
-char* LinuxUART::path() {
-  LinuxUARTLookup* lookup = _uart_table_get_by_adapter_ref(this);
-  if (lookup) {
-    return lookup->path;
+/*
+* True while RX goes through the framed path. That lasts past the gap being
+*   set to zero, until any frame already begun has been handed over.
+*/
+bool LinuxUART::_framing() {
+  return ((0 < __atomic_load_n(&_frame_gap, __ATOMIC_ACQUIRE)) || !_rx_frame.isEmpty() || !_rx_ready.isEmpty());
+}
+
+
+/*
+* Takes the port and its timer out of the reactor, and closes the port.
+*/
+void LinuxUART::_close_port() {
+  // After the reactor is shut down, it has let go of both, and closed the timer.
+  LinuxReactor* reactor = LinuxReactor::getInstance();
+  if (0 <= _timer) {
+    if (nullptr != reactor) {
+      reactor->remove(_timer);  // The reactor closes its own timers.
+    }
+    _timer = -1;
+  }
+  if (0 < _sock) {
+    if (nullptr != reactor) {
+      reactor->remove(_sock);
+    }
+    close(_sock);
+    _sock = -1;
   }
-  return (char*) "";
+  _events   = 0;
+  _timer_at = 0;
+  _bitrate_actual = 0;
 }
 
+
 /*******************************************************************************
 * Implementation of UARTAdapter.
 *******************************************************************************/
@@ -164,6 +409,44 @@ char* LinuxUART::path() {
 void LinuxUART::irq_handler() {}
 
 
+/*
+* Sets the idle gap that ends a frame. If the port is open, the gap is
+*   converted at the applied rate now, and the reactor picks it up on its next
+*   pass. Turning framing off hands over any frame already begun first.
+*/
+void LinuxUART::rxFrameGap(uint8_t x) {
+  __atomic_store_n(&_frame_gap_us, _frame_gap_to_us(x), __ATOMIC_RELEASE);
+  __atomic_store_n(&_frame_gap, x, __ATOMIC_RELEASE);
+}
+
+
+/*
+* Queue the buffer for TX, and ask the reactor to tell us when the port can
+*   take it. If the port is writable, that is immediately.
+*/
+int8_t LinuxUART::pushBuffer(StringBuilder* buf) {
+  const int8_t RET = UARTAdapter::pushBuffer(buf);
+  if (!_tx_buffer.isEmpty()) {
+    _flushed = false;
+    pthread_mutex_lock(&_io_mutex);
+    _set_interest(_events | EPOLLOUT);
+    pthread_mutex_unlock(&_io_mutex);
+  }
+  return RET;
+}
+
+
+
+void LinuxUART::printDebug(StringBuilder* output) {
+  UARTAdapter::printDebug(output);
+  output->concatf("\tPath:          %s\n", path());
+  output->concatf("\tLine rate:     %u bps%s (asked for %u)\n", _bitrate_actual, (_bitrate_other ? " via termios2" : ""), _opts.bitrate);
+  if (0 < _frame_gap) {
+    output->concatf("\tFrame gap:     %u chars (%uus)\n", _frame_gap, _frame_gap_us);
+    output->concatf("\tFrames taken:  %u (%d bytes open, %d waiting)\n", _frames_rx, _rx_frame.length(), _rx_ready.length());
+  }
+}
+
 
 /**
 * Execute any I/O callbacks that are pending. The function is present because
@@ -172,47 +455,101 @@ void LinuxUART::irq_handler() {}
 * @return 0 on no action, 1 on successful action, -1 on error.
 */
 int8_t LinuxUART::_pf_poll() {
+  C3P_PERF_SCOPE(_perf_uart_poll);
   int8_t return_value = 0;
-  LinuxUARTLookup* lookup = _uart_table_get_by_adapter_ref(this);
-  if (nullptr != lookup) {
-    if (lookup->sock > 0) {
-      if (txCapable() & (0 < _tx_buffer.count())) {
-        // Refill the TX buffer...
-        const uint32_t TX_COUNT = strict_min((uint32_t) 64, _tx_buffer.count());
-        if (0 < TX_COUNT) {
-          uint8_t side_buffer[TX_COUNT] = {0, };
-          const int32_t PEEK_COUNT = _tx_buffer.peek(side_buffer, TX_COUNT);
-          const int BYTES_WRITTEN = (int) ::write(lookup->sock, side_buffer, PEEK_COUNT);
-
-          //StringBuilder tmp_log;
-          //tmp_log.concatf("\n\n__________Bytes written (%d)________\n", bytes_written);
-          //_tx_buffer.printDebug(&tmp_log);
-          //printf("%s\n\n", tmp_log.string());
-          //_tx_buffer.cull(bytes_written);
-          _flushed = _tx_buffer.isEmpty();
-          if (BYTES_WRITTEN > 0) {
-            _tx_buffer.cull(BYTES_WRITTEN);
-            return_value |= 1;
+  if (_sock > 0) {
+    if (txCapable() & (0 < _tx_buffer.count())) {
+      // Offer the kernel only as much as its output queue has room for. If
+      //   the queue is larger than we think, the kernel will tell us with a
+      //   short write.
+      uint8_t stage[CONFIG_C3P_UART_TX_KBUF];
+      int queued = 0;
+      uint32_t room = sizeof(stage);
+      if ((0 == ioctl(_sock, TIOCOUTQ, &queued)) && (queued > 0)) {
+        room = ((uint32_t) queued < room) ? (room - (uint32_t) queued) : 0;
+      }
+      if (0 == room) {
+        room = sizeof(stage);   // The kernel said it was writable. Let it decide.
+      }
+      while ((0 < room) && !_tx_buffer.isEmpty()) {
+        const uint32_t TX_COUNT = strict_min(room, (uint32_t) _tx_buffer.count());
+        const int32_t  PEEK_COUNT = _tx_buffer.peek(stage, TX_COUNT);
+        const int BYTES_WRITTEN = (int) ::write(_sock, stage, PEEK_COUNT);
+        if (BYTES_WRITTEN > 0) {
+          if (nullptr != _capture) {
+            _capture->record(C3P_CAPTURE_DIR_TX, stage, (uint32_t) BYTES_WRITTEN);
           }
+          _tx_buffer.cull(BYTES_WRITTEN);
+          room -= strict_min(room, (uint32_t) BYTES_WRITTEN);
+          return_value |= 1;
         }
+        if (BYTES_WRITTEN < PEEK_COUNT) {
+          break;   // The kernel is full.
+        }
+      }
+    }
+    // We are flushed when the kernel has nothing of ours left to send.
+    //   Nothing will wake us for that, so we estimate when it will happen
+    //   from the line rate, and check again then.
+    uint32_t drain_us = 0;
+    if (!_flushed && _tx_buffer.isEmpty()) {
+      int queued = 0;
+      if ((0 == ioctl(_sock, TIOCOUTQ, &queued)) && (queued > 0) && (0 < _bitrate_actual)) {
+        const uint64_t DRAIN_US = ((uint64_t) queued * _char_bits() * 1000000) / _bitrate_actual;
+        drain_us = (DRAIN_US < 1000000) ? ((uint32_t) DRAIN_US + 1) : 1000000;
+      }
+      else {
+        _flushed = true;
       }
-      if (rxCapable()) {
-        const uint32_t RX_COUNT = strict_min((uint32_t) _rx_buffer.vacancy(), (uint32_t) 255);
-        uint8_t buf[RX_COUNT] = {0, };
-        int n = ::read(lookup->sock, buf, RX_COUNT);
+    }
+    uint32_t frame_us = 0;
+    if (rxCapable() && _framing()) {
+      return_value |= _poll_rx_framed(&frame_us);
+    }
+    else if (rxCapable()) {
+      // Drain the port while we are here. With VMIN and VTIME both zero, the
+      //   port reads readable on the first byte, and a non-blocking read()
+      //   returns whatever has arrived without waiting for more.
+      uint8_t buf[255];
+      uint32_t rx_count = 0;
+      int n = 0;
+      do {
+        rx_count = strict_min((uint32_t) _rx_buffer.vacancy(), (uint32_t) sizeof(buf));
+        n = (0 < rx_count) ? (int) ::read(_sock, buf, rx_count) : 0;
         if (n > 0) {
+          if (nullptr != _capture) {
+            _capture->record(C3P_CAPTURE_DIR_RX, buf, (uint32_t) n);
+          }
           _rx_buffer.insert(buf, n);
           last_byte_rx_time = millis();
-          //StringBuilder tmp_log;
-          //tmp_log.concatf("\n\n__________Bytes read (%d)________\n", n);
-          //_rx_buffer.printDebug(&tmp_log);
-          //printf("%s\n\n", tmp_log.string());
         }
         if (0 < _handle_rx_push()) {
           return_value |= 1;
         }
-      }
+      } while ((n > 0) && ((uint32_t) n == rx_count));
     }
+    // Only watch for what we can act on. A level-triggered fd that we
+    //   can't service would otherwise wake the reactor without end. RX that
+    //   the application refused will not wake us by itself, so the timer will.
+    uint32_t wait_us = drain_us;
+    if (0 < frame_us) {
+      wait_us = (0 == wait_us) ? frame_us : strict_min(wait_us, frame_us);
+    }
+    if (rxCapable() && !(_rx_buffer.isEmpty() && _rx_ready.isEmpty())) {
+      const uint32_t RETRY_US = CONFIG_C3P_UART_RX_RETRY_MS * 1000;
+      wait_us = (0 == wait_us) ? RETRY_US : strict_min(wait_us, RETRY_US);
+    }
+    pthread_mutex_lock(&_io_mutex);
+    uint32_t nu_events = 0;
+    if (rxCapable() && (_framing() ? _rx_ready.isEmpty() : (0 < _rx_buffer.vacancy()))) {
+      nu_events |= EPOLLIN;
+    }
+    if (!_tx_buffer.isEmpty()) {
+      nu_events |= EPOLLOUT;
+    }
+    _set_interest(nu_events);
+    _arm_timer(wait_us);
+    pthread_mutex_unlock(&_io_mutex);
   }
   return return_value;
 }
@@ -220,98 +557,137 @@ int8_t LinuxUART::_pf_poll() {
 
 int8_t LinuxUART::_pf_init() {
   int8_t ret = -1;
-  LinuxUARTLookup* lookup = _uart_table_get_by_adapter_ref(this);
-  if (nullptr != lookup) {
-    _adapter_clear_flag(UART_FLAG_UART_READY);
-    if (0 < lookup->sock) {
-      close(lookup->sock);
+  if (nullptr == _path) {
+    return ret;
+  }
+  _adapter_clear_flag(UART_FLAG_UART_READY);
+  _close_port();
+  _sock = open(_path, O_RDWR | O_NOCTTY | O_SYNC);
+  if (_sock != -1) {
+    tcgetattr(_sock, &_termAttr);
+    // cfsetspeed() knows only the standard rates. Anything else goes through
+    //   termios2 once the rest of the settings are in.
+    const bool STANDARD_RATE = (0 == cfsetspeed(&_termAttr, _opts.bitrate));
+    if (!STANDARD_RATE) {
+      cfsetspeed(&_termAttr, B38400);
     }
-    lookup->sock = open(lookup->path, O_RDWR | O_NOCTTY | O_SYNC);
-    if (lookup->sock != -1) {
-      tcgetattr(lookup->sock, &(lookup->termAttr));
-      cfsetspeed(&(lookup->termAttr), _opts.bitrate);
-      lookup->termAttr.c_cflag &= ~CSIZE;           // Enable char size mask
-      switch (_opts.bit_per_word) {
-        case 5:  lookup->termAttr.c_cflag |= CS5;  break;
-        case 6:  lookup->termAttr.c_cflag |= CS6;  break;
-        case 7:  lookup->termAttr.c_cflag |= CS7;  break;
-        case 8:  lookup->termAttr.c_cflag |= CS8;  break;
-        default:
-          c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "%d bis-per-word is invalid for %s.\n", _opts.bit_per_word, lookup->path);
-          return ret;
-      }
-      switch (_opts.parity) {
-        case UARTParityBit::NONE:  lookup->termAttr.c_cflag &= ~PARENB;            break;
-        case UARTParityBit::EVEN:  lookup->termAttr.c_cflag |= PARENB;             break;
-        case UARTParityBit::ODD:   lookup->termAttr.c_cflag |= (PARENB | PARODD);  break;
-        default:
-          c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Invalid parity selection for %s.\n", lookup->path);
-          return ret;
-      }
-      switch (_opts.stop_bits) {
-        case UARTStopBit::STOP_1:  lookup->termAttr.c_cflag &= ~CSTOPB;  break;
-        case UARTStopBit::STOP_2:  lookup->termAttr.c_cflag |= CSTOPB;   break;
-        default:
-          c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Unsupported stop-bit selection for %s.\n", lookup->path);
-          return ret;
-      }
-      switch (_opts.flow_control) {
-        case UARTFlowControl::NONE:     lookup->termAttr.c_cflag |= CLOCAL;   break;
-        case UARTFlowControl::RTS_CTS:  lookup->termAttr.c_cflag |= CRTSCTS;  break;
-        default:
-          c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Unsupported flow control selection for %s.\n", lookup->path);
-          return ret;
+    _termAttr.c_cflag &= ~CSIZE;           // Enable char size mask
+    switch (_opts.bit_per_word) {
+      case 5:  _termAttr.c_cflag |= CS5;  break;
+      case 6:  _termAttr.c_cflag |= CS6;  break;
+      case 7:  _termAttr.c_cflag |= CS7;  break;
+      case 8:  _termAttr.c_cflag |= CS8;  break;
+      default:
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "%d bis-per-word is invalid for %s.\n", _opts.bit_per_word, _path);
+        return ret;
+    }
+    switch (_opts.parity) {
+      case UARTParityBit::NONE:  _termAttr.c_cflag &= ~PARENB;            break;
+      case UARTParityBit::EVEN:  _termAttr.c_cflag |= PARENB;             break;
+      case UARTParityBit::ODD:   _termAttr.c_cflag |= (PARENB | PARODD);  break;
+      default:
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Invalid parity selection for %s.\n", _path);
+        return ret;
+    }
+    switch (_opts.stop_bits) {
+      case UARTStopBit::STOP_1:  _termAttr.c_cflag &= ~CSTOPB;  break;
+      case UARTStopBit::STOP_2:  _termAttr.c_cflag |= CSTOPB;   break;
+      default:
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Unsupported stop-bit selection for %s.\n", _path);
+        return ret;
+    }
+    switch (_opts.flow_control) {
+      case UARTFlowControl::NONE:     _termAttr.c_cflag |= CLOCAL;   break;
+      case UARTFlowControl::RTS_CTS:  _termAttr.c_cflag |= CRTSCTS;  break;
+      default:
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Unsupported flow control selection for %s.\n", _path);
+        return ret;
+    }
+    // If an input buffer was desired, we turn on RX.
+    if (0 < _rx_buffer.capacity()) {
+      _termAttr.c_cflag |= CREAD;
+      _adapter_set_flag(UART_FLAG_HAS_RX);
+    }
+
+    _termAttr.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+    _termAttr.c_iflag &= ~(IXON | IXOFF | IXANY);
+    _termAttr.c_oflag &= ~OPOST;
+    // The tty layer only reports the port readable once VMIN bytes are
+    //   waiting (when VTIME is zero). Zero for both means the first byte wakes
+    //   us, which is what keeps latency independent of message length.
+    _termAttr.c_cc[VMIN]  = 0;
+    _termAttr.c_cc[VTIME] = 0;
+    if (tcsetattr(_sock, TCSANOW, &_termAttr) == 0) {
+      if (0 != _apply_bitrate(STANDARD_RATE)) {
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "%s can't run at %ubps.\n", _path, _opts.bitrate);
+        _close_port();
+        return ret;
       }
-      // If an input buffer was desired, we turn on RX.
-      if (0 < _rx_buffer.capacity()) {
-        lookup->termAttr.c_cflag |= CREAD;
-        _adapter_set_flag(UART_FLAG_HAS_RX);
+      const uint32_t RATE_ERR = (_bitrate_actual > _opts.bitrate) ? (_bitrate_actual - _opts.bitrate) : (_opts.bitrate - _bitrate_actual);
+      if (RATE_ERR > (_opts.bitrate / 50)) {
+        // Past 2%, the far end is unlikely to stay in sync.
+        c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "%s asked for %ubps, but got %ubps.\n", _path, _opts.bitrate, _bitrate_actual);
       }
-
-      c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, "Opened UART (%s) at %dbps\n", lookup->path, _opts.bitrate);
-      lookup->termAttr.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
-      lookup->termAttr.c_iflag &= ~(IXON | IXOFF | IXANY);
-      lookup->termAttr.c_oflag &= ~OPOST;
-      lookup->termAttr.c_cc[VMIN]  = 0;
-      lookup->termAttr.c_cc[VTIME] = 0;
-      if (tcsetattr(lookup->sock, TCSANOW, &(lookup->termAttr)) == 0) {
-        _adapter_set_flag(UART_FLAG_UART_READY | UART_FLAG_HAS_TX);
-        _adapter_clear_flag(UART_FLAG_PENDING_CONF | UART_FLAG_PENDING_RESET);
-        _flushed = true;
-        if (0 == _uart_polling_thread_id) {
-          platform.createThread(&_uart_polling_thread_id, nullptr, uart_polling_handler, nullptr, nullptr);
+      c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, "Opened UART (%s) at %ubps\n", _path, _bitrate_actual);
+      __atomic_store_n(&_frame_gap_us, _frame_gap_to_us(_frame_gap), __ATOMIC_RELEASE);
+      _adapter_set_flag(UART_FLAG_UART_READY | UART_FLAG_HAS_TX);
+      _adapter_clear_flag(UART_FLAG_PENDING_CONF | UART_FLAG_PENDING_RESET);
+      _flushed = true;
+      LinuxReactor* reactor = LinuxReactor::getInstance();
+      const int FLAGS = fcntl(_sock, F_GETFL, 0);
+      fcntl(_sock, F_SETFL, FLAGS | O_NONBLOCK);
+      pthread_mutex_lock(&_io_mutex);
+      _events = (_tx_buffer.isEmpty() ? EPOLLIN : (EPOLLIN | EPOLLOUT));
+      const int8_t ADD_RET = (nullptr != reactor) ? reactor->add(_sock, _events, _reactor_cb, (void*) this) : -1;
+      pthread_mutex_unlock(&_io_mutex);
+      if (0 == ADD_RET) {
+        // The timer shares the port's reactor thread, so the two never call
+        //   poll() at once. It is disarmed until there is something to wait
+        //   for. Without it, refused RX and the TX drain would never be
+        //   revisited, so the port is no use.
+        _timer = reactor->addTimer(CONFIG_C3P_UART_RX_RETRY_MS * 1000, _reactor_cb, (void*) this, reactor->shardOf(_sock));
+        if (0 <= _timer) {
+          struct itimerspec its;
+          bzero(&its, sizeof(its));
+          timerfd_settime(_timer, 0, &its, nullptr);
+          ret = 0;
+        }
+        else {
+          c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Could not make a timer for %s.\n", _path);
         }
-        ret = 0;
       }
       else {
-        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to tcsetattr...\n");
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Reactor refused %s.\n", _path);
+      }
+      if (0 != ret) {
+        _adapter_clear_flag(UART_FLAG_UART_READY | UART_FLAG_HAS_TX);
+        _close_port();
       }
     }
     else {
-      c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Unable to open port: (%s)\n", lookup->path);
+      c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Failed to tcsetattr...\n");
     }
   }
+  else {
+    c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "Unable to open port: (%s)\n", _path);
+  }
   return ret;
 }
 
 
 int8_t LinuxUART::_pf_deinit() {
-  int8_t ret = -2;
-  LinuxUARTLookup* lookup = _uart_table_get_by_adapter_ref(this);
-  if (nullptr != lookup) {
-    _adapter_clear_flag(UART_FLAG_UART_READY | UART_FLAG_PENDING_RESET | UART_FLAG_PENDING_CONF);
-    if (txCapable()) {
-      //uart_wait_tx_idle_polling((uart_port_t) ADAPTER_NUM);
-      _flushed = true;
-    }
-    if (0 < lookup->sock) {
-      close(lookup->sock);  // Close the socket.
-      lookup->sock = -1;
-      c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, "Closed UART (%s)\n", lookup->path);
-    }
-    _tx_buffer.clear();
-    _rx_buffer.clear();
-    ret = 0;
+  _adapter_clear_flag(UART_FLAG_UART_READY | UART_FLAG_PENDING_RESET | UART_FLAG_PENDING_CONF);
+  if (txCapable()) {
+    //uart_wait_tx_idle_polling((uart_port_t) ADAPTER_NUM);
+    _flushed = true;
   }
-  return ret;
+  if (0 < _sock) {
+    _close_port();
+    c3p_log(LOG_LEV_INFO, __PRETTY_FUNCTION__, "Closed UART (%s)\n", path());
+  }
+  _tx_buffer.clear();
+  _rx_buffer.clear();
+  _rx_frame.clear();
+  _rx_ready.clear();
+  return 0;
 }
@@ -0,0 +1,942 @@
+/*
+File:   LinuxUring.cpp
+Author: J. Ian Lindsay
+Date:   2026.10.16
+
+Copyright 2026 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+This is a single io_uring, shared by every socket and file that uses it. It is
+  driven with the raw syscalls, so there is no dependency on liburing.
+
+Listeners post one multishot accept, and sockets post one multishot receive,
+  which the kernel fills from a ring of provided buffers shared by all of them.
+  Sends go out as chains of linked SQEs, so that the kernel keeps them in
+  order. A thread waits on the completion queue, and hands each completion to
+  the driver that asked for it. Whatever that thread submits from inside a
+  callback goes to the kernel with its next wait, in the same syscall.
+
+At startup, the ring runs a multishot receive over a socketpair. If that (or
+  anything before it) fails, getInstance() returns nullptr from then on, and
+  the drivers stay with the reactor. enabled(false) does the same at runtime,
+  for new sockets, so that the two paths can be compared in one process.
+*/
+
+#include "../Linux.h"
+
+#if defined(CONFIG_C3P_IO_URING)
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+
+/*******************************************************************************
+*      _______.___________.    ___   .___________. __    ______     _______.
+*     /       |           |   /   \  |           ||  |  /      |   /       |
+*    |   (----`---|  |----`  /  ^  \ `---|  |----`|  | |  ,----'  |   (----`
+*     \   \       |  |      /  /_\  \    |  |     |  | |  |        \   \
+* .----)   |      |  |     /  _____  \   |  |     |  | |  `----.----)   |
+* |_______/       |__|    /__/     \__\  |__|     |__|  \______|_______/
+*
+* Static members and initializers should be located here.
+*******************************************************************************/
+
+#ifndef CONFIG_C3P_IO_URING_ENTRIES
+  // Depth of the submission queue. The completion queue is eight times this.
+  #define CONFIG_C3P_IO_URING_ENTRIES   256
+#endif
+
+#ifndef CONFIG_C3P_IO_URING_BUFS
+  // Provided receive buffers, shared by every socket. Must be a power of two.
+  #define CONFIG_C3P_IO_URING_BUFS      256
+#endif
+
+#ifndef CONFIG_C3P_IO_URING_BUF_SIZE
+  // Bytes per provided receive buffer.
+  #define CONFIG_C3P_IO_URING_BUF_SIZE  16384
+#endif
+
+#define C3P_URING_BGID  0   // Our buffer group.
+#define C3P_URING_CANCEL_TAG  1   // Set in user_data of a cancel. Ops are aligned, so the bit is free.
+
+/* One request made of the ring. May span several SQEs, and many CQEs. */
+struct LinuxUringOp {
+  UringCallback cb;
+  void*         arg;
+  int           fd;
+  uint16_t      pending;   // SQEs that have yet to post their last completion.
+  bool          sends;     // The kernel reads memory that the caller owns.
+  bool          accepts;   // Each completion is a new descriptor.
+  bool          dead;      // Cancelled. Completions are reaped, but not passed on.
+  bool          cancel_queued;   // An ASYNC_CANCEL for it is in the SQ. Counted in pending.
+  StringBuilder hold;      // That memory, if the caller went away first. See hold().
+};
+
+/* The kernel's shared rings, as mapped into our address space. */
+struct LinuxUringRings {
+  int                  ring_fd;
+  struct io_uring_params params;
+  uint8_t*             sq_map;
+  size_t               sq_map_len;
+  uint8_t*             cq_map;
+  size_t               cq_map_len;
+  struct io_uring_sqe* sqes;
+  size_t               sqes_len;
+  uint32_t*            sq_head;
+  uint32_t*            sq_tail;
+  uint32_t*            sq_array;
+  uint32_t             sq_mask;
+  uint32_t             sq_local_tail;   // SQEs filled in, but maybe not published.
+  uint32_t*            cq_head;
+  uint32_t*            cq_tail;
+  uint32_t             cq_mask;
+  struct io_uring_cqe* cqes;
+  struct io_uring_buf_ring* buf_ring;
+  size_t               buf_ring_len;
+  uint16_t             buf_tail;
+  bool                 buf_registered;
+  uint8_t*             bufs[CONFIG_C3P_IO_URING_BUFS];
+};
+
+/* What a blocking transfer() waits on. One slot per SQE. */
+struct LinuxUringWaiter {
+  uint32_t remaining;
+  int32_t  err;
+};
+
+struct LinuxUringSlot {
+  LinuxUringWaiter* waiter;
+  struct iovec*     iov;
+};
+
+static LinuxUring*     _uring_instance    = nullptr;
+static bool            _uring_unsupported = false;   // Set once the kernel has said no.
+static bool            _uring_enabled     = true;
+static bool            _uring_shut_down   = false;   // Set once by shutdown(). Never cleared.
+static pthread_mutex_t _uring_instance_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+static int _uring_futex_wait(uint32_t* addr, uint32_t expected) {
+  return (int) syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+static int _uring_futex_wake(uint32_t* addr) {
+  return (int) syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+
+/*
+* Completion of one SQE from transfer(). The byte count is written back into
+*   the iovec it came from.
+*/
+static int8_t _uring_transfer_cb(int32_t res, uint8_t* data, bool more, void* arg) {
+  LinuxUringSlot* slot = (LinuxUringSlot*) arg;
+  if (res < 0) {
+    slot->waiter->err = res;
+    slot->iov->iov_len = 0;
+  }
+  else {
+    slot->iov->iov_len = (size_t) res;
+  }
+  if (0 == __atomic_sub_fetch(&slot->waiter->remaining, 1, __ATOMIC_ACQ_REL)) {
+    _uring_futex_wake(&slot->waiter->remaining);
+  }
+  return 0;
+}
+
+
+/**
+* The body of the ring's thread. Submits whatever callbacks queued on the last
+*   pass, and waits for completions, in one syscall.
+*/
+void* LinuxUring::_thread_handler(void* arg) {
+  LinuxUring* self = (LinuxUring*) arg;
+  // Signals are the business of the main thread.
+  sigset_t set;
+  sigfillset(&set);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  self->_self = pthread_self();
+  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Started io_uring thread.");
+
+  while (__atomic_load_n(&self->_running, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&self->_mutex);
+    if (0 < self->_cancels_owed) {
+      // Cancels that didn't fit. The last pass will have made room.
+      self->_cancels_owed = 0;
+      for (int i = 0; i < self->_ops.size(); i++) {
+        LinuxUringOp* op = self->_ops.get(i);
+        if (op->dead && !op->cancel_queued) {
+          self->_queue_cancel(op);
+        }
+      }
+    }
+    const uint32_t TO_SUBMIT = self->_unsubmitted;
+    self->_unsubmitted = 0;
+    __atomic_store_n(self->_rings->sq_tail, self->_rings->sq_local_tail, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&self->_mutex);
+    if (0 > self->_enter(TO_SUBMIT, 1)) {
+      if ((EINTR != errno) && (EBUSY != errno) && (EAGAIN != errno)) {
+        c3p_log(LOG_LEV_ERROR, __PRETTY_FUNCTION__, "io_uring_enter() failed (%d).", errno);
+        break;
+      }
+    }
+    self->_reap();
+  }
+  c3p_log(LOG_LEV_DEBUG, __PRETTY_FUNCTION__, "Exiting io_uring thread...");
+  return nullptr;
+}
+
+
+/*******************************************************************************
+* Ring class
+*******************************************************************************/
+
+/**
+* Returns the ring, creating it and starting its thread on first use.
+*
+* @return the ring, or nullptr if the kernel can't support it, or if it has
+*   been switched off or shut down.
+*/
+LinuxUring* LinuxUring::getInstance() {
+  if (!__atomic_load_n(&_uring_enabled, __ATOMIC_ACQUIRE)) {
+    return nullptr;
+  }
+  if ((nullptr == __atomic_load_n(&_uring_instance, __ATOMIC_ACQUIRE)) && !_uring_unsupported) {
+    pthread_mutex_lock(&_uring_instance_mutex);
+    if ((nullptr == _uring_instance) && !_uring_unsupported && !_uring_shut_down) {
+      LinuxUring* nu = new LinuxUring();
+      const int8_t RET = nu->_start();
+      if (0 == RET) {
+        __atomic_store_n(&_uring_instance, nu, __ATOMIC_RELEASE);
+      }
+      else {
+        c3p_log(LOG_LEV_WARN, __PRETTY_FUNCTION__, "io_uring is not usable (%d). I/O will use the reactor.", RET);
+        _uring_unsupported = true;
+        delete nu;
+      }
+    }
+    pthread_mutex_unlock(&_uring_instance_mutex);
+  }
+  return __atomic_load_n(&_uring_instance, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+* Drivers keep their own pointer to the ring. Once this returns true, that
+*   pointer is (or is about to be) dangling, and must not be used. The kernel
+*   cancels whatever was in flight when the ring closed.
+*
+* @return true once shutdown() has begun.
+*/
+bool LinuxUring::stopped() {
+  return __atomic_load_n(&_uring_shut_down, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+* @return true if new sockets and files will be given the ring.
+*/
+bool LinuxUring::enabled() {
+  return (__atomic_load_n(&_uring_enabled, __ATOMIC_ACQUIRE) && !_uring_unsupported);
+}
+
+
+/**
+* Switches the ring on or off for sockets and files opened from now on. Those
+*   that already have it keep it until they close.
+*/
+void LinuxUring::enabled(bool x) {
+  __atomic_store_n(&_uring_enabled, x, __ATOMIC_RELEASE);
+}
+
+
+/**
+* Stops the ring's thread, if it was ever started. Called by the platform as it
+*   shuts down. Anything still in flight is cancelled by the kernel. This is
+*   terminal: getInstance() will return nullptr from then on.
+*/
+void LinuxUring::shutdown() {
+  pthread_mutex_lock(&_uring_instance_mutex);
+  LinuxUring* r = _uring_instance;
+  __atomic_store_n(&_uring_shut_down, true, __ATOMIC_RELEASE);
+  __atomic_store_n(&_uring_instance, (LinuxUring*) nullptr, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&_uring_instance_mutex);
+  if (nullptr != r) {
+    delete r;
+  }
+}
+
+
+LinuxUring::LinuxUring() {
+  pthread_mutex_init(&_mutex, nullptr);
+}
+
+
+LinuxUring::~LinuxUring() {
+  if (0 != _thread_id) {
+    __atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&_mutex);
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*) _get_sqe();
+    if (nullptr != sqe) {
+      sqe->opcode = IORING_OP_NOP;   // Wakes the thread. user_data is zero.
+    }
+    _submit();
+    pthread_mutex_unlock(&_mutex);
+    pthread_join((pthread_t) _thread_id, nullptr);
+    _thread_id = 0;
+  }
+  if (nullptr != _rings) {
+    if (0 <= _rings->ring_fd) {
+      ::close(_rings->ring_fd);   // Also drops the buffer registration.
+    }
+    if (nullptr != _rings->sqes) {
+      munmap(_rings->sqes, _rings->sqes_len);
+    }
+    if ((nullptr != _rings->cq_map) && (_rings->cq_map != _rings->sq_map)) {
+      munmap(_rings->cq_map, _rings->cq_map_len);
+    }
+    if (nullptr != _rings->sq_map) {
+      munmap(_rings->sq_map, _rings->sq_map_len);
+    }
+    if (nullptr != _rings->buf_ring) {
+      munmap(_rings->buf_ring, _rings->buf_ring_len);
+    }
+    for (int i = 0; i < CONFIG_C3P_IO_URING_BUFS; i++) {
+      if (nullptr != _rings->bufs[i]) {
+        free(_rings->bufs[i]);
+      }
+    }
+    delete _rings;
+    _rings = nullptr;
+  }
+  while (0 < _ops.size()) {
+    delete _ops.remove();
+  }
+  pthread_mutex_destroy(&_mutex);
+}
+
+
+/*
+* Sets up the rings, checks that the kernel has everything we use, registers
+*   the provided buffers, and starts the thread.
+*
+* @return 0 on success, or a negative step number on failure.
+*/
+int8_t LinuxUring::_start() {
+  _rings = new LinuxUringRings;
+  memset((void*) _rings, 0, sizeof(LinuxUringRings));
+  LinuxUringRings* r = _rings;
+  struct io_uring_params* p = &r->params;
+  p->flags      = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+  p->cq_entries = (CONFIG_C3P_IO_URING_ENTRIES * 8);
+  r->ring_fd = (int) syscall(__NR_io_uring_setup, CONFIG_C3P_IO_URING_ENTRIES, p);
+  if (r->ring_fd < 0) {
+    return -1;   // ENOSYS, or forbidden by seccomp or sysctl.
+  }
+  if (0 == (p->features & IORING_FEAT_NODROP)) {
+    return -2;   // Older than 5.5. Multishot would lose completions.
+  }
+
+  r->sq_map_len = p->sq_off.array + (p->sq_entries * sizeof(uint32_t));
+  r->cq_map_len = p->cq_off.cqes + (p->cq_entries * sizeof(struct io_uring_cqe));
+  if (p->features & IORING_FEAT_SINGLE_MMAP) {
+    r->sq_map_len = strict_max(r->sq_map_len, r->cq_map_len);
+  }
+  void* m = mmap(nullptr, r->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQ_RING);
+  if (MAP_FAILED == m) {
+    return -3;
+  }
+  r->sq_map = (uint8_t*) m;
+  if (p->features & IORING_FEAT_SINGLE_MMAP) {
+    r->cq_map = r->sq_map;
+  }
+  else {
+    m = mmap(nullptr, r->cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_CQ_RING);
+    if (MAP_FAILED == m) {
+      return -3;
+    }
+    r->cq_map = (uint8_t*) m;
+  }
+  r->sqes_len = p->sq_entries * sizeof(struct io_uring_sqe);
+  m = mmap(nullptr, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQES);
+  if (MAP_FAILED == m) {
+    return -3;
+  }
+  r->sqes     = (struct io_uring_sqe*) m;
+  r->sq_head  = (uint32_t*) (r->sq_map + p->sq_off.head);
+  r->sq_tail  = (uint32_t*) (r->sq_map + p->sq_off.tail);
+  r->sq_array = (uint32_t*) (r->sq_map + p->sq_off.array);
+  r->sq_mask  = *((uint32_t*) (r->sq_map + p->sq_off.ring_mask));
+  r->sq_local_tail = *(r->sq_tail);
+  r->cq_head  = (uint32_t*) (r->cq_map + p->cq_off.head);
+  r->cq_tail  = (uint32_t*) (r->cq_map + p->cq_off.tail);
+  r->cq_mask  = *((uint32_t*) (r->cq_map + p->cq_off.ring_mask));
+  r->cqes     = (struct io_uring_cqe*) (r->cq_map + p->cq_off.cqes);
+
+  // Every opcode we use must be known to the kernel.
+  const size_t PROBE_LEN = sizeof(struct io_uring_probe) + (256 * sizeof(struct io_uring_probe_op));
+  struct io_uring_probe* probe = (struct io_uring_probe*) calloc(1, PROBE_LEN);
+  if (nullptr == probe) {
+    return -4;
+  }
+  bool probe_ok = (0 == syscall(__NR_io_uring_register, r->ring_fd, IORING_REGISTER_PROBE, probe, 256));
+  const uint8_t NEEDED_OPS[] = {
+    IORING_OP_NOP, IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND,
+    IORING_OP_READ, IORING_OP_WRITE, IORING_OP_SPLICE, IORING_OP_ASYNC_CANCEL
+  };
+  for (uint8_t i = 0; probe_ok && (i < sizeof(NEEDED_OPS)); i++) {
+    const uint8_t OP = NEEDED_OPS[i];
+    probe_ok = (OP <= probe->last_op) && (probe->ops[OP].flags & IO_URING_OP_SUPPORTED);
+  }
+  free(probe);
+  if (!probe_ok) {
+    return -4;
+  }
+
+  // The provided buffers. The ring's memory must be page-aligned.
+  r->buf_ring_len = CONFIG_C3P_IO_URING_BUFS * sizeof(struct io_uring_buf);
+  m = mmap(nullptr, r->buf_ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == m) {
+    return -5;
+  }
+  r->buf_ring = (struct io_uring_buf_ring*) m;
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr    = (uint64_t) (uintptr_t) r->buf_ring;
+  reg.ring_entries = CONFIG_C3P_IO_URING_BUFS;
+  reg.bgid         = C3P_URING_BGID;
+  if (0 != syscall(__NR_io_uring_register, r->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+    return -5;   // Older than 5.19.
+  }
+  r->buf_registered = true;
+  for (uint16_t i = 0; i < CONFIG_C3P_IO_URING_BUFS; i++) {
+    r->bufs[i] = (uint8_t*) malloc(CONFIG_C3P_IO_URING_BUF_SIZE);
+    if (nullptr == r->bufs[i]) {
+      return -6;
+    }
+    _recycle(i, false);
+  }
+
+  const int8_t TEST_RET = _self_test();
+  if (0 != TEST_RET) {
+    return TEST_RET;
+  }
+
+  _running = true;
+  PlatformThreadOpts topts;
+  memset(&topts, 0, sizeof(topts));
+  topts.thread_name = (char*) "C3PUring";
+  if (0 != platform.createThread(&_thread_id, nullptr, LinuxUring::_thread_handler, (void*) this, &topts)) {
+    _thread_id = 0;
+    _running = false;
+    return -9;
+  }
+  return 0;
+}
+
+
+/*
+* The probe can't see operation flags, and multishot receive came after the
+*   opcodes did (6.0). So try one, over a socketpair, before the thread exists.
+*
+* @return 0 if the kernel behaved, or -7/-8 if not.
+*/
+int8_t LinuxUring::_self_test() {
+  int sv[2];
+  if (0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv)) {
+    return -7;
+  }
+  int8_t ret = -8;
+  struct io_uring_sqe* sqe = (struct io_uring_sqe*) _get_sqe();
+  sqe->opcode    = IORING_OP_RECV;
+  sqe->fd        = sv[0];
+  sqe->ioprio    = IORING_RECV_MULTISHOT;
+  sqe->flags     = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = C3P_URING_BGID;
+  sqe->user_data = 1;
+  _submit();
+  // Two completions: one byte, and then the end of the stream.
+  if (1 == ::write(sv[1], "", 1)) {
+    ::close(sv[1]);
+    int seen = 0;
+    bool more_ok = false;
+    while ((seen < 2) && (0 <= _enter(0, 1))) {
+      uint32_t head = *(_rings->cq_head);
+      while (head != __atomic_load_n(_rings->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe* cqe = &_rings->cqes[head & _rings->cq_mask];
+        if (0 == seen) {
+          more_ok = ((1 == cqe->res) && (cqe->flags & IORING_CQE_F_BUFFER) && (cqe->flags & IORING_CQE_F_MORE));
+        }
+        else if ((0 == cqe->res) && more_ok) {
+          ret = 0;
+        }
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+          _recycle((uint16_t) (cqe->flags >> IORING_CQE_BUFFER_SHIFT), false);
+        }
+        // Done after one, if the kernel rejected the flags.
+        seen += ((cqe->flags & IORING_CQE_F_MORE) ? 1 : 2);
+        head++;
+        __atomic_store_n(_rings->cq_head, head, __ATOMIC_RELEASE);
+      }
+    }
+  }
+  else {
+    ::close(sv[1]);
+  }
+  ::close(sv[0]);
+  _count_enter = 0;
+  _count_sqe   = 0;
+  return ret;
+}
+
+
+/*
+* Returns a zeroed SQE, or nullptr if the queue is full even after asking the
+*   kernel to take what is in it. Caller must hold the mutex, and call
+*   _submit() once the SQE is filled in.
+*/
+void* LinuxUring::_get_sqe() {
+  LinuxUringRings* r = _rings;
+  if ((r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE)) >= r->params.sq_entries) {
+    // Full. Only the ring thread leaves SQEs for later, so this is rare.
+    __atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+    const uint32_t TO_SUBMIT = _unsubmitted;
+    _unsubmitted = 0;
+    _enter(TO_SUBMIT, 0);
+    if ((r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE)) >= r->params.sq_entries) {
+      return nullptr;
+    }
+  }
+  const uint32_t IDX = (r->sq_local_tail & r->sq_mask);
+  struct io_uring_sqe* sqe = &r->sqes[IDX];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  r->sq_array[IDX] = IDX;
+  r->sq_local_tail++;
+  _unsubmitted++;
+  _count_sqe++;
+  return (void*) sqe;
+}
+
+
+/*
+* Publishes the SQEs filled in since the last call. The ring thread leaves them
+*   for its next wait. Any other thread hands them to the kernel at once.
+*   Caller must hold the mutex.
+*/
+int8_t LinuxUring::_submit() {
+  __atomic_store_n(_rings->sq_tail, _rings->sq_local_tail, __ATOMIC_RELEASE);
+  if ((0 == _unsubmitted) || onRingThread()) {
+    return 0;
+  }
+  const uint32_t TO_SUBMIT = _unsubmitted;
+  _unsubmitted = 0;
+  return ((0 <= _enter(TO_SUBMIT, 0)) ? 0 : -1);
+}
+
+
+int LinuxUring::_enter(uint32_t to_submit, uint32_t min_complete) {
+  __atomic_fetch_add(&_count_enter, 1, __ATOMIC_RELAXED);
+  const uint32_t FLAGS = ((0 < min_complete) ? IORING_ENTER_GETEVENTS : 0);
+  return (int) syscall(__NR_io_uring_enter, _rings->ring_fd, to_submit, min_complete, FLAGS, nullptr, 0);
+}
+
+
+/* Caller must hold the mutex. */
+LinuxUringOp* LinuxUring::_op_new(int fd, UringCallback cb, void* arg, uint16_t sqe_count) {
+  LinuxUringOp* op = new LinuxUringOp;
+  op->cb      = cb;
+  op->arg     = arg;
+  op->fd      = fd;
+  op->pending = sqe_count;
+  op->sends   = false;
+  op->accepts = false;
+  op->dead    = false;
+  op->cancel_queued = false;
+  _ops.insert(op);
+  return op;
+}
+
+
+/*
+* Puts a provided buffer back in the kernel's ring. If the callback kept the
+*   old one, a new one takes its place. Only the ring thread calls this, once
+*   the buffers are first registered.
+*/
+void LinuxUring::_recycle(uint16_t bid, bool replace) {
+  LinuxUringRings* r = _rings;
+  if (replace) {
+    r->bufs[bid] = (uint8_t*) malloc(CONFIG_C3P_IO_URING_BUF_SIZE);
+    if (nullptr == r->bufs[bid]) {
+      return;   // One fewer buffer.
+    }
+  }
+  // Not buf_ring->bufs[]. Under C++, the kernel header's flex-array wrapper
+  //   shifts it by a word, on top of the tail.
+  struct io_uring_buf* buf = ((struct io_uring_buf*) r->buf_ring) + (r->buf_tail & (CONFIG_C3P_IO_URING_BUFS - 1));
+  buf->addr = (uint64_t) (uintptr_t) r->bufs[bid];
+  buf->len  = CONFIG_C3P_IO_URING_BUF_SIZE;
+  buf->bid  = bid;
+  r->buf_tail++;
+  __atomic_store_n(&r->buf_ring->tail, r->buf_tail, __ATOMIC_RELEASE);
+}
+
+
+/*
+* Takes every completion that is waiting, and passes each to its op's callback.
+*   An op is freed with the last completion of its last SQE, counting the
+*   cancel, if one was queued. A dead op's completions are dropped, except that
+*   a descriptor from a dead accept is closed, since nobody else will.
+*/
+void LinuxUring::_reap() {
+  LinuxUringRings* r = _rings;
+  uint32_t head = *(r->cq_head);
+  while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe* cqe = &r->cqes[head & r->cq_mask];
+    const uint64_t USER_DATA = cqe->user_data;
+    const int32_t  RES       = cqe->res;
+    const uint32_t FLAGS     = cqe->flags;
+    head++;
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    _count_cqe++;
+    LinuxUringOp* op = (LinuxUringOp*) (uintptr_t) (USER_DATA & ~((uint64_t) C3P_URING_CANCEL_TAG));
+    if (nullptr == op) {
+      continue;   // A wakeup.
+    }
+    if (USER_DATA & C3P_URING_CANCEL_TAG) {
+      // The cancel itself is done. The op's own completions may still follow.
+      pthread_mutex_lock(&_mutex);
+      if (0 == --op->pending) {
+        _ops.remove(op);
+        delete op;
+      }
+      pthread_mutex_unlock(&_mutex);
+      continue;
+    }
+    const bool MORE = (0 != (FLAGS & IORING_CQE_F_MORE));
+    const uint16_t BID = (uint16_t) (FLAGS >> IORING_CQE_BUFFER_SHIFT);
+    uint8_t* data = ((FLAGS & IORING_CQE_F_BUFFER) ? r->bufs[BID] : nullptr);
+    if (-ENOBUFS == RES) {
+      _count_nobufs++;
+    }
+    // Publish what we are about to run before checking whether it was
+    //   cancelled. cancel() does the same in the opposite order.
+    __atomic_store_n(&_current_fd, op->fd, __ATOMIC_SEQ_CST);
+    int8_t kept = 0;
+    if (!__atomic_load_n(&op->dead, __ATOMIC_SEQ_CST)) {
+      kept = op->cb(RES, data, MORE, op->arg);
+    }
+    else if (op->accepts && (0 <= RES)) {
+      ::close(RES);
+    }
+    __atomic_store_n(&_current_fd, -1, __ATOMIC_SEQ_CST);
+    if (nullptr != data) {
+      _recycle(BID, (1 == kept));
+    }
+    if (!MORE) {
+      pthread_mutex_lock(&_mutex);
+      if (0 == --op->pending) {
+        _ops.remove(op);
+        delete op;
+      }
+      pthread_mutex_unlock(&_mutex);
+    }
+  }
+}
+
+
+/**
+* @return true if called from the ring's own thread (ie, from a callback).
+*/
+bool LinuxUring::onRingThread() {
+  return ((0 != _thread_id) && pthread_equal(pthread_self(), _self));
+}
+
+
+/**
+* Posts a multishot accept. The callback gets each new descriptor as res, and
+*   owns it. If more is false, the accept has stopped, and must be posted again.
+*
+* @return 0 on success, or -1 if the queue is full.
+*/
+int8_t LinuxUring::accept(int fd, UringCallback cb, void* arg) {
+  int8_t ret = -1;
+  pthread_mutex_lock(&_mutex);
+  struct io_uring_sqe* sqe = (struct io_uring_sqe*) _get_sqe();
+  if (nullptr != sqe) {
+    sqe->opcode       = IORING_OP_ACCEPT;
+    sqe->fd           = fd;
+    sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    LinuxUringOp* op  = _op_new(fd, cb, arg, 1);
+    op->accepts       = true;
+    sqe->user_data    = (uint64_t) (uintptr_t) op;
+    ret = _submit();
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+/**
+* Posts a multishot receive into the shared provided buffers. The callback is
+*   given each read, and is told of EOF with res == 0. If more is false, the
+*   receive has stopped (out of buffers, most likely), and must be posted again.
+*
+* @return 0 on success, or -1 if the queue is full.
+*/
+int8_t LinuxUring::recv(int fd, UringCallback cb, void* arg) {
+  int8_t ret = -1;
+  pthread_mutex_lock(&_mutex);
+  struct io_uring_sqe* sqe = (struct io_uring_sqe*) _get_sqe();
+  if (nullptr != sqe) {
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = fd;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = C3P_URING_BGID;
+    sqe->user_data = (uint64_t) (uintptr_t) _op_new(fd, cb, arg, 1);
+    ret = _submit();
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+/**
+* Sends a run of buffers, as one chain of linked SQEs. The kernel starts each
+*   send only once the last is complete, and MSG_WAITALL makes a short send
+*   fail, so that the rest of the chain is cancelled rather than reordered.
+*   The callback is called once per buffer, with the bytes sent, or an error
+*   (-ECANCELED for those after a failure). The memory must stay put until then.
+*
+* @return 0 on success, or -1 if the queue can't take the whole chain.
+*/
+int8_t LinuxUring::send(int fd, struct iovec* iov, int count, UringCallback cb, void* arg) {
+  if ((count <= 0) || (count > CONFIG_C3P_IO_URING_CHAIN)) {
+    return -1;
+  }
+  int8_t ret = -1;
+  pthread_mutex_lock(&_mutex);
+  LinuxUringRings* r = _rings;
+  if ((r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) + count) > r->params.sq_entries) {
+    _submit();   // A partial chain would link into whatever came next.
+  }
+  if ((r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) + count) <= r->params.sq_entries) {
+    LinuxUringOp* op = _op_new(fd, cb, arg, (uint16_t) count);
+    op->sends = true;
+    for (int i = 0; i < count; i++) {
+      struct io_uring_sqe* sqe = (struct io_uring_sqe*) _get_sqe();
+      sqe->opcode    = IORING_OP_SEND;
+      sqe->fd        = fd;
+      sqe->addr      = (uint64_t) (uintptr_t) iov[i].iov_base;
+      sqe->len       = (uint32_t) iov[i].iov_len;
+      sqe->msg_flags = (MSG_WAITALL | MSG_NOSIGNAL);
+      sqe->flags     = ((i < (count - 1)) ? IOSQE_IO_LINK : 0);
+      sqe->user_data = (uint64_t) (uintptr_t) op;
+    }
+    ret = _submit();
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+/**
+* Moves up to len bytes from fd_in to fd_out without them passing through
+*   userspace. One of the two must be a pipe. off_in is the offset to read
+*   fd_in at, or -1 if it is a pipe. The op is filed under fd, so that
+*   cancel(fd) takes it down with everything else on that descriptor. The
+*   callback gets the bytes moved, or an error.
+*
+* @return 0 on success, or -1 if the queue is full.
+*/
+int8_t LinuxUring::splice(int fd, int fd_in, int64_t off_in, int fd_out, uint32_t len, UringCallback cb, void* arg) {
+  int8_t ret = -1;
+  pthread_mutex_lock(&_mutex);
+  struct io_uring_sqe* sqe = (struct io_uring_sqe*) _get_sqe();
+  if (nullptr != sqe) {
+    sqe->opcode        = IORING_OP_SPLICE;
+    sqe->fd            = fd_out;
+    sqe->off           = (uint64_t) -1;
+    sqe->splice_fd_in  = fd_in;
+    sqe->splice_off_in = (uint64_t) off_in;
+    sqe->len           = len;
+    sqe->splice_flags  = SPLICE_F_MOVE;
+    sqe->user_data     = (uint64_t) (uintptr_t) _op_new(fd, cb, arg, 1);
+    ret = _submit();
+  }
+  pthread_mutex_unlock(&_mutex);
+  return ret;
+}
+
+
+/**
+* Reads or writes a run of buffers at consecutive offsets in a file, in one
+*   submission, and blocks until all of them are done. Each iovec's length is
+*   replaced by the bytes that it actually moved. Not for the ring's thread.
+*
+* @return the total bytes moved, or a negative errno.
+*/
+int32_t LinuxUring::transfer(int fd, bool write, struct iovec* iov, int count, uint64_t offset) {
+  if ((count <= 0) || (count > CONFIG_C3P_IO_URING_CHAIN) || onRingThread()) {
+    return -EINVAL;
+  }
+  LinuxUringWaiter waiter;
+  LinuxUringSlot   slots[CONFIG_C3P_IO_URING_CHAIN];
+  waiter.remaining = 0;
+  waiter.err       = 0;
+  pthread_mutex_lock(&_mutex);
+  for (int i = 0; i < count; i++) {
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*) _get_sqe();
+    if (nullptr == sqe) {
+      break;   // Do what was queued, and report short.
+    }
+    slots[i].waiter = &waiter;
+    slots[i].iov    = &iov[i];
+    sqe->opcode     = (write ? IORING_OP_WRITE : IORING_OP_READ);
+    sqe->fd         = fd;
+    sqe->addr       = (uint64_t) (uintptr_t) iov[i].iov_base;
+    sqe->len        = (uint32_t) iov[i].iov_len;
+    sqe->off        = offset;
+    sqe->user_data  = (uint64_t) (uintptr_t) _op_new(fd, _uring_transfer_cb, (void*) &slots[i], 1);
+    offset += iov[i].iov_len;
+    waiter.remaining++;
+  }
+  for (int i = waiter.remaining; i < count; i++) {
+    iov[i].iov_len = 0;
+  }
+  _submit();
+  pthread_mutex_unlock(&_mutex);
+
+  uint32_t remaining = __atomic_load_n(&waiter.remaining, __ATOMIC_ACQUIRE);
+  while (0 < remaining) {
+    _uring_futex_wait(&waiter.remaining, remaining);
+    remaining = __atomic_load_n(&waiter.remaining, __ATOMIC_ACQUIRE);
+  }
+  if (0 != waiter.err) {
+    return waiter.err;
+  }
+  int32_t ret = 0;
+  for (int i = 0; i < count; i++) {
+    ret += (int32_t) iov[i].iov_len;
+  }
+  return ret;
+}
+
+
+/**
+* Cancels everything in flight on the given fd. Once this returns, none of its
+*   callbacks are running, or will run again, so the caller may close the fd
+*   and free the callbacks' argument. May be called from a callback.
+*
+* @return the number of ops cancelled.
+*/
+int8_t LinuxUring::cancel(int fd) {
+  if (fd < 0) {
+    return 0;
+  }
+  int8_t ret = 0;
+  int8_t found = 0;
+  do {
+    // A callback that was running may have posted a new op, so go again
+    //   until a pass finds nothing.
+    found = 0;
+    pthread_mutex_lock(&_mutex);
+    for (int i = 0; i < _ops.size(); i++) {
+      LinuxUringOp* op = _ops.get(i);
+      if ((fd == op->fd) && !op->dead) {
+        __atomic_store_n(&op->dead, true, __ATOMIC_SEQ_CST);
+        _queue_cancel(op);
+        found++;
+      }
+    }
+    _submit();
+    pthread_mutex_unlock(&_mutex);
+    ret += found;
+    if (!onRingThread()) {
+      // Wait out a callback that might have started before we marked it dead,
+      //   or that marked it dead itself, and is still running.
+      while (fd == __atomic_load_n(&_current_fd, __ATOMIC_SEQ_CST)) {
+        sched_yield();
+      }
+    }
+  } while ((0 < found) && !onRingThread());
+  return ret;
+}
+
+
+/*
+* Asks the kernel to stop an op that is already marked dead. The op is kept
+*   until the cancel completes, so that its address can't be reused by a new
+*   op before the kernel has matched it. If the SQ is full even after a flush,
+*   the ring thread queues the cancel before its next wait. Caller must hold
+*   the mutex.
+*/
+void LinuxUring::_queue_cancel(LinuxUringOp* op) {
+  struct io_uring_sqe* sqe = (struct io_uring_sqe*) _get_sqe();
+  if (nullptr == sqe) {
+    _cancels_owed++;
+    return;
+  }
+  sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+  sqe->fd           = -1;
+  sqe->addr         = (uint64_t) (uintptr_t) op;
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+  sqe->user_data    = ((uint64_t) (uintptr_t) op) | C3P_URING_CANCEL_TAG;
+  op->cancel_queued = true;
+  op->pending++;
+}
+
+
+/**
+* After cancel(), the kernel may still be reading memory that was handed to
+*   send(). This keeps the buffer's contents until it is done with them, and
+*   leaves the buffer empty. If no send is left in flight, it is left alone.
+*/
+void LinuxUring::hold(int fd, StringBuilder* buf) {
+  pthread_mutex_lock(&_mutex);
+  for (int i = 0; i < _ops.size(); i++) {
+    LinuxUringOp* op = _ops.get(i);
+    if ((fd == op->fd) && op->dead && op->sends) {
+      op->hold.concatHandoff(buf);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+
+void LinuxUring::printDebug(StringBuilder* output) {
+  StringBuilder::styleHeader1(output, (char*) "io_uring");
+  output->concatf("\tEnabled:\t%c\n", (enabled() ? 'y' : 'n'));
+  output->concatf("\tSQ/CQ depth:\t%u / %u\n", _rings->params.sq_entries, _rings->params.cq_entries);
+  output->concatf("\tRX buffers:\t%u x %u bytes (%u times empty)\n", CONFIG_C3P_IO_URING_BUFS, CONFIG_C3P_IO_URING_BUF_SIZE, _count_nobufs);
+  output->concatf("\tSyscalls:\t%u\n", _count_enter);
+  output->concatf("\tSQEs / CQEs:\t%u / %u\n", _count_sqe, _count_cqe);
+  pthread_mutex_lock(&_mutex);
+  output->concatf("\tOps in flight:\t%d\n", _ops.size());
+  pthread_mutex_unlock(&_mutex);
+}
+
+#endif  // CONFIG_C3P_IO_URING